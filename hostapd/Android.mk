@@ -157,12 +157,21 @@ ifdef CONFIG_ELOOP_EPOLL
 L_CFLAGS += -DCONFIG_ELOOP_EPOLL
 endif
 
+ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+L_CFLAGS += -DCONFIG_ELOOP_TIMEOUT_HEAP
+endif
+
+ifdef CONFIG_ELOOP_WORKERS
+L_CFLAGS += -DCONFIG_ELOOP_WORKERS
+endif
+
 OBJS += src/utils/common.c
 OBJS += src/utils/wpa_debug.c
 OBJS += src/utils/wpabuf.c
 OBJS += src/utils/os_$(CONFIG_OS).c
 OBJS += src/utils/ip_addr.c
 OBJS += src/utils/crc32.c
+OBJS += src/utils/addr_hash.c
 
 OBJS += src/common/ieee802_11_common.c
 OBJS += src/common/wpa_common.c
@@ -878,6 +887,7 @@ endif
 ifneq ($(CONFIG_TLS), openssl)
 SHA1OBJS += src/crypto/sha1-pbkdf2.c
 endif
+SHA1OBJS += src/crypto/sha1-pbkdf2-batch.c
 ifdef NEED_T_PRF
 SHA1OBJS += src/crypto/sha1-tprf.c
 endif
@@ -1097,6 +1107,10 @@ ifdef CONFIG_NO_STDOUT_DEBUG
 L_CFLAGS += -DCONFIG_NO_STDOUT_DEBUG
 endif
 
+ifdef CONFIG_DEBUG_MIN_LEVEL
+L_CFLAGS += -DWPA_DEBUG_MIN_LEVEL=$(CONFIG_DEBUG_MIN_LEVEL)
+endif
+
 ifdef CONFIG_DEBUG_SYSLOG
 L_CFLAGS += -DCONFIG_DEBUG_SYSLOG
 endif
@@ -1109,6 +1123,11 @@ ifdef CONFIG_DEBUG_FILE
 L_CFLAGS += -DCONFIG_DEBUG_FILE
 endif
 
+ifdef CONFIG_DEBUG_BINLOG
+L_CFLAGS += -DCONFIG_DEBUG_BINLOG
+OBJS += src/utils/wpa_debug_binlog.c
+endif
+
 ifdef CONFIG_ANDROID_LOG
 L_CFLAGS += -DCONFIG_ANDROID_LOG
 endif
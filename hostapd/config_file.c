@@ -613,6 +613,8 @@ static int hostapd_config_read_eap_user(const char *fname,
 	fclose(f);
 
 	if (ret == 0) {
+		hostapd_eap_user_index_free(conf);
+		conf->eap_user_index_failed = 0;
 		hostapd_config_free_eap_users(conf->eap_user);
 		conf->eap_user = new_user;
 	} else {
@@ -2480,6 +2482,20 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 	} else if (os_strcmp(buf, "eap_user_file") == 0) {
 		if (hostapd_config_read_eap_user(pos, bss))
 			return 1;
+	} else if (os_strcmp(buf, "eap_user_sqlite_cache_size") == 0) {
+		bss->eap_user_sqlite_cache_size = atoi(pos);
+	} else if (os_strcmp(buf, "eap_user_sqlite_cache_ttl") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid eap_user_sqlite_cache_ttl %d",
+				   line, val);
+			return 1;
+		}
+		bss->eap_user_sqlite_cache_ttl = val;
+	} else if (os_strcmp(buf, "eap_user_sqlite_async") == 0) {
+		bss->eap_user_sqlite_async = atoi(pos);
 	} else if (os_strcmp(buf, "ca_cert") == 0) {
 		os_free(bss->ca_cert);
 		bss->ca_cert = os_strdup(pos);
@@ -2519,6 +2535,11 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->crl_reload_interval = atoi(pos);
 	} else if (os_strcmp(buf, "tls_session_lifetime") == 0) {
 		bss->tls_session_lifetime = atoi(pos);
+	} else if (os_strcmp(buf, "tls_session_cache_size") == 0) {
+		bss->tls_session_cache_size = atoi(pos);
+	} else if (os_strcmp(buf, "tls_session_cache_file") == 0) {
+		os_free(bss->tls_session_cache_file);
+		bss->tls_session_cache_file = os_strdup(pos);
 	} else if (os_strcmp(buf, "tls_flags") == 0) {
 		bss->tls_flags = parse_tls_flags(pos);
 	} else if (os_strcmp(buf, "max_auth_rounds") == 0) {
@@ -2781,6 +2802,26 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->radius->acct_server->shared_secret_len = len;
 	} else if (os_strcmp(buf, "radius_retry_primary_interval") == 0) {
 		bss->radius->retry_primary_interval = atoi(pos);
+	} else if (os_strcmp(buf, "radius_client_sockets") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1 || val > 16) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid radius_client_sockets %d (1..16)",
+				   line, val);
+			return 1;
+		}
+		bss->radius->num_client_socks = val;
+	} else if (os_strcmp(buf, "radius_client_max_pending") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid radius_client_max_pending %d",
+				   line, val);
+			return 1;
+		}
+		bss->radius->max_pending = val;
 	} else if (os_strcmp(buf, "radius_acct_interim_interval") == 0) {
 		bss->acct_interim_interval = atoi(pos);
 	} else if (os_strcmp(buf, "radius_request_cui") == 0) {
@@ -3095,6 +3136,16 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->radius_server_acct_port = atoi(pos);
 	} else if (os_strcmp(buf, "radius_server_ipv6") == 0) {
 		bss->radius_server_ipv6 = atoi(pos);
+	} else if (os_strcmp(buf, "radius_server_max_sessions") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1 || val > 1000000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid radius_server_max_sessions %d",
+				   line, val);
+			return 1;
+		}
+		bss->radius_server_max_sessions = val;
 #endif /* RADIUS_SERVER */
 	} else if (os_strcmp(buf, "use_pae_group_addr") == 0) {
 		bss->use_pae_group_addr = atoi(pos);
@@ -3319,6 +3370,36 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->ignore_broadcast_ssid = atoi(pos);
 	} else if (os_strcmp(buf, "no_probe_resp_if_max_sta") == 0) {
 		bss->no_probe_resp_if_max_sta = atoi(pos);
+	} else if (os_strcmp(buf, "probe_resp_rate_limit") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 100000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid probe_resp_rate_limit %d",
+				   line, val);
+			return 1;
+		}
+		bss->probe_resp_rate_limit = val;
+	} else if (os_strcmp(buf, "probe_resp_rate_burst") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 100000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid probe_resp_rate_burst %d",
+				   line, val);
+			return 1;
+		}
+		bss->probe_resp_rate_burst = val;
+	} else if (os_strcmp(buf, "probe_resp_dedup_time") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 60000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid probe_resp_dedup_time %d",
+				   line, val);
+			return 1;
+		}
+		bss->probe_resp_dedup_time = val;
 #ifdef CONFIG_WEP
 	} else if (os_strcmp(buf, "wep_default_key") == 0) {
 		bss->ssid.wep.idx = atoi(pos);
@@ -4283,6 +4364,36 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->sae_anti_clogging_threshold = atoi(pos);
 	} else if (os_strcmp(buf, "sae_sync") == 0) {
 		bss->sae_sync = atoi(pos);
+	} else if (os_strcmp(buf, "sae_commit_queue_max") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1 || val > 10000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid sae_commit_queue_max value '%s'",
+				   line, pos);
+			return 1;
+		}
+		bss->sae_commit_queue_max = val;
+	} else if (os_strcmp(buf, "sae_commit_queue_delay") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 1000000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid sae_commit_queue_delay value '%s'",
+				   line, pos);
+			return 1;
+		}
+		bss->sae_commit_queue_delay = val;
+	} else if (os_strcmp(buf, "sae_commit_workers") == 0) {
+		int val = atoi(pos);
+
+		if (val < -1 || val > 64) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid sae_commit_workers value '%s'",
+				   line, pos);
+			return 1;
+		}
+		bss->sae_commit_workers = val;
 	} else if (os_strcmp(buf, "sae_groups") == 0) {
 		if (hostapd_parse_intlist(&bss->sae_groups, pos)) {
 			wpa_printf(MSG_ERROR,
@@ -4296,6 +4407,9 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->sae_confirm_immediate = atoi(pos);
 	} else if (os_strcmp(buf, "sae_pwe") == 0) {
 		bss->sae_pwe = atoi(pos);
+	} else if (os_strcmp(buf, "sae_pt_cache_file") == 0) {
+		os_free(bss->sae_pt_cache_file);
+		bss->sae_pt_cache_file = os_strdup(pos);
 	} else if (os_strcmp(buf, "local_pwr_constraint") == 0) {
 		int val = atoi(pos);
 		if (val < 0 || val > 255) {
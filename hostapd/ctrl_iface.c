@@ -38,6 +38,9 @@
 #endif /* CONFIG_DPP */
 #include "common/wpa_ctrl.h"
 #include "common/ptksa_cache.h"
+#ifdef CONFIG_SAE
+#include "common/sae.h"
+#endif /* CONFIG_SAE */
 #include "crypto/tls.h"
 #include "drivers/driver.h"
 #include "eapol_auth/eapol_auth_sm.h"
@@ -1662,11 +1665,14 @@ hostapd_ctrl_iface_kick_mismatch_psk_sta_iter(struct hostapd_data *hapd,
 static int hostapd_ctrl_iface_reload_wpa_psk(struct hostapd_data *hapd)
 {
 	struct hostapd_bss_config *conf = hapd->conf;
+	struct hostapd_wpa_psk *prev = conf->ssid.wpa_psk;
 	int err;
 
-	hostapd_config_clear_wpa_psk(&conf->ssid.wpa_psk);
-
-	err = hostapd_setup_wpa_psk(conf);
+	/* Keep the old entries around so that PBKDF2 is needed only for
+	 * passphrases that were added or changed */
+	conf->ssid.wpa_psk = NULL;
+	err = hostapd_setup_wpa_psk_reuse(conf, prev);
+	hostapd_config_clear_wpa_psk(&prev);
 	if (err < 0) {
 		wpa_printf(MSG_ERROR, "Reloading WPA-PSK passwords failed: %d",
 			   err);
@@ -2892,8 +2898,10 @@ static int hostapd_ctrl_iface_log_level(struct hostapd_data *hapd, char *cmd,
 	char *pos, *end, *stamp;
 	int ret;
 
-	/* cmd: "LOG_LEVEL [<level>]" */
+	/* cmd: "LOG_LEVEL [<level>]" or "LOG_LEVEL <module>=<level>" */
 	if (*cmd == '\0') {
+		int module;
+
 		pos = buf;
 		end = buf + buflen;
 		ret = os_snprintf(pos, end - pos, "Current level: %s\n"
@@ -2901,14 +2909,48 @@ static int hostapd_ctrl_iface_log_level(struct hostapd_data *hapd, char *cmd,
 				  debug_level_str(wpa_debug_level),
 				  wpa_debug_timestamp);
 		if (os_snprintf_error(end - pos, ret))
-			ret = 0;
+			return 0;
+		pos += ret;
 
-		return ret;
+		for (module = 0; module < NUM_WPA_DEBUG_MODULES; module++) {
+			int level = wpa_debug_get_module_level(module);
+
+			if (level < 0)
+				continue;
+			ret = os_snprintf(pos, end - pos, "Module %s: %s\n",
+					  wpa_debug_module_str(module),
+					  debug_level_str(level));
+			if (os_snprintf_error(end - pos, ret))
+				break;
+			pos += ret;
+		}
+
+		return pos - buf;
 	}
 
 	while (*cmd == ' ')
 		cmd++;
 
+	if (os_strchr(cmd, '=')) {
+		char *val = os_strchr(cmd, '=');
+		int module, level;
+
+		*val++ = '\0';
+		module = wpa_debug_module_from_str(cmd);
+		if (module < 0)
+			return -1;
+		if (os_strcasecmp(val, "DEFAULT") == 0) {
+			level = -1;
+		} else {
+			level = str_to_debug_level(val);
+			if (level < 0)
+				return -1;
+		}
+		wpa_debug_set_module_level(module, level);
+		os_memcpy(buf, "OK\n", 3);
+		return 3;
+	}
+
 	stamp = os_strchr(cmd, ' ');
 	if (stamp) {
 		*stamp++ = '\0';
@@ -3672,11 +3714,29 @@ static int hostapd_ctrl_iface_receive_process(struct hostapd_data *hapd,
 	} else if (os_strcmp(buf, "PMKSA") == 0) {
 		reply_len = hostapd_ctrl_iface_pmksa_list(hapd, reply,
 							  reply_size);
+	} else if (os_strcmp(buf, "HASH_STATS") == 0) {
+		reply_len = hostapd_ctrl_iface_hash_stats(hapd, reply,
+							  reply_size);
 	} else if (os_strcmp(buf, "PMKSA_FLUSH") == 0) {
 		hostapd_ctrl_iface_pmksa_flush(hapd);
 	} else if (os_strncmp(buf, "PMKSA_ADD ", 10) == 0) {
 		if (hostapd_ctrl_iface_pmksa_add(hapd, buf + 10) < 0)
 			reply_len = -1;
+#ifdef CONFIG_SAE
+	} else if (os_strcmp(buf, "SAE_PT_CACHE") == 0) {
+		reply_len = sae_pt_cache_status(reply, reply_size);
+	} else if (os_strcmp(buf, "SAE_PT_CACHE_FLUSH") == 0) {
+		sae_pt_cache_flush();
+#endif /* CONFIG_SAE */
+	} else if (os_strcmp(buf, "TLS_SESSION_CACHE") == 0) {
+		reply_len = tls_get_session_cache_status(hapd->ssl_ctx, reply,
+							 reply_size);
+	} else if (os_strcmp(buf, "TLS_CERT_STORE") == 0) {
+		reply_len = tls_get_cert_store_status(hapd->ssl_ctx, reply,
+						      reply_size);
+	} else if (os_strcmp(buf, "TLS_OCSP_STAPLING") == 0) {
+		reply_len = tls_get_ocsp_stapling_status(hapd->ssl_ctx, reply,
+							 reply_size);
 	} else if (os_strncmp(buf, "SET_NEIGHBOR ", 13) == 0) {
 		if (hostapd_ctrl_iface_set_neighbor(hapd, buf + 13))
 			reply_len = -1;
@@ -4111,6 +4171,7 @@ try_again:
 
 	hapd->msg_ctx = hapd;
 	wpa_msg_register_cb(hostapd_ctrl_iface_msg_cb);
+	ctrl_iface_update_msg_level();
 
 	return 0;
 
@@ -4258,6 +4319,7 @@ fail:
 	}
 	hapd->msg_ctx = hapd;
 	wpa_msg_register_cb(hostapd_ctrl_iface_msg_cb);
+	ctrl_iface_update_msg_level();
 
 	return 0;
 
@@ -4275,8 +4337,6 @@ fail:
 
 void hostapd_ctrl_iface_deinit(struct hostapd_data *hapd)
 {
-	struct wpa_ctrl_dst *dst, *prev;
-
 	if (hapd->ctrl_sock > -1) {
 #ifndef CONFIG_CTRL_IFACE_UDP
 		char *fname;
@@ -4307,9 +4367,7 @@ void hostapd_ctrl_iface_deinit(struct hostapd_data *hapd)
 #endif /* !CONFIG_CTRL_IFACE_UDP */
 	}
 
-	dl_list_for_each_safe(dst, prev, &hapd->ctrl_dst, struct wpa_ctrl_dst,
-			      list)
-		os_free(dst);
+	ctrl_iface_free_dsts(&hapd->ctrl_dst);
 
 #ifdef CONFIG_TESTING_OPTIONS
 	l2_packet_deinit(hapd->l2_test);
@@ -4425,6 +4483,7 @@ hostapd_global_ctrl_iface_fst_detach(struct hapd_interfaces *interfaces,
 			if (!fst_iface_detach(ifname)) {
 				hapd->iface->fst = NULL;
 				hapd->iface->fst_ies = NULL;
+				hostapd_probe_resp_tmpl_flush(hapd);
 				return 0;
 			}
 		}
@@ -4894,6 +4953,7 @@ try_again:
 	}
 
 	wpa_msg_register_cb(hostapd_ctrl_iface_msg_cb);
+	ctrl_iface_update_msg_level();
 
 	return 0;
 
@@ -4998,6 +5058,7 @@ fail:
 				 interface, NULL);
 
 	wpa_msg_register_cb(hostapd_ctrl_iface_msg_cb);
+	ctrl_iface_update_msg_level();
 
 	return 0;
 
@@ -5018,8 +5079,6 @@ void hostapd_global_ctrl_iface_deinit(struct hapd_interfaces *interfaces)
 #ifndef CONFIG_CTRL_IFACE_UDP
 	char *fname = NULL;
 #endif /* CONFIG_CTRL_IFACE_UDP */
-	struct wpa_ctrl_dst *dst, *prev;
-
 	if (interfaces->global_ctrl_sock > -1) {
 		eloop_unregister_read_sock(interfaces->global_ctrl_sock);
 		close(interfaces->global_ctrl_sock);
@@ -5050,9 +5109,7 @@ void hostapd_global_ctrl_iface_deinit(struct hapd_interfaces *interfaces)
 	os_free(interfaces->global_iface_path);
 	interfaces->global_iface_path = NULL;
 
-	dl_list_for_each_safe(dst, prev, &interfaces->global_ctrl_dst,
-			      struct wpa_ctrl_dst, list)
-		os_free(dst);
+	ctrl_iface_free_dsts(&interfaces->global_ctrl_dst);
 }
 
 
@@ -7,12 +7,1461 @@
  */
 
 #include "utils/includes.h"
+#ifdef CONFIG_SQLITE
+#include <sqlite3.h>
+#endif /* CONFIG_SQLITE */
 
 #include "utils/common.h"
 #include "utils/module_tests.h"
+#include "common/ieee802_11_defs.h"
+#include "eapol_auth/eapol_auth_sm.h"
+#include "drivers/driver.h"
+#include "ap/hostapd.h"
+#include "ap/ap_config.h"
+#include "ap/beacon.h"
+#include "ap/pmksa_cache_auth.h"
+#include "ap/sta_info.h"
+#include "ap/ieee802_11.h"
+#include "common/sae.h"
+#include "utils/eloop.h"
+#include "radius/radius.h"
+#include "radius/radius_client.h"
+#include "radius/radius_server.h"
+#include "eap_common/eap_defs.h"
+#include "ap/authsrv.h"
+
+
+static const u8 * wpa_psk_list_get(const struct hostapd_bss_config *conf,
+				   const u8 *addr, const u8 *prev_psk)
+{
+	struct hostapd_wpa_psk *psk;
+	int next_ok = prev_psk == NULL;
+
+	/* Reference implementation: search through the full list */
+	for (psk = conf->ssid.wpa_psk; psk; psk = psk->next) {
+		if (next_ok &&
+		    (psk->group || os_memcmp(psk->addr, addr, ETH_ALEN) == 0))
+			return psk->psk;
+		if (psk->psk == prev_psk)
+			next_ok = 1;
+	}
+
+	return NULL;
+}
+
+
+static int wpa_psk_cmp_list(const struct hostapd_bss_config *conf,
+			    const u8 *addr)
+{
+	const u8 *psk = NULL, *ref = NULL;
+	int count = 0;
+
+	do {
+		psk = hostapd_get_psk(conf, addr, NULL, psk, NULL);
+		ref = wpa_psk_list_get(conf, addr, ref);
+		if (psk != ref)
+			return -1;
+		count++;
+	} while (psk);
+
+	return count - 1;
+}
+
+
+static int wpa_psk_file_tests(void)
+{
+#ifndef CONFIG_NATIVE_WINDOWS
+	const char *fname = "/tmp/hapd_wpa_psk_module_test";
+	struct hostapd_bss_config *conf;
+	struct hostapd_wpa_psk *prev = NULL, *psk;
+	struct os_reltime start, end;
+	const unsigned int num = 2000, num_pw = 20;
+	unsigned int i;
+	u8 addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	u8 pmk[PMK_LEN];
+	FILE *f;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "wpa_psk_file tests");
+
+	conf = os_zalloc(sizeof(*conf));
+	if (!conf)
+		return -1;
+	hostapd_config_defaults_bss(conf);
+	conf->wpa_key_mgmt = WPA_KEY_MGMT_PSK;
+	os_memcpy(conf->ssid.ssid, "test", 4);
+	conf->ssid.ssid_len = 4;
+	conf->ssid.wpa_psk_file = os_strdup(fname);
+
+	f = fopen(fname, "w");
+	if (!f || !conf->ssid.wpa_psk_file)
+		goto fail;
+	fprintf(f, "00:00:00:00:00:00 wildcard passphrase\n");
+	for (i = 0; i < num; i++) {
+		addr[4] = i >> 8;
+		addr[5] = i;
+		if (i < num_pw)
+			fprintf(f, "vlanid=%u " MACSTR " passphrase %u\n",
+				i + 1, MAC2STR(addr), i);
+		else
+			fprintf(f, MACSTR " %064x\n", MAC2STR(addr), i);
+	}
+	/* Second PSK for the same STA */
+	fprintf(f, "02:00:00:00:00:05 %064x\n", 0x12345);
+	/* Same passphrase as for 02:00:00:00:00:00 */
+	fprintf(f, "02:00:00:00:fe:fe passphrase 0\n");
+	fclose(f);
+
+	os_get_reltime(&start);
+	if (hostapd_setup_wpa_psk(conf) < 0)
+		goto fail;
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &end);
+	wpa_printf(MSG_INFO, "wpa_psk_file: initial read in %u.%06u s",
+		   (unsigned int) end.sec, (unsigned int) end.usec);
+
+	addr[4] = 0xfe;
+	addr[5] = 0xfe;
+	os_memcpy(pmk, hostapd_get_psk(conf, addr, NULL, NULL, NULL),
+		  PMK_LEN);
+	addr[4] = 0;
+	addr[5] = 0;
+	if (os_memcmp(hostapd_get_psk(conf, addr, NULL, NULL, NULL), pmk,
+		      PMK_LEN) != 0)
+		goto fail;
+
+	for (i = 0; i < num + 2; i++) {
+		int vlan_id;
+
+		addr[4] = i >> 8;
+		addr[5] = i;
+		/* STA-specific entries first, then the wildcard entry */
+		if (wpa_psk_cmp_list(conf, addr) !=
+		    (i < num ? 2 : 1) + (i == 5))
+			goto fail;
+		if (!hostapd_get_psk(conf, addr, NULL, NULL, &vlan_id) ||
+		    vlan_id != (int) (i < num_pw && i != 5 ? i + 1 : 0))
+			goto fail;
+	}
+
+	/* Incremental reload: only the modified passphrase needs PBKDF2 */
+	addr[4] = 0;
+	addr[5] = 3;
+	os_memcpy(pmk, hostapd_get_psk(conf, addr, NULL, NULL, NULL),
+		  PMK_LEN);
+	f = fopen(fname, "a");
+	if (!f)
+		goto fail;
+	fprintf(f, "02:00:00:00:ff:ff new passphrase\n");
+	fclose(f);
+
+	prev = conf->ssid.wpa_psk;
+	conf->ssid.wpa_psk = NULL;
+	os_get_reltime(&start);
+	if (hostapd_setup_wpa_psk_reuse(conf, prev) < 0)
+		goto fail;
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &end);
+	wpa_printf(MSG_INFO, "wpa_psk_file: reload in %u.%06u s",
+		   (unsigned int) end.sec, (unsigned int) end.usec);
+	hostapd_config_clear_wpa_psk(&prev);
+
+	if (os_memcmp(hostapd_get_psk(conf, addr, NULL, NULL, NULL), pmk,
+		      PMK_LEN) != 0)
+		goto fail;
+	addr[4] = 0xff;
+	addr[5] = 0xff;
+	if (wpa_psk_cmp_list(conf, addr) != 2)
+		goto fail;
+
+	/* Modified list without an index update uses the full list */
+	psk = os_zalloc(sizeof(*psk));
+	if (!psk)
+		goto fail;
+	os_memcpy(psk->addr, addr, ETH_ALEN);
+	psk->next = conf->ssid.wpa_psk;
+	conf->ssid.wpa_psk = psk;
+	if (wpa_psk_cmp_list(conf, addr) != 3)
+		goto fail;
+	hostapd_wpa_psk_index_update(&conf->ssid);
+	if (wpa_psk_cmp_list(conf, addr) != 3)
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "wpa_psk_file module test failure");
+	unlink(fname);
+	hostapd_config_free_bss(conf);
+	return ret;
+#else /* CONFIG_NATIVE_WINDOWS */
+	return 0;
+#endif /* CONFIG_NATIVE_WINDOWS */
+}
+
+
+static void pmksa_cache_test_free_cb(struct rsn_pmksa_cache_entry *entry,
+				     void *ctx)
+{
+	unsigned int *freed = ctx;
+
+	(*freed)++;
+}
+
+
+static int pmksa_cache_auth_tests(void)
+{
+	struct rsn_pmksa_cache *pmksa;
+	struct rsn_pmksa_cache_entry *entry;
+	const unsigned int num = 1000;
+	u8 *pmkids = NULL;
+	u8 aa[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+	u8 spa[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	u8 pmk[PMK_LEN];
+	unsigned int i, freed = 0, count = 0;
+	os_time_t prev = 0;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "pmksa_cache_auth tests");
+
+	pmksa = pmksa_cache_auth_init(pmksa_cache_test_free_cb, &freed);
+	pmkids = os_malloc(num * PMKID_LEN);
+	if (!pmksa || !pmkids)
+		goto fail;
+	os_memset(pmk, 0x11, PMK_LEN);
+	if (os_get_random(pmkids, num * PMKID_LEN) < 0)
+		goto fail;
+
+	for (i = 0; i < num; i++) {
+		WPA_PUT_BE16(&spa[4], i);
+		if (!pmksa_cache_auth_add(pmksa, pmk, PMK_LEN,
+					  &pmkids[i * PMKID_LEN], NULL, 0, aa,
+					  spa, 1000 + (i * 7919) % 5000, NULL,
+					  WPA_KEY_MGMT_IEEE8021X))
+			goto fail;
+	}
+
+	/* Replaces the entry for the same SPA */
+	pmkids[(num - 1) * PMKID_LEN] ^= 0xff;
+	if (!pmksa_cache_auth_add(pmksa, pmk, PMK_LEN,
+				  &pmkids[(num - 1) * PMKID_LEN], NULL, 0,
+				  aa, spa, 10, NULL, WPA_KEY_MGMT_IEEE8021X) ||
+	    freed != 1)
+		goto fail;
+
+	for (i = 0; i < num; i++) {
+		const u8 *pmkid = &pmkids[i * PMKID_LEN];
+
+		WPA_PUT_BE16(&spa[4], i);
+		entry = pmksa_cache_auth_get(pmksa, NULL, pmkid);
+		if (!entry || os_memcmp(entry->spa, spa, ETH_ALEN) != 0 ||
+		    pmksa_cache_auth_get(pmksa, spa, NULL) != entry ||
+		    pmksa_cache_auth_get(pmksa, spa, pmkid) != entry)
+			goto fail;
+	}
+	WPA_PUT_BE16(&spa[4], num);
+	if (pmksa_cache_auth_get(pmksa, spa, NULL))
+		goto fail;
+
+	/* Remove entries from the middle of the expiration order */
+	for (i = 1; i < num - 1; i += 3) {
+		entry = pmksa_cache_auth_get(pmksa, NULL,
+					     &pmkids[i * PMKID_LEN]);
+		if (!entry)
+			goto fail;
+		pmksa_cache_free_entry(pmksa, entry);
+	}
+
+	while ((entry = pmksa_cache_auth_get(pmksa, NULL, NULL))) {
+		if (entry->expiration < prev)
+			goto fail;
+		prev = entry->expiration;
+		pmksa_cache_free_entry(pmksa, entry);
+		count++;
+	}
+	if (count != num - (num - 1 + 2) / 3 || freed != num + 1)
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "pmksa_cache_auth module test failure");
+	pmksa_cache_auth_deinit(pmksa);
+	os_free(pmkids);
+	return ret;
+}
+
+
+static struct hostapd_eap_user *
+eap_user_list_get(const struct hostapd_bss_config *conf, const u8 *identity,
+		  size_t identity_len, int phase2)
+{
+	struct hostapd_eap_user *user;
+
+	/* Reference implementation: search through the full list */
+	for (user = conf->eap_user; user; user = user->next) {
+		if (!phase2 && !user->identity)
+			break;
+		if (user->phase2 == !!phase2 && user->wildcard_prefix &&
+		    identity_len >= user->identity_len &&
+		    os_memcmp(user->identity, identity, user->identity_len) ==
+		    0)
+			break;
+		if (user->phase2 == !!phase2 &&
+		    user->identity_len == identity_len &&
+		    os_memcmp(user->identity, identity, identity_len) == 0)
+			break;
+	}
+
+	return user;
+}
+
+
+static struct hostapd_eap_user * eap_user_test_add(
+	struct hostapd_eap_user **tail, const char *identity, int prefix,
+	int phase2)
+{
+	struct hostapd_eap_user *user;
+
+	user = os_zalloc(sizeof(*user));
+	if (!user)
+		return NULL;
+	if (identity) {
+		user->identity = (u8 *) os_strdup(identity);
+		if (!user->identity) {
+			os_free(user);
+			return NULL;
+		}
+		user->identity_len = os_strlen(identity);
+	}
+	user->wildcard_prefix = prefix;
+	user->phase2 = phase2;
+	*tail = user;
+	return user;
+}
+
+
+static int eap_user_test_cmp_one(const struct hostapd_bss_config *conf,
+				 const char *identity)
+{
+	size_t len = os_strlen(identity);
+	int phase2;
+
+	for (phase2 = 0; phase2 <= 1; phase2++) {
+		if (hostapd_config_get_eap_user(conf, (const u8 *) identity,
+						len, phase2) !=
+		    eap_user_list_get(conf, (const u8 *) identity, len, phase2))
+			return -1;
+	}
+
+	return 0;
+}
+
+
+static int eap_user_test_cmp(const struct hostapd_bss_config *conf,
+			     const unsigned int num)
+{
+	const char *pre[] = { "user", "user", "realm", "realm", "realm" };
+	const char *post[] = { "", "@example.com", "/x", "/", "" };
+	char buf[50];
+	unsigned int i, j;
+
+	if (eap_user_test_cmp_one(conf, "") < 0 ||
+	    eap_user_test_cmp_one(conf, "u") < 0 ||
+	    eap_user_test_cmp_one(conf, "realm") < 0)
+		return -1;
+
+	for (i = 0; i < num + 10; i++) {
+		for (j = 0; j < ARRAY_SIZE(pre); j++) {
+			os_snprintf(buf, sizeof(buf), "%s%u%s",
+				    pre[j], i, post[j]);
+			if (eap_user_test_cmp_one(conf, buf) < 0)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+static int eap_user_index_tests(void)
+{
+	struct hostapd_bss_config *conf;
+	struct hostapd_data hapd;
+	struct hostapd_eap_user **tail, *user;
+	const unsigned int num = 2000;
+	char buf[50];
+	unsigned int i;
+	int res, steps = 0, ret = -1;
+
+	wpa_printf(MSG_INFO, "EAP user index tests");
+
+	conf = os_zalloc(sizeof(*conf));
+	if (!conf)
+		return -1;
+	hostapd_config_defaults_bss(conf);
+
+	tail = &conf->eap_user;
+	for (i = 0; i < num; i++) {
+		os_snprintf(buf, sizeof(buf), "user%u", i);
+		user = eap_user_test_add(tail, buf, 0, i % 3 == 0);
+		if (!user)
+			goto fail;
+		tail = &user->next;
+		if (i % 10 == 0) {
+			/* Wildcard prefixes, some of them shadowed by a shorter
+			 * prefix or an exact entry earlier in the list */
+			os_snprintf(buf, sizeof(buf), "realm%u/", i / 2);
+			user = eap_user_test_add(tail, buf, 1, i % 20 == 0);
+			if (!user)
+				goto fail;
+			tail = &user->next;
+		}
+		if (i == num / 2) {
+			/* Phase 1 catch-all and a later duplicate */
+			user = eap_user_test_add(tail, NULL, 0, 0);
+			if (!user)
+				goto fail;
+			tail = &user->next;
+			user = eap_user_test_add(tail, "user1", 0, 1);
+			if (!user)
+				goto fail;
+			tail = &user->next;
+			user = eap_user_test_add(tail, "realm1", 1, 0);
+			if (!user)
+				goto fail;
+			tail = &user->next;
+		}
+	}
+	/* Phase 2 catch-all prefix at the end of the list */
+	user = eap_user_test_add(tail, "", 1, 1);
+	if (!user)
+		goto fail;
+	user->identity_len = 0;
+
+	if (eap_user_test_cmp(conf, num) < 0)
+		goto fail;
+
+	/* Lookups during an incremental build */
+	do {
+		res = hostapd_eap_user_index_update(conf, 333);
+		if (res < 0 || eap_user_test_cmp(conf, num) < 0)
+			goto fail;
+		steps++;
+	} while (res == 0);
+	if (steps != (num + num / 10 + 4 + 332) / 333)
+		goto fail;
+
+	/* Replaced list is not used with the old index */
+	user = conf->eap_user;
+	conf->eap_user = user->next;
+	user->next = NULL;
+	hostapd_config_free_eap_users(user);
+	if (eap_user_test_cmp(conf, num) < 0 ||
+	    hostapd_eap_user_index_update(conf, num * 2) != 1 ||
+	    eap_user_test_cmp(conf, num) < 0)
+		goto fail;
+
+	/* Failed build is not retried on lookup, only on explicit restart */
+	os_memset(&hapd, 0, sizeof(hapd));
+	hapd.conf = conf;
+	hostapd_eap_user_index_free(conf);
+	conf->eap_user_index_failed = 1;
+	if (hostapd_get_eap_user(&hapd, (const u8 *) "user5", 5, 0) !=
+	    eap_user_list_get(conf, (const u8 *) "user5", 5, 0) ||
+	    conf->eap_user_index)
+		goto fail;
+	hostapd_eap_user_index_start(&hapd);
+	hostapd_eap_user_index_stop(&hapd);
+	if (!conf->eap_user_index || conf->eap_user_index_failed ||
+	    eap_user_test_cmp(conf, num) < 0)
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "EAP user index module test failure");
+	hostapd_config_free_bss(conf);
+	return ret;
+}
+
+
+#ifndef CONFIG_NO_RADIUS
+
+#define RADIUS_TEST_SECRET "radius-module-test"
+
+static unsigned int radius_test_responses;
+
+
+static RadiusRxResult
+radius_test_rx(struct radius_msg *msg, struct radius_msg *req,
+	       const u8 *shared_secret, size_t shared_secret_len, void *data)
+{
+	if (radius_msg_verify(msg, shared_secret, shared_secret_len, req, 1))
+		return RADIUS_RX_INVALID_AUTHENTICATOR;
+	radius_test_responses++;
+	return RADIUS_RX_PROCESSED;
+}
+
+
+struct radius_test_req {
+	struct sockaddr_in from;
+	u8 identifier;
+	u8 authenticator[16];
+};
+
+
+static int radius_test_recv(int s, struct radius_test_req *req)
+{
+	u8 buf[RADIUS_MAX_MSG_LEN];
+	socklen_t fromlen = sizeof(req->from);
+	struct radius_msg *msg;
+	struct radius_hdr *hdr;
+	int len;
+
+	len = recvfrom(s, buf, sizeof(buf), 0, (struct sockaddr *) &req->from,
+		       &fromlen);
+	if (len < 0)
+		return -1;
+	msg = radius_msg_parse(buf, len);
+	if (!msg)
+		return -1;
+	hdr = radius_msg_get_hdr(msg);
+	req->identifier = hdr->identifier;
+	os_memcpy(req->authenticator, hdr->authenticator,
+		  sizeof(req->authenticator));
+	radius_msg_free(msg);
+	return 0;
+}
+
+
+static int radius_test_reply(int s, const struct radius_test_req *req)
+{
+	struct radius_msg *msg;
+	struct wpabuf *buf;
+	int ret = -1;
+
+	msg = radius_msg_new(RADIUS_CODE_ACCESS_REJECT, req->identifier);
+	if (msg &&
+	    radius_msg_finish_srv(msg, (const u8 *) RADIUS_TEST_SECRET,
+				  os_strlen(RADIUS_TEST_SECRET),
+				  req->authenticator) == 0) {
+		buf = radius_msg_get_buf(msg);
+		if (sendto(s, wpabuf_head(buf), wpabuf_len(buf), 0,
+			   (const struct sockaddr *) &req->from,
+			   sizeof(req->from)) >= 0)
+			ret = 0;
+	}
+	radius_msg_free(msg);
+	return ret;
+}
+
+
+/* Send num Access-Requests and act as the RADIUS server for them. All the
+ * requests are pending at the same time and the RADIUS Identifier of each has
+ * to be unique on its source port. The requests are sent and replied to in
+ * small steps to stay within the socket receive buffers. Returns the number
+ * of source ports used or -1 on failure. */
+static int radius_test_run(struct radius_client_data *radius, int s,
+			   unsigned int num, int reply)
+{
+	struct radius_test_req *req;
+	struct radius_msg *msg;
+	u16 ports[16];
+	u8 ids[16][256];
+	u8 addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	unsigned int i, num_ports = 0, p;
+	int ret = -1;
+
+	req = os_calloc(num, sizeof(*req));
+	if (!req)
+		return -1;
+	os_memset(ids, 0, sizeof(ids));
+
+	for (i = 0; i < num; i++) {
+		msg = radius_msg_new(RADIUS_CODE_ACCESS_REQUEST,
+				     radius_client_get_id(radius));
+		if (!msg)
+			goto fail;
+		WPA_PUT_BE16(&addr[4], i);
+		if (!radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME,
+					 (const u8 *) "user", 4) ||
+		    radius_client_send(radius, msg, RADIUS_AUTH, addr) < 0) {
+			radius_msg_free(msg);
+			goto fail;
+		}
+
+		if (radius_test_recv(s, &req[i]) < 0) {
+			wpa_printf(MSG_ERROR,
+				   "RADIUS test: Request %u not received", i);
+			goto fail;
+		}
+		for (p = 0; p < num_ports; p++) {
+			if (ports[p] == req[i].from.sin_port)
+				break;
+		}
+		if (p == num_ports) {
+			if (num_ports == ARRAY_SIZE(ports))
+				goto fail;
+			ports[num_ports++] = req[i].from.sin_port;
+		}
+		if (ids[p][req[i].identifier]) {
+			wpa_printf(MSG_ERROR,
+				   "RADIUS test: Identifier %u used twice on port %u",
+				   req[i].identifier,
+				   ntohs(req[i].from.sin_port));
+			goto fail;
+		}
+		ids[p][req[i].identifier] = 1;
+	}
+
+	for (i = 0; reply && i < num; i++) {
+		if (radius_test_reply(s, &req[i]) < 0)
+			goto fail;
+		if (i % 32 == 31 || i == num - 1)
+			radius_client_receive_pending(radius);
+	}
+
+	ret = num_ports;
+fail:
+	os_free(req);
+	return ret;
+}
+
+
+static int radius_client_tests(void)
+{
+	struct hostapd_radius_server serv;
+	struct hostapd_radius_servers conf;
+	struct radius_client_data *radius = NULL;
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	struct timeval tv;
+	char mib[2000];
+	int s, ret = -1;
+
+	wpa_printf(MSG_INFO, "RADIUS client tests");
+
+	s = socket(PF_INET, SOCK_DGRAM, 0);
+	if (s < 0)
+		return -1;
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	tv.tv_sec = 2;
+	tv.tv_usec = 0;
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    getsockname(s, (struct sockaddr *) &addr, &addrlen) < 0 ||
+	    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0)
+		goto fail;
+
+	os_memset(&serv, 0, sizeof(serv));
+	serv.addr.af = AF_INET;
+	serv.addr.u.v4 = addr.sin_addr;
+	serv.port = ntohs(addr.sin_port);
+	serv.shared_secret = (u8 *) RADIUS_TEST_SECRET;
+	serv.shared_secret_len = os_strlen(RADIUS_TEST_SECRET);
+	os_memset(&conf, 0, sizeof(conf));
+	conf.auth_servers = conf.auth_server = &serv;
+	conf.num_auth_servers = 1;
+	conf.num_client_socks = 2;
+	conf.max_pending = 1000;
+
+	radius = radius_client_init(NULL, &conf);
+	if (!radius ||
+	    radius_client_register(radius, RADIUS_AUTH, radius_test_rx,
+				   NULL) < 0)
+		goto fail;
+
+	/* More pending requests than identifiers; the requests are spread
+	 * over the pool and each response is matched with its request */
+	radius_test_responses = 0;
+	if (radius_test_run(radius, s, 500, 1) != 2)
+		goto fail;
+	if (radius_test_responses != 500) {
+		wpa_printf(MSG_ERROR, "RADIUS test: %u/500 responses matched",
+			   radius_test_responses);
+		goto fail;
+	}
+
+	/* A larger pool from a configuration reload is used for new
+	 * requests */
+	conf.num_client_socks = 4;
+	radius_client_reconfig(radius, &conf);
+	radius_test_responses = 0;
+	if (radius_test_run(radius, s, 800, 1) != 4 ||
+	    radius_test_responses != 800)
+		goto fail;
+
+	/* Requests still pending during a reload are moved to the new pool
+	 * and do not get in the way of new requests */
+	if (radius_test_run(radius, s, 300, 0) != 2)
+		goto fail;
+	conf.num_client_socks = 3;
+	radius_client_reconfig(radius, &conf);
+	radius_test_responses = 0;
+	if (radius_test_run(radius, s, 200, 1) < 1 ||
+	    radius_test_responses != 200 ||
+	    radius_client_get_mib(radius, mib, sizeof(mib)) <= 0 ||
+	    !os_strstr(mib, "radiusAuthClientPendingRequests=300\n"))
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "RADIUS client test failed");
+	radius_client_deinit(radius);
+	close(s);
+	return ret;
+}
+
+#endif /* CONFIG_NO_RADIUS */
+
+
+#ifdef NEED_AP_MLME
+
+struct probe_resp_test_frame {
+	u8 buf[1500];
+	size_t len;
+	unsigned int count;
+};
+
+
+static int probe_resp_test_send_mlme(void *priv, const u8 *data,
+				     size_t data_len, int noack,
+				     unsigned int freq, const u16 *csa_offs,
+				     size_t csa_offs_len, int no_encrypt,
+				     unsigned int wait)
+{
+	struct probe_resp_test_frame *frame = priv;
+
+	if (data_len > sizeof(frame->buf))
+		return -1;
+	os_memcpy(frame->buf, data, data_len);
+	frame->len = data_len;
+	frame->count++;
+	return 0;
+}
+
+
+static int probe_resp_test_cmp(struct hostapd_data *hapd,
+			       struct probe_resp_test_frame *frame,
+			       const u8 *req, size_t req_len)
+{
+	u8 cached[1500];
+	size_t cached_len;
+	unsigned int count = frame->count;
+
+	/* Response from the cached template */
+	handle_probe_req(hapd, (const struct ieee80211_mgmt *) req, req_len,
+			 0);
+	cached_len = frame->len;
+	os_memcpy(cached, frame->buf, cached_len);
+
+	/* Response generated from scratch */
+	hostapd_probe_resp_tmpl_flush(hapd);
+	handle_probe_req(hapd, (const struct ieee80211_mgmt *) req, req_len,
+			 0);
+
+	if (frame->count != count + 2 || cached_len != frame->len ||
+	    os_memcmp(cached, frame->buf, cached_len) != 0)
+		return -1;
+	return 0;
+}
+
+
+static int probe_resp_tests(void)
+{
+	struct wpa_driver_ops drv;
+	struct probe_resp_test_frame *frame;
+	struct hostapd_iface *iface;
+	struct hostapd_config *conf = NULL;
+	struct hostapd_data *hapd = NULL;
+	struct ieee80211_mgmt *mgmt;
+	struct os_reltime start, end, now;
+	const unsigned int num = 20000;
+	u8 req[IEEE80211_HDRLEN + 2 + 8 + 2 + 4];
+	u8 *pos, *ssid_len;
+	unsigned int i, count;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "probe response tests");
+
+	frame = os_zalloc(sizeof(*frame));
+	iface = hostapd_alloc_iface();
+	if (!frame || !iface)
+		goto fail;
+	conf = hostapd_config_defaults();
+	if (!conf)
+		goto fail;
+	hapd = hostapd_alloc_bss_data(iface, conf, conf->bss[0]);
+	if (!hapd)
+		goto fail;
+	iface->conf = conf;
+	iface->bss = &hapd;
+	iface->num_bss = 1;
+
+	os_memset(&drv, 0, sizeof(drv));
+	drv.send_mlme = probe_resp_test_send_mlme;
+	hapd->driver = &drv;
+	hapd->drv_priv = frame;
+	os_memcpy(hapd->own_addr, "\x02\x00\x00\x00\x01\x00", ETH_ALEN);
+	os_memcpy(hapd->conf->ssid.ssid, "test", 4);
+	hapd->conf->ssid.ssid_len = 4;
+	hapd->conf->ssid.ssid_set = 1;
+	hapd->conf->bss_load_update_period = 100;
+
+	os_memset(req, 0, sizeof(req));
+	mgmt = (struct ieee80211_mgmt *) req;
+	mgmt->frame_control = IEEE80211_FC(WLAN_FC_TYPE_MGMT,
+					   WLAN_FC_STYPE_PROBE_REQ);
+	os_memset(mgmt->da, 0xff, ETH_ALEN);
+	os_memcpy(mgmt->sa, "\x02\x00\x00\x00\x00\x01", ETH_ALEN);
+	os_memset(mgmt->bssid, 0xff, ETH_ALEN);
+	pos = req + IEEE80211_HDRLEN;
+	*pos++ = WLAN_EID_SUPP_RATES;
+	*pos++ = 8;
+	os_memcpy(pos, "\x82\x84\x8b\x96\x0c\x12\x18\x24", 8);
+	pos += 8;
+	/* SSID element last so that it can be truncated to a wildcard SSID */
+	*pos++ = WLAN_EID_SSID;
+	ssid_len = pos;
+	*pos++ = 4;
+	os_memcpy(pos, "test", 4);
+
+	if (probe_resp_test_cmp(hapd, frame, req, sizeof(req)) < 0)
+		goto fail;
+
+	/* Per-request fields */
+	os_memcpy(mgmt->sa, "\x02\x00\x00\x00\x00\x02", ETH_ALEN);
+	hapd->num_sta = 5;
+	if (probe_resp_test_cmp(hapd, frame, req, sizeof(req)) < 0 ||
+	    os_memcmp(((struct ieee80211_mgmt *) frame->buf)->da, mgmt->sa,
+		      ETH_ALEN) != 0)
+		goto fail;
+
+	/* Wildcard SSID */
+	*ssid_len = 0;
+	if (probe_resp_test_cmp(hapd, frame, req, sizeof(req) - 4) < 0)
+		goto fail;
+	*ssid_len = 4;
+
+	/* Throughput with and without the template */
+	count = frame->count;
+	os_get_reltime(&start);
+	for (i = 0; i < num; i++) {
+		mgmt->sa[5] = i;
+		handle_probe_req(hapd, mgmt, sizeof(req), 0);
+	}
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &end);
+	wpa_printf(MSG_INFO,
+		   "probe response template: %u requests in %u.%06u s",
+		   num, (unsigned int) end.sec, (unsigned int) end.usec);
+
+	os_get_reltime(&start);
+	for (i = 0; i < num; i++) {
+		mgmt->sa[5] = i;
+		hostapd_probe_resp_tmpl_flush(hapd);
+		handle_probe_req(hapd, mgmt, sizeof(req), 0);
+	}
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &end);
+	wpa_printf(MSG_INFO,
+		   "probe response generation: %u requests in %u.%06u s",
+		   num, (unsigned int) end.sec, (unsigned int) end.usec);
+
+	if (frame->count - count != 2 * num)
+		goto fail;
+
+	/* Duplicate suppression */
+	hapd->conf->probe_resp_dedup_time = 1000;
+	count = frame->count;
+	for (i = 0; i < 3; i++) {
+		mgmt->sa[5] = i % 2;
+		handle_probe_req(hapd, mgmt, sizeof(req), 0);
+		handle_probe_req(hapd, mgmt, sizeof(req), 0);
+	}
+	if (frame->count - count != 2 || hapd->probe_req_dup != 4)
+		goto fail;
+	/* Different SSID from the same STA */
+	*ssid_len = 0;
+	handle_probe_req(hapd, mgmt, sizeof(req) - 4, 0);
+	*ssid_len = 4;
+	if (frame->count - count != 3)
+		goto fail;
+	hapd->conf->probe_resp_dedup_time = 0;
+
+	/* Rate limiting applies only to wildcard SSID Probe Request frames */
+	hapd->conf->probe_resp_rate_limit = 10;
+	hapd->conf->probe_resp_rate_burst = 5;
+	count = frame->count;
+	for (i = 0; i < 20; i++)
+		handle_probe_req(hapd, mgmt, sizeof(req), 0);
+	if (frame->count - count != 20)
+		goto fail;
+	/* Take the first token at a time ahead of the real clock so that no
+	 * tokens are added while the frames below are processed */
+	os_get_reltime(&now);
+	now.sec += 3600;
+	now.usec = 0;
+	if (!hostapd_probe_resp_rate_ok(hapd, &now))
+		goto fail;
+	*ssid_len = 0;
+	count = frame->count;
+	for (i = 0; i < 20; i++)
+		handle_probe_req(hapd, mgmt, sizeof(req) - 4, 0);
+	*ssid_len = 4;
+	if (frame->count - count != 4 || hapd->probe_req_rate_limited != 16)
+		goto fail;
+
+	/* 100 ms adds one token at 10 responses per second */
+	now.usec += 100000;
+	if (!hostapd_probe_resp_rate_ok(hapd, &now) ||
+	    hostapd_probe_resp_rate_ok(hapd, &now))
+		goto fail;
+	/* The bucket does not go back in time */
+	now.usec -= 50000;
+	if (hostapd_probe_resp_rate_ok(hapd, &now))
+		goto fail;
+	/* Refilled up to the burst size */
+	now.sec += 10;
+	for (i = 0; i < 5; i++) {
+		if (!hostapd_probe_resp_rate_ok(hapd, &now))
+			goto fail;
+	}
+	if (hostapd_probe_resp_rate_ok(hapd, &now))
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "probe response module test failure");
+	if (hapd) {
+		hostapd_probe_resp_tmpl_flush(hapd);
+		os_free(hapd);
+	}
+	hostapd_config_free(conf);
+	os_free(iface);
+	os_free(frame);
+	return ret;
+}
+
+
+#ifdef CONFIG_SAE
+
+static int sae_queue_test_commit(struct hostapd_data *hapd,
+				 struct sae_data *sae, const u8 *addr,
+				 const char *pw)
+{
+	struct ieee80211_mgmt *mgmt;
+	struct wpabuf *buf;
+	int ret = -1;
+
+	buf = wpabuf_alloc(IEEE80211_HDRLEN + sizeof(mgmt->u.auth) +
+			   SAE_COMMIT_MAX_LEN);
+	if (!buf)
+		return -1;
+	mgmt = wpabuf_put(buf, IEEE80211_HDRLEN + sizeof(mgmt->u.auth));
+	os_memset(mgmt, 0, IEEE80211_HDRLEN + sizeof(mgmt->u.auth));
+	mgmt->frame_control = IEEE80211_FC(WLAN_FC_TYPE_MGMT,
+					   WLAN_FC_STYPE_AUTH);
+	os_memcpy(mgmt->da, hapd->own_addr, ETH_ALEN);
+	os_memcpy(mgmt->sa, addr, ETH_ALEN);
+	os_memcpy(mgmt->bssid, hapd->own_addr, ETH_ALEN);
+	mgmt->u.auth.auth_alg = host_to_le16(WLAN_AUTH_SAE);
+	mgmt->u.auth.auth_transaction = host_to_le16(1);
+	mgmt->u.auth.status_code = host_to_le16(WLAN_STATUS_SUCCESS);
+
+	if (sae_set_group(sae, 19) == 0 &&
+	    sae_prepare_commit(addr, hapd->own_addr, (const u8 *) pw,
+			       os_strlen(pw), NULL, sae) == 0 &&
+	    sae_write_commit(sae, buf, NULL, NULL) == 0) {
+		ieee802_11_mgmt(hapd, wpabuf_head(buf), wpabuf_len(buf), NULL);
+		ret = 0;
+	}
+	wpabuf_free(buf);
+	return ret;
+}
+
+
+static int sae_queue_test_check(struct hostapd_data *hapd,
+				struct probe_resp_test_frame *frame,
+				struct sae_data *sae, size_t num_sae)
+{
+	const struct ieee80211_mgmt *resp;
+	struct sta_info *sta;
+	struct sae_data *peer;
+	int groups[] = { 19, 0 };
+	size_t hdr_len = IEEE80211_HDRLEN + sizeof(resp->u.auth);
+
+	/* The AP sent its commit and derived the same PMK as the STA */
+	resp = (const struct ieee80211_mgmt *) frame->buf;
+	if (frame->len < hdr_len ||
+	    le_to_host16(resp->u.auth.auth_transaction) != 1 ||
+	    le_to_host16(resp->u.auth.status_code) != WLAN_STATUS_SUCCESS ||
+	    resp->da[5] < 1 || resp->da[5] > num_sae)
+		return -1;
+	peer = &sae[resp->da[5] - 1];
+	sta = ap_get_sta(hapd, resp->da);
+	if (!sta || !sta->sae ||
+	    sae_parse_commit(peer, resp->u.auth.variable, frame->len - hdr_len,
+			     NULL, NULL, groups, 0) != WLAN_STATUS_SUCCESS ||
+	    sae_process_commit(peer) < 0 ||
+	    os_memcmp(peer->pmk, sta->sae->pmk, SAE_PMK_LEN) != 0)
+		return -1;
+	return 0;
+}
+
+
+static int sae_queue_tests(void)
+{
+	struct wpa_driver_ops drv;
+	struct probe_resp_test_frame *frame;
+	struct hostapd_iface *iface;
+	struct hostapd_config *conf = NULL;
+	struct hostapd_data *hapd = NULL;
+	struct hostapd_sae_commit_queue *q;
+	const struct ieee80211_mgmt *mgmt;
+	struct sae_data sae[6];
+	u8 addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	const char *pw = "password";
+	unsigned int i, count, remaining;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "SAE commit queue tests");
+
+	os_memset(sae, 0, sizeof(sae));
+	frame = os_zalloc(sizeof(*frame));
+	iface = hostapd_alloc_iface();
+	if (!frame || !iface)
+		goto fail;
+	conf = hostapd_config_defaults();
+	if (!conf)
+		goto fail;
+	hapd = hostapd_alloc_bss_data(iface, conf, conf->bss[0]);
+	if (!hapd)
+		goto fail;
+	iface->conf = conf;
+	iface->bss = &hapd;
+	iface->num_bss = 1;
+	iface->state = HAPD_IFACE_ENABLED;
+
+	os_memset(&drv, 0, sizeof(drv));
+	drv.send_mlme = probe_resp_test_send_mlme;
+	hapd->driver = &drv;
+	hapd->drv_priv = frame;
+	hapd->msg_ctx = hapd;
+	os_memcpy(hapd->own_addr, "\x02\x00\x00\x00\x01\x00", ETH_ALEN);
+	hapd->conf->wpa = WPA_PROTO_RSN;
+	hapd->conf->wpa_key_mgmt = WPA_KEY_MGMT_SAE;
+	hapd->conf->ssid.wpa_passphrase = os_strdup(pw);
+	if (!hapd->conf->ssid.wpa_passphrase)
+		goto fail;
+	hapd->conf->sae_anti_clogging_threshold = 100;
+	hapd->conf->sae_commit_queue_max = 4;
+	hapd->conf->sae_commit_queue_delay = 100000;
+
+	/* Commit messages beyond the queue limit are dropped */
+	for (i = 0; i < ARRAY_SIZE(sae); i++) {
+		addr[5] = i + 1;
+		if (sae_queue_test_commit(hapd, &sae[i], addr, pw) < 0)
+			goto fail;
+	}
+	if (dl_list_len(&hapd->sae_commit_queue) != 4 || frame->count ||
+	    hapd->num_sta ||
+	    eloop_cancel_timeout(auth_sae_process_commit, hapd, NULL) != 1) {
+		wpa_printf(MSG_ERROR, "SAE: Unexpected commit queue state");
+		goto fail;
+	}
+
+	/*
+	 * Emulate completed worker jobs: a matching precomputed PWE for the
+	 * first two entries and one for a different password for the third
+	 * entry, which must not be used.
+	 */
+	i = 0;
+	dl_list_for_each(q, &hapd->sae_commit_queue,
+			 struct hostapd_sae_commit_queue, list) {
+		if (i == 3)
+			break;
+		mgmt = (const struct ieee80211_mgmt *) q->msg;
+		q->pwe = sae_pwe_precomp_init(19, hapd->own_addr, mgmt->sa,
+					      (const u8 *) (i < 2 ? pw : "wrong"),
+					      i < 2 ? os_strlen(pw) : 5, NULL);
+		if (!q->pwe || sae_pwe_precomp_derive(q->pwe) < 0)
+			goto fail;
+		q->pwe_job = SAE_PWE_JOB_DONE;
+		i++;
+	}
+
+	/* Each processed frame schedules the next one based on the remaining
+	 * queue length */
+	for (i = 0; i < 4; i++) {
+		count = frame->count;
+		auth_sae_process_commit(hapd, NULL);
+		remaining = dl_list_len(&hapd->sae_commit_queue);
+		if (frame->count != count + 1 || remaining != 3 - i ||
+		    sae_queue_test_check(hapd, frame, sae,
+					 ARRAY_SIZE(sae)) < 0) {
+			wpa_printf(MSG_ERROR,
+				   "SAE: Queued commit message %u not processed correctly",
+				   i);
+			goto fail;
+		}
+		if (remaining &&
+		    (eloop_deplete_timeout(0, remaining * 100000,
+					   auth_sae_process_commit,
+					   hapd, NULL) != 0 ||
+		     eloop_deplete_timeout(0, remaining * 100000 - 50000,
+					   auth_sae_process_commit,
+					   hapd, NULL) != 1)) {
+			wpa_printf(MSG_ERROR, "SAE: Unexpected queue pacing");
+			goto fail;
+		}
+		eloop_cancel_timeout(auth_sae_process_commit, hapd, NULL);
+	}
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "SAE commit queue module test failure");
+	for (i = 0; i < ARRAY_SIZE(sae); i++)
+		sae_clear_data(&sae[i]);
+	if (hapd) {
+		auth_sae_queue_flush(hapd);
+		hostapd_free_stas(hapd);
+		os_free(hapd);
+	}
+	hostapd_config_free(conf);
+	os_free(iface);
+	os_free(frame);
+	return ret;
+}
+
+#endif /* CONFIG_SAE */
+
+#endif /* NEED_AP_MLME */
+
+
+#if defined(CONFIG_SQLITE) && defined(RADIUS_SERVER)
+
+#define EAP_USER_DB_TEST_SECRET "radius"
+
+static int eap_user_db_test_sql(const char *fname, const char *sql)
+{
+	sqlite3 *db;
+	int ret;
+
+	if (sqlite3_open(fname, &db) != SQLITE_OK) {
+		sqlite3_close(db);
+		return -1;
+	}
+	ret = sqlite3_exec(db, sql, NULL, NULL, NULL) == SQLITE_OK ? 0 : -1;
+	sqlite3_close(db);
+	return ret;
+}
+
+
+/* Check the password of a user or that the user is not found (password NULL)
+ */
+static int eap_user_db_test_get(struct hostapd_data *hapd,
+				const char *identity, const char *password)
+{
+	const struct hostapd_eap_user *user;
+
+	user = hostapd_get_eap_user(hapd, (const u8 *) identity,
+				    os_strlen(identity), 0);
+	if (!password)
+		return user ? -1 : 0;
+	if (!user || !user->password ||
+	    user->password_len != os_strlen(password) ||
+	    os_memcmp(user->password, password, user->password_len) != 0)
+		return -1;
+	return 0;
+}
+
+
+static int eap_user_db_test_prefetch(struct hostapd_data *hapd,
+				     const char *identity, void *session_ctx)
+{
+	return hostapd_prefetch_eap_user(hapd, (const u8 *) identity,
+					 os_strlen(identity), 0, session_ctx);
+}
+
+
+/* Send an Access-Request with EAP-Response/Identity; count > 1 to add
+ * retransmissions */
+static int eap_user_db_test_send(int s, u8 identifier, const char *user,
+				 int count)
+{
+	struct radius_msg *msg;
+	struct wpabuf *buf;
+	u8 eap[sizeof(struct eap_hdr) + 1 + 32];
+	size_t len = os_strlen(user);
+	int i, ret = -1;
+
+	msg = radius_msg_new(RADIUS_CODE_ACCESS_REQUEST, identifier);
+	if (!msg)
+		return -1;
+	eap[0] = EAP_CODE_RESPONSE;
+	eap[1] = identifier;
+	WPA_PUT_BE16(&eap[2], sizeof(struct eap_hdr) + 1 + len);
+	eap[4] = EAP_TYPE_IDENTITY;
+	os_memcpy(&eap[5], user, len);
+	if (radius_msg_make_authenticator(msg) < 0 ||
+	    !radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME, (const u8 *) user,
+				 len) ||
+	    !radius_msg_add_eap(msg, eap, sizeof(struct eap_hdr) + 1 + len) ||
+	    radius_msg_finish(msg, (const u8 *) EAP_USER_DB_TEST_SECRET,
+			      os_strlen(EAP_USER_DB_TEST_SECRET)) < 0)
+		goto fail;
+	buf = radius_msg_get_buf(msg);
+	for (i = 0; i < count; i++) {
+		if (send(s, wpabuf_head(buf), wpabuf_len(buf), 0) < 0)
+			goto fail;
+	}
+	ret = 0;
+fail:
+	radius_msg_free(msg);
+	return ret;
+}
+
+
+/* Returns the code of a received reply with the identifier, 0 if no reply was
+ * received, or -1 on failure */
+static int eap_user_db_test_recv(int s, u8 identifier)
+{
+	struct radius_msg *msg;
+	u8 buf[1500];
+	int len, code;
+
+	len = recv(s, buf, sizeof(buf), MSG_DONTWAIT);
+	if (len < 0)
+		return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+	msg = radius_msg_parse(buf, len);
+	if (!msg)
+		return -1;
+	code = radius_msg_get_hdr(msg)->identifier == identifier ?
+		radius_msg_get_hdr(msg)->code : -1;
+	radius_msg_free(msg);
+	return code;
+}
+
+
+static int eap_user_db_tests(void)
+{
+#ifndef CONFIG_NATIVE_WINDOWS
+	char fname[] = "/tmp/eap_user_db_test_XXXXXX";
+	char clients[] = "/tmp/eap_user_db_clients_XXXXXX";
+	struct hostapd_iface *iface;
+	struct hostapd_config *conf = NULL;
+	struct hostapd_data *hapd = NULL;
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	char mib[2000];
+	int session_a, session_b, session_c;
+	int fd, s = -1, ret = -1;
+	FILE *f;
+
+	wpa_printf(MSG_INFO, "EAP user DB tests");
+
+	fd = mkstemp(fname);
+	if (fd < 0)
+		return -1;
+	close(fd);
+	fd = mkstemp(clients);
+	if (fd < 0) {
+		unlink(fname);
+		return -1;
+	}
+	f = fdopen(fd, "w");
+	if (!f) {
+		close(fd);
+		goto fail;
+	}
+	fprintf(f, "127.0.0.1/32 %s\n", EAP_USER_DB_TEST_SECRET);
+	fclose(f);
+
+	if (eap_user_db_test_sql(
+		    fname,
+		    "CREATE TABLE users(identity TEXT PRIMARY KEY, methods TEXT, password TEXT, remediation TEXT, phase2 INTEGER, t_c_timestamp INTEGER);"
+		    "CREATE TABLE wildcards(identity TEXT PRIMARY KEY, methods TEXT);"
+		    "INSERT INTO users(identity,methods,password,phase2) VALUES ('alice','MD5','secret',0);"
+		    "INSERT INTO users(identity,methods,password,phase2) VALUES ('bob','MD5','secret',0);"
+		    "INSERT INTO users(identity,methods,password,phase2) VALUES ('carol','MD5','secret',0);") < 0)
+		goto fail;
+
+	iface = hostapd_alloc_iface();
+	if (!iface)
+		goto fail;
+	conf = hostapd_config_defaults();
+	if (!conf) {
+		os_free(iface);
+		goto fail;
+	}
+	hapd = hostapd_alloc_bss_data(iface, conf, conf->bss[0]);
+	if (!hapd) {
+		os_free(iface);
+		goto fail;
+	}
+	iface->conf = conf;
+	iface->bss = &hapd;
+	iface->num_bss = 1;
+	hapd->conf->eap_user_sqlite = os_strdup(fname);
+	if (!hapd->conf->eap_user_sqlite)
+		goto fail;
+	hapd->conf->eap_user_sqlite_cache_size = 2;
+	hapd->conf->eap_user_sqlite_cache_ttl = 3600;
+
+	/* Cache hits do not see database changes until the cache is flushed;
+	 * negative results are cached as well */
+	if (eap_user_db_test_get(hapd, "alice", "secret") < 0 ||
+	    eap_user_db_test_get(hapd, "dave", NULL) < 0 ||
+	    eap_user_db_test_sql(
+		    fname,
+		    "UPDATE users SET password='changed' WHERE identity='alice';"
+		    "INSERT INTO users(identity,methods,password,phase2) VALUES ('dave','MD5','secret',0);") < 0 ||
+	    eap_user_db_test_get(hapd, "alice", "secret") < 0 ||
+	    eap_user_db_test_get(hapd, "dave", NULL) < 0)
+		goto fail;
+	hostapd_eap_user_db_flush(hapd);
+	if (eap_user_db_test_get(hapd, "alice", "changed") < 0 ||
+	    eap_user_db_test_get(hapd, "dave", "secret") < 0)
+		goto fail;
+
+	/* Asynchronous lookups: a cached result is available immediately, a
+	 * removed session is not notified, and the result for a waiting session
+	 * is kept until it is used even if the cache is full */
+	hapd->conf->eap_user_sqlite_async = 1;
+	hostapd_eap_user_db_flush(hapd);
+	if (eap_user_db_test_get(hapd, "dave", "secret") < 0 ||
+	    eap_user_db_test_prefetch(hapd, "dave", &session_a) != 0 ||
+	    eap_user_db_test_prefetch(hapd, "alice", &session_a) != 1 ||
+	    eap_user_db_test_prefetch(hapd, "bob", &session_b) != 1 ||
+	    eap_user_db_test_prefetch(hapd, "carol", &session_c) != 1)
+		goto fail;
+	hostapd_cancel_eap_user_prefetch(hapd, &session_a);
+	hostapd_cancel_eap_user_prefetch(hapd, &session_b);
+	if (hostapd_eap_user_db_run_pending(hapd) != 1 ||
+	    eap_user_db_test_sql(
+		    fname,
+		    "UPDATE users SET password='changed' WHERE identity IN ('bob','carol');") < 0 ||
+	    eap_user_db_test_get(hapd, "x1", NULL) < 0 ||
+	    eap_user_db_test_get(hapd, "x2", NULL) < 0 ||
+	    eap_user_db_test_get(hapd, "x3", NULL) < 0 ||
+	    eap_user_db_test_prefetch(hapd, "carol", &session_c) != 0 ||
+	    eap_user_db_test_get(hapd, "carol", "secret") < 0)
+		goto fail;
+	/* Once used, the result for carol can be evicted */
+	if (eap_user_db_test_get(hapd, "x4", NULL) < 0 ||
+	    eap_user_db_test_get(hapd, "x5", NULL) < 0 ||
+	    eap_user_db_test_get(hapd, "carol", "changed") < 0)
+		goto fail;
+
+	/* The integrated RADIUS server does not reply to a new Access-Request
+	 * before the user lookup for it has completed */
+	hostapd_eap_user_db_flush(hapd);
+	s = socket(PF_INET, SOCK_DGRAM, 0);
+	if (s < 0)
+		goto fail;
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    getsockname(s, (struct sockaddr *) &addr, &addrlen) < 0)
+		goto fail;
+	/* Let the RADIUS server use the port of the test socket */
+	close(s);
+	s = -1;
+	hapd->conf->eap_server = 1;
+	hapd->conf->radius_server_auth_port = ntohs(addr.sin_port);
+	hapd->conf->radius_server_clients = os_strdup(clients);
+	if (!hapd->conf->radius_server_clients || authsrv_init(hapd) < 0)
+		goto fail;
+	s = socket(PF_INET, SOCK_DGRAM, 0);
+	if (s < 0 ||
+	    connect(s, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+		goto fail;
+
+	/* A retransmission is dropped while the lookup is pending */
+	if (eap_user_db_test_send(s, 1, "alice", 2) < 0)
+		goto fail;
+	radius_server_receive_pending(hapd->radius_srv);
+	if (eap_user_db_test_recv(s, 1) != 0 ||
+	    hostapd_eap_user_db_run_pending(hapd) != 1 ||
+	    eap_user_db_test_recv(s, 1) != RADIUS_CODE_ACCESS_CHALLENGE ||
+	    radius_server_get_mib(hapd->radius_srv, mib, sizeof(mib)) < 0 ||
+	    !os_strstr(mib, "radiusAuthServTotalDupAccessRequests=1\n"))
+		goto fail;
+
+	/* A deferred request that is removed is not notified */
+	if (eap_user_db_test_send(s, 2, "bob", 1) < 0)
+		goto fail;
+	radius_server_receive_pending(hapd->radius_srv);
+	if (eap_user_db_test_recv(s, 2) != 0)
+		goto fail;
+	authsrv_deinit(hapd);
+	if (hostapd_eap_user_db_run_pending(hapd) != 0)
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "EAP user DB module test failure");
+	if (s >= 0)
+		close(s);
+	if (hapd) {
+		authsrv_deinit(hapd);
+		hostapd_eap_user_db_deinit(hapd);
+		bin_clear_free(hapd->tmp_eap_user.identity,
+			       hapd->tmp_eap_user.identity_len);
+		bin_clear_free(hapd->tmp_eap_user.password,
+			       hapd->tmp_eap_user.password_len);
+		os_free(hapd->iface);
+		os_free(hapd);
+	}
+	hostapd_config_free(conf);
+	unlink(fname);
+	unlink(clients);
+	return ret;
+#else /* CONFIG_NATIVE_WINDOWS */
+	return 0;
+#endif /* CONFIG_NATIVE_WINDOWS */
+}
+
+#endif /* CONFIG_SQLITE && RADIUS_SERVER */
+
 
 int hapd_module_tests(void)
 {
+	int ret = 0;
+
 	wpa_printf(MSG_INFO, "hostapd module tests");
-	return 0;
+
+	if (wpa_psk_file_tests() < 0 ||
+	    pmksa_cache_auth_tests() < 0 ||
+	    eap_user_index_tests() < 0)
+		ret = -1;
+
+#ifndef CONFIG_NO_RADIUS
+	if (radius_client_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_NO_RADIUS */
+
+#if defined(CONFIG_SQLITE) && defined(RADIUS_SERVER)
+	if (eap_user_db_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_SQLITE && RADIUS_SERVER */
+
+#ifdef NEED_AP_MLME
+	if (probe_resp_tests() < 0)
+		ret = -1;
+#ifdef CONFIG_SAE
+	if (sae_queue_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_SAE */
+#endif /* NEED_AP_MLME */
+
+	return ret;
 }
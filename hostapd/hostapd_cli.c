@@ -1307,6 +1307,48 @@ static int hostapd_cli_cmd_pmksa_flush(struct wpa_ctrl *ctrl, int argc,
 }
 
 
+static int hostapd_cli_cmd_hash_stats(struct wpa_ctrl *ctrl, int argc,
+				      char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "HASH_STATS");
+}
+
+
+static int hostapd_cli_cmd_sae_pt_cache(struct wpa_ctrl *ctrl, int argc,
+					char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "SAE_PT_CACHE");
+}
+
+
+static int hostapd_cli_cmd_sae_pt_cache_flush(struct wpa_ctrl *ctrl, int argc,
+					      char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "SAE_PT_CACHE_FLUSH");
+}
+
+
+static int hostapd_cli_cmd_tls_session_cache(struct wpa_ctrl *ctrl, int argc,
+					     char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "TLS_SESSION_CACHE");
+}
+
+
+static int hostapd_cli_cmd_tls_cert_store(struct wpa_ctrl *ctrl, int argc,
+					  char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "TLS_CERT_STORE");
+}
+
+
+static int hostapd_cli_cmd_tls_ocsp_stapling(struct wpa_ctrl *ctrl, int argc,
+					     char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "TLS_OCSP_STAPLING");
+}
+
+
 static int hostapd_cli_cmd_set_neighbor(struct wpa_ctrl *ctrl, int argc,
 					char *argv[])
 {
@@ -1684,6 +1726,18 @@ static const struct hostapd_cli_cmd hostapd_cli_commands[] = {
 	  " = show PMKSA cache entries" },
 	{ "pmksa_flush", hostapd_cli_cmd_pmksa_flush, NULL,
 	  " = flush PMKSA cache" },
+	{ "hash_stats", hostapd_cli_cmd_hash_stats, NULL,
+	  " = show STA, AP, and PMKSA hash table occupancy" },
+	{ "sae_pt_cache", hostapd_cli_cmd_sae_pt_cache, NULL,
+	  " = show SAE PT cache counters" },
+	{ "sae_pt_cache_flush", hostapd_cli_cmd_sae_pt_cache_flush, NULL,
+	  " = flush SAE PT cache" },
+	{ "tls_session_cache", hostapd_cli_cmd_tls_session_cache, NULL,
+	  " = show shared TLS session cache statistics" },
+	{ "tls_cert_store", hostapd_cli_cmd_tls_cert_store, NULL,
+	  " = show trusted certificate store and CRL reload status" },
+	{ "tls_ocsp_stapling", hostapd_cli_cmd_tls_ocsp_stapling, NULL,
+	  " = show OCSP stapling response cache status" },
 	{ "set_neighbor", hostapd_cli_cmd_set_neighbor, NULL,
 	  "<addr> <ssid=> <nr=> [lci=] [civic=] [stat]\n"
 	  "  = add AP to neighbor database" },
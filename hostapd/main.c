@@ -19,6 +19,9 @@
 #include "crypto/tls.h"
 #include "common/version.h"
 #include "common/dpp.h"
+#ifdef CONFIG_SAE
+#include "common/sae.h"
+#endif /* CONFIG_SAE */
 #include "drivers/driver.h"
 #include "eap_server/eap.h"
 #include "eap_server/tncs.h"
@@ -379,6 +382,51 @@ static int hostapd_global_init(struct hapd_interfaces *interfaces,
 }
 
 
+#ifdef CONFIG_SAE
+static int hostapd_sae_pt_cache_file_seen(struct hapd_interfaces *interfaces,
+					  size_t iface_idx, size_t bss_idx,
+					  const char *fname)
+{
+	struct hostapd_config *conf;
+	size_t i, j;
+
+	for (i = 0; i <= iface_idx; i++) {
+		conf = interfaces->iface[i]->conf;
+		for (j = 0; j < conf->num_bss; j++) {
+			if (i == iface_idx && j == bss_idx)
+				return 0;
+			if (conf->bss[j]->sae_pt_cache_file &&
+			    os_strcmp(conf->bss[j]->sae_pt_cache_file,
+				      fname) == 0)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/* Load each configured SAE PT cache file once before the BSSs are set up */
+static void hostapd_sae_pt_cache_load(struct hapd_interfaces *interfaces)
+{
+	struct hostapd_config *conf;
+	const char *fname;
+	size_t i, j;
+
+	for (i = 0; i < interfaces->count; i++) {
+		conf = interfaces->iface[i]->conf;
+		for (j = 0; j < conf->num_bss; j++) {
+			fname = conf->bss[j]->sae_pt_cache_file;
+			if (fname &&
+			    !hostapd_sae_pt_cache_file_seen(interfaces, i, j,
+							    fname))
+				sae_pt_cache_load(fname);
+		}
+	}
+}
+#endif /* CONFIG_SAE */
+
+
 static void hostapd_global_deinit(const char *pid_file, int eloop_initialized)
 {
 	int i;
@@ -395,6 +443,10 @@ static void hostapd_global_deinit(const char *pid_file, int eloop_initialized)
 	tncs_global_deinit();
 #endif /* EAP_SERVER_TNC */
 
+#ifdef CONFIG_SAE
+	sae_pt_cache_flush();
+#endif /* CONFIG_SAE */
+
 	random_deinit();
 
 	if (eloop_initialized)
@@ -490,6 +542,9 @@ static void usage(void)
 		"        (records all messages regardless of debug verbosity)\n"
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 		"   -i   list of interface names to use\n"
+#ifdef CONFIG_DEBUG_BINLOG
+		"   -l   log output to a binary log file instead of stdout\n"
+#endif /* CONFIG_DEBUG_BINLOG */
 #ifdef CONFIG_DEBUG_SYSLOG
 		"   -s   log output to syslog instead of stdout\n"
 #endif /* CONFIG_DEBUG_SYSLOG */
@@ -653,6 +708,7 @@ int main(int argc, char *argv[])
 	int start_ifaces_in_sync = 0;
 	char **if_names = NULL;
 	size_t if_names_size = 0;
+	const char *binlog_file = NULL;
 #ifdef CONFIG_DPP
 	struct dpp_global_config dpp_conf;
 #endif /* CONFIG_DPP */
@@ -686,7 +742,7 @@ int main(int argc, char *argv[])
 #endif /* CONFIG_DPP */
 
 	for (;;) {
-		c = getopt(argc, argv, "b:Bde:f:hi:KP:sSTtu:vg:G:j:");
+		c = getopt(argc, argv, "b:Bde:f:hi:Kl:P:sSTtu:vg:G:j:");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -710,6 +766,11 @@ int main(int argc, char *argv[])
 		case 'K':
 			wpa_debug_show_keys++;
 			break;
+#ifdef CONFIG_DEBUG_BINLOG
+		case 'l':
+			binlog_file = optarg;
+			break;
+#endif /* CONFIG_DEBUG_BINLOG */
 		case 'P':
 			os_free(pid_file);
 			pid_file = os_rel2abs_path(optarg);
@@ -783,6 +844,8 @@ int main(int argc, char *argv[])
 		wpa_debug_open_file(log_file);
 	if (!log_file && !wpa_debug_syslog)
 		wpa_debug_setup_stdout();
+	if (binlog_file && wpa_debug_open_binlog(binlog_file) < 0)
+		return -1;
 #ifdef CONFIG_DEBUG_SYSLOG
 	if (wpa_debug_syslog)
 		wpa_debug_open_syslog();
@@ -882,6 +945,10 @@ int main(int argc, char *argv[])
 		}
 	}
 
+#ifdef CONFIG_SAE
+	hostapd_sae_pt_cache_load(&interfaces);
+#endif /* CONFIG_SAE */
+
 	/*
 	 * Enable configured interfaces. Depending on channel configuration,
 	 * this may complete full initialization before returning or use a
@@ -940,6 +1007,7 @@ int main(int argc, char *argv[])
 	hostapd_global_deinit(pid_file, interfaces.eloop_initialized);
 	os_free(pid_file);
 
+	wpa_debug_close_binlog();
 	wpa_debug_close_syslog();
 	if (log_file)
 		wpa_debug_close_file();
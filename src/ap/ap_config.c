@@ -9,6 +9,7 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "crypto/crypto.h"
 #include "crypto/sha1.h"
 #include "crypto/tls.h"
 #include "radius/radius_client.h"
@@ -89,6 +90,7 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 
 	bss->radius_server_auth_port = 1812;
 	bss->eap_sim_db_timeout = 1;
+	bss->eap_user_sqlite_cache_ttl = 60;
 	bss->eap_sim_id = 3;
 	bss->ap_max_inactivity = AP_MAX_INACTIVITY;
 	bss->eapol_version = EAPOL_VERSION;
@@ -123,6 +125,8 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 
 	bss->sae_anti_clogging_threshold = 5;
 	bss->sae_sync = 5;
+	bss->sae_commit_queue_max = 15;
+	bss->sae_commit_queue_delay = 50000;
 
 	bss->gas_frag_limit = 1400;
 
@@ -300,8 +304,236 @@ int hostapd_mac_comp(const void *a, const void *b)
 }
 
 
+/* Lookup table for PMKs that have already been derived from passphrases,
+ * either for a previous PSK list or for earlier entries in the same file */
+struct hostapd_wpa_psk_prev {
+	const struct hostapd_wpa_psk **tbl;
+	size_t size;
+	size_t count;
+};
+
+
+static void hostapd_wpa_psk_passphrase_hash(const struct hostapd_ssid *ssid,
+					    const char *passphrase, u8 *hash)
+{
+	const u8 *addr[3];
+	size_t len[3];
+	u8 ssid_len = ssid->ssid_len;
+
+	addr[0] = &ssid_len;
+	len[0] = 1;
+	addr[1] = ssid->ssid;
+	len[1] = ssid->ssid_len;
+	addr[2] = (const u8 *) passphrase;
+	len[2] = os_strlen(passphrase);
+	sha256_vector(3, addr, len, hash);
+}
+
+
+static void hostapd_wpa_psk_prev_insert(const struct hostapd_wpa_psk **tbl,
+					size_t size,
+					const struct hostapd_wpa_psk *psk)
+{
+	size_t i;
+
+	i = WPA_GET_BE32(psk->passphrase_hash) & (size - 1);
+	while (tbl[i])
+		i = (i + 1) & (size - 1);
+	tbl[i] = psk;
+}
+
+
+static int hostapd_wpa_psk_prev_add(struct hostapd_wpa_psk_prev *prev,
+				    const struct hostapd_wpa_psk *psk)
+{
+	const struct hostapd_wpa_psk **tbl;
+	size_t size, i;
+
+	if (2 * (prev->count + 1) > prev->size) {
+		size = prev->size ? 2 * prev->size : 16;
+		tbl = os_calloc(size, sizeof(*tbl));
+		if (!tbl)
+			return -1;
+		for (i = 0; i < prev->size; i++) {
+			if (prev->tbl[i])
+				hostapd_wpa_psk_prev_insert(tbl, size,
+							    prev->tbl[i]);
+		}
+		os_free(prev->tbl);
+		prev->tbl = tbl;
+		prev->size = size;
+	}
+
+	hostapd_wpa_psk_prev_insert(prev->tbl, prev->size, psk);
+	prev->count++;
+	return 0;
+}
+
+
+static int hostapd_wpa_psk_prev_init(struct hostapd_wpa_psk_prev *prev,
+				     const struct hostapd_wpa_psk *list)
+{
+	const struct hostapd_wpa_psk *psk;
+
+	os_memset(prev, 0, sizeof(*prev));
+	for (psk = list; psk; psk = psk->next) {
+		if (psk->passphrase_hash_set &&
+		    hostapd_wpa_psk_prev_add(prev, psk) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+
+static const struct hostapd_wpa_psk *
+hostapd_wpa_psk_prev_get(struct hostapd_wpa_psk_prev *prev, const u8 *hash)
+{
+	size_t i;
+
+	if (!prev || !prev->tbl)
+		return NULL;
+
+	i = WPA_GET_BE32(hash) & (prev->size - 1);
+	while (prev->tbl[i]) {
+		if (os_memcmp(prev->tbl[i]->passphrase_hash, hash,
+			      SHA256_MAC_LEN) == 0)
+			return prev->tbl[i];
+		i = (i + 1) & (prev->size - 1);
+	}
+
+	return NULL;
+}
+
+
+static int hostapd_wpa_psk_from_passphrase(struct hostapd_ssid *ssid,
+					   struct hostapd_wpa_psk *psk,
+					   const char *passphrase,
+					   struct hostapd_wpa_psk_prev *prev)
+{
+	const struct hostapd_wpa_psk *src;
+
+	hostapd_wpa_psk_passphrase_hash(ssid, passphrase,
+					psk->passphrase_hash);
+	psk->passphrase_hash_set = 1;
+
+	src = hostapd_wpa_psk_prev_get(prev, psk->passphrase_hash);
+	if (src) {
+		os_memcpy(psk->psk, src->psk, PMK_LEN);
+		return 1;
+	}
+
+	if (pbkdf2_sha1(passphrase, ssid->ssid, ssid->ssid_len,
+			4096, psk->psk, PMK_LEN) < 0)
+		return -1;
+
+	/* Same passphrase may be used for multiple STAs; derive it only once.
+	 * The entry stays valid until the table is freed since the new list is
+	 * not released during setup. */
+	if (prev)
+		hostapd_wpa_psk_prev_add(prev, psk);
+	return 0;
+}
+
+
+/* Passphrase from a PSK file waiting for the PMK to be derived */
+struct hostapd_wpa_psk_pending {
+	struct hostapd_wpa_psk *psk;
+	/* Earlier entry with the same passphrase or %NULL to run PBKDF2 */
+	const struct hostapd_wpa_psk *src;
+	char *passphrase;
+};
+
+
+static int hostapd_wpa_psk_pending_add(struct hostapd_wpa_psk_pending **pending,
+				       size_t *num, struct hostapd_ssid *ssid,
+				       struct hostapd_wpa_psk *psk,
+				       const char *passphrase,
+				       struct hostapd_wpa_psk_prev *prev)
+{
+	struct hostapd_wpa_psk_pending *n, *p;
+
+	if ((*num & (*num - 1)) == 0) {
+		n = os_realloc_array(*pending, *num ? 2 * *num : 16,
+				     sizeof(**pending));
+		if (!n)
+			return -1;
+		*pending = n;
+	}
+	p = &(*pending)[*num];
+	os_memset(p, 0, sizeof(*p));
+	p->psk = psk;
+
+	hostapd_wpa_psk_passphrase_hash(ssid, passphrase, psk->passphrase_hash);
+	psk->passphrase_hash_set = 1;
+	p->src = hostapd_wpa_psk_prev_get(prev, psk->passphrase_hash);
+	if (!p->src) {
+		p->passphrase = os_strdup(passphrase);
+		if (!p->passphrase)
+			return -1;
+		/* Same passphrase may be used for multiple STAs; derive it
+		 * only once. */
+		if (prev)
+			hostapd_wpa_psk_prev_add(prev, psk);
+	}
+	(*num)++;
+	return 0;
+}
+
+
+static int hostapd_wpa_psk_pending_derive(struct hostapd_ssid *ssid,
+					  struct hostapd_wpa_psk_pending *pending,
+					  size_t num, unsigned int *derived)
+{
+	struct pbkdf2_sha1_job *jobs;
+	size_t i, num_jobs = 0;
+	int ret;
+
+	jobs = os_calloc(num, sizeof(*jobs));
+	if (!jobs)
+		return -1;
+	for (i = 0; i < num; i++) {
+		if (pending[i].src)
+			continue;
+		jobs[num_jobs].passphrase = pending[i].passphrase;
+		jobs[num_jobs].ssid = ssid->ssid;
+		jobs[num_jobs].ssid_len = ssid->ssid_len;
+		jobs[num_jobs].buf = pending[i].psk->psk;
+		jobs[num_jobs].buflen = PMK_LEN;
+		num_jobs++;
+	}
+
+	ret = pbkdf2_sha1_batch(jobs, num_jobs, 4096, 0);
+	os_free(jobs);
+	if (ret < 0)
+		return -1;
+	*derived = num_jobs;
+
+	/* All sources are now derived, either earlier or in this batch */
+	for (i = 0; i < num; i++) {
+		if (pending[i].src)
+			os_memcpy(pending[i].psk->psk, pending[i].src->psk,
+				  PMK_LEN);
+	}
+
+	return 0;
+}
+
+
+static void hostapd_wpa_psk_pending_free(struct hostapd_wpa_psk_pending *pending,
+					 size_t num)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++)
+		str_clear_free(pending[i].passphrase);
+	os_free(pending);
+}
+
+
 static int hostapd_config_read_wpa_psk(const char *fname,
-				       struct hostapd_ssid *ssid)
+				       struct hostapd_ssid *ssid,
+				       struct hostapd_wpa_psk_prev *prev)
 {
 	FILE *f;
 	char buf[128], *pos;
@@ -312,8 +544,11 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 	char *name;
 	char *value;
 	int line = 0, ret = 0, len, ok;
+	unsigned int derived = 0;
 	u8 addr[ETH_ALEN];
 	struct hostapd_wpa_psk *psk;
+	struct hostapd_wpa_psk_pending *pending = NULL;
+	size_t num_pending = 0;
 
 	if (!fname)
 		return 0;
@@ -407,12 +642,14 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		ok = 0;
 		len = os_strlen(pos);
 		if (len == 2 * PMK_LEN &&
-		    hexstr2bin(pos, psk->psk, PMK_LEN) == 0)
-			ok = 1;
-		else if (len >= 8 && len < 64 &&
-			 pbkdf2_sha1(pos, ssid->ssid, ssid->ssid_len,
-				     4096, psk->psk, PMK_LEN) == 0)
+		    hexstr2bin(pos, psk->psk, PMK_LEN) == 0) {
 			ok = 1;
+		} else if (len >= 8 && len < 64) {
+			/* PMKs are derived in a batch once the file is read */
+			ok = hostapd_wpa_psk_pending_add(&pending, &num_pending,
+							 ssid, psk, pos,
+							 prev) == 0;
+		}
 		if (!ok) {
 			wpa_printf(MSG_ERROR,
 				   "Invalid PSK '%s' on line %d in '%s'",
@@ -442,11 +679,26 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 
 	fclose(f);
 
+	if (ret == 0 && num_pending &&
+	    hostapd_wpa_psk_pending_derive(ssid, pending, num_pending,
+					   &derived) < 0) {
+		wpa_printf(MSG_ERROR,
+			   "Failed to derive PSKs from passphrases in '%s'",
+			   fname);
+		ret = -1;
+	}
+	hostapd_wpa_psk_pending_free(pending, num_pending);
+
+	wpa_printf(MSG_DEBUG,
+		   "Read %d lines from WPA PSK file '%s' (passphrases: %u derived, %u reused)",
+		   line, fname, derived, (unsigned int) num_pending - derived);
+
 	return ret;
 }
 
 
-static int hostapd_derive_psk(struct hostapd_ssid *ssid)
+static int hostapd_derive_psk(struct hostapd_ssid *ssid,
+			      struct hostapd_wpa_psk_prev *prev)
 {
 	ssid->wpa_psk = os_zalloc(sizeof(struct hostapd_wpa_psk));
 	if (ssid->wpa_psk == NULL) {
@@ -458,49 +710,73 @@ static int hostapd_derive_psk(struct hostapd_ssid *ssid)
 	wpa_hexdump_ascii_key(MSG_DEBUG, "PSK (ASCII passphrase)",
 			      (u8 *) ssid->wpa_passphrase,
 			      os_strlen(ssid->wpa_passphrase));
-	pbkdf2_sha1(ssid->wpa_passphrase,
-		    ssid->ssid, ssid->ssid_len,
-		    4096, ssid->wpa_psk->psk, PMK_LEN);
+	hostapd_wpa_psk_from_passphrase(ssid, ssid->wpa_psk,
+					ssid->wpa_passphrase, prev);
 	wpa_hexdump_key(MSG_DEBUG, "PSK (from passphrase)",
 			ssid->wpa_psk->psk, PMK_LEN);
 	return 0;
 }
 
 
+#ifdef CONFIG_SAE
+static void hostapd_sae_pt_cache_reserve(struct hostapd_bss_config *conf,
+					 unsigned int entries)
+{
+	sae_pt_cache_reserve((int) entries -
+			     (int) conf->sae_pt_cache_reserved);
+	conf->sae_pt_cache_reserved = entries;
+}
+#endif /* CONFIG_SAE */
+
+
 int hostapd_setup_sae_pt(struct hostapd_bss_config *conf)
 {
 #ifdef CONFIG_SAE
 	struct hostapd_ssid *ssid = &conf->ssid;
 	struct sae_password_entry *pw;
+	unsigned int num_pw;
 
 	if ((conf->sae_pwe == 0 && !hostapd_sae_pw_id_in_use(conf) &&
 	     !hostapd_sae_pk_in_use(conf)) ||
 	    conf->sae_pwe == 3 ||
-	    !wpa_key_mgmt_sae(conf->wpa_key_mgmt))
+	    !wpa_key_mgmt_sae(conf->wpa_key_mgmt)) {
+		hostapd_sae_pt_cache_reserve(conf, 0);
 		return 0; /* PT not needed */
+	}
+
+	/* Make sure all PTs of this configuration fit into the cache */
+	num_pw = ssid->wpa_passphrase ? 1 : 0;
+	for (pw = conf->sae_passwords; pw; pw = pw->next)
+		num_pw++;
+	hostapd_sae_pt_cache_reserve(conf, num_pw *
+				     (conf->sae_groups ?
+				      int_array_len(conf->sae_groups) : 1));
 
 	sae_deinit_pt(ssid->pt);
 	ssid->pt = NULL;
 	if (ssid->wpa_passphrase) {
-		ssid->pt = sae_derive_pt(conf->sae_groups, ssid->ssid,
-					 ssid->ssid_len,
-					 (const u8 *) ssid->wpa_passphrase,
-					 os_strlen(ssid->wpa_passphrase),
-					 NULL);
+		ssid->pt = sae_derive_pt_cached(conf->sae_groups, ssid->ssid,
+						ssid->ssid_len,
+						(const u8 *) ssid->wpa_passphrase,
+						os_strlen(ssid->wpa_passphrase),
+						NULL);
 		if (!ssid->pt)
 			return -1;
 	}
 
 	for (pw = conf->sae_passwords; pw; pw = pw->next) {
 		sae_deinit_pt(pw->pt);
-		pw->pt = sae_derive_pt(conf->sae_groups, ssid->ssid,
-				       ssid->ssid_len,
-				       (const u8 *) pw->password,
-				       os_strlen(pw->password),
-				       pw->identifier);
+		pw->pt = sae_derive_pt_cached(conf->sae_groups, ssid->ssid,
+					      ssid->ssid_len,
+					      (const u8 *) pw->password,
+					      os_strlen(pw->password),
+					      pw->identifier);
 		if (!pw->pt)
 			return -1;
 	}
+
+	if (conf->sae_pt_cache_file)
+		sae_pt_cache_save(conf->sae_pt_cache_file, 0);
 #endif /* CONFIG_SAE */
 
 	return 0;
@@ -508,12 +784,36 @@ int hostapd_setup_sae_pt(struct hostapd_bss_config *conf)
 
 
 int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf)
+{
+	return hostapd_setup_wpa_psk_reuse(conf, NULL);
+}
+
+
+/**
+ * hostapd_setup_wpa_psk_reuse - Set up WPA PSKs for a BSS
+ * @conf: BSS configuration
+ * @prev: PSK list from an earlier configuration of the BSS or %NULL
+ * Returns: 0 on success, -1 on failure
+ *
+ * This is like hostapd_setup_wpa_psk(), but PMKs for passphrases that were
+ * already derived for the same SSID in @prev are copied instead of running
+ * PBKDF2 again. @prev is not modified; the caller is responsible for freeing
+ * it after this call.
+ */
+int hostapd_setup_wpa_psk_reuse(struct hostapd_bss_config *conf,
+				const struct hostapd_wpa_psk *prev)
 {
 	struct hostapd_ssid *ssid = &conf->ssid;
+	struct hostapd_wpa_psk_prev prev_tbl;
+	int ret = -1;
 
 	if (hostapd_setup_sae_pt(conf) < 0)
 		return -1;
 
+	if (hostapd_wpa_psk_prev_init(&prev_tbl, prev) < 0)
+		wpa_printf(MSG_DEBUG,
+			   "Could not index previous PSKs - derive all PSKs");
+
 	if (ssid->wpa_passphrase != NULL) {
 		if (ssid->wpa_psk != NULL) {
 			wpa_printf(MSG_DEBUG, "Using pre-configured WPA PSK "
@@ -521,13 +821,81 @@ int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf)
 		} else {
 			wpa_printf(MSG_DEBUG, "Deriving WPA PSK based on "
 				   "passphrase");
-			if (hostapd_derive_psk(ssid) < 0)
-				return -1;
+			if (hostapd_derive_psk(ssid, &prev_tbl) < 0)
+				goto out;
 		}
 		ssid->wpa_psk->group = 1;
 	}
 
-	return hostapd_config_read_wpa_psk(ssid->wpa_psk_file, &conf->ssid);
+	ret = hostapd_config_read_wpa_psk(ssid->wpa_psk_file, &conf->ssid,
+					  &prev_tbl);
+out:
+	os_free(prev_tbl.tbl);
+	hostapd_wpa_psk_index_update(ssid);
+	return ret;
+}
+
+
+static unsigned int hostapd_wpa_psk_hash(const u8 *addr, unsigned int size)
+{
+	u32 hash;
+
+	hash = WPA_GET_BE24(addr) ^ (WPA_GET_BE24(addr + 3) * 0x9e3779b1);
+	return (hash ^ (hash >> 15)) & (size - 1);
+}
+
+
+/**
+ * hostapd_wpa_psk_index_update - Rebuild the STA address index for PSKs
+ * @ssid: SSID configuration with the wpa_psk list
+ *
+ * This needs to be called after entries have been added to or removed from
+ * ssid->wpa_psk. Entries that are bound to a specific STA address are
+ * indexed by that address while wildcard and P2P Device Address entries are
+ * kept in a separate list. If the index cannot be allocated,
+ * hostapd_get_psk() falls back to going through the full list.
+ */
+void hostapd_wpa_psk_index_update(struct hostapd_ssid *ssid)
+{
+	struct hostapd_wpa_psk *psk;
+	unsigned int count = 0, size = 16, order = 0, h;
+
+	os_free(ssid->wpa_psk_hash);
+	ssid->wpa_psk_hash = NULL;
+	ssid->wpa_psk_hash_size = 0;
+	ssid->wpa_psk_hash_head = NULL;
+	ssid->wpa_psk_any = NULL;
+
+	for (psk = ssid->wpa_psk; psk; psk = psk->next)
+		count++;
+	if (!count)
+		return;
+	while (size < count && size < 0x1000000)
+		size <<= 1;
+
+	ssid->wpa_psk_hash = os_calloc(size, sizeof(*ssid->wpa_psk_hash));
+	if (!ssid->wpa_psk_hash)
+		return;
+	/* Generation 0 is reserved for entries that have not been indexed */
+	if (++ssid->wpa_psk_hash_gen == 0)
+		ssid->wpa_psk_hash_gen++;
+
+	for (psk = ssid->wpa_psk; psk; psk = psk->next) {
+		psk->order = order++;
+		psk->hash_gen = ssid->wpa_psk_hash_gen;
+		if (psk->group || is_zero_ether_addr(psk->addr) ||
+		    !is_zero_ether_addr(psk->p2p_dev_addr)) {
+			psk->hnext = ssid->wpa_psk_any;
+			ssid->wpa_psk_any = psk;
+		} else {
+			h = hostapd_wpa_psk_hash(psk->addr, size);
+			psk->hnext = ssid->wpa_psk_hash[h];
+			ssid->wpa_psk_hash[h] = psk;
+		}
+	}
+
+	ssid->wpa_psk_hash_size = size;
+	ssid->wpa_psk_hash_head = ssid->wpa_psk;
 }
 
 
@@ -658,6 +1026,254 @@ void hostapd_config_free_eap_users(struct hostapd_eap_user *user)
 }
 
 
+struct hostapd_eap_user_trie {
+	struct hostapd_eap_user_trie *child; /* first child node */
+	struct hostapd_eap_user_trie *sibling;
+	struct hostapd_eap_user *user; /* first wildcard prefix entry */
+	u8 label;
+};
+
+struct hostapd_eap_user_index {
+	struct hostapd_eap_user *head; /* eap_user list that is indexed */
+	struct hostapd_eap_user *next; /* first entry not yet indexed */
+	unsigned int count; /* number of indexed entries */
+	struct hostapd_eap_user **hash; /* exact identities */
+	unsigned int hash_size;
+	struct hostapd_eap_user *any; /* first "*" entry */
+	struct hostapd_eap_user_trie prefix[2]; /* wildcard prefixes (phase) */
+};
+
+
+static unsigned int hostapd_eap_user_hash(const u8 *identity, size_t len,
+					  unsigned int size)
+{
+	u32 hash = 2166136261U;
+
+	while (len--) {
+		hash ^= *identity++;
+		hash *= 16777619U;
+	}
+	return (hash ^ (hash >> 16)) & (size - 1);
+}
+
+
+static void hostapd_eap_user_trie_free(struct hostapd_eap_user_trie *node)
+{
+	struct hostapd_eap_user_trie *child, *next;
+
+	for (child = node->child; child; child = next) {
+		next = child->sibling;
+		hostapd_eap_user_trie_free(child);
+		os_free(child);
+	}
+	node->child = NULL;
+}
+
+
+static int hostapd_eap_user_trie_add(struct hostapd_eap_user_trie *node,
+				     struct hostapd_eap_user *user)
+{
+	struct hostapd_eap_user_trie *child;
+	size_t i;
+
+	for (i = 0; i < user->identity_len; i++) {
+		for (child = node->child; child; child = child->sibling) {
+			if (child->label == user->identity[i])
+				break;
+		}
+		if (!child) {
+			child = os_zalloc(sizeof(*child));
+			if (!child)
+				return -1;
+			child->label = user->identity[i];
+			child->sibling = node->child;
+			node->child = child;
+		}
+		node = child;
+	}
+
+	/* Earlier entries in the list take precedence */
+	if (!node->user)
+		node->user = user;
+	return 0;
+}
+
+
+void hostapd_eap_user_index_free(struct hostapd_bss_config *conf)
+{
+	struct hostapd_eap_user_index *idx = conf->eap_user_index;
+
+	if (!idx)
+		return;
+	hostapd_eap_user_trie_free(&idx->prefix[0]);
+	hostapd_eap_user_trie_free(&idx->prefix[1]);
+	os_free(idx->hash);
+	os_free(idx);
+	conf->eap_user_index = NULL;
+}
+
+
+/**
+ * hostapd_eap_user_index_update - Build the EAP user index
+ * @conf: BSS configuration with the eap_user list
+ * @max_users: Maximum number of entries to add in this call
+ * Returns: 1 if the full list is indexed, 0 if more entries remain to be
+ * added, or -1 on failure
+ *
+ * Exact identities are indexed in a hash table and wildcard prefix entries
+ * in a trie so that hostapd_config_get_eap_user() does not need to go
+ * through the full list. The index is built in steps of at most @max_users
+ * entries and a new index is started automatically if conf->eap_user has
+ * been replaced. Lookups use the entries that are already indexed and go
+ * through the remaining part of the list, so the result is the same at any
+ * point of the build. On failure, lookups fall back to the full list.
+ */
+int hostapd_eap_user_index_update(struct hostapd_bss_config *conf,
+				  unsigned int max_users)
+{
+	struct hostapd_eap_user_index *idx = conf->eap_user_index;
+	struct hostapd_eap_user *user;
+	unsigned int count = 0, size = 16, h;
+
+	if (idx && idx->head != conf->eap_user)
+		hostapd_eap_user_index_free(conf);
+	if (!conf->eap_user)
+		return 1;
+
+	idx = conf->eap_user_index;
+	if (!idx) {
+		for (user = conf->eap_user; user; user = user->next)
+			count++;
+		while (size < count && size < 0x1000000)
+			size <<= 1;
+
+		idx = os_zalloc(sizeof(*idx));
+		if (!idx)
+			return -1;
+		idx->hash = os_calloc(size, sizeof(*idx->hash));
+		if (!idx->hash) {
+			os_free(idx);
+			return -1;
+		}
+		idx->hash_size = size;
+		idx->head = idx->next = conf->eap_user;
+		conf->eap_user_index = idx;
+	}
+
+	while (idx->next && max_users--) {
+		user = idx->next;
+		user->order = idx->count;
+		if (user->wildcard_prefix) {
+			if (hostapd_eap_user_trie_add(&idx->prefix[!!user->phase2],
+						      user) < 0) {
+				hostapd_eap_user_index_free(conf);
+				return -1;
+			}
+		} else {
+			if (!user->identity && !idx->any)
+				idx->any = user;
+			h = hostapd_eap_user_hash(user->identity,
+						  user->identity_len,
+						  idx->hash_size);
+			user->hnext = idx->hash[h];
+			idx->hash[h] = user;
+		}
+		idx->next = user->next;
+		idx->count++;
+	}
+
+	return idx->next ? 0 : 1;
+}
+
+
+static int hostapd_eap_user_match(const struct hostapd_eap_user *user,
+				  const u8 *identity, size_t identity_len,
+				  int phase2)
+{
+	if (!phase2 && user->identity == NULL) {
+		/* Wildcard match */
+		return 1;
+	}
+
+	if (user->phase2 == !!phase2 && user->wildcard_prefix &&
+	    identity_len >= user->identity_len &&
+	    os_memcmp(user->identity, identity, user->identity_len) == 0) {
+		/* Wildcard prefix match */
+		return 1;
+	}
+
+	return user->phase2 == !!phase2 &&
+		user->identity_len == identity_len &&
+		os_memcmp(user->identity, identity, identity_len) == 0;
+}
+
+
+static struct hostapd_eap_user *
+hostapd_get_eap_user_indexed(const struct hostapd_eap_user_index *idx,
+			     const u8 *identity, size_t identity_len,
+			     int phase2)
+{
+	const struct hostapd_eap_user_trie *node;
+	struct hostapd_eap_user *user, *best = NULL;
+	size_t i;
+
+	if (!phase2)
+		best = idx->any;
+
+	for (user = idx->hash[hostapd_eap_user_hash(identity, identity_len,
+						    idx->hash_size)];
+	     user; user = user->hnext) {
+		if ((!best || user->order < best->order) &&
+		    hostapd_eap_user_match(user, identity, identity_len,
+					   phase2))
+			best = user;
+	}
+
+	/* All nodes on the path are prefixes of the identity */
+	node = &idx->prefix[!!phase2];
+	for (i = 0; node; i++) {
+		if (node->user && (!best || node->user->order < best->order))
+			best = node->user;
+		if (i == identity_len)
+			break;
+		for (node = node->child; node; node = node->sibling) {
+			if (node->label == identity[i])
+				break;
+		}
+	}
+
+	return best;
+}
+
+
+struct hostapd_eap_user *
+hostapd_config_get_eap_user(const struct hostapd_bss_config *conf,
+			    const u8 *identity, size_t identity_len,
+			    int phase2)
+{
+	const struct hostapd_eap_user_index *idx = conf->eap_user_index;
+	struct hostapd_eap_user *user = conf->eap_user;
+
+	if (idx && idx->head == conf->eap_user) {
+		user = hostapd_get_eap_user_indexed(idx, identity,
+						    identity_len, phase2);
+		if (user)
+			return user;
+		/* Entries that are not yet indexed come after indexed ones */
+		user = idx->next;
+	}
+
+	while (user) {
+		if (hostapd_eap_user_match(user, identity, identity_len,
+					   phase2))
+			break;
+		user = user->next;
+	}
+
+	return user;
+}
+
+
 #ifdef CONFIG_WEP
 static void hostapd_config_free_wep(struct hostapd_wep_keys *keys)
 {
@@ -756,6 +1372,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 		return;
 
 	hostapd_config_clear_wpa_psk(&conf->ssid.wpa_psk);
+	os_free(conf->ssid.wpa_psk_hash);
 
 	str_clear_free(conf->ssid.wpa_passphrase);
 	os_free(conf->ssid.wpa_psk_file);
@@ -769,6 +1386,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	sae_deinit_pt(conf->ssid.pt);
 #endif /* CONFIG_SAE */
 
+	hostapd_eap_user_index_free(conf);
 	hostapd_config_free_eap_users(conf->eap_user);
 	os_free(conf->eap_user_sqlite);
 
@@ -796,6 +1414,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	os_free(conf->private_key_passwd);
 	os_free(conf->private_key_passwd2);
 	os_free(conf->check_cert_subject);
+	os_free(conf->tls_session_cache_file);
 	os_free(conf->ocsp_stapling_response);
 	os_free(conf->ocsp_stapling_response_multi);
 	os_free(conf->dh_file);
@@ -948,6 +1567,10 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 #endif /* CONFIG_DPP */
 
 	hostapd_config_free_sae_passwords(conf);
+	os_free(conf->sae_pt_cache_file);
+#ifdef CONFIG_SAE
+	hostapd_sae_pt_cache_reserve(conf, 0);
+#endif /* CONFIG_SAE */
 
 #ifdef CONFIG_AIRTIME_POLICY
 	{
@@ -1090,6 +1713,65 @@ const char * hostapd_get_vlan_id_ifname(struct hostapd_vlan *vlan, int vlan_id)
 }
 
 
+static int hostapd_wpa_psk_match(const struct hostapd_wpa_psk *psk,
+				 const u8 *addr, const u8 *p2p_dev_addr)
+{
+	return psk->group ||
+		(addr && os_memcmp(psk->addr, addr, ETH_ALEN) == 0) ||
+		(!addr && p2p_dev_addr &&
+		 os_memcmp(psk->p2p_dev_addr, p2p_dev_addr, ETH_ALEN) == 0);
+}
+
+
+static int hostapd_wpa_psk_index_valid(const struct hostapd_ssid *ssid)
+{
+	return ssid->wpa_psk_hash && ssid->wpa_psk &&
+		ssid->wpa_psk_hash_head == ssid->wpa_psk &&
+		ssid->wpa_psk->hash_gen == ssid->wpa_psk_hash_gen;
+}
+
+
+static struct hostapd_wpa_psk *
+hostapd_get_psk_indexed(const struct hostapd_ssid *ssid, const u8 *addr,
+			const u8 *p2p_dev_addr, const u8 *prev_psk)
+{
+	struct hostapd_wpa_psk *chains[2], *psk, *best = NULL;
+	unsigned int min_order = 0;
+	int i, found = 0;
+
+	/* Candidates are returned in the wpa_psk list order, so both the
+	 * wildcard entries and the per-STA entries need to be considered */
+	chains[0] = ssid->wpa_psk_any;
+	chains[1] = addr ? ssid->wpa_psk_hash[
+		hostapd_wpa_psk_hash(addr, ssid->wpa_psk_hash_size)] : NULL;
+
+	if (prev_psk) {
+		for (i = 0; i < 2 && !found; i++) {
+			for (psk = chains[i]; psk; psk = psk->hnext) {
+				if (psk->psk == prev_psk) {
+					min_order = psk->order + 1;
+					found = 1;
+					break;
+				}
+			}
+		}
+		if (!found)
+			return NULL;
+	}
+
+	for (i = 0; i < 2; i++) {
+		for (psk = chains[i]; psk; psk = psk->hnext) {
+			if (psk->order >= min_order &&
+			    (!best || psk->order < best->order) &&
+			    hostapd_wpa_psk_match(psk, addr, p2p_dev_addr))
+				best = psk;
+		}
+	}
+
+	return best;
+}
+
+
 const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   const u8 *addr, const u8 *p2p_dev_addr,
 			   const u8 *prev_psk, int *vlan_id)
@@ -1111,13 +1793,16 @@ const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   MAC2STR(addr), prev_psk);
 	}
 
+	if (hostapd_wpa_psk_index_valid(&conf->ssid)) {
+		psk = hostapd_get_psk_indexed(&conf->ssid, addr, p2p_dev_addr,
+					      prev_psk);
+		if (psk && vlan_id)
+			*vlan_id = psk->vlan_id;
+		return psk ? psk->psk : NULL;
+	}
+
 	for (psk = conf->ssid.wpa_psk; psk != NULL; psk = psk->next) {
-		if (next_ok &&
-		    (psk->group ||
-		     (addr && os_memcmp(psk->addr, addr, ETH_ALEN) == 0) ||
-		     (!addr && p2p_dev_addr &&
-		      os_memcmp(psk->p2p_dev_addr, p2p_dev_addr, ETH_ALEN) ==
-		      0))) {
+		if (next_ok && hostapd_wpa_psk_match(psk, addr, p2p_dev_addr)) {
 			if (vlan_id)
 				*vlan_id = psk->vlan_id;
 			return psk->psk;
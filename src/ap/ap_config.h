@@ -66,6 +66,7 @@ struct mac_acl_entry {
 struct hostapd_radius_servers;
 struct ft_remote_r0kh;
 struct ft_remote_r1kh;
+struct hostapd_eap_user_index;
 
 #ifdef CONFIG_WEP
 #define NUM_WEP_KEYS 4
@@ -106,6 +107,16 @@ struct hostapd_ssid {
 	char *wpa_psk_file;
 	struct sae_pt *pt;
 
+	/* Index of wpa_psk by STA address; see hostapd_wpa_psk_index_update().
+	 * The index is used only as long as wpa_psk_hash_head still matches
+	 * wpa_psk, so list modifications fall back to a full list search
+	 * until the index is updated. */
+	struct hostapd_wpa_psk **wpa_psk_hash;
+	struct hostapd_wpa_psk *wpa_psk_any; /* entries not indexed by addr */
+	struct hostapd_wpa_psk *wpa_psk_hash_head;
+	unsigned int wpa_psk_hash_size;
+	unsigned int wpa_psk_hash_gen;
+
 #ifdef CONFIG_WEP
 	struct hostapd_wep_keys wep;
 #endif /* CONFIG_WEP */
@@ -163,10 +174,23 @@ struct hostapd_wpa_psk {
 	u8 addr[ETH_ALEN];
 	u8 p2p_dev_addr[ETH_ALEN];
 	int vlan_id;
+
+	/* Hash over SSID and passphrase for entries derived from a passphrase;
+	 * used to avoid repeating PBKDF2 for unchanged entries on reload */
+	int passphrase_hash_set;
+	u8 passphrase_hash[SHA256_MAC_LEN];
+
+	/* hostapd_ssid::wpa_psk_hash chain; valid only when hash_gen matches
+	 * hostapd_ssid::wpa_psk_hash_gen */
+	struct hostapd_wpa_psk *hnext;
+	unsigned int order; /* position in the hostapd_ssid::wpa_psk list */
+	unsigned int hash_gen;
 };
 
 struct hostapd_eap_user {
 	struct hostapd_eap_user *next;
+	struct hostapd_eap_user *hnext; /* identity hash chain */
+	unsigned int order; /* position in the list when indexed */
 	u8 *identity;
 	size_t identity_len;
 	struct {
@@ -292,7 +316,14 @@ struct hostapd_bss_config {
 	int eap_server; /* Use internal EAP server instead of external
 			 * RADIUS server */
 	struct hostapd_eap_user *eap_user;
+	/* Index of eap_user; see hostapd_eap_user_index_update() */
+	struct hostapd_eap_user_index *eap_user_index;
+	/* Index build failed; use full list search until eap_user reload */
+	int eap_user_index_failed;
 	char *eap_user_sqlite;
+	unsigned int eap_user_sqlite_cache_size; /* 0 = no cache */
+	unsigned int eap_user_sqlite_cache_ttl; /* in seconds */
+	int eap_user_sqlite_async;
 	char *eap_sim_db;
 	unsigned int eap_sim_db_timeout;
 	int eap_server_erp; /* Whether ERP is enabled on internal EAP server */
@@ -415,6 +446,8 @@ struct hostapd_bss_config {
 	int check_crl_strict;
 	unsigned int crl_reload_interval;
 	unsigned int tls_session_lifetime;
+	unsigned int tls_session_cache_size;
+	char *tls_session_cache_file;
 	unsigned int tls_flags;
 	unsigned int max_auth_rounds;
 	unsigned int max_auth_rounds_short;
@@ -444,6 +477,7 @@ struct hostapd_bss_config {
 	int radius_server_auth_port;
 	int radius_server_acct_port;
 	int radius_server_ipv6;
+	int radius_server_max_sessions;
 
 	int use_pae_group_addr; /* Whether to send EAPOL frames to PAE group
 				 * address instead of individual address
@@ -453,6 +487,9 @@ struct hostapd_bss_config {
 	int ap_max_inactivity;
 	int ignore_broadcast_ssid;
 	int no_probe_resp_if_max_sta;
+	unsigned int probe_resp_rate_limit;
+	unsigned int probe_resp_rate_burst;
+	unsigned int probe_resp_dedup_time;
 
 	int wmm_enabled;
 	int wmm_uapsd;
@@ -657,11 +694,16 @@ struct hostapd_bss_config {
 
 	unsigned int sae_anti_clogging_threshold;
 	unsigned int sae_sync;
+	unsigned int sae_commit_queue_max;
+	unsigned int sae_commit_queue_delay;
+	int sae_commit_workers;
 	int sae_require_mfp;
 	int sae_confirm_immediate;
 	int sae_pwe;
 	int *sae_groups;
 	struct sae_password_entry *sae_passwords;
+	char *sae_pt_cache_file;
+	unsigned int sae_pt_cache_reserved; /* PT cache entries reserved */
 
 	char *wowlan_triggers; /* Wake-on-WLAN triggers */
 
@@ -1153,6 +1195,13 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss);
 void hostapd_config_free_radius_attr(struct hostapd_radius_attr *attr);
 void hostapd_config_free_eap_user(struct hostapd_eap_user *user);
 void hostapd_config_free_eap_users(struct hostapd_eap_user *user);
+int hostapd_eap_user_index_update(struct hostapd_bss_config *conf,
+				  unsigned int max_users);
+void hostapd_eap_user_index_free(struct hostapd_bss_config *conf);
+struct hostapd_eap_user *
+hostapd_config_get_eap_user(const struct hostapd_bss_config *conf,
+			    const u8 *identity, size_t identity_len,
+			    int phase2);
 void hostapd_config_clear_wpa_psk(struct hostapd_wpa_psk **p);
 void hostapd_config_free_bss(struct hostapd_bss_config *conf);
 void hostapd_config_free(struct hostapd_config *conf);
@@ -1163,6 +1212,9 @@ const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   const u8 *addr, const u8 *p2p_dev_addr,
 			   const u8 *prev_psk, int *vlan_id);
 int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf);
+int hostapd_setup_wpa_psk_reuse(struct hostapd_bss_config *conf,
+				const struct hostapd_wpa_psk *prev);
+void hostapd_wpa_psk_index_update(struct hostapd_ssid *ssid);
 int hostapd_vlan_valid(struct hostapd_vlan *vlan,
 		       struct vlan_description *vlan_desc);
 const char * hostapd_get_vlan_id_ifname(struct hostapd_vlan *vlan,
@@ -52,12 +52,12 @@ static int ap_list_beacon_olbc(struct hostapd_iface *iface, struct ap_info *ap)
 
 static struct ap_info * ap_get_ap(struct hostapd_iface *iface, const u8 *ap)
 {
-	struct ap_info *s;
+	struct addr_hash_node *node;
 
-	s = iface->ap_hash[STA_HASH(ap)];
-	while (s != NULL && os_memcmp(s->addr, ap, ETH_ALEN) != 0)
-		s = s->hnext;
-	return s;
+	node = addr_hash_get(&iface->ap_hash, ap);
+	if (!node)
+		return NULL;
+	return addr_hash_entry(node, struct ap_info, hnode);
 }
 
 
@@ -87,30 +87,17 @@ static void ap_ap_list_del(struct hostapd_iface *iface, struct ap_info *ap)
 }
 
 
-static void ap_ap_hash_add(struct hostapd_iface *iface, struct ap_info *ap)
+static int ap_ap_hash_add(struct hostapd_iface *iface, struct ap_info *ap)
 {
-	ap->hnext = iface->ap_hash[STA_HASH(ap->addr)];
-	iface->ap_hash[STA_HASH(ap->addr)] = ap;
+	return addr_hash_add(&iface->ap_hash,
+			     ADDR_HASH_ADDR_OFFSET(struct ap_info, hnode, addr),
+			     &ap->hnode);
 }
 
 
 static void ap_ap_hash_del(struct hostapd_iface *iface, struct ap_info *ap)
 {
-	struct ap_info *s;
-
-	s = iface->ap_hash[STA_HASH(ap->addr)];
-	if (s == NULL) return;
-	if (os_memcmp(s->addr, ap->addr, ETH_ALEN) == 0) {
-		iface->ap_hash[STA_HASH(ap->addr)] = s->hnext;
-		return;
-	}
-
-	while (s->hnext != NULL &&
-	       os_memcmp(s->hnext->addr, ap->addr, ETH_ALEN) != 0)
-		s = s->hnext;
-	if (s->hnext != NULL)
-		s->hnext = s->hnext->hnext;
-	else
+	if (addr_hash_del(&iface->ap_hash, &ap->hnode) < 0)
 		wpa_printf(MSG_INFO, "AP: could not remove AP " MACSTR
 			   " from hash table",  MAC2STR(ap->addr));
 }
@@ -152,9 +139,12 @@ static struct ap_info * ap_ap_add(struct hostapd_iface *iface, const u8 *addr)
 
 	/* initialize AP info data */
 	os_memcpy(ap->addr, addr, ETH_ALEN);
+	if (ap_ap_hash_add(iface, ap) < 0) {
+		os_free(ap);
+		return NULL;
+	}
 	ap_ap_list_add(iface, ap);
 	iface->num_ap++;
-	ap_ap_hash_add(iface, ap);
 
 	if (iface->num_ap > iface->conf->ap_table_max_size && ap != ap->prev) {
 		wpa_printf(MSG_DEBUG, "Removing the least recently used AP "
@@ -305,4 +295,5 @@ int ap_list_init(struct hostapd_iface *iface)
 void ap_list_deinit(struct hostapd_iface *iface)
 {
 	hostapd_free_aps(iface);
+	addr_hash_deinit(&iface->ap_hash);
 }
@@ -11,13 +11,15 @@
 #ifndef AP_LIST_H
 #define AP_LIST_H
 
+#include "utils/addr_hash.h"
+
 struct ap_info {
 	/* Note: next/prev pointers are updated whenever a new beacon is
 	 * received because these are used to find the least recently used
 	 * entries. */
 	struct ap_info *next; /* next entry in AP list */
 	struct ap_info *prev; /* previous entry in AP list */
-	struct ap_info *hnext; /* next entry in hash table list */
+	struct addr_hash_node hnode; /* entry in iface->ap_hash */
 	u8 addr[6];
 	u8 supported_rates[WLAN_SUPP_RATES_MAX];
 	int erp; /* ERP Info or -1 if ERP info element not present */
@@ -9,6 +9,9 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "utils/eloop.h"
+#include "crypto/crypto.h"
+#include "crypto/sha256.h"
 #include "crypto/tls.h"
 #include "eap_server/eap.h"
 #include "eap_server/eap_sim_db.h"
@@ -25,9 +28,8 @@
 #endif /* EAP_SERVER_SIM || EAP_SERVER_AKA */
 
 
-#ifdef EAP_SIM_DB
-static int hostapd_sim_db_cb_sta(struct hostapd_data *hapd,
-				 struct sta_info *sta, void *ctx)
+static int authsrv_eap_pending_cb_sta(struct hostapd_data *hapd,
+				      struct sta_info *sta, void *ctx)
 {
 	if (eapol_auth_eap_pending_cb(sta->eapol_sm, ctx) == 0)
 		return 1;
@@ -35,15 +37,32 @@ static int hostapd_sim_db_cb_sta(struct hostapd_data *hapd,
 }
 
 
-static void hostapd_sim_db_cb(void *ctx, void *session_ctx)
+/**
+ * authsrv_eap_pending_cb - Continue EAP processing after a pending operation
+ * @hapd: Pointer to BSS data
+ * @session_ctx: Pending EAP context pointer (EAP server state machine)
+ *
+ * The session is looked up from the stations using the integrated EAP server
+ * and, if not found there, from the RADIUS server sessions.
+ */
+void authsrv_eap_pending_cb(struct hostapd_data *hapd, void *session_ctx)
 {
-	struct hostapd_data *hapd = ctx;
-	if (ap_for_each_sta(hapd, hostapd_sim_db_cb_sta, session_ctx) == 0) {
+	if (ap_for_each_sta(hapd, authsrv_eap_pending_cb_sta,
+			    session_ctx) == 0) {
 #ifdef RADIUS_SERVER
 		radius_server_eap_pending_cb(hapd->radius_srv, session_ctx);
 #endif /* RADIUS_SERVER */
 	}
 }
+
+
+#ifdef EAP_SIM_DB
+static void hostapd_sim_db_cb(void *ctx, void *session_ctx)
+{
+	struct hostapd_data *hapd = ctx;
+
+	authsrv_eap_pending_cb(hapd, session_ctx);
+}
 #endif /* EAP_SIM_DB */
 
 
@@ -101,6 +120,22 @@ out:
 }
 
 
+static int hostapd_radius_prefetch_eap_user(void *ctx, const u8 *identity,
+					    size_t identity_len, int phase2,
+					    void *session_ctx)
+{
+	return hostapd_prefetch_eap_user(ctx, identity, identity_len, phase2,
+					 session_ctx);
+}
+
+
+static void hostapd_radius_cancel_eap_user_prefetch(void *ctx,
+						    void *session_ctx)
+{
+	hostapd_cancel_eap_user_prefetch(ctx, session_ctx);
+}
+
+
 static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 {
 	struct radius_server_conf srv;
@@ -111,7 +146,10 @@ static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 	srv.acct_port = conf->radius_server_acct_port;
 	srv.conf_ctx = hapd;
 	srv.ipv6 = conf->radius_server_ipv6;
+	srv.max_sessions = conf->radius_server_max_sessions;
 	srv.get_eap_user = hostapd_radius_get_eap_user;
+	srv.prefetch_eap_user = hostapd_radius_prefetch_eap_user;
+	srv.cancel_eap_user_prefetch = hostapd_radius_cancel_eap_user_prefetch;
 	srv.eap_req_id_text = conf->eap_req_id_text;
 	srv.eap_req_id_text_len = conf->eap_req_id_text_len;
 	srv.sqlite_file = conf->eap_user_sqlite;
@@ -170,6 +208,80 @@ static void authsrv_tls_event(void *ctx, enum tls_event ev,
 		break;
 	}
 }
+
+
+static void authsrv_tls_session_ctx_add(u8 *ctx, const void *data,
+					size_t len)
+{
+	const u8 *addr[2];
+	size_t vlen[2];
+
+	addr[0] = ctx;
+	vlen[0] = SHA256_MAC_LEN;
+	addr[1] = data;
+	vlen[1] = len;
+	sha256_vector(2, addr, vlen, ctx);
+}
+
+
+/*
+ * Hash of the server configuration that a resumed session relies on. The
+ * shared TLS session cache resumes sessions only through contexts with the
+ * same value, so a session cannot be used to skip certificate validation or
+ * the inner authentication of a BSS that would not have accepted it.
+ */
+static void authsrv_tls_session_ctx(struct hostapd_data *hapd, u8 *ctx)
+{
+	const struct hostapd_bss_config *conf = hapd->conf;
+	const char *str[] = {
+		conf->ca_cert, conf->server_cert, conf->server_cert2,
+		conf->private_key, conf->private_key2, conf->dh_file,
+		conf->openssl_ciphers, conf->openssl_ecdh_curves,
+		conf->check_cert_subject, conf->eap_user_sqlite,
+		conf->eap_sim_db, conf->server_id,
+	};
+	int val[3];
+	const struct hostapd_eap_user *user;
+	char *buf;
+	size_t i, len;
+
+	os_memset(ctx, 0, SHA256_MAC_LEN);
+	for (i = 0; i < ARRAY_SIZE(str); i++)
+		authsrv_tls_session_ctx_add(ctx, str[i],
+					    str[i] ? os_strlen(str[i]) + 1 : 0);
+
+	val[0] = conf->check_crl;
+	val[1] = conf->check_crl_strict;
+	val[2] = conf->tls_flags;
+	authsrv_tls_session_ctx_add(ctx, val, sizeof(val));
+
+	buf = conf->ca_cert ? os_readfile(conf->ca_cert, &len) : NULL;
+	if (buf) {
+		authsrv_tls_session_ctx_add(ctx, buf, len);
+		os_free(buf);
+	}
+
+	for (user = conf->eap_user; user; user = user->next) {
+		const u8 *addr[5];
+		size_t vlen[5];
+
+		val[0] = user->phase2;
+		val[1] = user->ttls_auth;
+		val[2] = user->wildcard_prefix | (user->password_hash << 1) |
+			(user->remediation << 2) | (user->macacl << 3);
+		addr[0] = ctx;
+		vlen[0] = SHA256_MAC_LEN;
+		addr[1] = user->identity;
+		vlen[1] = user->identity_len;
+		addr[2] = user->password;
+		vlen[2] = user->password_len;
+		addr[3] = (const u8 *) user->methods;
+		vlen[3] = sizeof(user->methods);
+		addr[4] = (const u8 *) val;
+		vlen[4] = sizeof(val);
+		sha256_vector(5, addr, vlen, ctx);
+	}
+}
 #endif /* EAP_TLS_FUNCS */
 
 
@@ -236,9 +348,19 @@ int authsrv_init(struct hostapd_data *hapd)
 	     hapd->conf->server_cert2 || hapd->conf->private_key2)) {
 		struct tls_config conf;
 		struct tls_connection_params params;
+		u8 session_ctx[SHA256_MAC_LEN];
 
 		os_memset(&conf, 0, sizeof(conf));
 		conf.tls_session_lifetime = hapd->conf->tls_session_lifetime;
+		conf.tls_session_cache_size =
+			hapd->conf->tls_session_cache_size;
+		conf.tls_session_cache_file =
+			hapd->conf->tls_session_cache_file;
+		if (hapd->conf->tls_session_cache_size) {
+			authsrv_tls_session_ctx(hapd, session_ctx);
+			conf.tls_session_cache_ctx = session_ctx;
+			conf.tls_session_cache_ctx_len = sizeof(session_ctx);
+		}
 		if (hapd->conf->crl_reload_interval > 0 &&
 		    hapd->conf->check_crl <= 0) {
 			wpa_printf(MSG_INFO,
@@ -252,6 +374,10 @@ int authsrv_init(struct hostapd_data *hapd)
 		conf.tls_flags = hapd->conf->tls_flags;
 		conf.event_cb = authsrv_tls_event;
 		conf.cb_ctx = hapd;
+		conf.submit_work = eloop_submit_work;
+		conf.cancel_work = eloop_cancel_work;
+		conf.register_read_sock = eloop_register_read_sock;
+		conf.unregister_read_sock = eloop_unregister_read_sock;
 		hapd->ssl_ctx = tls_init(&conf);
 		if (hapd->ssl_ctx == NULL) {
 			wpa_printf(MSG_ERROR, "Failed to initialize TLS");
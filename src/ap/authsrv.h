@@ -11,5 +11,6 @@
 
 int authsrv_init(struct hostapd_data *hapd);
 void authsrv_deinit(struct hostapd_data *hapd);
+void authsrv_eap_pending_cb(struct hostapd_data *hapd, void *session_ctx);
 
 #endif /* AUTHSRV_H */
@@ -433,7 +433,7 @@ static u8 * hostapd_gen_probe_resp(struct hostapd_data *hapd,
 				   int is_p2p, size_t *resp_len)
 {
 	struct ieee80211_mgmt *resp;
-	u8 *pos, *epos, *csa_pos;
+	u8 *pos, *epos, *csa_pos, *bss_load_pos;
 	size_t buflen;
 
 #define MAX_PROBERESP_LEN 768
@@ -523,7 +523,10 @@ static u8 * hostapd_gen_probe_resp(struct hostapd_data *hapd,
 	pos = hostapd_eid_ext_supp_rates(hapd, pos);
 
 	pos = hostapd_get_rsne(hapd, pos, epos - pos);
-	pos = hostapd_eid_bss_load(hapd, pos, epos - pos);
+	bss_load_pos = hostapd_eid_bss_load(hapd, pos, epos - pos);
+	hapd->bss_load_off_proberesp =
+		bss_load_pos != pos ? pos - (u8 *) resp : 0;
+	pos = bss_load_pos;
 	pos = hostapd_eid_rm_enabled_capab(hapd, pos, epos - pos);
 	pos = hostapd_get_mde(hapd, pos, epos - pos);
 
@@ -639,6 +642,35 @@ static u8 * hostapd_gen_probe_resp(struct hostapd_data *hapd,
 }
 
 
+static u8 * hostapd_get_probe_resp_tmpl(struct hostapd_data *hapd,
+					const struct ieee80211_mgmt *req,
+					int is_p2p, size_t *resp_len)
+{
+	struct ieee80211_mgmt *resp;
+	int idx = !!is_p2p;
+
+	if (!hapd->probe_resp_tmpl[idx]) {
+		hapd->probe_resp_tmpl[idx] =
+			hostapd_gen_probe_resp(hapd, NULL, is_p2p,
+					       &hapd->probe_resp_tmpl_len[idx]);
+		if (!hapd->probe_resp_tmpl[idx])
+			return NULL;
+	}
+
+	resp = (struct ieee80211_mgmt *) hapd->probe_resp_tmpl[idx];
+	os_memcpy(resp->da, req->sa, ETH_ALEN);
+
+	/* Station count in the BSS Load element is not tracked by the
+	 * template invalidation */
+	if (hapd->bss_load_off_proberesp)
+		hostapd_eid_bss_load(hapd, hapd->probe_resp_tmpl[idx] +
+				     hapd->bss_load_off_proberesp, 2 + 5);
+
+	*resp_len = hapd->probe_resp_tmpl_len[idx];
+	return hapd->probe_resp_tmpl[idx];
+}
+
+
 enum ssid_match_result {
 	NO_SSID_MATCH,
 	EXACT_SSID_MATCH,
@@ -808,6 +840,115 @@ void sta_track_claim_taxonomy_info(struct hostapd_iface *iface, const u8 *addr,
 #endif /* CONFIG_TAXONOMY */
 
 
+#define PROBE_REQ_SEEN_SIZE 256
+
+struct hostapd_probe_req_seen {
+	struct {
+		u8 addr[ETH_ALEN];
+		u32 ssid_hash;
+		struct os_reltime last;
+	} entry[PROBE_REQ_SEEN_SIZE];
+};
+
+
+static u32 probe_req_fnv1a(u32 hash, const u8 *data, size_t len)
+{
+	while (len--) {
+		hash ^= *data++;
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+
+/* Returns 1 if a response to the same STA for the same SSID was sent within
+ * probe_resp_dedup_time. *slot is set for hostapd_probe_req_seen_add(). */
+static int hostapd_probe_req_dup(struct hostapd_data *hapd, const u8 *addr,
+				 const u8 *ssid, size_t ssid_len,
+				 struct os_reltime *now, u32 *ssid_hash,
+				 u32 *slot)
+{
+	struct os_reltime age;
+	unsigned int ms = hapd->conf->probe_resp_dedup_time;
+
+	*ssid_hash = probe_req_fnv1a(2166136261U, ssid, ssid_len);
+	*slot = probe_req_fnv1a(*ssid_hash, addr, ETH_ALEN) %
+		PROBE_REQ_SEEN_SIZE;
+
+	if (!hapd->probe_req_seen ||
+	    os_memcmp(hapd->probe_req_seen->entry[*slot].addr, addr,
+		      ETH_ALEN) != 0 ||
+	    hapd->probe_req_seen->entry[*slot].ssid_hash != *ssid_hash)
+		return 0;
+
+	os_reltime_sub(now, &hapd->probe_req_seen->entry[*slot].last, &age);
+	return age.sec < (os_time_t) (ms / 1000) ||
+		(age.sec == (os_time_t) (ms / 1000) &&
+		 age.usec < (os_time_t) (ms % 1000) * 1000);
+}
+
+
+/* Collisions in the direct mapped table only result in additional
+ * responses */
+static void hostapd_probe_req_seen_add(struct hostapd_data *hapd,
+				       const u8 *addr, u32 ssid_hash, u32 slot,
+				       struct os_reltime *now)
+{
+	if (!hapd->probe_req_seen) {
+		hapd->probe_req_seen = os_zalloc(sizeof(*hapd->probe_req_seen));
+		if (!hapd->probe_req_seen)
+			return;
+	}
+
+	os_memcpy(hapd->probe_req_seen->entry[slot].addr, addr, ETH_ALEN);
+	hapd->probe_req_seen->entry[slot].ssid_hash = ssid_hash;
+	hapd->probe_req_seen->entry[slot].last = *now;
+}
+
+
+/**
+ * hostapd_probe_resp_rate_ok - Token bucket for probe_resp_rate_limit
+ * @hapd: BSS data
+ * @now: Current time
+ * Returns: 1 if a Probe Response frame can be sent, 0 if not
+ *
+ * The bucket never moves back in time, i.e., tokens are added only once @now
+ * has passed the latest time used with the bucket.
+ */
+int hostapd_probe_resp_rate_ok(struct hostapd_data *hapd,
+			       struct os_reltime *now)
+{
+	unsigned int rate = hapd->conf->probe_resp_rate_limit;
+	unsigned int burst = hapd->conf->probe_resp_rate_burst;
+	u64 max;
+	struct os_reltime age;
+
+	if (!burst)
+		burst = rate;
+	max = (u64) burst * 1000000;
+
+	if (!os_reltime_initialized(&hapd->probe_resp_tokens_update)) {
+		hapd->probe_resp_tokens = max;
+		hapd->probe_resp_tokens_update = *now;
+	} else if (os_reltime_before(&hapd->probe_resp_tokens_update, now)) {
+		os_reltime_sub(now, &hapd->probe_resp_tokens_update, &age);
+		if ((u64) age.sec >= burst / rate + 1)
+			hapd->probe_resp_tokens = max;
+		else
+			hapd->probe_resp_tokens +=
+				((u64) age.sec * 1000000 + age.usec) * rate;
+		if (hapd->probe_resp_tokens > max)
+			hapd->probe_resp_tokens = max;
+		hapd->probe_resp_tokens_update = *now;
+	}
+
+	if (hapd->probe_resp_tokens < 1000000)
+		return 0;
+	hapd->probe_resp_tokens -= 1000000;
+	return 1;
+}
+
+
 void handle_probe_req(struct hostapd_data *hapd,
 		      const struct ieee80211_mgmt *mgmt, size_t len,
 		      int ssi_signal)
@@ -823,6 +964,10 @@ void handle_probe_req(struct hostapd_data *hapd,
 	u16 csa_offs[2];
 	size_t csa_offs_len;
 	struct radius_sta rad_info;
+	struct os_reltime now;
+	u32 ssid_hash = 0, slot = 0;
+
+	hapd->probe_req_rx++;
 
 	if (hapd->iconf->rssi_ignore_probe_request && ssi_signal &&
 	    ssi_signal < hapd->iconf->rssi_ignore_probe_request)
@@ -1048,8 +1193,34 @@ void handle_probe_req(struct hostapd_data *hapd,
 	wpa_msg_ctrl(hapd->msg_ctx, MSG_INFO, RX_PROBE_REQUEST "sa=" MACSTR
 		     " signal=%d", MAC2STR(mgmt->sa), ssi_signal);
 
-	resp = hostapd_gen_probe_resp(hapd, mgmt, elems.p2p != NULL,
-				      &resp_len);
+	if (hapd->conf->probe_resp_rate_limit ||
+	    hapd->conf->probe_resp_dedup_time)
+		os_get_reltime(&now);
+
+	if (hapd->conf->probe_resp_dedup_time &&
+	    hostapd_probe_req_dup(hapd, mgmt->sa, elems.ssid, elems.ssid_len,
+				  &now, &ssid_hash, &slot)) {
+		wpa_printf(MSG_EXCESSIVE, "Ignore duplicate Probe Request from "
+			   MACSTR, MAC2STR(mgmt->sa));
+		hapd->probe_req_dup++;
+		return;
+	}
+
+	if (hapd->conf->probe_resp_rate_limit && res == WILDCARD_SSID_MATCH &&
+	    !hostapd_probe_resp_rate_ok(hapd, &now)) {
+		wpa_printf(MSG_EXCESSIVE,
+			   "Ignore wildcard Probe Request from " MACSTR
+			   " due to probe_resp_rate_limit", MAC2STR(mgmt->sa));
+		hapd->probe_req_rate_limited++;
+		return;
+	}
+
+	if (hapd->conf->probe_resp_dedup_time)
+		hostapd_probe_req_seen_add(hapd, mgmt->sa, ssid_hash, slot,
+					   &now);
+
+	resp = hostapd_get_probe_resp_tmpl(hapd, mgmt, elems.p2p != NULL,
+					   &resp_len);
 	if (resp == NULL)
 		return;
 
@@ -1077,8 +1248,8 @@ void handle_probe_req(struct hostapd_data *hapd,
 
 	if (ret < 0)
 		wpa_printf(MSG_INFO, "handle_probe_req: send failed");
-
-	os_free(resp);
+	else
+		hapd->probe_resp_tx++;
 
 	wpa_printf(MSG_EXCESSIVE, "STA " MACSTR " sent probe request for %s "
 		   "SSID", MAC2STR(mgmt->sa),
@@ -1124,6 +1295,21 @@ static u8 * hostapd_probe_resp_offloads(struct hostapd_data *hapd,
 #endif /* NEED_AP_MLME */
 
 
+/* Needs to be called whenever information included in Probe Response frames
+ * changes; ieee802_11_build_ap_params() takes care of this for all changes
+ * that result in the Beacon frame being rebuilt. */
+void hostapd_probe_resp_tmpl_flush(struct hostapd_data *hapd)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(hapd->probe_resp_tmpl); i++) {
+		os_free(hapd->probe_resp_tmpl[i]);
+		hapd->probe_resp_tmpl[i] = NULL;
+		hapd->probe_resp_tmpl_len[i] = 0;
+	}
+}
+
+
 #ifdef CONFIG_IEEE80211AX
 /* Unsolicited broadcast Probe Response transmission, 6 GHz only */
 static u8 * hostapd_unsol_bcast_probe_resp(struct hostapd_data *hapd,
@@ -1400,6 +1586,8 @@ int ieee802_11_build_ap_params(struct hostapd_data *hapd,
 	u16 capab_info;
 	u8 *pos, *tailpos, *tailend, *csa_pos;
 
+	hostapd_probe_resp_tmpl_flush(hapd);
+
 #define BEACON_HEAD_BUF_SIZE 256
 #define BEACON_TAIL_BUF_SIZE 512
 	head = os_zalloc(BEACON_HEAD_BUF_SIZE);
@@ -1753,6 +1941,8 @@ int ieee802_11_set_beacon(struct hostapd_data *hapd)
 	struct wpabuf *beacon, *proberesp, *assocresp;
 	int res, ret = -1;
 
+	hostapd_probe_resp_tmpl_flush(hapd);
+
 	if (hapd->csa_in_progress) {
 		wpa_printf(MSG_ERROR, "Cannot set beacons during CSA period");
 		return -1;
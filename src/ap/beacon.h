@@ -21,6 +21,9 @@ int ieee802_11_update_beacons(struct hostapd_iface *iface);
 int ieee802_11_build_ap_params(struct hostapd_data *hapd,
 			       struct wpa_driver_ap_params *params);
 void ieee802_11_free_ap_params(struct wpa_driver_ap_params *params);
+void hostapd_probe_resp_tmpl_flush(struct hostapd_data *hapd);
+int hostapd_probe_resp_rate_ok(struct hostapd_data *hapd,
+			       struct os_reltime *now);
 void sta_track_add(struct hostapd_iface *iface, const u8 *addr, int ssi_signal);
 void sta_track_del(struct hostapd_sta_info *info);
 void sta_track_expire(struct hostapd_iface *iface, int force);
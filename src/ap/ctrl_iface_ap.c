@@ -861,6 +861,19 @@ int hostapd_ctrl_iface_status(struct hostapd_data *hapd, char *buf,
 		if (os_snprintf_error(buflen - len, ret))
 			return len;
 		len += ret;
+
+		ret = os_snprintf(buf + len, buflen - len,
+				  "probe_req_rx[%d]=%u\n"
+				  "probe_resp_tx[%d]=%u\n"
+				  "probe_req_rate_limited[%d]=%u\n"
+				  "probe_req_dup[%d]=%u\n",
+				  (int) i, bss->probe_req_rx,
+				  (int) i, bss->probe_resp_tx,
+				  (int) i, bss->probe_req_rate_limited,
+				  (int) i, bss->probe_req_dup);
+		if (os_snprintf_error(buflen - len, ret))
+			return len;
+		len += ret;
 	}
 
 	if (hapd->conf->chan_util_avg_period) {
@@ -930,6 +943,26 @@ int hostapd_ctrl_iface_pmksa_list(struct hostapd_data *hapd, char *buf,
 }
 
 
+int hostapd_ctrl_iface_hash_stats(struct hostapd_data *hapd, char *buf,
+				  size_t len)
+{
+	char *pos = buf, *end = buf + len;
+	int ret;
+
+	ret = addr_hash_stats(&hapd->sta_hash, "sta", pos, end - pos);
+	if (ret < 0)
+		return pos - buf;
+	pos += ret;
+	ret = addr_hash_stats(&hapd->iface->ap_hash, "ap", pos, end - pos);
+	if (ret < 0)
+		return pos - buf;
+	pos += ret;
+	pos += wpa_auth_pmksa_hash_stats(hapd->wpa_auth, pos, end - pos);
+
+	return pos - buf;
+}
+
+
 void hostapd_ctrl_iface_pmksa_flush(struct hostapd_data *hapd)
 {
 	wpa_auth_pmksa_flush(hapd->wpa_auth);
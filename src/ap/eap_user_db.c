@@ -12,11 +12,14 @@
 #endif /* CONFIG_SQLITE */
 
 #include "common.h"
+#include "utils/eloop.h"
+#include "utils/list.h"
 #include "eap_common/eap_wsc_common.h"
 #include "eap_server/eap_methods.h"
 #include "eap_server/eap.h"
 #include "ap_config.h"
 #include "hostapd.h"
+#include "authsrv.h"
 
 #ifdef CONFIG_SQLITE
 
@@ -76,164 +79,942 @@ static void set_user_methods(struct hostapd_eap_user *user, const char *methods)
 }
 
 
-static int get_user_cb(void *ctx, int argc, char *argv[], char *col[])
+/* Upper limit for the number of cache hash buckets */
+#define EAP_USER_DB_HASH_MAX 65536
+
+/* Failed lookups are cached only briefly to allow the database to recover */
+#define EAP_USER_DB_ERROR_TTL 1
+
+struct eap_user_db_conn {
+	sqlite3 *db;
+	sqlite3_stmt *user_stmt;
+	sqlite3_stmt *wildcard_stmt;
+};
+
+/*
+ * Result of a database query. This may be filled in a worker thread, so the
+ * strings are allocated with sqlite3_mprintf() and freed with sqlite3_free().
+ */
+struct eap_user_db_result {
+	int found; /* password was set in the users table */
+	char *password;
+	char *methods;
+	int remediation; /* -1 if not set */
+	u32 t_c_timestamp;
+	char *wildcard; /* longest matching identity prefix from wildcards */
+	char *wildcard_methods;
+	char *error; /* SQLite error message */
+};
+
+struct eap_user_db_entry {
+	struct dl_list list; /* in eap_user_db::lru, most recent first */
+	struct eap_user_db_entry *hnext;
+	u32 hash;
+	struct os_reltime expire;
+	u8 *key;
+	size_t key_len;
+	int phase2;
+	int found;
+	unsigned int pinned; /* number of eap_user_db_pin entries */
+	struct hostapd_eap_user user; /* valid if found */
+};
+
+/*
+ * Result of an asynchronous lookup that the session has not yet used. The
+ * cache entry is not expired or evicted while it is pinned, so that the
+ * session finds it when it retries the lookup.
+ */
+struct eap_user_db_pin {
+	struct dl_list list; /* in eap_user_db::pins */
+	void *session_ctx;
+	struct eap_user_db_entry *entry;
+};
+
+struct eap_user_db_lookup {
+	struct dl_list list; /* in eap_user_db::lookups */
+	u8 *identity;
+	size_t identity_len;
+	int phase2;
+	void *session_ctx; /* NULL if the session was removed */
+	struct eap_user_db_result res;
+};
+
+struct eap_user_db {
+	struct hostapd_data *hapd;
+	char *file;
+	struct eap_user_db_conn conn;
+	/* Used only by the active asynchronous lookup */
+	struct eap_user_db_conn async_conn;
+
+	struct dl_list lru;
+	struct eap_user_db_entry **hash;
+	unsigned int hash_mask;
+	unsigned int entries;
+	unsigned int max_entries;
+
+	/* Pending asynchronous lookups; only the first one can be active */
+	struct dl_list lookups;
+	int lookup_active;
+
+	struct dl_list pins; /* struct eap_user_db_pin */
+};
+
+
+static void eap_user_db_conn_close(struct eap_user_db_conn *conn)
 {
-	struct hostapd_eap_user *user = ctx;
-	int i;
+	sqlite3_finalize(conn->user_stmt);
+	sqlite3_finalize(conn->wildcard_stmt);
+	sqlite3_close(conn->db);
+	os_memset(conn, 0, sizeof(*conn));
+}
 
-	for (i = 0; i < argc; i++) {
-		if (os_strcmp(col[i], "password") == 0 && argv[i]) {
-			bin_clear_free(user->password, user->password_len);
-			user->password_len = os_strlen(argv[i]);
-			user->password = (u8 *) os_strdup(argv[i]);
-			user->next = (void *) 1;
-		} else if (os_strcmp(col[i], "methods") == 0 && argv[i]) {
-			set_user_methods(user, argv[i]);
-		} else if (os_strcmp(col[i], "remediation") == 0 && argv[i]) {
-			user->remediation = strlen(argv[i]) > 0;
-		} else if (os_strcmp(col[i], "t_c_timestamp") == 0 && argv[i]) {
-			user->t_c_timestamp = strtol(argv[i], NULL, 10);
-		}
+
+static int eap_user_db_conn_open(struct eap_user_db_conn *conn,
+				 const char *file)
+{
+	const char *user_sql =
+		"SELECT * FROM users WHERE identity=? AND phase2=?;";
+	const char *wildcard_sql = "SELECT identity,methods FROM wildcards;";
+
+	if (sqlite3_open(file, &conn->db)) {
+		wpa_printf(MSG_INFO, "DB: Failed to open database %s: %s",
+			   file, sqlite3_errmsg(conn->db));
+		eap_user_db_conn_close(conn);
+		return -1;
+	}
+
+	if (sqlite3_prepare_v2(conn->db, user_sql, -1, &conn->user_stmt,
+			       NULL) != SQLITE_OK ||
+	    sqlite3_prepare_v2(conn->db, wildcard_sql, -1,
+			       &conn->wildcard_stmt, NULL) != SQLITE_OK) {
+		wpa_printf(MSG_INFO,
+			   "DB: Failed to prepare SQL statement: %s  db: %s",
+			   sqlite3_errmsg(conn->db), file);
+		eap_user_db_conn_close(conn);
+		return -1;
 	}
 
 	return 0;
 }
 
 
-static int get_wildcard_cb(void *ctx, int argc, char *argv[], char *col[])
+static char * eap_user_db_strdup(const unsigned char *str)
+{
+	return sqlite3_mprintf("%s", (const char *) str);
+}
+
+
+static void eap_user_db_result_clear(struct eap_user_db_result *res)
+{
+	sqlite3_free(res->password);
+	sqlite3_free(res->methods);
+	sqlite3_free(res->wildcard);
+	sqlite3_free(res->wildcard_methods);
+	sqlite3_free(res->error);
+	os_memset(res, 0, sizeof(*res));
+	res->remediation = -1;
+}
+
+
+/* This does not use any hostapd data, so it can be run in a worker thread */
+static void eap_user_db_query(struct eap_user_db_conn *conn,
+			      const u8 *identity, size_t identity_len,
+			      int phase2, struct eap_user_db_result *res)
 {
-	struct hostapd_eap_user *user = ctx;
-	int i, id = -1, methods = -1;
-	size_t len;
+	sqlite3_stmt *stmt = conn->user_stmt;
+	int i, rc;
+
+	sqlite3_bind_text(stmt, 1, (const char *) identity, identity_len,
+			  SQLITE_STATIC);
+	sqlite3_bind_int(stmt, 2, phase2);
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		for (i = 0; i < sqlite3_column_count(stmt); i++) {
+			const char *col = sqlite3_column_name(stmt, i);
+			const unsigned char *val = sqlite3_column_text(stmt, i);
 
-	for (i = 0; i < argc; i++) {
-		if (os_strcmp(col[i], "identity") == 0 && argv[i])
-			id = i;
-		else if (os_strcmp(col[i], "methods") == 0 && argv[i])
-			methods = i;
+			if (!col || !val)
+				continue;
+			if (os_strcmp(col, "password") == 0) {
+				sqlite3_free(res->password);
+				res->password = eap_user_db_strdup(val);
+				res->found = 1;
+			} else if (os_strcmp(col, "methods") == 0) {
+				sqlite3_free(res->methods);
+				res->methods = eap_user_db_strdup(val);
+			} else if (os_strcmp(col, "remediation") == 0) {
+				res->remediation = val[0] != '\0';
+			} else if (os_strcmp(col, "t_c_timestamp") == 0) {
+				res->t_c_timestamp =
+					strtol((const char *) val, NULL, 10);
+			}
+		}
 	}
+	if (rc != SQLITE_DONE && !res->error)
+		res->error = sqlite3_mprintf("%s", sqlite3_errmsg(conn->db));
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
 
-	if (id < 0 || methods < 0)
-		return 0;
+	if (res->found || phase2)
+		return;
+
+	stmt = conn->wildcard_stmt;
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		const unsigned char *id = sqlite3_column_text(stmt, 0);
+		const unsigned char *methods = sqlite3_column_text(stmt, 1);
+		size_t len;
+
+		if (!id || !methods)
+			continue;
+		len = os_strlen((const char *) id);
+		if (len <= identity_len &&
+		    os_memcmp(id, identity, len) == 0 &&
+		    (!res->wildcard || len > os_strlen(res->wildcard))) {
+			sqlite3_free(res->wildcard);
+			sqlite3_free(res->wildcard_methods);
+			res->wildcard = eap_user_db_strdup(id);
+			res->wildcard_methods = eap_user_db_strdup(methods);
+		}
+	}
+	if (rc != SQLITE_DONE && !res->error)
+		res->error = sqlite3_mprintf("%s", sqlite3_errmsg(conn->db));
+	sqlite3_reset(stmt);
+}
+
+
+/* Returns 1 if the user was found, 0 if not, or -1 on allocation failure */
+static int eap_user_db_result_to_user(struct eap_user_db_result *res,
+				      const u8 *identity, size_t identity_len,
+				      int phase2, struct hostapd_eap_user *user)
+{
+	os_memset(user, 0, sizeof(*user));
+	user->phase2 = phase2;
+	user->identity = os_zalloc(identity_len + 1);
+	if (!user->identity)
+		return -1;
+	os_memcpy(user->identity, identity, identity_len);
+	user->identity_len = identity_len;
 
-	len = os_strlen(argv[id]);
-	if (len <= user->identity_len &&
-	    os_memcmp(argv[id], user->identity, len) == 0 &&
-	    (user->password == NULL || len > user->password_len)) {
-		bin_clear_free(user->password, user->password_len);
-		user->password_len = os_strlen(argv[id]);
-		user->password = (u8 *) os_strdup(argv[id]);
-		user->next = (void *) 1;
-		set_user_methods(user, argv[methods]);
+	if (res->methods)
+		set_user_methods(user, res->methods);
+	if (res->remediation >= 0)
+		user->remediation = res->remediation;
+	user->t_c_timestamp = res->t_c_timestamp;
+
+	if (res->found && res->password) {
+		user->password = (u8 *) os_strdup(res->password);
+		if (!user->password)
+			return -1;
+		user->password_len = os_strlen(res->password);
+		return 1;
 	}
 
+	if (res->wildcard && res->wildcard_methods) {
+		bin_clear_free(user->identity, user->identity_len);
+		user->identity = (u8 *) os_strdup(res->wildcard);
+		if (!user->identity) {
+			user->identity_len = 0;
+			return -1;
+		}
+		user->identity_len = os_strlen(res->wildcard);
+		set_user_methods(user, res->wildcard_methods);
+		return 1;
+	}
+
+	return 0;
+}
+
+
+static void eap_user_db_user_clear(struct hostapd_eap_user *user)
+{
+	bin_clear_free(user->identity, user->identity_len);
+	bin_clear_free(user->password, user->password_len);
+	os_memset(user, 0, sizeof(*user));
+}
+
+
+static int eap_user_db_user_copy(struct hostapd_eap_user *dst,
+				 const struct hostapd_eap_user *src)
+{
+	*dst = *src;
+	dst->next = NULL;
+	dst->identity = NULL;
+	dst->password = NULL;
+	if (src->identity) {
+		dst->identity = os_memdup(src->identity, src->identity_len + 1);
+		if (!dst->identity)
+			goto fail;
+	}
+	if (src->password) {
+		dst->password = os_memdup(src->password, src->password_len + 1);
+		if (!dst->password)
+			goto fail;
+	}
 	return 0;
+fail:
+	eap_user_db_user_clear(dst);
+	return -1;
+}
+
+
+static u32 eap_user_db_hash(const u8 *key, size_t key_len, int phase2)
+{
+	u32 hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < key_len; i++) {
+		hash ^= key[i];
+		hash *= 16777619U;
+	}
+	hash ^= !!phase2;
+	hash *= 16777619U;
+
+	return hash;
+}
+
+
+static void eap_user_db_cache_remove(struct eap_user_db *db,
+				     struct eap_user_db_entry *entry)
+{
+	struct eap_user_db_entry **pos;
+
+	for (pos = &db->hash[entry->hash & db->hash_mask]; *pos;
+	     pos = &(*pos)->hnext) {
+		if (*pos == entry) {
+			*pos = entry->hnext;
+			break;
+		}
+	}
+	dl_list_del(&entry->list);
+	db->entries--;
+	eap_user_db_user_clear(&entry->user);
+	os_free(entry->key);
+	os_free(entry);
+}
+
+
+static struct eap_user_db_entry *
+eap_user_db_cache_get(struct eap_user_db *db, const u8 *identity,
+		      size_t identity_len, int phase2)
+{
+	struct eap_user_db_entry *entry;
+	struct os_reltime now;
+	u32 hash;
+
+	if (!db->hash)
+		return NULL;
+
+	hash = eap_user_db_hash(identity, identity_len, phase2);
+	for (entry = db->hash[hash & db->hash_mask]; entry;
+	     entry = entry->hnext) {
+		if (entry->hash == hash && entry->phase2 == phase2 &&
+		    entry->key_len == identity_len &&
+		    os_memcmp(entry->key, identity, identity_len) == 0)
+			break;
+	}
+	if (!entry)
+		return NULL;
+
+	os_get_reltime(&now);
+	if (!entry->pinned && os_reltime_before(&entry->expire, &now)) {
+		eap_user_db_cache_remove(db, entry);
+		return NULL;
+	}
+
+	dl_list_del(&entry->list);
+	dl_list_add(&db->lru, &entry->list);
+	return entry;
+}
+
+
+static struct eap_user_db_entry *
+eap_user_db_cache_add(struct eap_user_db *db, const u8 *identity,
+		      size_t identity_len, int phase2,
+		      const struct hostapd_eap_user *user, unsigned int ttl)
+{
+	struct eap_user_db_entry *entry;
+
+	if (!db->hash)
+		return NULL;
+
+	entry = eap_user_db_cache_get(db, identity, identity_len, phase2);
+	if (entry && entry->pinned) {
+		/* Sessions are waiting to use this result, so update it in
+		 * place */
+		eap_user_db_user_clear(&entry->user);
+		entry->found = user && eap_user_db_user_copy(&entry->user,
+							     user) == 0;
+		os_get_reltime(&entry->expire);
+		entry->expire.sec += ttl;
+		return entry;
+	}
+	if (entry)
+		eap_user_db_cache_remove(db, entry);
+	if (db->entries >= db->max_entries) {
+		dl_list_for_each_reverse(entry, &db->lru,
+					 struct eap_user_db_entry, list) {
+			if (!entry->pinned) {
+				eap_user_db_cache_remove(db, entry);
+				break;
+			}
+		}
+	}
+
+	entry = os_zalloc(sizeof(*entry));
+	if (!entry)
+		return NULL;
+	entry->key = os_memdup(identity, identity_len ? identity_len : 1);
+	if (!entry->key ||
+	    (user && eap_user_db_user_copy(&entry->user, user) < 0)) {
+		os_free(entry->key);
+		os_free(entry);
+		return NULL;
+	}
+	entry->key_len = identity_len;
+	entry->phase2 = phase2;
+	entry->found = !!user;
+	entry->hash = eap_user_db_hash(identity, identity_len, phase2);
+	os_get_reltime(&entry->expire);
+	entry->expire.sec += ttl;
+
+	entry->hnext = db->hash[entry->hash & db->hash_mask];
+	db->hash[entry->hash & db->hash_mask] = entry;
+	dl_list_add(&db->lru, &entry->list);
+	db->entries++;
+
+	return entry;
+}
+
+
+static void eap_user_db_pin_free(struct eap_user_db_pin *pin)
+{
+	dl_list_del(&pin->list);
+	pin->entry->pinned--;
+	os_free(pin);
+}
+
+
+static void eap_user_db_pin(struct eap_user_db *db,
+			    struct eap_user_db_entry *entry, void *session_ctx)
+{
+	struct eap_user_db_pin *pin;
+
+	if (!entry || !session_ctx)
+		return;
+	pin = os_zalloc(sizeof(*pin));
+	if (!pin)
+		return;
+	pin->session_ctx = session_ctx;
+	pin->entry = entry;
+	entry->pinned++;
+	dl_list_add_tail(&db->pins, &pin->list);
+}
+
+
+/* One of the waiting sessions has used the result in the entry */
+static void eap_user_db_unpin_entry(struct eap_user_db *db,
+				    struct eap_user_db_entry *entry)
+{
+	struct eap_user_db_pin *pin;
+
+	dl_list_for_each(pin, &db->pins, struct eap_user_db_pin, list) {
+		if (pin->entry == entry) {
+			eap_user_db_pin_free(pin);
+			return;
+		}
+	}
+}
+
+
+static void eap_user_db_cache_deinit(struct eap_user_db *db)
+{
+	struct eap_user_db_entry *entry;
+	struct eap_user_db_pin *pin;
+
+	while ((pin = dl_list_first(&db->pins, struct eap_user_db_pin, list)))
+		eap_user_db_pin_free(pin);
+	while ((entry = dl_list_first(&db->lru, struct eap_user_db_entry,
+				      list)))
+		eap_user_db_cache_remove(db, entry);
+	os_free(db->hash);
+	db->hash = NULL;
+	db->hash_mask = 0;
+	db->max_entries = 0;
 }
 
 
+static void eap_user_db_cache_init(struct eap_user_db *db)
+{
+	unsigned int size = 16;
+
+	db->max_entries = db->hapd->conf->eap_user_sqlite_cache_size;
+	if (!db->max_entries)
+		return;
+
+	while (size < db->max_entries && size < EAP_USER_DB_HASH_MAX)
+		size <<= 1;
+	db->hash = os_calloc(size, sizeof(struct eap_user_db_entry *));
+	if (!db->hash) {
+		db->max_entries = 0;
+		return;
+	}
+	db->hash_mask = size - 1;
+}
+
+
+static void eap_user_db_pending_timeout(void *eloop_ctx, void *user_ctx)
+{
+	authsrv_eap_pending_cb(eloop_ctx, user_ctx);
+}
+
+
+static void eap_user_db_lookup_free(struct eap_user_db_lookup *lookup)
+{
+	eap_user_db_result_clear(&lookup->res);
+	bin_clear_free(lookup->identity, lookup->identity_len);
+	os_free(lookup);
+}
+
+
+static void eap_user_db_work(void *eloop_ctx, void *user_ctx);
+
+static void eap_user_db_free(struct eap_user_db *db)
+{
+	struct eap_user_db_lookup *lookup;
+
+	eloop_cancel_work(eap_user_db_work, db, ELOOP_ALL_CTX);
+	/* Let the waiting sessions retry the lookup */
+	while ((lookup = dl_list_first(&db->lookups, struct eap_user_db_lookup,
+				       list))) {
+		dl_list_del(&lookup->list);
+		if (lookup->session_ctx)
+			eloop_register_timeout(0, 0,
+					       eap_user_db_pending_timeout,
+					       db->hapd, lookup->session_ctx);
+		eap_user_db_lookup_free(lookup);
+	}
+	eap_user_db_cache_deinit(db);
+	eap_user_db_conn_close(&db->conn);
+	eap_user_db_conn_close(&db->async_conn);
+	os_free(db->file);
+	os_free(db);
+}
+
+
+static struct eap_user_db * eap_user_db_get(struct hostapd_data *hapd)
+{
+	struct eap_user_db *db = hapd->eap_user_db;
+
+	if (db && os_strcmp(db->file, hapd->conf->eap_user_sqlite) == 0)
+		return db;
+
+	if (db)
+		eap_user_db_free(db);
+	hapd->eap_user_db = NULL;
+
+	db = os_zalloc(sizeof(*db));
+	if (!db)
+		return NULL;
+	db->file = os_strdup(hapd->conf->eap_user_sqlite);
+	if (!db->file) {
+		os_free(db);
+		return NULL;
+	}
+	db->hapd = hapd;
+	dl_list_init(&db->lru);
+	dl_list_init(&db->lookups);
+	dl_list_init(&db->pins);
+	eap_user_db_cache_init(db);
+	hapd->eap_user_db = db;
+
+	return db;
+}
+
+
+/* Store the query result in hapd->tmp_eap_user and in the cache */
 static const struct hostapd_eap_user *
-eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
-		    size_t identity_len, int phase2)
+eap_user_db_complete(struct eap_user_db *db, const u8 *identity,
+		     size_t identity_len, int phase2,
+		     struct eap_user_db_result *res,
+		     struct eap_user_db_entry **entry)
+{
+	struct hostapd_eap_user *user = &db->hapd->tmp_eap_user;
+	struct eap_user_db_entry *added;
+	int found;
+
+	if (res->error)
+		wpa_printf(MSG_DEBUG,
+			   "DB: Failed to complete SQL operation: %s  db: %s",
+			   res->error, db->file);
+
+	eap_user_db_user_clear(user);
+	found = eap_user_db_result_to_user(res, identity, identity_len, phase2,
+					   user);
+	if (found < 0)
+		return NULL;
+	added = eap_user_db_cache_add(db, identity, identity_len, phase2,
+				      found ? user : NULL,
+				      res->error ? EAP_USER_DB_ERROR_TTL :
+				      db->hapd->conf->eap_user_sqlite_cache_ttl);
+	if (entry)
+		*entry = added;
+
+	return found ? user : NULL;
+}
+
+
+static int eap_user_sqlite_valid_identity(const u8 *identity,
+					  size_t identity_len)
 {
-	sqlite3 *db;
-	struct hostapd_eap_user *user = NULL;
-	char id_str[256], cmd[300];
 	size_t i;
-	int res;
 
-	if (identity_len >= sizeof(id_str)) {
+	if (identity_len >= 256) {
 		wpa_printf(MSG_DEBUG, "%s: identity len too big: %d >= %d",
-			   __func__, (int) identity_len,
-			   (int) (sizeof(id_str)));
-		return NULL;
+			   __func__, (int) identity_len, 256);
+		return 0;
 	}
-	os_memcpy(id_str, identity, identity_len);
-	id_str[identity_len] = '\0';
 	for (i = 0; i < identity_len; i++) {
-		if (id_str[i] >= 'a' && id_str[i] <= 'z')
+		if (identity[i] >= 'a' && identity[i] <= 'z')
 			continue;
-		if (id_str[i] >= 'A' && id_str[i] <= 'Z')
+		if (identity[i] >= 'A' && identity[i] <= 'Z')
 			continue;
-		if (id_str[i] >= '0' && id_str[i] <= '9')
+		if (identity[i] >= '0' && identity[i] <= '9')
 			continue;
-		if (id_str[i] == '-' || id_str[i] == '_' || id_str[i] == '.' ||
-		    id_str[i] == ',' || id_str[i] == '@' || id_str[i] == '\\' ||
-		    id_str[i] == '!' || id_str[i] == '#' || id_str[i] == '%' ||
-		    id_str[i] == '=' || id_str[i] == ' ')
+		if (identity[i] == '-' || identity[i] == '_' ||
+		    identity[i] == '.' || identity[i] == ',' ||
+		    identity[i] == '@' || identity[i] == '\\' ||
+		    identity[i] == '!' || identity[i] == '#' ||
+		    identity[i] == '%' || identity[i] == '=' ||
+		    identity[i] == ' ')
 			continue;
 		wpa_printf(MSG_INFO, "DB: Unsupported character in identity");
-		return NULL;
+		return 0;
 	}
 
-	bin_clear_free(hapd->tmp_eap_user.identity,
-		       hapd->tmp_eap_user.identity_len);
-	bin_clear_free(hapd->tmp_eap_user.password,
-		       hapd->tmp_eap_user.password_len);
-	os_memset(&hapd->tmp_eap_user, 0, sizeof(hapd->tmp_eap_user));
-	hapd->tmp_eap_user.phase2 = phase2;
-	hapd->tmp_eap_user.identity = os_zalloc(identity_len + 1);
-	if (hapd->tmp_eap_user.identity == NULL)
+	return 1;
+}
+
+
+static const struct hostapd_eap_user *
+eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
+		    size_t identity_len, int phase2)
+{
+	struct eap_user_db *db;
+	struct eap_user_db_entry *entry;
+	struct eap_user_db_result res;
+	const struct hostapd_eap_user *user;
+
+	if (!eap_user_sqlite_valid_identity(identity, identity_len))
 		return NULL;
-	os_memcpy(hapd->tmp_eap_user.identity, identity, identity_len);
-	hapd->tmp_eap_user.identity_len = identity_len;
 
-	if (sqlite3_open(hapd->conf->eap_user_sqlite, &db)) {
-		wpa_printf(MSG_INFO, "DB: Failed to open database %s: %s",
-			   hapd->conf->eap_user_sqlite, sqlite3_errmsg(db));
-		sqlite3_close(db);
+	db = eap_user_db_get(hapd);
+	if (!db)
+		return NULL;
+
+	entry = eap_user_db_cache_get(db, identity, identity_len, phase2);
+	if (entry) {
+		wpa_printf(MSG_DEBUG, "DB: Cached result for identity (%s)",
+			   entry->found ? "found" : "not found");
+		if (entry->pinned)
+			eap_user_db_unpin_entry(db, entry);
+		eap_user_db_user_clear(&hapd->tmp_eap_user);
+		if (!entry->found ||
+		    eap_user_db_user_copy(&hapd->tmp_eap_user,
+					  &entry->user) < 0)
+			return NULL;
+		return &hapd->tmp_eap_user;
+	}
+
+	if (!db->conn.db && eap_user_db_conn_open(&db->conn, db->file) < 0)
 		return NULL;
+
+	wpa_hexdump_ascii(MSG_DEBUG, "DB: Look up identity",
+			  identity, identity_len);
+	os_memset(&res, 0, sizeof(res));
+	res.remediation = -1;
+	eap_user_db_query(&db->conn, identity, identity_len, phase2, &res);
+	user = eap_user_db_complete(db, identity, identity_len, phase2, &res,
+				    NULL);
+	if (res.error) {
+		/* Reopen the database for the next lookup */
+		eap_user_db_conn_close(&db->conn);
+	}
+	eap_user_db_result_clear(&res);
+
+	return user;
+}
+
+
+static void eap_user_db_work(void *eloop_ctx, void *user_ctx)
+{
+	struct eap_user_db *db = eloop_ctx;
+	struct eap_user_db_lookup *lookup = user_ctx;
+
+	eap_user_db_query(&db->async_conn, lookup->identity,
+			  lookup->identity_len, lookup->phase2, &lookup->res);
+}
+
+
+static void eap_user_db_lookup_next(struct eap_user_db *db);
+
+static void eap_user_db_work_done(void *eloop_ctx, void *user_ctx)
+{
+	struct eap_user_db *db = eloop_ctx;
+	struct eap_user_db_lookup *lookup = user_ctx;
+	struct hostapd_data *hapd = db->hapd;
+	void *session_ctx = lookup->session_ctx;
+	struct eap_user_db_entry *entry = NULL;
+
+	db->lookup_active = 0;
+	dl_list_del(&lookup->list);
+	eap_user_db_complete(db, lookup->identity, lookup->identity_len,
+			     lookup->phase2, &lookup->res, &entry);
+	if (lookup->res.error)
+		eap_user_db_conn_close(&db->async_conn);
+	eap_user_db_lookup_free(lookup);
+
+	wpa_printf(MSG_DEBUG, "DB: Asynchronous user lookup completed");
+	if (session_ctx) {
+		eap_user_db_pin(db, entry, session_ctx);
+		authsrv_eap_pending_cb(hapd, session_ctx);
 	}
 
-	res = os_snprintf(cmd, sizeof(cmd),
-			  "SELECT * FROM users WHERE identity='%s' AND phase2=%d;",
-			  id_str, phase2);
-	if (os_snprintf_error(sizeof(cmd), res))
-		goto fail;
+	/* The pending callback may have started the next lookup or even
+	 * replaced the database context */
+	if (hapd->eap_user_db == db)
+		eap_user_db_lookup_next(db);
+}
+
+
+static void eap_user_db_lookup_next(struct eap_user_db *db)
+{
+	struct eap_user_db_lookup *lookup;
+	struct eap_user_db_entry *entry;
+
+	while (!db->lookup_active &&
+	       (lookup = dl_list_first(&db->lookups,
+				       struct eap_user_db_lookup, list))) {
+		entry = eap_user_db_cache_get(db, lookup->identity,
+					      lookup->identity_len,
+					      lookup->phase2);
+		if (!entry) {
+			if ((db->async_conn.db ||
+			     eap_user_db_conn_open(&db->async_conn,
+						   db->file) == 0) &&
+			    eloop_submit_work(eap_user_db_work,
+					      eap_user_db_work_done,
+					      db, lookup) == 0) {
+				db->lookup_active = 1;
+				return;
+			}
+
+			/* Complete the lookup synchronously to make sure the
+			 * waiting session does not try again */
+			eap_user_sqlite_get(db->hapd, lookup->identity,
+					    lookup->identity_len,
+					    lookup->phase2);
+			entry = eap_user_db_cache_get(db, lookup->identity,
+						      lookup->identity_len,
+						      lookup->phase2);
+		}
 
-	wpa_printf(MSG_DEBUG, "DB: %s", cmd);
-	if (sqlite3_exec(db, cmd, get_user_cb, &hapd->tmp_eap_user, NULL) !=
-	    SQLITE_OK) {
+		/* The caller may not yet be waiting, so notify it from a
+		 * timeout */
+		dl_list_del(&lookup->list);
+		eap_user_db_pin(db, entry, lookup->session_ctx);
+		eloop_register_timeout(0, 0, eap_user_db_pending_timeout,
+				       db->hapd, lookup->session_ctx);
+		eap_user_db_lookup_free(lookup);
+	}
+}
+
+
+static int eap_user_sqlite_prefetch(struct hostapd_data *hapd,
+				    const u8 *identity, size_t identity_len,
+				    int phase2, void *session_ctx)
+{
+	struct eap_user_db *db;
+	struct eap_user_db_lookup *lookup;
+
+	if (!hapd->conf->eap_user_sqlite_async ||
+	    !eap_user_sqlite_valid_identity(identity, identity_len))
+		return 0;
+
+	db = eap_user_db_get(hapd);
+	if (!db)
+		return 0;
+	if (!db->hash) {
 		wpa_printf(MSG_DEBUG,
-			   "DB: Failed to complete SQL operation: %s  db: %s",
-			   sqlite3_errmsg(db), hapd->conf->eap_user_sqlite);
-	} else if (hapd->tmp_eap_user.next)
-		user = &hapd->tmp_eap_user;
-
-	if (user == NULL && !phase2) {
-		os_snprintf(cmd, sizeof(cmd),
-			    "SELECT identity,methods FROM wildcards;");
-		wpa_printf(MSG_DEBUG, "DB: %s", cmd);
-		if (sqlite3_exec(db, cmd, get_wildcard_cb, &hapd->tmp_eap_user,
-				 NULL) != SQLITE_OK) {
-			wpa_printf(MSG_DEBUG,
-				   "DB: Failed to complete SQL operation: %s  db: %s",
-				   sqlite3_errmsg(db),
-				   hapd->conf->eap_user_sqlite);
-		} else if (hapd->tmp_eap_user.next) {
-			user = &hapd->tmp_eap_user;
-			os_free(user->identity);
-			user->identity = user->password;
-			user->identity_len = user->password_len;
-			user->password = NULL;
-			user->password_len = 0;
+			   "DB: Asynchronous lookups require eap_user_sqlite_cache_size");
+		return 0;
+	}
+	if (eap_user_db_cache_get(db, identity, identity_len, phase2))
+		return 0;
+
+	lookup = os_zalloc(sizeof(*lookup));
+	if (!lookup)
+		return 0;
+	lookup->identity = os_memdup(identity, identity_len ? identity_len : 1);
+	if (!lookup->identity) {
+		os_free(lookup);
+		return 0;
+	}
+	lookup->identity_len = identity_len;
+	lookup->phase2 = phase2;
+	lookup->session_ctx = session_ctx;
+	lookup->res.remediation = -1;
+	dl_list_add_tail(&db->lookups, &lookup->list);
+
+	wpa_hexdump_ascii(MSG_DEBUG, "DB: Start asynchronous lookup for identity",
+			  identity, identity_len);
+	eap_user_db_lookup_next(db);
+
+	return 1;
+}
+
+
+static void eap_user_sqlite_cancel(struct hostapd_data *hapd,
+				   void *session_ctx)
+{
+	struct eap_user_db *db = hapd->eap_user_db;
+	struct eap_user_db_lookup *lookup, *tmp;
+	struct eap_user_db_pin *pin, *ptmp;
+
+	eloop_cancel_timeout(eap_user_db_pending_timeout, hapd, session_ctx);
+	if (!db)
+		return;
+
+	dl_list_for_each_safe(lookup, tmp, &db->lookups,
+			      struct eap_user_db_lookup, list) {
+		if (lookup->session_ctx != session_ctx)
+			continue;
+		if (db->lookup_active &&
+		    lookup == dl_list_first(&db->lookups,
+					    struct eap_user_db_lookup, list)) {
+			/* The worker is using this entry; drop the result
+			 * once it has completed */
+			lookup->session_ctx = NULL;
+			continue;
 		}
+		dl_list_del(&lookup->list);
+		eap_user_db_lookup_free(lookup);
 	}
 
-fail:
-	sqlite3_close(db);
+	dl_list_for_each_safe(pin, ptmp, &db->pins, struct eap_user_db_pin,
+			      list) {
+		if (pin->session_ctx == session_ctx)
+			eap_user_db_pin_free(pin);
+	}
+}
 
-	return user;
+
+void hostapd_eap_user_db_flush(struct hostapd_data *hapd)
+{
+	struct eap_user_db *db = hapd->eap_user_db;
+
+	if (!db)
+		return;
+	eap_user_db_cache_deinit(db);
+	eap_user_db_cache_init(db);
+}
+
+
+void hostapd_eap_user_db_deinit(struct hostapd_data *hapd)
+{
+	if (!hapd->eap_user_db)
+		return;
+	eap_user_db_free(hapd->eap_user_db);
+	hapd->eap_user_db = NULL;
+	eloop_cancel_timeout(eap_user_db_pending_timeout, hapd, ELOOP_ALL_CTX);
 }
 
+
+#ifdef CONFIG_MODULE_TESTS
+/**
+ * hostapd_eap_user_db_run_pending - Complete queued asynchronous lookups
+ * @hapd: Pointer to BSS data
+ * Returns: Number of sessions that were notified of a completed lookup
+ *
+ * Module tests run from within an event loop callback, so they cannot wait
+ * for the submitted work to be completed. The lookups are run here instead.
+ */
+int hostapd_eap_user_db_run_pending(struct hostapd_data *hapd)
+{
+	struct eap_user_db *db = hapd->eap_user_db;
+	struct eap_user_db_lookup *lookup;
+	int notified = 0;
+
+	while (db && db->lookup_active) {
+		lookup = dl_list_first(&db->lookups, struct eap_user_db_lookup,
+				       list);
+		eloop_cancel_work(eap_user_db_work, db, lookup);
+		eap_user_db_result_clear(&lookup->res);
+		eap_user_db_work(db, lookup);
+		if (lookup->session_ctx)
+			notified++;
+		eap_user_db_work_done(db, lookup);
+		db = hapd->eap_user_db;
+	}
+
+	return notified;
+}
+#endif /* CONFIG_MODULE_TESTS */
+
 #endif /* CONFIG_SQLITE */
 
 
-const struct hostapd_eap_user *
-hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
-		     size_t identity_len, int phase2)
+/* Number of EAP user entries to index per event loop iteration */
+#define EAP_USER_INDEX_BATCH_SIZE 10000
+
+static void hostapd_eap_user_index_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	int res;
+
+	res = hostapd_eap_user_index_update(hapd->conf,
+					    EAP_USER_INDEX_BATCH_SIZE);
+	if (res == 0)
+		eloop_register_timeout(0, 0, hostapd_eap_user_index_timeout,
+				       hapd, NULL);
+	else if (res < 0) {
+		wpa_printf(MSG_INFO,
+			   "Failed to build EAP user index - use full list search");
+		hapd->conf->eap_user_index_failed = 1;
+	}
+	else
+		wpa_printf(MSG_DEBUG, "EAP user index ready");
+}
+
+
+/**
+ * hostapd_eap_user_index_start - Start building the EAP user index
+ * @hapd: Pointer to BSS data
+ *
+ * The index for the configured EAP users is built from the event loop in
+ * steps of EAP_USER_INDEX_BATCH_SIZE entries so that a large EAP user file
+ * does not block other processing. Lookups give the same result while the
+ * index is being built. If the build fails, lookups go through the full list
+ * and the build is not retried before this function is called again on
+ * configuration reload.
+ */
+void hostapd_eap_user_index_start(struct hostapd_data *hapd)
+{
+	eloop_cancel_timeout(hostapd_eap_user_index_timeout, hapd, NULL);
+	hapd->conf->eap_user_index_failed = 0;
+	hostapd_eap_user_index_timeout(hapd, NULL);
+}
+
+
+void hostapd_eap_user_index_stop(struct hostapd_data *hapd)
+{
+	eloop_cancel_timeout(hostapd_eap_user_index_timeout, hapd, NULL);
+}
+
+
+static const struct hostapd_eap_user *
+hostapd_get_conf_eap_user(struct hostapd_data *hapd, const u8 *identity,
+			  size_t identity_len, int phase2)
 {
 	const struct hostapd_bss_config *conf = hapd->conf;
-	struct hostapd_eap_user *user = conf->eap_user;
 
 #ifdef CONFIG_WPS
 	if (conf->wps_state && identity_len == WSC_ID_ENROLLEE_LEN &&
@@ -258,29 +1039,27 @@ hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
 	}
 #endif /* CONFIG_WPS */
 
-	while (user) {
-		if (!phase2 && user->identity == NULL) {
-			/* Wildcard match */
-			break;
-		}
+	if (!conf->eap_user_index && conf->eap_user &&
+	    !conf->eap_user_index_failed &&
+	    !eloop_is_timeout_registered(hostapd_eap_user_index_timeout, hapd,
+					 NULL))
+		hostapd_eap_user_index_start(hapd);
 
-		if (user->phase2 == !!phase2 && user->wildcard_prefix &&
-		    identity_len >= user->identity_len &&
-		    os_memcmp(user->identity, identity, user->identity_len) ==
-		    0) {
-			/* Wildcard prefix match */
-			break;
-		}
+	return hostapd_config_get_eap_user(conf, identity, identity_len,
+					   phase2);
+}
 
-		if (user->phase2 == !!phase2 &&
-		    user->identity_len == identity_len &&
-		    os_memcmp(user->identity, identity, identity_len) == 0)
-			break;
-		user = user->next;
-	}
+
+const struct hostapd_eap_user *
+hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
+		     size_t identity_len, int phase2)
+{
+	const struct hostapd_eap_user *user;
+
+	user = hostapd_get_conf_eap_user(hapd, identity, identity_len, phase2);
 
 #ifdef CONFIG_SQLITE
-	if (user == NULL && conf->eap_user_sqlite) {
+	if (user == NULL && hapd->conf->eap_user_sqlite) {
 		return eap_user_sqlite_get(hapd, identity, identity_len,
 					   phase2);
 	}
@@ -288,3 +1067,46 @@ hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
 
 	return user;
 }
+
+
+/**
+ * hostapd_prefetch_eap_user - Start an asynchronous EAP user lookup
+ * @hapd: Pointer to BSS data
+ * @identity: User identity
+ * @identity_len: Length of identity in octets
+ * @phase2: Whether this is for Phase 2 identity
+ * @session_ctx: EAP session to continue with authsrv_eap_pending_cb()
+ * Returns: 1 if the lookup is pending, 0 if hostapd_get_eap_user() can be
+ * called directly
+ */
+int hostapd_prefetch_eap_user(struct hostapd_data *hapd, const u8 *identity,
+			      size_t identity_len, int phase2,
+			      void *session_ctx)
+{
+#ifdef CONFIG_SQLITE
+	if (hapd->conf->eap_user_sqlite &&
+	    !hostapd_get_conf_eap_user(hapd, identity, identity_len, phase2))
+		return eap_user_sqlite_prefetch(hapd, identity, identity_len,
+						phase2, session_ctx);
+#endif /* CONFIG_SQLITE */
+
+	return 0;
+}
+
+
+/**
+ * hostapd_cancel_eap_user_prefetch - Stop user lookups for a removed session
+ * @hapd: Pointer to BSS data
+ * @session_ctx: Session context from hostapd_prefetch_eap_user()
+ *
+ * This is called when the EAP session is removed, so that session_ctx is not
+ * passed to authsrv_eap_pending_cb() after that. Queued lookups for the
+ * session are dropped and results that the session did not use are released.
+ */
+void hostapd_cancel_eap_user_prefetch(struct hostapd_data *hapd,
+				      void *session_ctx)
+{
+#ifdef CONFIG_SQLITE
+	eap_user_sqlite_cancel(hapd, session_ctx);
+#endif /* CONFIG_SQLITE */
+}
@@ -99,7 +99,8 @@ void hostapd_reconfig_encryption(struct hostapd_data *hapd)
 }
 
 
-static void hostapd_reload_bss(struct hostapd_data *hapd)
+static void hostapd_reload_bss(struct hostapd_data *hapd,
+			       const struct hostapd_wpa_psk *prev_psk)
 {
 	struct hostapd_ssid *ssid;
 
@@ -113,6 +114,12 @@ static void hostapd_reload_bss(struct hostapd_data *hapd)
 	radius_client_reconfig(hapd->radius, hapd->conf->radius);
 #endif /* CONFIG_NO_RADIUS */
 
+	hostapd_eap_user_index_start(hapd);
+#ifdef CONFIG_SQLITE
+	/* The database contents may have changed as well */
+	hostapd_eap_user_db_flush(hapd);
+#endif /* CONFIG_SQLITE */
+
 	ssid = &hapd->conf->ssid;
 	if (!ssid->wpa_psk_set && ssid->wpa_psk && !ssid->wpa_psk->next &&
 	    ssid->wpa_passphrase_set && ssid->wpa_passphrase) {
@@ -122,7 +129,7 @@ static void hostapd_reload_bss(struct hostapd_data *hapd)
 		 */
 		hostapd_config_clear_wpa_psk(&hapd->conf->ssid.wpa_psk);
 	}
-	if (hostapd_setup_wpa_psk(hapd->conf)) {
+	if (hostapd_setup_wpa_psk_reuse(hapd->conf, prev_psk)) {
 		wpa_printf(MSG_ERROR, "Failed to re-configure WPA PSK "
 			   "after reloading configuration");
 	}
@@ -220,7 +227,7 @@ int hostapd_reload_config(struct hostapd_iface *iface)
 		/* Only in-memory config in use - assume it has been updated */
 		hostapd_clear_old(iface);
 		for (j = 0; j < iface->num_bss; j++)
-			hostapd_reload_bss(iface->bss[j]);
+			hostapd_reload_bss(iface->bss[j], NULL);
 		return 0;
 	}
 
@@ -284,7 +291,8 @@ int hostapd_reload_config(struct hostapd_iface *iface)
 			hapd->iconf,
 			hostapd_get_oper_centr_freq_seg1_idx(oldconf));
 		hapd->conf = newconf->bss[j];
-		hostapd_reload_bss(hapd);
+		hostapd_reload_bss(hapd, j < oldconf->num_bss ?
+				   oldconf->bss[j]->ssid.wpa_psk : NULL);
 	}
 
 	hostapd_config_free(oldconf);
@@ -359,6 +367,9 @@ void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	os_free(hapd->probereq_cb);
 	hapd->probereq_cb = NULL;
 	hapd->num_probereq_cb = 0;
+	hostapd_probe_resp_tmpl_flush(hapd);
+	os_free(hapd->probe_req_seen);
+	hapd->probe_req_seen = NULL;
 
 #ifdef CONFIG_P2P
 	wpabuf_free(hapd->p2p_beacon_ie);
@@ -424,7 +435,9 @@ void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	dhcp_snoop_deinit(hapd);
 	x_snoop_deinit(hapd);
 
+	hostapd_eap_user_index_stop(hapd);
 #ifdef CONFIG_SQLITE
+	hostapd_eap_user_db_deinit(hapd);
 	bin_clear_free(hapd->tmp_eap_user.identity,
 		       hapd->tmp_eap_user.identity_len);
 	bin_clear_free(hapd->tmp_eap_user.password,
@@ -446,17 +459,7 @@ void hostapd_free_hapd_data(struct hostapd_data *hapd)
 #endif /* CONFIG_OCV */
 
 #ifdef CONFIG_SAE
-	{
-		struct hostapd_sae_commit_queue *q;
-
-		while ((q = dl_list_first(&hapd->sae_commit_queue,
-					  struct hostapd_sae_commit_queue,
-					  list))) {
-			dl_list_del(&q->list);
-			os_free(q);
-		}
-	}
-	eloop_cancel_timeout(auth_sae_process_commit, hapd, NULL);
+	auth_sae_queue_flush(hapd);
 #endif /* CONFIG_SAE */
 }
 
@@ -1239,6 +1242,8 @@ static int hostapd_setup_bss(struct hostapd_data *hapd, int first)
 		return -1;
 	}
 
+	hostapd_eap_user_index_start(hapd);
+
 	/* Set SSID for the kernel driver (to be used in beacon and probe
 	 * response frames) */
 	if (set_ssid && hostapd_set_ssid(hapd, conf->ssid.ssid,
@@ -2373,6 +2378,8 @@ static void hostapd_bss_deinit(struct hostapd_data *hapd)
 	wpa_msg(hapd->msg_ctx, MSG_INFO, AP_EVENT_DISABLED);
 #ifdef CONFIG_SQLITE
 	if (hapd->rad_attr_db) {
+		sqlite3_finalize(hapd->rad_attr_stmt);
+		hapd->rad_attr_stmt = NULL;
 		sqlite3_close(hapd->rad_attr_db);
 		hapd->rad_attr_db = NULL;
 	}
@@ -2745,7 +2752,7 @@ int hostapd_reload_iface(struct hostapd_iface *hapd_iface)
 	}
 	hostapd_clear_old(hapd_iface);
 	for (j = 0; j < hapd_iface->num_bss; j++)
-		hostapd_reload_bss(hapd_iface->bss[j]);
+		hostapd_reload_bss(hapd_iface->bss[j], NULL);
 
 	return 0;
 }
@@ -3557,6 +3564,7 @@ void hostapd_cleanup_cs_params(struct hostapd_data *hapd)
 	hapd->csa_in_progress = 0;
 	hapd->cs_c_off_ecsa_beacon = 0;
 	hapd->cs_c_off_ecsa_proberesp = 0;
+	hostapd_probe_resp_tmpl_flush(hapd);
 }
 
 
@@ -15,6 +15,7 @@
 
 #include "common/defs.h"
 #include "utils/list.h"
+#include "utils/addr_hash.h"
 #include "ap_config.h"
 #include "drivers/driver.h"
 
@@ -143,9 +144,19 @@ struct hostapd_neighbor_entry {
 	int stationary;
 };
 
+struct hostapd_probe_req_seen;
+
+struct sae_pwe_precomp;
+
 struct hostapd_sae_commit_queue {
 	struct dl_list list;
 	int rssi;
+	/* PWE precomputed in a worker for a queued commit message */
+	struct sae_pwe_precomp *pwe;
+	enum {
+		SAE_PWE_JOB_NONE, SAE_PWE_JOB_PENDING, SAE_PWE_JOB_DONE,
+		SAE_PWE_JOB_SKIP
+	} pwe_job;
 	size_t len;
 	u8 msg[];
 };
@@ -166,9 +177,7 @@ struct hostapd_data {
 
 	int num_sta; /* number of entries in sta_list */
 	struct sta_info *sta_list; /* STA info list head */
-#define STA_HASH_SIZE 256
-#define STA_HASH(sta) (sta[5])
-	struct sta_info *sta_hash[STA_HASH_SIZE];
+	struct addr_hash sta_hash; /* STA info entries by address */
 
 	/*
 	 * Bitfield for indicating which AIDs are allocated. Only AID values
@@ -295,6 +304,23 @@ struct hostapd_data {
 	unsigned int cs_c_off_ecsa_beacon;
 	unsigned int cs_c_off_ecsa_proberesp;
 
+	/* Probe Response frame templates for handle_probe_req(); index 1 is
+	 * used for P2P Probe Request frames. These are cleared whenever the
+	 * Beacon frame contents are rebuilt. */
+	u8 *probe_resp_tmpl[2];
+	size_t probe_resp_tmpl_len[2];
+	unsigned int bss_load_off_proberesp;
+
+	/* Probe Request frame throttling (probe_resp_rate_limit and
+	 * probe_resp_dedup_time) */
+	u64 probe_resp_tokens; /* in 1/1000000 of a response */
+	struct os_reltime probe_resp_tokens_update;
+	struct hostapd_probe_req_seen *probe_req_seen;
+	u32 probe_req_rx;
+	u32 probe_resp_tx;
+	u32 probe_req_rate_limited;
+	u32 probe_req_dup;
+
 #ifdef CONFIG_P2P
 	struct p2p_data *p2p;
 	struct p2p_group *p2p_group;
@@ -325,6 +351,7 @@ struct hostapd_data {
 
 #ifdef CONFIG_SQLITE
 	struct hostapd_eap_user tmp_eap_user;
+	struct eap_user_db *eap_user_db;
 #endif /* CONFIG_SQLITE */
 
 #ifdef CONFIG_SAE
@@ -335,6 +362,9 @@ struct hostapd_data {
 	u16 sae_pending_token_idx[256];
 	int dot11RSNASAERetransPeriod; /* msec */
 	struct dl_list sae_commit_queue; /* struct hostapd_sae_commit_queue */
+	unsigned int sae_pwe_jobs; /* number of pending PWE precomputations */
+	/* Precomputed PWE for the queued frame that is being processed */
+	const struct sae_pwe_precomp *sae_pwe_hint;
 #endif /* CONFIG_SAE */
 
 #ifdef CONFIG_TESTING_OPTIONS
@@ -423,6 +453,7 @@ struct hostapd_data {
 
 #ifdef CONFIG_SQLITE
 	sqlite3 *rad_attr_db;
+	sqlite3_stmt *rad_attr_stmt;
 #endif /* CONFIG_SQLITE */
 
 #ifdef CONFIG_CTRL_IFACE_UDP
@@ -493,7 +524,7 @@ struct hostapd_iface {
 
 	int num_ap; /* number of entries in ap_list */
 	struct ap_info *ap_list; /* AP info list head */
-	struct ap_info *ap_hash[STA_HASH_SIZE];
+	struct addr_hash ap_hash; /* AP info entries by address */
 
 	u64 drv_flags;
 	u64 drv_flags2;
@@ -680,6 +711,18 @@ void hostapd_acs_channel_selected(struct hostapd_data *hapd,
 const struct hostapd_eap_user *
 hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
 		     size_t identity_len, int phase2);
+int hostapd_prefetch_eap_user(struct hostapd_data *hapd, const u8 *identity,
+			      size_t identity_len, int phase2,
+			      void *session_ctx);
+void hostapd_cancel_eap_user_prefetch(struct hostapd_data *hapd,
+				      void *session_ctx);
+#ifdef CONFIG_MODULE_TESTS
+int hostapd_eap_user_db_run_pending(struct hostapd_data *hapd);
+#endif /* CONFIG_MODULE_TESTS */
+void hostapd_eap_user_index_start(struct hostapd_data *hapd);
+void hostapd_eap_user_index_stop(struct hostapd_data *hapd);
+void hostapd_eap_user_db_flush(struct hostapd_data *hapd);
+void hostapd_eap_user_db_deinit(struct hostapd_data *hapd);
 
 struct hostapd_data * hostapd_get_iface(struct hapd_interfaces *interfaces,
 					const char *ifname);
@@ -488,7 +488,7 @@ static void sae_set_state(struct sta_info *sta, enum sae_state state,
 
 
 static const char * sae_get_password(struct hostapd_data *hapd,
-				     struct sta_info *sta,
+				     const u8 *addr,
 				     const char *rx_id,
 				     struct sae_password_entry **pw_entry,
 				     struct sae_pt **s_pt,
@@ -501,7 +501,7 @@ static const char * sae_get_password(struct hostapd_data *hapd,
 
 	for (pw = hapd->conf->sae_passwords; pw; pw = pw->next) {
 		if (!is_broadcast_ether_addr(pw->peer_addr) &&
-		    os_memcmp(pw->peer_addr, sta->addr, ETH_ALEN) != 0)
+		    os_memcmp(pw->peer_addr, addr, ETH_ALEN) != 0)
 			continue;
 		if ((rx_id && !pw->identifier) || (!rx_id && pw->identifier))
 			continue;
@@ -559,21 +559,30 @@ static struct wpabuf * auth_build_sae_commit(struct hostapd_data *hapd,
 		 status_code == WLAN_STATUS_SAE_PK)
 		use_pt = 1;
 
-	password = sae_get_password(hapd, sta, rx_id, &pw, &pt, &pk);
+	password = sae_get_password(hapd, sta->addr, rx_id, &pw, &pt, &pk);
 	if (!password || (use_pt && !pt)) {
 		wpa_printf(MSG_DEBUG, "SAE: No password available");
 		return NULL;
 	}
 
-	if (update && use_pt &&
-	    sae_prepare_commit_pt(sta->sae, pt, hapd->own_addr, sta->addr,
-				  NULL, pk) < 0)
+	if (update && !rx_id &&
+	    sae_pwe_precomp_match(hapd->sae_pwe_hint, sta->sae->group,
+				  hapd->own_addr, sta->addr,
+				  (const u8 *) password, os_strlen(password),
+				  use_pt ? pt : NULL)) {
+		wpa_printf(MSG_DEBUG, "SAE: Use precomputed PWE");
+		if (sae_prepare_commit_precomp(sta->sae, hapd->sae_pwe_hint,
+					       use_pt ? pt : NULL, NULL,
+					       pk) < 0)
+			return NULL;
+	} else if (update && use_pt &&
+		   sae_prepare_commit_pt(sta->sae, pt, hapd->own_addr,
+					 sta->addr, NULL, pk) < 0) {
 		return NULL;
-
-	if (update && !use_pt &&
-	    sae_prepare_commit(hapd->own_addr, sta->addr,
-			       (u8 *) password, os_strlen(password), rx_id,
-			       sta->sae) < 0) {
+	} else if (update && !use_pt &&
+		   sae_prepare_commit(hapd->own_addr, sta->addr,
+				      (u8 *) password, os_strlen(password),
+				      rx_id, sta->sae) < 0) {
 		wpa_printf(MSG_DEBUG, "SAE: Could not pick PWE");
 		return NULL;
 	}
@@ -1608,6 +1617,169 @@ int auth_sae_init_committed(struct hostapd_data *hapd, struct sta_info *sta)
 }
 
 
+static void auth_sae_schedule_commit(struct hostapd_data *hapd,
+				     unsigned int queue_len)
+{
+	unsigned int delay;
+
+	if (queue_len == 0)
+		delay = 0;
+	else if (hapd->conf->sae_commit_queue_delay > 60000000 / queue_len)
+		delay = 60000000; /* limit to one minute */
+	else
+		delay = queue_len * hapd->conf->sae_commit_queue_delay;
+
+	eloop_register_timeout(delay / 1000000, delay % 1000000,
+			       auth_sae_process_commit, hapd, NULL);
+}
+
+
+static unsigned int auth_sae_pwe_workers(struct hostapd_data *hapd)
+{
+	int workers = hapd->conf->sae_commit_workers;
+
+	if (workers < 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		workers = cpus > 0 ? cpus : 1;
+#else /* _SC_NPROCESSORS_ONLN */
+		workers = 1;
+#endif /* _SC_NPROCESSORS_ONLN */
+	}
+
+	return workers;
+}
+
+
+static struct sae_pwe_precomp *
+auth_sae_pwe_precomp(struct hostapd_data *hapd,
+		     const struct ieee80211_mgmt *mgmt, size_t len)
+{
+	const char *password;
+	struct sae_pt *pt;
+	u16 status_code;
+	int group, h2e;
+
+	if (len < IEEE80211_HDRLEN + sizeof(mgmt->u.auth) + 2 ||
+	    le_to_host16(mgmt->u.auth.auth_transaction) != 1)
+		return NULL;
+
+	status_code = le_to_host16(mgmt->u.auth.status_code);
+	if (status_code == WLAN_STATUS_SUCCESS)
+		h2e = 0;
+	else if (status_code == WLAN_STATUS_SAE_HASH_TO_ELEMENT ||
+		 status_code == WLAN_STATUS_SAE_PK)
+		h2e = 1;
+	else
+		return NULL;
+
+	group = WPA_GET_LE16(mgmt->u.auth.variable);
+	if (!sae_is_group_enabled(hapd, group))
+		return NULL;
+
+	password = sae_get_password(hapd, mgmt->sa, NULL, NULL, &pt, NULL);
+	if (!password || (h2e && !pt))
+		return NULL;
+
+	return sae_pwe_precomp_init(group, hapd->own_addr, mgmt->sa,
+				    (const u8 *) password, os_strlen(password),
+				    h2e ? pt : NULL);
+}
+
+
+static void auth_sae_pwe_work(void *eloop_ctx, void *user_ctx)
+{
+	struct hostapd_sae_commit_queue *q = user_ctx;
+
+	/* Runs in a worker thread; only q->pwe may be accessed here */
+	if (sae_pwe_precomp_derive(q->pwe) < 0)
+		wpa_printf(MSG_DEBUG, "SAE: PWE precomputation failed");
+}
+
+
+static void auth_sae_pwe_start(struct hostapd_data *hapd);
+
+static void auth_sae_pwe_done(void *eloop_ctx, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	struct hostapd_sae_commit_queue *q = user_ctx;
+
+	q->pwe_job = SAE_PWE_JOB_DONE;
+	hapd->sae_pwe_jobs--;
+	auth_sae_pwe_start(hapd);
+
+	/* auth_sae_process_commit() waits for the job of the first entry */
+	if (q == dl_list_first(&hapd->sae_commit_queue,
+			       struct hostapd_sae_commit_queue, list) &&
+	    !eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
+		eloop_register_timeout(0, 0, auth_sae_process_commit, hapd,
+				       NULL);
+}
+
+
+/*
+ * Start PWE derivation for queued commit messages in worker threads so that
+ * the expensive part of processing the next messages runs in parallel while
+ * the event loop thread processes the queue in order.
+ */
+static void auth_sae_pwe_start(struct hostapd_data *hapd)
+{
+	struct hostapd_sae_commit_queue *q;
+	unsigned int workers;
+
+	workers = auth_sae_pwe_workers(hapd);
+	if (!workers || (hapd->conf->mesh & MESH_ENABLED))
+		return;
+
+	dl_list_for_each(q, &hapd->sae_commit_queue,
+			 struct hostapd_sae_commit_queue, list) {
+		if (hapd->sae_pwe_jobs >= workers)
+			break;
+		if (q->pwe_job != SAE_PWE_JOB_NONE)
+			continue;
+		q->pwe_job = SAE_PWE_JOB_SKIP;
+		q->pwe = auth_sae_pwe_precomp(
+			hapd, (const struct ieee80211_mgmt *) q->msg, q->len);
+		if (!q->pwe)
+			continue;
+		if (eloop_submit_work(auth_sae_pwe_work, auth_sae_pwe_done,
+				      hapd, q) < 0) {
+			sae_pwe_precomp_deinit(q->pwe);
+			q->pwe = NULL;
+			continue;
+		}
+		q->pwe_job = SAE_PWE_JOB_PENDING;
+		hapd->sae_pwe_jobs++;
+	}
+}
+
+
+static void auth_sae_queue_free(struct hostapd_data *hapd,
+				struct hostapd_sae_commit_queue *q)
+{
+	if (q->pwe_job == SAE_PWE_JOB_PENDING) {
+		eloop_cancel_work(auth_sae_pwe_work, hapd, q);
+		hapd->sae_pwe_jobs--;
+	}
+	sae_pwe_precomp_deinit(q->pwe);
+	os_free(q);
+}
+
+
+void auth_sae_queue_flush(struct hostapd_data *hapd)
+{
+	struct hostapd_sae_commit_queue *q;
+
+	while ((q = dl_list_first(&hapd->sae_commit_queue,
+				  struct hostapd_sae_commit_queue, list))) {
+		dl_list_del(&q->list);
+		auth_sae_queue_free(hapd, q);
+	}
+	eloop_cancel_timeout(auth_sae_process_commit, hapd, NULL);
+}
+
+
 void auth_sae_process_commit(void *eloop_ctx, void *user_ctx)
 {
 	struct hostapd_data *hapd = eloop_ctx;
@@ -1618,18 +1790,26 @@ void auth_sae_process_commit(void *eloop_ctx, void *user_ctx)
 			  struct hostapd_sae_commit_queue, list);
 	if (!q)
 		return;
+	if (q->pwe_job == SAE_PWE_JOB_PENDING) {
+		/* Continued from auth_sae_pwe_done() */
+		wpa_printf(MSG_DEBUG,
+			   "SAE: Wait for PWE precomputation for the next message in queue");
+		return;
+	}
 	wpa_printf(MSG_DEBUG,
 		   "SAE: Process next available message from queue");
 	dl_list_del(&q->list);
+	hapd->sae_pwe_hint = q->pwe;
 	handle_auth(hapd, (const struct ieee80211_mgmt *) q->msg, q->len,
 		    q->rssi, 1);
-	os_free(q);
+	hapd->sae_pwe_hint = NULL;
+	auth_sae_queue_free(hapd, q);
+	auth_sae_pwe_start(hapd);
 
 	if (eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
 		return;
 	queue_len = dl_list_len(&hapd->sae_commit_queue);
-	eloop_register_timeout(0, queue_len * 50000, auth_sae_process_commit,
-			       hapd, NULL);
+	auth_sae_schedule_commit(hapd, queue_len);
 }
 
 
@@ -1642,7 +1822,7 @@ static void auth_sae_queue(struct hostapd_data *hapd,
 	const struct ieee80211_mgmt *mgmt2;
 
 	queue_len = dl_list_len(&hapd->sae_commit_queue);
-	if (queue_len >= 15) {
+	if (queue_len >= hapd->conf->sae_commit_queue_max) {
 		wpa_printf(MSG_DEBUG,
 			   "SAE: No more room in message queue - drop the new frame from "
 			   MACSTR, MAC2STR(mgmt->sa));
@@ -1675,7 +1855,7 @@ static void auth_sae_queue(struct hostapd_data *hapd,
 				   "SAE: Replace queued message from same STA with same transaction number");
 			dl_list_add(&q2->list, &q->list);
 			dl_list_del(&q2->list);
-			os_free(q2);
+			auth_sae_queue_free(hapd, q2);
 			goto queued;
 		}
 	}
@@ -1684,10 +1864,10 @@ static void auth_sae_queue(struct hostapd_data *hapd,
 	dl_list_add_tail(&hapd->sae_commit_queue, &q->list);
 
 queued:
+	auth_sae_pwe_start(hapd);
 	if (eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
 		return;
-	eloop_register_timeout(0, queue_len * 50000, auth_sae_process_commit,
-			       hapd, NULL);
+	auth_sae_schedule_commit(hapd, queue_len);
 }
 
 
@@ -2404,7 +2584,7 @@ static int pasn_wd_handle_sae_commit(struct hostapd_data *hapd,
 		return -1;
 	}
 
-	password = sae_get_password(hapd, sta, NULL, NULL, NULL, NULL);
+	password = sae_get_password(hapd, sta->addr, NULL, NULL, NULL, NULL);
 	if (!password) {
 		wpa_printf(MSG_DEBUG, "PASN: No SAE password found");
 		return -1;
@@ -625,20 +625,24 @@ int add_sqlite_radius_attr(struct hostapd_data *hapd, struct sta_info *sta,
 	const char *attrtxt;
 	char addrtxt[3 * ETH_ALEN];
 	char *sql;
-	sqlite3_stmt *stmt = NULL;
+	sqlite3_stmt *stmt;
 
 	if (!hapd->rad_attr_db)
 		return 0;
 
 	os_snprintf(addrtxt, sizeof(addrtxt), MACSTR, MAC2STR(sta->addr));
 
+	/* The statement is prepared once and reused for each request */
 	sql = "SELECT attr FROM radius_attributes WHERE sta=? AND (reqtype=? OR reqtype IS NULL);";
-	if (sqlite3_prepare_v2(hapd->rad_attr_db, sql, os_strlen(sql), &stmt,
-			       NULL) != SQLITE_OK) {
+	if (!hapd->rad_attr_stmt &&
+	    sqlite3_prepare_v2(hapd->rad_attr_db, sql, os_strlen(sql),
+			       &hapd->rad_attr_stmt, NULL) != SQLITE_OK) {
 		wpa_printf(MSG_ERROR, "DB: Failed to prepare SQL statement: %s",
 			   sqlite3_errmsg(hapd->rad_attr_db));
+		hapd->rad_attr_stmt = NULL;
 		return -1;
 	}
+	stmt = hapd->rad_attr_stmt;
 	sqlite3_bind_text(stmt, 1, addrtxt, os_strlen(addrtxt), SQLITE_STATIC);
 	sqlite3_bind_text(stmt, 2, acct ? "acct" : "auth", 4, SQLITE_STATIC);
 	while (sqlite3_step(stmt) == SQLITE_ROW) {
@@ -668,7 +672,6 @@ int add_sqlite_radius_attr(struct hostapd_data *hapd, struct sta_info *sta,
 
 	sqlite3_reset(stmt);
 	sqlite3_clear_bindings(stmt);
-	sqlite3_finalize(stmt);
 #endif /* CONFIG_SQLITE */
 
 	return 0;
@@ -2311,6 +2314,25 @@ out:
 }
 
 
+static int ieee802_1x_prefetch_eap_user(void *ctx, const u8 *identity,
+					size_t identity_len, int phase2,
+					void *session_ctx)
+{
+	struct hostapd_data *hapd = ctx;
+
+	return hostapd_prefetch_eap_user(hapd, identity, identity_len, phase2,
+					 session_ctx);
+}
+
+
+static void ieee802_1x_cancel_eap_user_prefetch(void *ctx, void *session_ctx)
+{
+	struct hostapd_data *hapd = ctx;
+
+	hostapd_cancel_eap_user_prefetch(hapd, session_ctx);
+}
+
+
 static int ieee802_1x_sta_entry_alive(void *ctx, const u8 *addr)
 {
 	struct hostapd_data *hapd = ctx;
@@ -2454,6 +2476,8 @@ int ieee802_1x_init(struct hostapd_data *hapd)
 	cb.aaa_send = ieee802_1x_aaa_send;
 	cb.finished = _ieee802_1x_finished;
 	cb.get_eap_user = ieee802_1x_get_eap_user;
+	cb.prefetch_eap_user = ieee802_1x_prefetch_eap_user;
+	cb.cancel_eap_user_prefetch = ieee802_1x_cancel_eap_user_prefetch;
 	cb.sta_entry_alive = ieee802_1x_sta_entry_alive;
 	cb.logger = ieee802_1x_logger;
 	cb.set_port_authorized = ieee802_1x_set_port_authorized;
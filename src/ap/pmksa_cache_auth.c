@@ -21,12 +21,19 @@
 static const int pmksa_cache_max_entries = 1024;
 static const int dot11RSNAConfigPMKLifetime = 43200;
 
+#define PMKID_HASH_MIN_SIZE 128
+
 struct rsn_pmksa_cache {
-#define PMKID_HASH_SIZE 128
-#define PMKID_HASH(pmkid) (unsigned int) ((pmkid)[0] & 0x7f)
-	struct rsn_pmksa_cache_entry *pmkid[PMKID_HASH_SIZE];
-	struct rsn_pmksa_cache_entry *pmksa;
+	/* Hash table of entries by PMKID; the number of buckets is a power of
+	 * two and follows the number of entries */
+	struct rsn_pmksa_cache_entry **pmkid;
+	size_t pmkid_size;
+	struct dl_list pmksa; /* all entries in the order they were added */
+	/* Binary min-heap of the entries ordered by expiration time */
+	struct rsn_pmksa_cache_entry **expire;
+	size_t expire_size;
 	int pmksa_count;
+	struct addr_hash spa; /* entries by Supplicant address */
 
 	void (*free_cb)(struct rsn_pmksa_cache_entry *entry, void *ctx);
 	void *ctx;
@@ -36,6 +43,96 @@ struct rsn_pmksa_cache {
 static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa);
 
 
+static unsigned int pmkid_hash(const struct rsn_pmksa_cache *pmksa,
+			       const u8 *pmkid)
+{
+	/* PMKIDs of cached entries are HMAC outputs, so any of the octets
+	 * will do; use all of them to avoid depending on that */
+	return (WPA_GET_LE32(pmkid) ^ WPA_GET_LE32(pmkid + 4) ^
+		WPA_GET_LE32(pmkid + 8) ^ WPA_GET_LE32(pmkid + 12)) &
+		(pmksa->pmkid_size - 1);
+}
+
+
+static void pmkid_hash_resize(struct rsn_pmksa_cache *pmksa, size_t size)
+{
+	struct rsn_pmksa_cache_entry **old = pmksa->pmkid, *entry, *next;
+	size_t old_size = pmksa->pmkid_size, i;
+	unsigned int hash;
+
+	pmksa->pmkid = os_calloc(size, sizeof(*pmksa->pmkid));
+	if (!pmksa->pmkid) {
+		/* Keep using the old table with longer chains */
+		pmksa->pmkid = old;
+		return;
+	}
+	pmksa->pmkid_size = size;
+
+	for (i = 0; i < old_size; i++) {
+		for (entry = old[i]; entry; entry = next) {
+			next = entry->hnext;
+			hash = pmkid_hash(pmksa, entry->pmkid);
+			entry->hnext = pmksa->pmkid[hash];
+			pmksa->pmkid[hash] = entry;
+		}
+	}
+	os_free(old);
+}
+
+
+static void pmksa_expire_heap_set(struct rsn_pmksa_cache *pmksa, size_t idx,
+				  struct rsn_pmksa_cache_entry *entry)
+{
+	pmksa->expire[idx] = entry;
+	entry->expire_idx = idx;
+}
+
+
+static void pmksa_expire_heap_up(struct rsn_pmksa_cache *pmksa, size_t idx)
+{
+	struct rsn_pmksa_cache_entry *entry = pmksa->expire[idx], *parent;
+
+	while (idx > 0) {
+		parent = pmksa->expire[(idx - 1) / 2];
+		if (parent->expiration <= entry->expiration)
+			break;
+		pmksa_expire_heap_set(pmksa, idx, parent);
+		idx = (idx - 1) / 2;
+	}
+	pmksa_expire_heap_set(pmksa, idx, entry);
+}
+
+
+static void pmksa_expire_heap_down(struct rsn_pmksa_cache *pmksa, size_t idx)
+{
+	struct rsn_pmksa_cache_entry *entry = pmksa->expire[idx], *child;
+	size_t count = pmksa->pmksa_count, c;
+
+	for (;;) {
+		c = 2 * idx + 1;
+		if (c >= count)
+			break;
+		if (c + 1 < count &&
+		    pmksa->expire[c + 1]->expiration <
+		    pmksa->expire[c]->expiration)
+			c++;
+		child = pmksa->expire[c];
+		if (entry->expiration <= child->expiration)
+			break;
+		pmksa_expire_heap_set(pmksa, idx, child);
+		idx = c;
+	}
+	pmksa_expire_heap_set(pmksa, idx, entry);
+}
+
+
+static struct rsn_pmksa_cache_entry *
+pmksa_cache_oldest(struct rsn_pmksa_cache *pmksa)
+{
+	return pmksa->pmksa_count > 0 ? pmksa->expire[0] : NULL;
+}
+
+
 static void _pmksa_cache_free_entry(struct rsn_pmksa_cache_entry *entry)
 {
 	os_free(entry->vlan_desc);
@@ -51,42 +148,39 @@ static void _pmksa_cache_free_entry(struct rsn_pmksa_cache_entry *entry)
 void pmksa_cache_free_entry(struct rsn_pmksa_cache *pmksa,
 			    struct rsn_pmksa_cache_entry *entry)
 {
-	struct rsn_pmksa_cache_entry *pos, *prev;
-	unsigned int hash;
+	struct rsn_pmksa_cache_entry **pos, *last;
+	size_t idx;
 
-	pmksa->pmksa_count--;
 	pmksa->free_cb(entry, pmksa->ctx);
 
 	/* unlink from hash list */
-	hash = PMKID_HASH(entry->pmkid);
-	pos = pmksa->pmkid[hash];
-	prev = NULL;
-	while (pos) {
-		if (pos == entry) {
-			if (prev != NULL)
-				prev->hnext = entry->hnext;
-			else
-				pmksa->pmkid[hash] = entry->hnext;
-			break;
-		}
-		prev = pos;
-		pos = pos->hnext;
+	pos = &pmksa->pmkid[pmkid_hash(pmksa, entry->pmkid)];
+	while (*pos && *pos != entry)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = entry->hnext;
+
+	addr_hash_del(&pmksa->spa, &entry->spa_hnode);
+
+	/* unlink from expiration heap */
+	idx = entry->expire_idx;
+	pmksa->pmksa_count--;
+	if (idx < (size_t) pmksa->pmksa_count) {
+		last = pmksa->expire[pmksa->pmksa_count];
+		pmksa_expire_heap_set(pmksa, idx, last);
+		if (idx > 0 &&
+		    last->expiration < pmksa->expire[(idx - 1) / 2]->expiration)
+			pmksa_expire_heap_up(pmksa, idx);
+		else
+			pmksa_expire_heap_down(pmksa, idx);
 	}
 
 	/* unlink from entry list */
-	pos = pmksa->pmksa;
-	prev = NULL;
-	while (pos) {
-		if (pos == entry) {
-			if (prev != NULL)
-				prev->next = entry->next;
-			else
-				pmksa->pmksa = entry->next;
-			break;
-		}
-		prev = pos;
-		pos = pos->next;
-	}
+	dl_list_del(&entry->list);
+
+	if (pmksa->pmkid_size > PMKID_HASH_MIN_SIZE &&
+	    (size_t) pmksa->pmksa_count < pmksa->pmkid_size / 4)
+		pmkid_hash_resize(pmksa, pmksa->pmkid_size / 2);
 
 	_pmksa_cache_free_entry(entry);
 }
@@ -98,10 +192,12 @@ void pmksa_cache_free_entry(struct rsn_pmksa_cache *pmksa,
  */
 void pmksa_cache_auth_flush(struct rsn_pmksa_cache *pmksa)
 {
-	while (pmksa->pmksa) {
+	struct rsn_pmksa_cache_entry *entry;
+
+	while ((entry = pmksa_cache_oldest(pmksa))) {
 		wpa_printf(MSG_DEBUG, "RSN: Flush PMKSA cache entry for "
-			   MACSTR, MAC2STR(pmksa->pmksa->spa));
-		pmksa_cache_free_entry(pmksa, pmksa->pmksa);
+			   MACSTR, MAC2STR(entry->spa));
+		pmksa_cache_free_entry(pmksa, entry);
 	}
 }
 
@@ -109,13 +205,15 @@ void pmksa_cache_auth_flush(struct rsn_pmksa_cache *pmksa)
 static void pmksa_cache_expire(void *eloop_ctx, void *timeout_ctx)
 {
 	struct rsn_pmksa_cache *pmksa = eloop_ctx;
+	struct rsn_pmksa_cache_entry *entry;
 	struct os_reltime now;
 
 	os_get_reltime(&now);
-	while (pmksa->pmksa && pmksa->pmksa->expiration <= now.sec) {
+	while ((entry = pmksa_cache_oldest(pmksa)) &&
+	       entry->expiration <= now.sec) {
 		wpa_printf(MSG_DEBUG, "RSN: expired PMKSA cache entry for "
-			   MACSTR, MAC2STR(pmksa->pmksa->spa));
-		pmksa_cache_free_entry(pmksa, pmksa->pmksa);
+			   MACSTR, MAC2STR(entry->spa));
+		pmksa_cache_free_entry(pmksa, entry);
 	}
 
 	pmksa_cache_set_expiration(pmksa);
@@ -124,14 +222,16 @@ static void pmksa_cache_expire(void *eloop_ctx, void *timeout_ctx)
 
 static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa)
 {
+	struct rsn_pmksa_cache_entry *entry;
 	int sec;
 	struct os_reltime now;
 
 	eloop_cancel_timeout(pmksa_cache_expire, pmksa, NULL);
-	if (pmksa->pmksa == NULL)
+	entry = pmksa_cache_oldest(pmksa);
+	if (entry == NULL)
 		return;
 	os_get_reltime(&now);
-	sec = pmksa->pmksa->expiration - now.sec;
+	sec = entry->expiration - now.sec;
 	if (sec < 0)
 		sec = 0;
 	eloop_register_timeout(sec + 1, 0, pmksa_cache_expire, pmksa, NULL);
@@ -219,39 +319,47 @@ void pmksa_cache_to_eapol_data(struct hostapd_data *hapd,
 }
 
 
-static void pmksa_cache_link_entry(struct rsn_pmksa_cache *pmksa,
-				   struct rsn_pmksa_cache_entry *entry)
+static int pmksa_cache_link_entry(struct rsn_pmksa_cache *pmksa,
+				  struct rsn_pmksa_cache_entry *entry)
 {
-	struct rsn_pmksa_cache_entry *pos, *prev;
-	int hash;
-
-	/* Add the new entry; order by expiration time */
-	pos = pmksa->pmksa;
-	prev = NULL;
-	while (pos) {
-		if (pos->expiration > entry->expiration)
-			break;
-		prev = pos;
-		pos = pos->next;
-	}
-	if (prev == NULL) {
-		entry->next = pmksa->pmksa;
-		pmksa->pmksa = entry;
-	} else {
-		entry->next = prev->next;
-		prev->next = entry;
+	unsigned int hash;
+
+	if ((size_t) pmksa->pmksa_count == pmksa->expire_size) {
+		struct rsn_pmksa_cache_entry **expire;
+		size_t size = pmksa->expire_size ? pmksa->expire_size * 2 : 16;
+
+		expire = os_realloc_array(pmksa->expire, size,
+					  sizeof(*expire));
+		if (!expire)
+			return -1;
+		pmksa->expire = expire;
+		pmksa->expire_size = size;
 	}
 
-	hash = PMKID_HASH(entry->pmkid);
+	if (addr_hash_add(&pmksa->spa,
+			  ADDR_HASH_ADDR_OFFSET(struct rsn_pmksa_cache_entry,
+						spa_hnode, spa),
+			  &entry->spa_hnode) < 0)
+		return -1;
+
+	if ((size_t) pmksa->pmksa_count >= pmksa->pmkid_size)
+		pmkid_hash_resize(pmksa, pmksa->pmkid_size * 2);
+	hash = pmkid_hash(pmksa, entry->pmkid);
 	entry->hnext = pmksa->pmkid[hash];
 	pmksa->pmkid[hash] = entry;
 
+	dl_list_add_tail(&pmksa->pmksa, &entry->list);
+
+	pmksa_expire_heap_set(pmksa, pmksa->pmksa_count, entry);
 	pmksa->pmksa_count++;
-	if (prev == NULL)
+	pmksa_expire_heap_up(pmksa, entry->expire_idx);
+	if (entry->expire_idx == 0)
 		pmksa_cache_set_expiration(pmksa);
 	wpa_printf(MSG_DEBUG, "RSN: added PMKSA cache entry for " MACSTR,
 		   MAC2STR(entry->spa));
 	wpa_hexdump(MSG_DEBUG, "RSN: added PMKID", entry->pmkid, PMKID_LEN);
+
+	return 0;
 }
 
 
@@ -288,8 +396,11 @@ pmksa_cache_auth_add(struct rsn_pmksa_cache *pmksa,
 					      aa, spa, session_timeout, eapol,
 					      akmp);
 
-	if (pmksa_cache_auth_add_entry(pmksa, entry) < 0)
+	if (pmksa_cache_auth_add_entry(pmksa, entry) < 0) {
+		if (entry)
+			_pmksa_cache_free_entry(entry);
 		return NULL;
+	}
 
 	return entry;
 }
@@ -361,6 +472,7 @@ pmksa_cache_auth_create_entry(const u8 *pmk, size_t pmk_len, const u8 *pmkid,
  * This function adds PMKSA cache entry to the PMKSA cache. If an old entry is
  * already in the cache for the same Supplicant, this entry will be replaced
  * with the new entry. PMKID will be calculated based on the PMK.
+ * Returns: 0 on success, -1 on failure; the entry is not freed on failure
  */
 int pmksa_cache_auth_add_entry(struct rsn_pmksa_cache *pmksa,
 			       struct rsn_pmksa_cache_entry *entry)
@@ -376,17 +488,16 @@ int pmksa_cache_auth_add_entry(struct rsn_pmksa_cache *pmksa,
 	if (pos)
 		pmksa_cache_free_entry(pmksa, pos);
 
-	if (pmksa->pmksa_count >= pmksa_cache_max_entries && pmksa->pmksa) {
+	pos = pmksa_cache_oldest(pmksa);
+	if (pmksa->pmksa_count >= pmksa_cache_max_entries && pos) {
 		/* Remove the oldest entry to make room for the new entry */
 		wpa_printf(MSG_DEBUG, "RSN: removed the oldest PMKSA cache "
 			   "entry (for " MACSTR ") to make room for new one",
-			   MAC2STR(pmksa->pmksa->spa));
-		pmksa_cache_free_entry(pmksa, pmksa->pmksa);
+			   MAC2STR(pos->spa));
+		pmksa_cache_free_entry(pmksa, pos);
 	}
 
-	pmksa_cache_link_entry(pmksa, entry);
-
-	return 0;
+	return pmksa_cache_link_entry(pmksa, entry);
 }
 
 
@@ -430,7 +541,10 @@ pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
 	}
 	entry->opportunistic = 1;
 
-	pmksa_cache_link_entry(pmksa, entry);
+	if (pmksa_cache_link_entry(pmksa, entry) < 0) {
+		_pmksa_cache_free_entry(entry);
+		return NULL;
+	}
 
 	return entry;
 }
@@ -443,22 +557,18 @@ pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
 void pmksa_cache_auth_deinit(struct rsn_pmksa_cache *pmksa)
 {
 	struct rsn_pmksa_cache_entry *entry, *prev;
-	int i;
 
 	if (pmksa == NULL)
 		return;
 
-	entry = pmksa->pmksa;
-	while (entry) {
-		prev = entry;
-		entry = entry->next;
-		_pmksa_cache_free_entry(prev);
-	}
+	dl_list_for_each_safe(entry, prev, &pmksa->pmksa,
+			      struct rsn_pmksa_cache_entry, list)
+		_pmksa_cache_free_entry(entry);
 	eloop_cancel_timeout(pmksa_cache_expire, pmksa, NULL);
 	pmksa->pmksa_count = 0;
-	pmksa->pmksa = NULL;
-	for (i = 0; i < PMKID_HASH_SIZE; i++)
-		pmksa->pmkid[i] = NULL;
+	os_free(pmksa->pmkid);
+	os_free(pmksa->expire);
+	addr_hash_deinit(&pmksa->spa);
 	os_free(pmksa);
 }
 
@@ -477,19 +587,29 @@ pmksa_cache_auth_get(struct rsn_pmksa_cache *pmksa,
 	struct rsn_pmksa_cache_entry *entry;
 
 	if (pmkid) {
-		for (entry = pmksa->pmkid[PMKID_HASH(pmkid)]; entry;
+		for (entry = pmksa->pmkid[pmkid_hash(pmksa, pmkid)]; entry;
 		     entry = entry->hnext) {
 			if ((spa == NULL ||
 			     os_memcmp(entry->spa, spa, ETH_ALEN) == 0) &&
 			    os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0)
 				return entry;
 		}
-	} else {
-		for (entry = pmksa->pmksa; entry; entry = entry->next) {
-			if (spa == NULL ||
-			    os_memcmp(entry->spa, spa, ETH_ALEN) == 0)
-				return entry;
+	} else if (spa) {
+		struct rsn_pmksa_cache_entry *found = NULL;
+		struct addr_hash_node *node;
+
+		/* Return the entry that expires first like the list scan */
+		for (node = addr_hash_get(&pmksa->spa, spa); node;
+		     node = addr_hash_get_next(&pmksa->spa, node)) {
+			entry = addr_hash_entry(node,
+						struct rsn_pmksa_cache_entry,
+						spa_hnode);
+			if (!found || entry->expiration < found->expiration)
+				found = entry;
 		}
+		return found;
+	} else {
+		return pmksa_cache_oldest(pmksa);
 	}
 
 	return NULL;
@@ -511,11 +631,13 @@ struct rsn_pmksa_cache_entry * pmksa_cache_get_okc(
 	const u8 *pmkid)
 {
 	struct rsn_pmksa_cache_entry *entry;
+	struct addr_hash_node *node;
 	u8 new_pmkid[PMKID_LEN];
 
-	for (entry = pmksa->pmksa; entry; entry = entry->next) {
-		if (os_memcmp(entry->spa, spa, ETH_ALEN) != 0)
-			continue;
+	for (node = addr_hash_get(&pmksa->spa, spa); node;
+	     node = addr_hash_get_next(&pmksa->spa, node)) {
+		entry = addr_hash_entry(node, struct rsn_pmksa_cache_entry,
+					spa_hnode);
 		if (wpa_key_mgmt_sae(entry->akmp) ||
 		    wpa_key_mgmt_fils(entry->akmp)) {
 			if (os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0)
@@ -545,6 +667,14 @@ pmksa_cache_auth_init(void (*free_cb)(struct rsn_pmksa_cache_entry *entry,
 
 	pmksa = os_zalloc(sizeof(*pmksa));
 	if (pmksa) {
+		pmksa->pmkid = os_calloc(PMKID_HASH_MIN_SIZE,
+					 sizeof(*pmksa->pmkid));
+		if (!pmksa->pmkid) {
+			os_free(pmksa);
+			return NULL;
+		}
+		pmksa->pmkid_size = PMKID_HASH_MIN_SIZE;
+		dl_list_init(&pmksa->pmksa);
 		pmksa->free_cb = free_cb;
 		pmksa->ctx = ctx;
 	}
@@ -602,21 +732,17 @@ int pmksa_cache_auth_radius_das_disconnect(struct rsn_pmksa_cache *pmksa,
 					   struct radius_das_attrs *attr)
 {
 	int found = 0;
-	struct rsn_pmksa_cache_entry *entry, *prev;
+	struct rsn_pmksa_cache_entry *entry, *next;
 
 	if (attr->acct_session_id)
 		return -1;
 
-	entry = pmksa->pmksa;
-	while (entry) {
+	dl_list_for_each_safe(entry, next, &pmksa->pmksa,
+			      struct rsn_pmksa_cache_entry, list) {
 		if (das_attr_match(entry, attr)) {
 			found++;
-			prev = entry;
-			entry = entry->next;
-			pmksa_cache_free_entry(pmksa, prev);
-			continue;
+			pmksa_cache_free_entry(pmksa, entry);
 		}
-		entry = entry->next;
 	}
 
 	return found ? 0 : -1;
@@ -647,8 +773,8 @@ int pmksa_cache_auth_list(struct rsn_pmksa_cache *pmksa, char *buf, size_t len)
 		return pos - buf;
 	pos += ret;
 	i = 0;
-	entry = pmksa->pmksa;
-	while (entry) {
+	dl_list_for_each(entry, &pmksa->pmksa, struct rsn_pmksa_cache_entry,
+			 list) {
 		ret = os_snprintf(pos, buf + len - pos, "%d " MACSTR " ",
 				  i, MAC2STR(entry->spa));
 		if (os_snprintf_error(buf + len - pos, ret))
@@ -662,12 +788,47 @@ int pmksa_cache_auth_list(struct rsn_pmksa_cache *pmksa, char *buf, size_t len)
 		if (os_snprintf_error(buf + len - pos, ret))
 			return pos - buf;
 		pos += ret;
-		entry = entry->next;
 	}
 	return pos - buf;
 }
 
 
+/**
+ * pmksa_cache_auth_hash_stats - Write PMKSA cache index statistics
+ * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
+ * @buf: Buffer for the text
+ * @len: Length of the buffer
+ * Returns: Number of bytes written to buffer
+ */
+int pmksa_cache_auth_hash_stats(struct rsn_pmksa_cache *pmksa, char *buf,
+				size_t len)
+{
+	struct rsn_pmksa_cache_entry *entry;
+	size_t i, chain, max_chain = 0, used = 0;
+	int ret, ret2;
+
+	for (i = 0; i < pmksa->pmkid_size; i++) {
+		chain = 0;
+		for (entry = pmksa->pmkid[i]; entry; entry = entry->hnext)
+			chain++;
+		if (chain)
+			used++;
+		if (chain > max_chain)
+			max_chain = chain;
+	}
+
+	ret = os_snprintf(buf, len,
+			  "pmksa_pmkid: size=%zu entries=%d used=%zu max_chain=%zu\n",
+			  pmksa->pmkid_size, pmksa->pmksa_count, used, max_chain);
+	if (os_snprintf_error(len, ret))
+		return 0;
+	ret2 = addr_hash_stats(&pmksa->spa, "pmksa_spa", buf + ret, len - ret);
+	if (ret2 < 0)
+		return ret;
+	return ret + ret2;
+}
+
+
 #ifdef CONFIG_PMKSA_CACHE_EXTERNAL
 #ifdef CONFIG_MESH
 
@@ -700,7 +861,8 @@ int pmksa_cache_auth_list_mesh(struct rsn_pmksa_cache *pmksa, const u8 *addr,
 	 * Entry format:
 	 * <BSSID> <PMKID> <PMK> <expiration in seconds>
 	 */
-	for (entry = pmksa->pmksa; entry; entry = entry->next) {
+	dl_list_for_each(entry, &pmksa->pmksa, struct rsn_pmksa_cache_entry,
+			 list) {
 		if (addr && os_memcmp(entry->spa, addr, ETH_ALEN) != 0)
 			continue;
 
@@ -9,13 +9,18 @@
 #ifndef PMKSA_CACHE_H
 #define PMKSA_CACHE_H
 
+#include "utils/list.h"
+#include "utils/addr_hash.h"
 #include "radius/radius.h"
 
 /**
  * struct rsn_pmksa_cache_entry - PMKSA cache entry
  */
 struct rsn_pmksa_cache_entry {
-	struct rsn_pmksa_cache_entry *next, *hnext;
+	struct dl_list list; /* entry in the list of all entries */
+	struct rsn_pmksa_cache_entry *hnext; /* next entry in PMKID hash */
+	struct addr_hash_node spa_hnode; /* entry in the SPA index */
+	size_t expire_idx; /* position in the expiration heap */
 	u8 pmkid[PMKID_LEN];
 	u8 pmk[PMK_LEN_MAX];
 	size_t pmk_len;
@@ -47,6 +52,8 @@ pmksa_cache_auth_get(struct rsn_pmksa_cache *pmksa,
 struct rsn_pmksa_cache_entry * pmksa_cache_get_okc(
 	struct rsn_pmksa_cache *pmksa, const u8 *spa, const u8 *aa,
 	const u8 *pmkid);
+int pmksa_cache_auth_hash_stats(struct rsn_pmksa_cache *pmksa, char *buf,
+				size_t len);
 struct rsn_pmksa_cache_entry *
 pmksa_cache_auth_add(struct rsn_pmksa_cache *pmksa,
 		     const u8 *pmk, size_t pmk_len, const u8 *pmkid,
@@ -68,12 +68,12 @@ int ap_for_each_sta(struct hostapd_data *hapd,
 
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta)
 {
-	struct sta_info *s;
+	struct addr_hash_node *node;
 
-	s = hapd->sta_hash[STA_HASH(sta)];
-	while (s != NULL && os_memcmp(s->addr, sta, 6) != 0)
-		s = s->hnext;
-	return s;
+	node = addr_hash_get(&hapd->sta_hash, sta);
+	if (!node)
+		return NULL;
+	return addr_hash_entry(node, struct sta_info, hnode);
 }
 
 
@@ -121,30 +121,18 @@ static void ap_sta_list_del(struct hostapd_data *hapd, struct sta_info *sta)
 }
 
 
-void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta)
+int ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta)
 {
-	sta->hnext = hapd->sta_hash[STA_HASH(sta->addr)];
-	hapd->sta_hash[STA_HASH(sta->addr)] = sta;
+	return addr_hash_add(&hapd->sta_hash,
+			     ADDR_HASH_ADDR_OFFSET(struct sta_info, hnode,
+						   addr),
+			     &sta->hnode);
 }
 
 
 static void ap_sta_hash_del(struct hostapd_data *hapd, struct sta_info *sta)
 {
-	struct sta_info *s;
-
-	s = hapd->sta_hash[STA_HASH(sta->addr)];
-	if (s == NULL) return;
-	if (os_memcmp(s->addr, sta->addr, 6) == 0) {
-		hapd->sta_hash[STA_HASH(sta->addr)] = s->hnext;
-		return;
-	}
-
-	while (s->hnext != NULL &&
-	       os_memcmp(s->hnext->addr, sta->addr, ETH_ALEN) != 0)
-		s = s->hnext;
-	if (s->hnext != NULL)
-		s->hnext = s->hnext->hnext;
-	else
+	if (addr_hash_del(&hapd->sta_hash, &sta->hnode) < 0)
 		wpa_printf(MSG_DEBUG, "AP: could not remove STA " MACSTR
 			   " from hash table", MAC2STR(sta->addr));
 }
@@ -433,6 +421,8 @@ void hostapd_free_stas(struct hostapd_data *hapd)
 			   MAC2STR(prev->addr));
 		ap_free_sta(hapd, prev);
 	}
+
+	addr_hash_deinit(&hapd->sta_hash);
 }
 
 
@@ -742,6 +732,12 @@ struct sta_info * ap_sta_add(struct hostapd_data *hapd, const u8 *addr)
 	}
 	sta->supported_rates_len = i;
 
+	os_memcpy(sta->addr, addr, ETH_ALEN);
+	if (ap_sta_hash_add(hapd, sta) < 0) {
+		os_free(sta);
+		return NULL;
+	}
+
 	if (!(hapd->iface->drv_flags & WPA_DRIVER_FLAGS_INACTIVITY_TIMER)) {
 		wpa_printf(MSG_DEBUG, "%s: register ap_handle_timer timeout "
 			   "for " MACSTR " (%d seconds - ap_max_inactivity)",
@@ -752,11 +748,9 @@ struct sta_info * ap_sta_add(struct hostapd_data *hapd, const u8 *addr)
 	}
 
 	/* initialize STA info data */
-	os_memcpy(sta->addr, addr, ETH_ALEN);
 	sta->next = hapd->sta_list;
 	hapd->sta_list = sta;
 	hapd->num_sta++;
-	ap_sta_hash_add(hapd, sta);
 	ap_sta_remove_in_other_bss(hapd, sta);
 	sta->last_seq_ctrl = WLAN_INVALID_MGMT_SEQ;
 	dl_list_init(&sta->ip6addr);
@@ -11,6 +11,7 @@
 
 #include "common/defs.h"
 #include "list.h"
+#include "utils/addr_hash.h"
 #include "vlan.h"
 #include "common/wpa_common.h"
 #include "common/ieee802_11_defs.h"
@@ -104,7 +105,7 @@ struct pasn_data {
 
 struct sta_info {
 	struct sta_info *next; /* next entry in sta list */
-	struct sta_info *hnext; /* next entry in hash table list */
+	struct addr_hash_node hnode; /* entry in hapd->sta_hash */
 	u8 addr[6];
 	be32 ipaddr;
 	struct dl_list ip6addr; /* list head for struct ip6addr */
@@ -354,7 +355,7 @@ int ap_for_each_sta(struct hostapd_data *hapd,
 		    void *ctx);
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta);
 struct sta_info * ap_get_sta_p2p(struct hostapd_data *hapd, const u8 *addr);
-void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta);
+int ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_sta_ip6addr_del(struct hostapd_data *hapd, struct sta_info *sta);
 void hostapd_free_stas(struct hostapd_data *hapd);
@@ -6,6 +6,8 @@
  * See README for more details.
  */
 
+#define WPA_DEBUG_MODULE WPA_DEBUG_MODULE_WPA
+
 #include "utils/includes.h"
 
 #include "utils/common.h"
@@ -4878,6 +4880,15 @@ int wpa_auth_pmksa_list(struct wpa_authenticator *wpa_auth, char *buf,
 }
 
 
+int wpa_auth_pmksa_hash_stats(struct wpa_authenticator *wpa_auth, char *buf,
+			      size_t len)
+{
+	if (!wpa_auth || !wpa_auth->pmksa)
+		return 0;
+	return pmksa_cache_auth_hash_stats(wpa_auth->pmksa, buf, len);
+}
+
+
 void wpa_auth_pmksa_flush(struct wpa_authenticator *wpa_auth)
 {
 	if (wpa_auth && wpa_auth->pmksa)
@@ -431,6 +431,8 @@ void wpa_auth_pmksa_remove(struct wpa_authenticator *wpa_auth,
 			   const u8 *sta_addr);
 int wpa_auth_pmksa_list(struct wpa_authenticator *wpa_auth, char *buf,
 			size_t len);
+int wpa_auth_pmksa_hash_stats(struct wpa_authenticator *wpa_auth, char *buf,
+			      size_t len);
 void wpa_auth_pmksa_flush(struct wpa_authenticator *wpa_auth);
 int wpa_auth_pmksa_list_mesh(struct wpa_authenticator *wpa_auth, const u8 *addr,
 			     char *buf, size_t len);
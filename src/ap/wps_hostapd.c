@@ -134,6 +134,7 @@ static int hostapd_wps_new_psk_cb(void *ctx, const u8 *mac_addr,
 
 	p->next = ssid->wpa_psk;
 	ssid->wpa_psk = p;
+	hostapd_wpa_psk_index_update(ssid);
 
 	if (ssid->wpa_psk_file) {
 		FILE *f;
@@ -958,6 +959,7 @@ static void hostapd_wps_clear_ies(struct hostapd_data *hapd, int deinit_only)
 
 	wpabuf_free(hapd->wps_probe_resp_ie);
 	hapd->wps_probe_resp_ie = NULL;
+	hostapd_probe_resp_tmpl_flush(hapd);
 
 	if (deinit_only) {
 		if (hapd->drv_priv)
@@ -7,6 +7,9 @@
  */
 
 #include "utils/includes.h"
+#if defined(CONFIG_SAE) && !defined(CONFIG_NATIVE_WINDOWS)
+#include <sys/stat.h>
+#endif /* CONFIG_SAE && !CONFIG_NATIVE_WINDOWS */
 
 #include "utils/common.h"
 #include "utils/module_tests.h"
@@ -201,6 +204,248 @@ static const struct rsn_ie_parse_test_data rsn_parse_tests[] = {
 	{ NULL, 0, 0 }
 };
 
+static void ie_index_test_elem(struct wpabuf *buf, u8 id, const char *data,
+			       size_t len)
+{
+	wpabuf_put_u8(buf, id);
+	wpabuf_put_u8(buf, len);
+	wpabuf_put_data(buf, data, len);
+}
+
+
+/* IEs modeled after a Probe Response frame from a current dual band AP */
+static struct wpabuf * ie_index_test_ies(unsigned int i)
+{
+	struct wpabuf *buf;
+	char ssid[32];
+	int ssid_len;
+
+	buf = wpabuf_alloc(1000);
+	if (!buf)
+		return NULL;
+	ssid_len = os_snprintf(ssid, sizeof(ssid), "venue-%u", i);
+	ie_index_test_elem(buf, WLAN_EID_SSID, ssid, ssid_len);
+	ie_index_test_elem(buf, WLAN_EID_SUPP_RATES,
+			   "\x8c\x12\x98\x24\xb0\x48\x60\x6c", 8);
+	ie_index_test_elem(buf, WLAN_EID_DS_PARAMS, "\x24", 1);
+	ie_index_test_elem(buf, WLAN_EID_COUNTRY, "US \x24\x04\x24\x34\x04\x1e",
+			   8);
+	ie_index_test_elem(buf, WLAN_EID_BSS_LOAD, "\x03\x00\x20\x00\x00", 5);
+	ie_index_test_elem(buf, WLAN_EID_RSN,
+			   "\x01\x00\x00\x0f\xac\x04\x01\x00\x00\x0f\xac\x04"
+			   "\x02\x00\x00\x0f\xac\x02\x00\x0f\xac\x08\xcc\x00",
+			   24);
+	ie_index_test_elem(buf, WLAN_EID_RRM_ENABLED_CAPABILITIES,
+			   "\x73\x00\x00\x00\x00", 5);
+	ie_index_test_elem(buf, WLAN_EID_MOBILITY_DOMAIN, "\x11\x22\x01", 3);
+	ie_index_test_elem(buf, WLAN_EID_HT_CAP,
+			   "\xef\x19\x1b\xff\xff\x00\x00\x00\x00\x00\x00"
+			   "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+			   "\x00\x00\x00\x00", 26);
+	ie_index_test_elem(buf, WLAN_EID_HT_OPERATION,
+			   "\x24\x05\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+			   "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+			   22);
+	ie_index_test_elem(buf, WLAN_EID_EXT_CAPAB,
+			   "\x04\x00\x08\x00\x00\x00\x00\x40\x00\x40", 10);
+	ie_index_test_elem(buf, WLAN_EID_VHT_CAP,
+			   "\xb2\x79\x8b\x0f\xaa\xff\x00\x00\xaa\xff\x00\x20",
+			   12);
+	ie_index_test_elem(buf, WLAN_EID_VHT_OPERATION, "\x01\x2a\x00\x00\x00",
+			   5);
+	ie_index_test_elem(buf, WLAN_EID_EXTENSION,
+			   "\x23\x0d\x01\x00\x02\x40\x00\x04\x70\x0c\x89"
+			   "\x7f\x03\x80\x04\x00\x00\x00\xaa\xaa\xaa\xaa",
+			   22);
+	ie_index_test_elem(buf, WLAN_EID_EXTENSION,
+			   "\x24\xf4\x3f\x00\x19\xfc\xff", 7);
+	ie_index_test_elem(buf, WLAN_EID_EXTENSION,
+			   "\x26\x00\x03\xa4\xff\x27\xa4\xff\x42\x43\xff"
+			   "\x62\x32\xff", 14);
+	ie_index_test_elem(buf, WLAN_EID_VENDOR_SPECIFIC,
+			   "\x00\x50\xf2\x02\x01\x01\x80\x00\x03\xa4\x00\x00"
+			   "\x27\xa4\x00\x00\x42\x43\x5e\x00\x62\x32\x2f\x00",
+			   24);
+	ie_index_test_elem(buf, WLAN_EID_VENDOR_SPECIFIC,
+			   "\x00\x50\xf2\x04\x10\x4a\x00\x01\x10\x10\x44\x00"
+			   "\x01\x02", 14);
+	ie_index_test_elem(buf, WLAN_EID_VENDOR_SPECIFIC,
+			   "\x50\x6f\x9a\x16\x01\x01\x40", 7);
+	ie_index_test_elem(buf, WLAN_EID_VENDOR_SPECIFIC,
+			   "\x00\x10\x18\x02\x00\x00\x1c\x00\x00", 9);
+	ie_index_test_elem(buf, WLAN_EID_VENDOR_SPECIFIC,
+			   "\x00\x0b\x86\x01\x04\x08\x09", 7);
+	/* Fragmented WPS IE */
+	ie_index_test_elem(buf, WLAN_EID_VENDOR_SPECIFIC,
+			   "\x00\x50\xf2\x04\x10\x3b\x00\x01\x03", 9);
+	if (i % 4 == 0) {
+		/* Vendor element without vendor type and an extension
+		 * element without extension ID */
+		ie_index_test_elem(buf, WLAN_EID_VENDOR_SPECIFIC, "\x00\x50",
+				   2);
+		ie_index_test_elem(buf, WLAN_EID_EXTENSION, "", 0);
+	}
+	if (i % 8 == 1) {
+		/* Truncated element */
+		wpabuf_put_u8(buf, WLAN_EID_MESH_ID);
+		wpabuf_put_u8(buf, 10);
+		wpabuf_put_data(buf, "mesh", 4);
+	}
+
+	return buf;
+}
+
+
+static int ie_index_cmp_linear(const struct ie_index *idx, const u8 *ies,
+			       size_t len)
+{
+	static const u32 vendor_types[] = {
+		WPA_IE_VENDOR_TYPE, WMM_IE_VENDOR_TYPE, WPS_IE_VENDOR_TYPE,
+		P2P_IE_VENDOR_TYPE, MBO_IE_VENDOR_TYPE, OWE_IE_VENDOR_TYPE,
+		0x00101802, 0x000b8601, 0x00500000
+	};
+	struct wpabuf *a, *b;
+	unsigned int i;
+	int ok;
+
+	for (i = 0; i < 256; i++) {
+		if (ie_index_get(idx, ies, i) != get_ie(ies, len, i) ||
+		    ie_index_get_ext(idx, ies, i) != get_ie_ext(ies, len, i))
+			return -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(vendor_types); i++) {
+		if (ie_index_get_vendor(idx, ies, vendor_types[i]) !=
+		    get_vendor_ie(ies, len, vendor_types[i]))
+			return -1;
+		a = ie_index_get_vendor_multi(idx, ies, vendor_types[i]);
+		b = ieee802_11_vendor_ie_concat(ies, len, vendor_types[i]);
+		ok = (!a && !b) ||
+			(a && b && wpabuf_len(a) == wpabuf_len(b) &&
+			 os_memcmp(wpabuf_head(a), wpabuf_head(b),
+				   wpabuf_len(a)) == 0);
+		wpabuf_free(a);
+		wpabuf_free(b);
+		if (!ok)
+			return -1;
+	}
+
+	return 0;
+}
+
+
+static int ie_index_tests(void)
+{
+	/* Lookups done for each candidate during scan result sorting and BSS
+	 * selection */
+	static const u8 eids[] = {
+		WLAN_EID_SSID, WLAN_EID_RSN, WLAN_EID_SUPP_RATES,
+		WLAN_EID_EXT_SUPP_RATES, WLAN_EID_HT_CAP, WLAN_EID_VHT_CAP,
+		WLAN_EID_MESH_ID, WLAN_EID_RSNX, WLAN_EID_MOBILITY_DOMAIN,
+		WLAN_EID_EXT_CAPAB
+	};
+	static const u32 vendor_types[] = {
+		WPA_IE_VENDOR_TYPE, WPS_IE_VENDOR_TYPE, P2P_IE_VENDOR_TYPE,
+		OWE_IE_VENDOR_TYPE, MBO_IE_VENDOR_TYPE
+	};
+	const unsigned int num_bss = 64, rounds = 2000;
+	struct wpabuf *ies[64];
+	struct ie_index *idx[64], *empty = NULL;
+	struct os_reltime start, end;
+	unsigned int i, j, r;
+	size_t found = 0, found_idx = 0;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "IE index tests");
+
+	os_memset(ies, 0, sizeof(ies));
+	os_memset(idx, 0, sizeof(idx));
+	for (i = 0; i < num_bss; i++) {
+		ies[i] = ie_index_test_ies(i);
+		if (!ies[i])
+			goto fail;
+		idx[i] = ie_index_build(wpabuf_head(ies[i]),
+					wpabuf_len(ies[i]));
+		if (!idx[i] ||
+		    ie_index_cmp_linear(idx[i], wpabuf_head(ies[i]),
+					wpabuf_len(ies[i])) < 0) {
+			wpa_printf(MSG_ERROR, "IE index mismatch for BSS %u", i);
+			goto fail;
+		}
+	}
+
+	empty = ie_index_build(wpabuf_head(ies[0]), 0);
+	if (!empty || empty->num != 0 ||
+	    ie_index_get(empty, wpabuf_head(ies[0]), WLAN_EID_SSID) ||
+	    ie_index_get_vendor_multi(empty, wpabuf_head(ies[0]),
+				      WPS_IE_VENDOR_TYPE))
+		goto fail;
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < num_bss; i++) {
+			const u8 *pos = wpabuf_head(ies[i]);
+			size_t len = wpabuf_len(ies[i]);
+
+			for (j = 0; j < ARRAY_SIZE(eids); j++)
+				found += !!get_ie(pos, len, eids[j]);
+			found += !!get_ie_ext(pos, len,
+					      WLAN_EID_EXT_HE_CAPABILITIES);
+			for (j = 0; j < ARRAY_SIZE(vendor_types); j++)
+				found += !!get_vendor_ie(pos, len,
+							 vendor_types[j]);
+		}
+	}
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &end);
+	wpa_printf(MSG_INFO, "IE lookups without index: %u.%06u s",
+		   (unsigned int) end.sec, (unsigned int) end.usec);
+
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		/* Include the cost of building the index once per scan */
+		if (r % 100 == 0) {
+			for (i = 0; i < num_bss; i++) {
+				os_free(idx[i]);
+				idx[i] = ie_index_build(wpabuf_head(ies[i]),
+							wpabuf_len(ies[i]));
+				if (!idx[i])
+					goto fail;
+			}
+		}
+		for (i = 0; i < num_bss; i++) {
+			const u8 *pos = wpabuf_head(ies[i]);
+
+			for (j = 0; j < ARRAY_SIZE(eids); j++)
+				found_idx += !!ie_index_get(idx[i], pos,
+							    eids[j]);
+			found_idx += !!ie_index_get_ext(
+				idx[i], pos, WLAN_EID_EXT_HE_CAPABILITIES);
+			for (j = 0; j < ARRAY_SIZE(vendor_types); j++)
+				found_idx += !!ie_index_get_vendor(
+					idx[i], pos, vendor_types[j]);
+		}
+	}
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &end);
+	wpa_printf(MSG_INFO, "IE lookups with index: %u.%06u s",
+		   (unsigned int) end.sec, (unsigned int) end.usec);
+	if (found != found_idx)
+		goto fail;
+
+	ret = 0;
+fail:
+	for (i = 0; i < num_bss; i++) {
+		wpabuf_free(ies[i]);
+		os_free(idx[i]);
+	}
+	os_free(empty);
+	if (ret)
+		wpa_printf(MSG_ERROR, "IE index test failed");
+	return ret;
+}
+
+
 static int rsn_ie_parse_tests(void)
 {
 	int i, ret = 0;
@@ -548,6 +793,248 @@ fail:
 }
 
 
+#ifdef CONFIG_SAE
+static int sae_pt_cache_cmp(const struct sae_pt *a, const struct sae_pt *b)
+{
+	struct wpabuf *abin, *bbin;
+	int res = -1;
+
+	for (; a && b; a = a->next, b = b->next) {
+		abin = sae_pt_to_bin(a);
+		bbin = sae_pt_to_bin(b);
+		res = a->group != b->group || !abin || !bbin ||
+			wpabuf_cmp(abin, bbin) ? -1 : 0;
+		wpabuf_clear_free(abin);
+		wpabuf_clear_free(bbin);
+		if (res)
+			return -1;
+	}
+	return a || b ? -1 : res;
+}
+#endif /* CONFIG_SAE */
+
+
+static int sae_pt_cache_tests(void)
+{
+#if defined(CONFIG_SAE) && !defined(CONFIG_NATIVE_WINDOWS)
+	int groups[] = { 19, 20, 0 };
+	const char *ssid = "byteme";
+	const char *pw = "mekmitasdigoat";
+	char fname[] = "/tmp/sae_pt_cache_test_XXXXXX";
+	char saved[] = "/tmp/sae_pt_cache_saved_XXXXXX";
+	struct sae_pt *pt1 = NULL, *pt2 = NULL, *pt3 = NULL;
+	u8 zero[2 * 32];
+	char status[200];
+	struct stat st;
+	int fd, ret = -1;
+
+	wpa_printf(MSG_INFO, "SAE PT cache tests");
+
+	fd = mkstemp(fname);
+	if (fd < 0)
+		return -1;
+	close(fd);
+	fd = mkstemp(saved);
+	if (fd < 0) {
+		unlink(fname);
+		return -1;
+	}
+	close(fd);
+
+	/* Move the entries of the running process out of the way */
+	if (sae_pt_cache_save(saved, 1) < 0) {
+		unlink(fname);
+		unlink(saved);
+		return -1;
+	}
+	sae_pt_cache_flush();
+
+	pt1 = sae_derive_pt(groups, (const u8 *) ssid, os_strlen(ssid),
+			    (const u8 *) pw, os_strlen(pw), "psk4internet");
+	pt2 = sae_derive_pt_cached(groups, (const u8 *) ssid, os_strlen(ssid),
+				   (const u8 *) pw, os_strlen(pw),
+				   "psk4internet");
+	pt3 = sae_derive_pt_cached(groups, (const u8 *) ssid, os_strlen(ssid),
+				   (const u8 *) pw, os_strlen(pw),
+				   "psk4internet");
+	if (!pt1 || sae_pt_cache_cmp(pt1, pt2) < 0 ||
+	    sae_pt_cache_cmp(pt1, pt3) < 0) {
+		wpa_printf(MSG_ERROR, "SAE: Cached PT mismatch");
+		goto fail;
+	}
+	sae_deinit_pt(pt3);
+
+	/* A different password identifier must not hit the same entry */
+	pt3 = sae_derive_pt_cached(groups, (const u8 *) ssid, os_strlen(ssid),
+				   (const u8 *) pw, os_strlen(pw), NULL);
+	if (!pt3 || sae_pt_cache_cmp(pt1, pt3) == 0 ||
+	    sae_pt_cache_status(status, sizeof(status)) <= 0 ||
+	    !os_strstr(status, "entries=4\n"))
+		goto fail;
+	sae_deinit_pt(pt2);
+	pt2 = NULL;
+	sae_deinit_pt(pt3);
+	pt3 = NULL;
+
+	os_memset(zero, 0, sizeof(zero));
+	pt3 = sae_pt_from_bin(19, NULL, 0, zero, sizeof(zero));
+	if (pt3) {
+		wpa_printf(MSG_ERROR, "SAE: Invalid encoded PT accepted");
+		goto fail;
+	}
+
+	/* The size limit follows the entries reserved by configurations */
+	sae_pt_cache_reserve(5000);
+	if (sae_pt_cache_status(status, sizeof(status)) <= 0 ||
+	    !os_strstr(status, "max_entries=5000\n")) {
+		sae_pt_cache_reserve(-5000);
+		wpa_printf(MSG_ERROR, "SAE: PT cache size not reserved");
+		goto fail;
+	}
+	sae_pt_cache_reserve(-5000);
+	if (sae_pt_cache_status(status, sizeof(status)) <= 0 ||
+	    !os_strstr(status, "max_entries=1024\n"))
+		goto fail;
+
+	/* Replacing a file with wider permissions must not keep them */
+	if (chmod(fname, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) < 0 ||
+	    sae_pt_cache_save(fname, 1) < 0 ||
+	    stat(fname, &st) < 0 || (st.st_mode & (S_IRWXG | S_IRWXO))) {
+		wpa_printf(MSG_ERROR, "SAE: PT cache file permissions not set");
+		goto fail;
+	}
+	sae_pt_cache_flush();
+	if (sae_pt_cache_load(fname) != 4) {
+		wpa_printf(MSG_ERROR, "SAE: PT cache file load failed");
+		goto fail;
+	}
+	pt2 = sae_derive_pt_cached(groups, (const u8 *) ssid, os_strlen(ssid),
+				   (const u8 *) pw, os_strlen(pw),
+				   "psk4internet");
+	if (sae_pt_cache_cmp(pt1, pt2) < 0 ||
+	    sae_pt_cache_status(status, sizeof(status)) <= 0 ||
+	    !os_strstr(status, "entries=4\n")) {
+		wpa_printf(MSG_ERROR, "SAE: PT mismatch after cache reload");
+		goto fail;
+	}
+
+	ret = 0;
+fail:
+	unlink(fname);
+	sae_pt_cache_flush();
+	if (sae_pt_cache_load(saved) < 0)
+		ret = -1;
+	unlink(saved);
+	sae_deinit_pt(pt1);
+	sae_deinit_pt(pt2);
+	sae_deinit_pt(pt3);
+	return ret;
+#else /* CONFIG_SAE && !CONFIG_NATIVE_WINDOWS */
+	return 0;
+#endif /* CONFIG_SAE && !CONFIG_NATIVE_WINDOWS */
+}
+
+
+#ifdef CONFIG_SAE
+static int sae_pwe_precomp_test(int group, const struct sae_pt *pt)
+{
+	const u8 addr1[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+	const u8 addr2[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	const u8 *pw = (const u8 *) "mekmitasdigoat";
+	size_t pw_len = os_strlen((const char *) pw);
+	struct sae_data sae1, sae2;
+	struct sae_pwe_precomp *pre;
+	u8 bin1[2 * SAE_MAX_PRIME_LEN], bin2[2 * SAE_MAX_PRIME_LEN];
+	size_t prime_len;
+	int ret = -1;
+
+	os_memset(&sae1, 0, sizeof(sae1));
+	os_memset(&sae2, 0, sizeof(sae2));
+	pre = sae_pwe_precomp_init(group, addr1, addr2, pw, pw_len, pt);
+	if (!pre || sae_pwe_precomp_derive(pre) < 0 ||
+	    sae_set_group(&sae1, group) < 0 ||
+	    sae_set_group(&sae2, group) < 0)
+		goto fail;
+
+	/* The result can be used only with the same parameters */
+	if (!sae_pwe_precomp_match(pre, group, addr1, addr2, pw, pw_len, pt) ||
+	    sae_pwe_precomp_match(pre, group, addr2, addr1, pw, pw_len, pt) ||
+	    sae_pwe_precomp_match(pre, group + 1, addr1, addr2, pw, pw_len,
+				  pt) ||
+	    (pt && sae_pwe_precomp_match(pre, group, addr1, addr2, pw, pw_len,
+					 NULL)) ||
+	    (!pt && sae_pwe_precomp_match(pre, group, addr1, addr2, pw,
+					  pw_len - 1, NULL))) {
+		wpa_printf(MSG_ERROR, "SAE: Precomputed PWE match failure");
+		goto fail;
+	}
+
+	if (sae_prepare_commit_precomp(&sae1, pre, pt, NULL, NULL) < 0 ||
+	    (pt && sae_prepare_commit_pt(&sae2, pt, addr1, addr2, NULL,
+					 NULL) < 0) ||
+	    (!pt && sae_prepare_commit(addr1, addr2, pw, pw_len, NULL,
+				       &sae2) < 0) ||
+	    sae1.h2e != sae2.h2e)
+		goto fail;
+
+	prime_len = sae1.tmp->prime_len;
+	if (sae1.tmp->ec &&
+	    (crypto_ec_point_to_bin(sae1.tmp->ec, sae1.tmp->pwe_ecc, bin1,
+				    bin1 + prime_len) < 0 ||
+	     crypto_ec_point_to_bin(sae2.tmp->ec, sae2.tmp->pwe_ecc, bin2,
+				    bin2 + prime_len) < 0))
+		goto fail;
+	if (sae1.tmp->dh &&
+	    (crypto_bignum_to_bin(sae1.tmp->pwe_ffc, bin1, sizeof(bin1),
+				  prime_len) < 0 ||
+	     crypto_bignum_to_bin(sae2.tmp->pwe_ffc, bin2, sizeof(bin2),
+				  prime_len) < 0))
+		goto fail;
+	if (os_memcmp(bin1, bin2, sae1.tmp->ec ? 2 * prime_len :
+		      prime_len) != 0) {
+		wpa_printf(MSG_ERROR, "SAE: Precomputed PWE mismatch (group %d)",
+			   group);
+		goto fail;
+	}
+
+	ret = 0;
+fail:
+	sae_pwe_precomp_deinit(pre);
+	sae_clear_data(&sae1);
+	sae_clear_data(&sae2);
+	return ret;
+}
+#endif /* CONFIG_SAE */
+
+
+static int sae_pwe_precomp_tests(void)
+{
+#ifdef CONFIG_SAE
+	int groups[] = { 19, 0 };
+	const char *ssid = "byteme";
+	const char *pw = "mekmitasdigoat";
+	struct sae_pt *pt;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "SAE PWE precomputation tests");
+
+	pt = sae_derive_pt(groups, (const u8 *) ssid, os_strlen(ssid),
+			   (const u8 *) pw, os_strlen(pw), NULL);
+	if (pt &&
+	    sae_pwe_precomp_test(19, NULL) == 0 &&
+	    sae_pwe_precomp_test(19, pt) == 0 &&
+	    sae_pwe_precomp_test(15, NULL) == 0)
+		ret = 0;
+	if (ret)
+		wpa_printf(MSG_ERROR, "SAE PWE precomputation test failure");
+	sae_deinit_pt(pt);
+	return ret;
+#else /* CONFIG_SAE */
+	return 0;
+#endif /* CONFIG_SAE */
+}
+
+
 static int sae_pk_tests(void)
 {
 #ifdef CONFIG_SAE_PK
@@ -818,9 +1305,12 @@ int common_module_tests(void)
 	if (ieee802_11_parse_tests() < 0 ||
 	    gas_tests() < 0 ||
 	    sae_tests() < 0 ||
+	    sae_pt_cache_tests() < 0 ||
+	    sae_pwe_precomp_tests() < 0 ||
 	    sae_pk_tests() < 0 ||
 	    pasn_tests() < 0 ||
-	    rsn_ie_parse_tests() < 0)
+	    rsn_ie_parse_tests() < 0 ||
+	    ie_index_tests() < 0)
 		ret = -1;
 
 	return ret;
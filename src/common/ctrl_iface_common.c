@@ -14,6 +14,41 @@
 #include "utils/common.h"
 #include "ctrl_iface_common.h"
 
+/*
+ * Number of attached monitors for each requested debug level. This is used to
+ * let wpa_msg() skip messages that no monitor would receive.
+ */
+static unsigned int ctrl_iface_monitors[MSG_ERROR + 2];
+
+
+static unsigned int * ctrl_iface_monitor_count(int level)
+{
+	if (level < MSG_EXCESSIVE)
+		level = MSG_EXCESSIVE;
+	else if (level > MSG_ERROR)
+		level = MSG_ERROR + 1;
+	return &ctrl_iface_monitors[level];
+}
+
+
+/**
+ * ctrl_iface_update_msg_level - Update wpa_msg() filtering for monitors
+ *
+ * This is called whenever the set of attached monitors changes and by the
+ * control interface implementations after registering their wpa_msg()
+ * callback.
+ */
+void ctrl_iface_update_msg_level(void)
+{
+	int level;
+
+	for (level = MSG_EXCESSIVE; level <= MSG_ERROR; level++) {
+		if (ctrl_iface_monitors[level])
+			break;
+	}
+	wpa_msg_set_cb_level(level);
+}
+
 static int sockaddr_compare(struct sockaddr_storage *a, socklen_t a_len,
 			    struct sockaddr_storage *b, socklen_t b_len)
 {
@@ -161,6 +196,8 @@ int ctrl_iface_attach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 	dst->debug_level = MSG_INFO;
 	ctrl_set_events(dst, input);
 	dl_list_add(ctrl_dst, &dst->list);
+	(*ctrl_iface_monitor_count(dst->debug_level))++;
+	ctrl_iface_update_msg_level();
 
 	sockaddr_print(MSG_DEBUG, "CTRL_IFACE monitor attached", from, fromlen);
 	return 0;
@@ -177,8 +214,10 @@ int ctrl_iface_detach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 				      &dst->addr, dst->addrlen)) {
 			sockaddr_print(MSG_DEBUG, "CTRL_IFACE monitor detached",
 				       from, fromlen);
+			(*ctrl_iface_monitor_count(dst->debug_level))--;
 			dl_list_del(&dst->list);
 			os_free(dst);
+			ctrl_iface_update_msg_level();
 			return 0;
 		}
 	}
@@ -200,10 +239,26 @@ int ctrl_iface_level(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 			sockaddr_print(MSG_DEBUG,
 				       "CTRL_IFACE changed monitor level",
 				       from, fromlen);
+			(*ctrl_iface_monitor_count(dst->debug_level))--;
 			dst->debug_level = atoi(level);
+			(*ctrl_iface_monitor_count(dst->debug_level))++;
+			ctrl_iface_update_msg_level();
 			return 0;
 		}
 	}
 
 	return -1;
 }
+
+
+void ctrl_iface_free_dsts(struct dl_list *ctrl_dst)
+{
+	struct wpa_ctrl_dst *dst, *prev;
+
+	dl_list_for_each_safe(dst, prev, ctrl_dst, struct wpa_ctrl_dst, list) {
+		(*ctrl_iface_monitor_count(dst->debug_level))--;
+		dl_list_del(&dst->list);
+		os_free(dst);
+	}
+	ctrl_iface_update_msg_level();
+}
@@ -38,5 +38,7 @@ int ctrl_iface_detach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		      socklen_t fromlen);
 int ctrl_iface_level(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		     socklen_t fromlen, const char *level);
+void ctrl_iface_free_dsts(struct dl_list *ctrl_dst);
+void ctrl_iface_update_msg_level(void);
 
 #endif /* CONTROL_IFACE_COMMON_H */
@@ -2036,6 +2036,177 @@ const u8 * get_vendor_ie(const u8 *ies, size_t len, u32 vendor_type)
 }
 
 
+static int ie_index_cmp(const void *a, const void *b)
+{
+	const struct ie_index_entry *ea = a, *eb = b;
+
+	if (ea->id != eb->id)
+		return ea->id < eb->id ? -1 : 1;
+	if (ea->has_sub != eb->has_sub)
+		return ea->has_sub < eb->has_sub ? -1 : 1;
+	if (ea->sub != eb->sub)
+		return ea->sub < eb->sub ? -1 : 1;
+	return (int) ea->offset - (int) eb->offset;
+}
+
+
+/**
+ * ie_index_build - Build an index of the elements in an IE buffer
+ * @ies: Information elements buffer
+ * @len: Information elements buffer length
+ * Returns: Allocated index (to be freed with os_free()) or %NULL on failure
+ *
+ * Like for_each_element(), the index covers the elements preceding the first
+ * truncated element.
+ */
+struct ie_index * ie_index_build(const u8 *ies, size_t len)
+{
+	const struct element *elem;
+	struct ie_index *idx;
+	struct ie_index_entry *e;
+	size_t num = 0;
+
+	if (!ies || len > 0xffff)
+		return NULL;
+
+	for_each_element(elem, ies, len)
+		num++;
+
+	idx = os_malloc(sizeof(*idx) + num * sizeof(idx->entry[0]));
+	if (!idx)
+		return NULL;
+	idx->num = num;
+
+	e = idx->entry;
+	for_each_element(elem, ies, len) {
+		e->offset = (const u8 *) elem - ies;
+		e->id = elem->id;
+		e->has_sub = 0;
+		e->sub = 0;
+		if (elem->id == WLAN_EID_EXTENSION && elem->datalen > 0) {
+			e->has_sub = 1;
+			e->sub = elem->data[0];
+		} else if (elem->id == WLAN_EID_VENDOR_SPECIFIC &&
+			   elem->datalen >= 4) {
+			e->has_sub = 1;
+			e->sub = WPA_GET_BE32(elem->data);
+		}
+		e++;
+	}
+
+	qsort(idx->entry, num, sizeof(idx->entry[0]), ie_index_cmp);
+
+	return idx;
+}
+
+
+/* Returns the position of the first entry not sorting before the key */
+static size_t ie_index_lower(const struct ie_index *idx, u8 id, u8 has_sub,
+			     u32 sub)
+{
+	struct ie_index_entry key;
+	size_t lo = 0, hi = idx->num, mid;
+
+	key.id = id;
+	key.has_sub = has_sub;
+	key.sub = sub;
+	key.offset = 0;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (ie_index_cmp(&idx->entry[mid], &key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+
+const u8 * ie_index_get(const struct ie_index *idx, const u8 *ies, u8 eid)
+{
+	size_t i;
+	int offset = -1;
+
+	/* Entries with the same element ID are sorted by the extension ID or
+	 * vendor type first, so the first one is not necessarily the first
+	 * element in the buffer. */
+	for (i = ie_index_lower(idx, eid, 0, 0);
+	     i < idx->num && idx->entry[i].id == eid; i++) {
+		if (offset < 0 || idx->entry[i].offset < offset)
+			offset = idx->entry[i].offset;
+		if (eid != WLAN_EID_EXTENSION && eid != WLAN_EID_VENDOR_SPECIFIC)
+			break;
+	}
+
+	return offset < 0 ? NULL : ies + offset;
+}
+
+
+const u8 * ie_index_get_ext(const struct ie_index *idx, const u8 *ies, u8 ext)
+{
+	size_t i;
+
+	i = ie_index_lower(idx, WLAN_EID_EXTENSION, 1, ext);
+	if (i < idx->num && idx->entry[i].id == WLAN_EID_EXTENSION &&
+	    idx->entry[i].has_sub && idx->entry[i].sub == ext)
+		return ies + idx->entry[i].offset;
+
+	return NULL;
+}
+
+
+const u8 * ie_index_get_vendor(const struct ie_index *idx, const u8 *ies,
+			       u32 vendor_type)
+{
+	size_t i;
+
+	i = ie_index_lower(idx, WLAN_EID_VENDOR_SPECIFIC, 1, vendor_type);
+	if (i < idx->num && idx->entry[i].id == WLAN_EID_VENDOR_SPECIFIC &&
+	    idx->entry[i].has_sub && idx->entry[i].sub == vendor_type)
+		return ies + idx->entry[i].offset;
+
+	return NULL;
+}
+
+
+/**
+ * ie_index_get_vendor_multi - Fetch concatenated vendor element payload
+ * @idx: Index from ie_index_build()
+ * @ies: Information elements buffer that was indexed
+ * @vendor_type: Vendor type (four octets starting the IE payload)
+ * Returns: Concatenated payload (after the vendor type) of the matching
+ *	elements in buffer order or %NULL if not found
+ */
+struct wpabuf * ie_index_get_vendor_multi(const struct ie_index *idx,
+					  const u8 *ies, u32 vendor_type)
+{
+	struct wpabuf *buf;
+	size_t i, start, len = 0;
+	const u8 *pos;
+
+	start = ie_index_lower(idx, WLAN_EID_VENDOR_SPECIFIC, 1, vendor_type);
+	for (i = start; i < idx->num &&
+		     idx->entry[i].id == WLAN_EID_VENDOR_SPECIFIC &&
+		     idx->entry[i].has_sub &&
+		     idx->entry[i].sub == vendor_type; i++)
+		len += ies[idx->entry[i].offset + 1] - 4;
+	if (i == start || len == 0)
+		return NULL;
+
+	buf = wpabuf_alloc(len);
+	if (!buf)
+		return NULL;
+	for (i = start; wpabuf_len(buf) < len; i++) {
+		pos = ies + idx->entry[i].offset;
+		wpabuf_put_data(buf, pos + 2 + 4, pos[1] - 4);
+	}
+
+	return buf;
+}
+
+
 size_t mbo_add_ie(u8 *buf, size_t len, const u8 *attr, size_t attr_len)
 {
 	/*
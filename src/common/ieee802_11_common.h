@@ -248,6 +248,32 @@ const u8 * get_ie(const u8 *ies, size_t len, u8 eid);
 const u8 * get_ie_ext(const u8 *ies, size_t len, u8 ext);
 const u8 * get_vendor_ie(const u8 *ies, size_t len, u32 vendor_type);
 
+/**
+ * struct ie_index - Index of the elements in an IE buffer
+ *
+ * The entries are sorted by element ID, extension ID or vendor type, and the
+ * offset of the element so that repeated lookups from the same IE buffer do
+ * not need to walk through the buffer. The lookup functions return the same
+ * element as get_ie(), get_ie_ext(), and get_vendor_ie().
+ */
+struct ie_index {
+	size_t num;
+	struct ie_index_entry {
+		u32 sub; /* extension ID or vendor type */
+		u16 offset;
+		u8 id;
+		u8 has_sub;
+	} entry[];
+};
+
+struct ie_index * ie_index_build(const u8 *ies, size_t len);
+const u8 * ie_index_get(const struct ie_index *idx, const u8 *ies, u8 eid);
+const u8 * ie_index_get_ext(const struct ie_index *idx, const u8 *ies, u8 ext);
+const u8 * ie_index_get_vendor(const struct ie_index *idx, const u8 *ies,
+			       u32 vendor_type);
+struct wpabuf * ie_index_get_vendor_multi(const struct ie_index *idx,
+					  const u8 *ies, u32 vendor_type);
+
 size_t mbo_add_ie(u8 *buf, size_t len, const u8 *attr, size_t attr_len);
 
 size_t add_multi_ap_ie(u8 *buf, size_t len, u8 value);
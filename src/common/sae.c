@@ -6,10 +6,17 @@
  * See README for more details.
  */
 
+#define WPA_DEBUG_MODULE WPA_DEBUG_MODULE_SAE
+
 #include "includes.h"
+#ifndef CONFIG_NATIVE_WINDOWS
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif /* CONFIG_NATIVE_WINDOWS */
 
 #include "common.h"
 #include "utils/const_time.h"
+#include "utils/list.h"
 #include "crypto/crypto.h"
 #include "crypto/sha256.h"
 #include "crypto/sha384.h"
@@ -278,16 +285,18 @@ fail:
 }
 
 
-static int sae_derive_pwe_ecc(struct sae_data *sae, const u8 *addr1,
-			      const u8 *addr2, const u8 *password,
-			      size_t password_len, const char *identifier)
+static int sae_derive_pwe_ecc_dummy(struct sae_data *sae, const u8 *addr1,
+				    const u8 *addr2, const u8 *password,
+				    size_t password_len,
+				    const char *identifier,
+				    const u8 *dummy_password)
 {
 	u8 counter, k;
 	u8 addrs[2 * ETH_ALEN];
 	const u8 *addr[3];
 	size_t len[3];
 	size_t num_elem;
-	u8 *dummy_password, *tmp_password;
+	u8 *tmp_password;
 	int pwd_seed_odd = 0;
 	u8 prime[SAE_MAX_ECC_PRIME_LEN];
 	size_t prime_len;
@@ -304,10 +313,8 @@ static int sae_derive_pwe_ecc(struct sae_data *sae, const u8 *addr1,
 
 	os_memset(x_bin, 0, sizeof(x_bin));
 
-	dummy_password = os_malloc(password_len);
 	tmp_password = os_malloc(password_len);
-	if (!dummy_password || !tmp_password ||
-	    random_get_bytes(dummy_password, password_len) < 0)
+	if (!tmp_password)
 		goto fail;
 
 	prime_len = sae->tmp->prime_len;
@@ -444,7 +451,6 @@ fail:
 	crypto_bignum_deinit(qr, 0);
 	crypto_bignum_deinit(qnr, 0);
 	crypto_bignum_deinit(y, 1);
-	os_free(dummy_password);
 	bin_clear_free(tmp_password, password_len);
 	crypto_bignum_deinit(x, 1);
 	os_memset(x_bin, 0, sizeof(x_bin));
@@ -454,6 +460,24 @@ fail:
 }
 
 
+static int sae_derive_pwe_ecc(struct sae_data *sae, const u8 *addr1,
+			      const u8 *addr2, const u8 *password,
+			      size_t password_len, const char *identifier)
+{
+	u8 *dummy_password;
+	int res = -1;
+
+	dummy_password = os_malloc(password_len);
+	if (dummy_password &&
+	    random_get_bytes(dummy_password, password_len) == 0)
+		res = sae_derive_pwe_ecc_dummy(sae, addr1, addr2, password,
+					       password_len, identifier,
+					       dummy_password);
+	os_free(dummy_password);
+	return res;
+}
+
+
 static int sae_derive_pwe_ffc(struct sae_data *sae, const u8 *addr1,
 			      const u8 *addr2, const u8 *password,
 			      size_t password_len, const char *identifier)
@@ -1291,6 +1315,545 @@ void sae_deinit_pt(struct sae_pt *pt)
 }
 
 
+/**
+ * sae_pt_to_bin - Encode a single PT entry
+ * @pt: PT entry (only this entry is encoded; pt->next is ignored)
+ * Returns: Newly allocated buffer with x||y (ECC) or the zero padded element
+ * (FFC) or %NULL on failure
+ */
+struct wpabuf * sae_pt_to_bin(const struct sae_pt *pt)
+{
+	struct wpabuf *buf;
+	size_t prime_len;
+	u8 *pos;
+
+	if (pt->ec && pt->ecc_pt) {
+		prime_len = crypto_ec_prime_len(pt->ec);
+		buf = wpabuf_alloc(2 * prime_len);
+		if (!buf)
+			return NULL;
+		pos = wpabuf_put(buf, 2 * prime_len);
+		if (crypto_ec_point_to_bin(pt->ec, pt->ecc_pt, pos,
+					   pos + prime_len) < 0) {
+			wpabuf_clear_free(buf);
+			return NULL;
+		}
+		return buf;
+	}
+
+	if (pt->dh && pt->ffc_pt) {
+		prime_len = pt->dh->prime_len;
+		buf = wpabuf_alloc(prime_len);
+		if (!buf ||
+		    crypto_bignum_to_bin(pt->ffc_pt, wpabuf_put(buf, prime_len),
+					 prime_len, prime_len) < 0) {
+			wpabuf_clear_free(buf);
+			return NULL;
+		}
+		return buf;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * sae_pt_from_bin - Build a PT entry from its encoded form
+ * @group: Group of the encoded element
+ * @ssid: SSID the PT was derived for (needed for SAE-PK)
+ * @ssid_len: Length of @ssid
+ * @data: Encoded PT from sae_pt_to_bin()
+ * @len: Length of @data
+ * Returns: New PT entry or %NULL if the element is not valid for the group
+ */
+struct sae_pt * sae_pt_from_bin(int group, const u8 *ssid, size_t ssid_len,
+				const u8 *data, size_t len)
+{
+	struct sae_pt *pt;
+	struct crypto_bignum *prime = NULL, *one = NULL;
+
+	if (ssid_len > 32)
+		return NULL;
+
+	pt = os_zalloc(sizeof(*pt));
+	if (!pt)
+		return NULL;
+
+#ifdef CONFIG_SAE_PK
+	os_memcpy(pt->ssid, ssid, ssid_len);
+	pt->ssid_len = ssid_len;
+#endif /* CONFIG_SAE_PK */
+	pt->group = group;
+	pt->ec = crypto_ec_init(group);
+	if (pt->ec) {
+		if (len != 2 * crypto_ec_prime_len(pt->ec))
+			goto fail;
+		pt->ecc_pt = crypto_ec_point_from_bin(pt->ec, data);
+		if (!pt->ecc_pt ||
+		    !crypto_ec_point_is_on_curve(pt->ec, pt->ecc_pt) ||
+		    crypto_ec_point_is_at_infinity(pt->ec, pt->ecc_pt))
+			goto fail;
+		return pt;
+	}
+
+	pt->dh = dh_groups_get(group);
+	if (!pt->dh || len != pt->dh->prime_len)
+		goto fail;
+
+	/* 1 < PT < p */
+	pt->ffc_pt = crypto_bignum_init_set(data, len);
+	prime = crypto_bignum_init_set(pt->dh->prime, pt->dh->prime_len);
+	one = crypto_bignum_init_uint(1);
+	if (!pt->ffc_pt || !prime || !one ||
+	    crypto_bignum_cmp(pt->ffc_pt, one) <= 0 ||
+	    crypto_bignum_cmp(pt->ffc_pt, prime) >= 0)
+		goto fail;
+
+	crypto_bignum_deinit(prime, 0);
+	crypto_bignum_deinit(one, 0);
+	return pt;
+fail:
+	wpa_printf(MSG_DEBUG, "SAE: Invalid encoded PT for group %d", group);
+	crypto_bignum_deinit(prime, 0);
+	crypto_bignum_deinit(one, 0);
+	sae_deinit_pt(pt);
+	return NULL;
+}
+
+
+/*
+ * Process wide cache of derived PT values. Entries are indexed by a hash over
+ * SSID, password, and password identifier (the plaintext password itself is
+ * not stored) and the group. Lookups return a private copy of the element, so
+ * callers own and free the returned PT chain as with sae_derive_pt().
+ */
+
+#define SAE_PT_CACHE_BUCKETS 64
+/* Minimum size limit; leaves room for entries of earlier configurations */
+#define SAE_PT_CACHE_MIN_ENTRIES 1024
+
+struct sae_pt_cache_entry {
+	struct dl_list list; /* bucket */
+	struct dl_list lru; /* sae_pt_cache.lru; most recently used first */
+	u8 key[SHA256_MAC_LEN];
+	int group;
+	struct wpabuf *pt;
+};
+
+static struct sae_pt_cache {
+	int initialized;
+	struct dl_list buckets[SAE_PT_CACHE_BUCKETS];
+	struct dl_list lru;
+	unsigned int entries;
+	unsigned int reserved; /* entries needed by the current configuration */
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evictions;
+	unsigned int loaded;
+	unsigned int dirty;
+} sae_pt_cache;
+
+
+static void sae_pt_cache_init(void)
+{
+	unsigned int i;
+
+	if (sae_pt_cache.initialized)
+		return;
+	for (i = 0; i < SAE_PT_CACHE_BUCKETS; i++)
+		dl_list_init(&sae_pt_cache.buckets[i]);
+	dl_list_init(&sae_pt_cache.lru);
+	sae_pt_cache.initialized = 1;
+}
+
+
+static int sae_pt_cache_key(const u8 *ssid, size_t ssid_len,
+			    const u8 *password, size_t password_len,
+			    const char *identifier, u8 *key)
+{
+	const u8 *addr[6];
+	size_t len[6];
+	u8 ssid_len_buf[1], pw_len_buf[2], id_len_buf[2];
+	size_t id_len = identifier ? os_strlen(identifier) : 0;
+
+	/* Length prefixed fields to keep the encoding unambiguous; a missing
+	 * identifier is encoded with length 0xffff */
+	ssid_len_buf[0] = ssid_len;
+	WPA_PUT_BE16(pw_len_buf, password_len);
+	WPA_PUT_BE16(id_len_buf, identifier ? id_len : 0xffff);
+	addr[0] = ssid_len_buf;
+	len[0] = sizeof(ssid_len_buf);
+	addr[1] = ssid;
+	len[1] = ssid_len;
+	addr[2] = pw_len_buf;
+	len[2] = sizeof(pw_len_buf);
+	addr[3] = password;
+	len[3] = password_len;
+	addr[4] = id_len_buf;
+	len[4] = sizeof(id_len_buf);
+	addr[5] = (const u8 *) identifier;
+	len[5] = id_len;
+	return sha256_vector(6, addr, len, key);
+}
+
+
+static struct dl_list * sae_pt_cache_bucket(const u8 *key, int group)
+{
+	return &sae_pt_cache.buckets[(key[0] ^ group) &
+				     (SAE_PT_CACHE_BUCKETS - 1)];
+}
+
+
+static struct sae_pt_cache_entry * sae_pt_cache_get(const u8 *key, int group)
+{
+	struct sae_pt_cache_entry *e;
+
+	dl_list_for_each(e, sae_pt_cache_bucket(key, group),
+			 struct sae_pt_cache_entry, list) {
+		if (e->group == group &&
+		    os_memcmp(e->key, key, SHA256_MAC_LEN) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+
+static void sae_pt_cache_free_entry(struct sae_pt_cache_entry *e)
+{
+	dl_list_del(&e->list);
+	dl_list_del(&e->lru);
+	wpabuf_clear_free(e->pt);
+	bin_clear_free(e, sizeof(*e));
+	sae_pt_cache.entries--;
+}
+
+
+static unsigned int sae_pt_cache_max(void)
+{
+	return sae_pt_cache.reserved > SAE_PT_CACHE_MIN_ENTRIES ?
+		sae_pt_cache.reserved : SAE_PT_CACHE_MIN_ENTRIES;
+}
+
+
+/**
+ * sae_pt_cache_reserve - Update the number of entries that need to fit
+ * @entries: Number of PT entries to add to (or, if negative, remove from) the
+ *	reservation
+ *
+ * Configurations call this with the number of PTs (passwords times groups)
+ * they derive through the cache, and again with the negated value when they
+ * are freed. The cache size limit is the larger of the total reservation and
+ * SAE_PT_CACHE_MIN_ENTRIES, so the entries in use are not evicted by each
+ * other regardless of how many passwords are configured.
+ */
+void sae_pt_cache_reserve(int entries)
+{
+	if (entries < 0 && (unsigned int) -entries > sae_pt_cache.reserved)
+		sae_pt_cache.reserved = 0;
+	else
+		sae_pt_cache.reserved += entries;
+}
+
+
+static int sae_pt_cache_add(const u8 *key, int group, struct wpabuf *pt)
+{
+	struct sae_pt_cache_entry *e;
+
+	e = sae_pt_cache_get(key, group);
+	if (e) {
+		wpabuf_clear_free(e->pt);
+		e->pt = pt;
+		return 0;
+	}
+
+	while (sae_pt_cache.entries >= sae_pt_cache_max()) {
+		e = dl_list_last(&sae_pt_cache.lru, struct sae_pt_cache_entry,
+				 lru);
+		if (!e)
+			break;
+		sae_pt_cache_free_entry(e);
+		sae_pt_cache.evictions++;
+	}
+
+	e = os_zalloc(sizeof(*e));
+	if (!e) {
+		wpabuf_clear_free(pt);
+		return -1;
+	}
+	os_memcpy(e->key, key, SHA256_MAC_LEN);
+	e->group = group;
+	e->pt = pt;
+	dl_list_add(sae_pt_cache_bucket(key, group), &e->list);
+	dl_list_add(&sae_pt_cache.lru, &e->lru);
+	sae_pt_cache.entries++;
+	return 0;
+}
+
+
+/**
+ * sae_derive_pt_cached - Derive PT using the process wide PT cache
+ *
+ * This is equivalent to sae_derive_pt(), but the hash-to-element operation is
+ * only performed for (SSID, password, identifier, group) combinations that
+ * have not been derived (or loaded with sae_pt_cache_load()) before.
+ */
+struct sae_pt * sae_derive_pt_cached(int *groups, const u8 *ssid,
+				     size_t ssid_len,
+				     const u8 *password, size_t password_len,
+				     const char *identifier)
+{
+	struct sae_pt *pt = NULL, *last = NULL, *tmp;
+	struct sae_pt_cache_entry *e;
+	struct wpabuf *bin;
+	int default_groups[] = { 19, 0 };
+	u8 key[SHA256_MAC_LEN];
+	int i;
+
+	if (ssid_len > 32 ||
+	    sae_pt_cache_key(ssid, ssid_len, password, password_len,
+			     identifier, key) < 0)
+		return sae_derive_pt(groups, ssid, ssid_len, password,
+				     password_len, identifier);
+
+	sae_pt_cache_init();
+	if (!groups)
+		groups = default_groups;
+	for (i = 0; groups[i] > 0; i++) {
+		tmp = NULL;
+		e = sae_pt_cache_get(key, groups[i]);
+		if (e) {
+			tmp = sae_pt_from_bin(groups[i], ssid, ssid_len,
+					      wpabuf_head(e->pt),
+					      wpabuf_len(e->pt));
+			if (tmp) {
+				sae_pt_cache.hits++;
+				dl_list_del(&e->lru);
+				dl_list_add(&sae_pt_cache.lru, &e->lru);
+			} else {
+				sae_pt_cache_free_entry(e);
+			}
+		}
+
+		if (!tmp) {
+			sae_pt_cache.misses++;
+			tmp = sae_derive_pt_group(groups[i], ssid, ssid_len,
+						  password, password_len,
+						  identifier);
+			if (!tmp)
+				continue;
+			bin = sae_pt_to_bin(tmp);
+			if (bin && sae_pt_cache_add(key, groups[i], bin) == 0)
+				sae_pt_cache.dirty = 1;
+		}
+
+		if (last)
+			last->next = tmp;
+		else
+			pt = tmp;
+		last = tmp;
+	}
+
+	forced_memzero(key, sizeof(key));
+	return pt;
+}
+
+
+/**
+ * sae_pt_cache_flush - Remove all entries from the PT cache
+ */
+void sae_pt_cache_flush(void)
+{
+	struct sae_pt_cache_entry *e, *n;
+
+	if (!sae_pt_cache.initialized)
+		return;
+	dl_list_for_each_safe(e, n, &sae_pt_cache.lru,
+			      struct sae_pt_cache_entry, lru)
+		sae_pt_cache_free_entry(e);
+	sae_pt_cache.dirty = 0;
+}
+
+
+/**
+ * sae_pt_cache_load - Merge PT cache entries from a file
+ * @fname: File written by sae_pt_cache_save()
+ * Returns: Number of entries added or -1 if the file could not be read
+ *
+ * Each line has the format "<group> <key> <PT>" with key and PT hex encoded.
+ * Invalid lines are skipped and entries already in the cache are kept.
+ */
+int sae_pt_cache_load(const char *fname)
+{
+	FILE *f;
+	char buf[20 + 2 * SHA256_MAC_LEN + 2 * SAE_MAX_PRIME_LEN + 2];
+	char *pos, *key_hex, *pt_hex;
+	u8 key[SHA256_MAC_LEN];
+	struct wpabuf *bin;
+	struct sae_pt *pt;
+	int group, added = 0, line = 0;
+
+	f = fopen(fname, "r");
+	if (!f)
+		return -1;
+	sae_pt_cache_init();
+
+	while (fgets(buf, sizeof(buf), f)) {
+		line++;
+		pos = os_strchr(buf, '\n');
+		if (pos)
+			*pos = '\0';
+		if (buf[0] == '#' || buf[0] == '\0')
+			continue;
+
+		group = atoi(buf);
+		key_hex = os_strchr(buf, ' ');
+		if (!key_hex)
+			goto invalid;
+		key_hex++;
+		pt_hex = os_strchr(key_hex, ' ');
+		if (!pt_hex || pt_hex - key_hex != 2 * SHA256_MAC_LEN ||
+		    hexstr2bin(key_hex, key, SHA256_MAC_LEN) < 0)
+			goto invalid;
+		pt_hex++;
+		if (sae_pt_cache_get(key, group))
+			continue;
+
+		bin = wpabuf_parse_bin(pt_hex);
+		if (!bin)
+			goto invalid;
+		/* Validate the element before accepting it; SSID is only used
+		 * for SAE-PK and it is filled in again on lookup */
+		pt = sae_pt_from_bin(group, NULL, 0, wpabuf_head(bin),
+				     wpabuf_len(bin));
+		if (!pt) {
+			wpabuf_clear_free(bin);
+			goto invalid;
+		}
+		sae_deinit_pt(pt);
+		if (sae_pt_cache_add(key, group, bin) == 0) {
+			added++;
+			sae_pt_cache.loaded++;
+		}
+		continue;
+	invalid:
+		wpa_printf(MSG_INFO, "SAE: Invalid PT cache line %d in '%s'",
+			   line, fname);
+	}
+
+	forced_memzero(buf, sizeof(buf));
+	fclose(f);
+	wpa_printf(MSG_DEBUG, "SAE: Loaded %d PT cache entries from '%s'",
+		   added, fname);
+	return added;
+}
+
+
+/**
+ * sae_pt_cache_save - Write the PT cache into a file
+ * @fname: File name; the file is written as <fname>.tmp with owner-only access
+ *	since a PT is password equivalent and then renamed to @fname
+ * @force: Write the file even if no new entries were added since the last
+ *	save
+ * Returns: 0 on success, -1 on failure
+ */
+int sae_pt_cache_save(const char *fname, int force)
+{
+	struct sae_pt_cache_entry *e;
+	char hex[2 * SAE_MAX_PRIME_LEN + 1];
+	char key_hex[2 * SHA256_MAC_LEN + 1];
+	char *tmp;
+	size_t len;
+	FILE *f;
+	int ret = 0;
+#ifndef CONFIG_NATIVE_WINDOWS
+	int fd;
+#endif /* CONFIG_NATIVE_WINDOWS */
+
+	if (!force && !sae_pt_cache.dirty)
+		return 0;
+
+	/* Write a new file and rename it into place so that the entries are
+	 * never readable through a file with wider permissions */
+	len = os_strlen(fname) + 5;
+	tmp = os_malloc(len);
+	if (!tmp)
+		return -1;
+	os_snprintf(tmp, len, "%s.tmp", fname);
+#ifdef CONFIG_NATIVE_WINDOWS
+	f = fopen(tmp, "w");
+#else /* CONFIG_NATIVE_WINDOWS */
+	unlink(tmp);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+		  S_IRUSR | S_IWUSR);
+	f = fd >= 0 ? fdopen(fd, "w") : NULL;
+	if (fd >= 0 && !f)
+		close(fd);
+#endif /* CONFIG_NATIVE_WINDOWS */
+	if (!f) {
+		wpa_printf(MSG_INFO, "SAE: Could not open PT cache file '%s'",
+			   tmp);
+		os_free(tmp);
+		return -1;
+	}
+
+	fprintf(f, "# SAE PT cache - do not edit\n");
+	if (sae_pt_cache.initialized) {
+		/* Oldest first so that the LRU order survives a reload */
+		dl_list_for_each_reverse(e, &sae_pt_cache.lru,
+					 struct sae_pt_cache_entry, lru) {
+			wpa_snprintf_hex(key_hex, sizeof(key_hex), e->key,
+					 SHA256_MAC_LEN);
+			wpa_snprintf_hex(hex, sizeof(hex), wpabuf_head(e->pt),
+					 wpabuf_len(e->pt));
+			if (fprintf(f, "%d %s %s\n", e->group, key_hex,
+				    hex) < 0)
+				ret = -1;
+		}
+	}
+	forced_memzero(hex, sizeof(hex));
+
+	if (fclose(f) != 0)
+		ret = -1;
+	if (ret == 0 && rename(tmp, fname) != 0) {
+		wpa_printf(MSG_INFO, "SAE: Could not replace PT cache file '%s': %s",
+			   fname, strerror(errno));
+		ret = -1;
+	}
+	if (ret < 0)
+		unlink(tmp);
+	else
+		sae_pt_cache.dirty = 0;
+	os_free(tmp);
+	return ret;
+}
+
+
+/**
+ * sae_pt_cache_status - Get PT cache counters in text format
+ * @buf: Buffer for the status text
+ * @buflen: Length of @buf
+ * Returns: Number of bytes written to @buf
+ */
+int sae_pt_cache_status(char *buf, size_t buflen)
+{
+	int ret;
+
+	ret = os_snprintf(buf, buflen,
+			  "entries=%u\n"
+			  "max_entries=%u\n"
+			  "hits=%u\n"
+			  "misses=%u\n"
+			  "evictions=%u\n"
+			  "loaded=%u\n",
+			  sae_pt_cache.entries, sae_pt_cache_max(),
+			  sae_pt_cache.hits, sae_pt_cache.misses,
+			  sae_pt_cache.evictions, sae_pt_cache.loaded);
+	if (os_snprintf_error(buflen, ret))
+		return 0;
+	return ret;
+}
+
+
 static int sae_derive_commit_element_ecc(struct sae_data *sae,
 					 struct crypto_bignum *mask)
 {
@@ -1379,9 +1942,32 @@ int sae_prepare_commit(const u8 *addr1, const u8 *addr2,
 }
 
 
-int sae_prepare_commit_pt(struct sae_data *sae, const struct sae_pt *pt,
-			  const u8 *addr1, const u8 *addr2,
-			  int *rejected_groups, const struct sae_pk *pk)
+static int sae_set_pwe_bin(struct sae_data *sae, const u8 *pwe)
+{
+	if (sae->tmp->ec) {
+		crypto_ec_point_deinit(sae->tmp->pwe_ecc, 1);
+		sae->tmp->pwe_ecc = crypto_ec_point_from_bin(sae->tmp->ec, pwe);
+		if (!sae->tmp->pwe_ecc)
+			return -1;
+	}
+
+	if (sae->tmp->dh) {
+		crypto_bignum_deinit(sae->tmp->pwe_ffc, 1);
+		sae->tmp->pwe_ffc = crypto_bignum_init_set(pwe,
+							   sae->tmp->prime_len);
+		if (!sae->tmp->pwe_ffc)
+			return -1;
+	}
+
+	return 0;
+}
+
+
+static int sae_prepare_commit_h2e(struct sae_data *sae,
+				  const struct sae_pt *pt,
+				  const u8 *addr1, const u8 *addr2,
+				  int *rejected_groups,
+				  const struct sae_pk *pk, const u8 *pwe)
 {
 	if (!sae->tmp)
 		return -1;
@@ -1418,15 +2004,16 @@ int sae_prepare_commit_pt(struct sae_data *sae, const struct sae_pt *pt,
 		sae->tmp->own_rejected_groups = groups;
 	}
 
-	if (pt->ec) {
+	if (pwe) {
+		if (sae_set_pwe_bin(sae, pwe) < 0)
+			return -1;
+	} else if (pt->ec) {
 		crypto_ec_point_deinit(sae->tmp->pwe_ecc, 1);
 		sae->tmp->pwe_ecc = sae_derive_pwe_from_pt_ecc(pt, addr1,
 							       addr2);
 		if (!sae->tmp->pwe_ecc)
 			return -1;
-	}
-
-	if (pt->dh) {
+	} else if (pt->dh) {
 		crypto_bignum_deinit(sae->tmp->pwe_ffc, 1);
 		sae->tmp->pwe_ffc = sae_derive_pwe_from_pt_ffc(pt, addr1,
 							       addr2);
@@ -1439,6 +2026,242 @@ int sae_prepare_commit_pt(struct sae_data *sae, const struct sae_pt *pt,
 }
 
 
+int sae_prepare_commit_pt(struct sae_data *sae, const struct sae_pt *pt,
+			  const u8 *addr1, const u8 *addr2,
+			  int *rejected_groups, const struct sae_pk *pk)
+{
+	return sae_prepare_commit_h2e(sae, pt, addr1, addr2, rejected_groups,
+				      pk, NULL);
+}
+
+
+/*
+ * PWE derivation split into a part that can be run outside the thread that
+ * owns the SAE instance. sae_pwe_precomp_init() collects everything that needs
+ * the random number pool or shared configuration data, sae_pwe_precomp_derive()
+ * does the expensive hunting-and-pecking loop or the PT scalar operation using
+ * only the private copies, and sae_prepare_commit_precomp() installs the result
+ * into an SAE instance in the same way as sae_prepare_commit() or
+ * sae_prepare_commit_pt() would.
+ */
+
+struct sae_pwe_precomp {
+	struct sae_data sae; /* group parameters for the derivation */
+	int group;
+	u8 addr1[ETH_ALEN];
+	u8 addr2[ETH_ALEN];
+	u8 *password; /* hunting-and-pecking */
+	u8 *dummy_password;
+	size_t password_len;
+	struct wpabuf *pt_bin; /* hash-to-element: encoded PT */
+	struct sae_pt *pt; /* hash-to-element: private copy of the PT */
+	int derived;
+	u8 pwe[2 * SAE_MAX_PRIME_LEN];
+};
+
+
+static const struct sae_pt * sae_pt_for_group(const struct sae_pt *pt,
+					      int group)
+{
+	while (pt && pt->group != group)
+		pt = pt->next;
+	return pt;
+}
+
+
+/**
+ * sae_pwe_precomp_init - Prepare PWE derivation for a peer
+ * @group: Finite cyclic group
+ * @addr1: Own MAC address
+ * @addr2: Peer MAC address
+ * @password: Password for hunting-and-pecking (used if @pt is %NULL)
+ * @password_len: Length of @password
+ * @pt: PT list for hash-to-element or %NULL for hunting-and-pecking
+ * Returns: Precomputation context or %NULL on failure
+ *
+ * The returned context does not refer to any of the arguments, so
+ * sae_pwe_precomp_derive() can be called for it from another thread.
+ */
+struct sae_pwe_precomp * sae_pwe_precomp_init(int group, const u8 *addr1,
+					      const u8 *addr2,
+					      const u8 *password,
+					      size_t password_len,
+					      const struct sae_pt *pt)
+{
+	struct sae_pwe_precomp *pre;
+
+	pre = os_zalloc(sizeof(*pre));
+	if (!pre)
+		return NULL;
+	pre->group = group;
+	os_memcpy(pre->addr1, addr1, ETH_ALEN);
+	os_memcpy(pre->addr2, addr2, ETH_ALEN);
+	if (sae_set_group(&pre->sae, group) < 0)
+		goto fail;
+
+	if (pt) {
+		pt = sae_pt_for_group(pt, group);
+		if (!pt)
+			goto fail;
+		pre->pt_bin = sae_pt_to_bin(pt);
+		if (!pre->pt_bin)
+			goto fail;
+		pre->pt = sae_pt_from_bin(group, NULL, 0,
+					  wpabuf_head(pre->pt_bin),
+					  wpabuf_len(pre->pt_bin));
+		if (!pre->pt)
+			goto fail;
+		return pre;
+	}
+
+	pre->password = os_memdup(password, password_len);
+	pre->dummy_password = os_malloc(password_len);
+	pre->password_len = password_len;
+	if (!pre->password || !pre->dummy_password ||
+	    random_get_bytes(pre->dummy_password, password_len) < 0)
+		goto fail;
+	return pre;
+fail:
+	sae_pwe_precomp_deinit(pre);
+	return NULL;
+}
+
+
+/**
+ * sae_pwe_precomp_derive - Derive the PWE for a precomputation context
+ * @pre: Context from sae_pwe_precomp_init()
+ * Returns: 0 on success, -1 on failure
+ *
+ * This function uses only data owned by @pre and can be called from a worker
+ * thread (see eloop_submit_work()).
+ */
+int sae_pwe_precomp_derive(struct sae_pwe_precomp *pre)
+{
+	struct sae_temporary_data *tmp = pre->sae.tmp;
+	size_t prime_len = tmp->prime_len;
+	int res;
+
+	if (pre->pt && pre->pt->ec) {
+		crypto_ec_point_deinit(tmp->pwe_ecc, 1);
+		tmp->pwe_ecc = sae_derive_pwe_from_pt_ecc(pre->pt, pre->addr1,
+							  pre->addr2);
+		res = tmp->pwe_ecc ? 0 : -1;
+	} else if (pre->pt && pre->pt->dh) {
+		crypto_bignum_deinit(tmp->pwe_ffc, 1);
+		tmp->pwe_ffc = sae_derive_pwe_from_pt_ffc(pre->pt, pre->addr1,
+							  pre->addr2);
+		res = tmp->pwe_ffc ? 0 : -1;
+	} else if (tmp->ec) {
+		res = sae_derive_pwe_ecc_dummy(&pre->sae, pre->addr1,
+					       pre->addr2, pre->password,
+					       pre->password_len, NULL,
+					       pre->dummy_password);
+	} else {
+		res = sae_derive_pwe_ffc(&pre->sae, pre->addr1, pre->addr2,
+					 pre->password, pre->password_len,
+					 NULL);
+	}
+	if (res < 0)
+		return -1;
+
+	if (tmp->ec)
+		res = crypto_ec_point_to_bin(tmp->ec, tmp->pwe_ecc, pre->pwe,
+					     pre->pwe + prime_len);
+	else
+		res = crypto_bignum_to_bin(tmp->pwe_ffc, pre->pwe,
+					   sizeof(pre->pwe), prime_len);
+	if (res < 0)
+		return -1;
+	pre->derived = 1;
+	return 0;
+}
+
+
+/**
+ * sae_pwe_precomp_match - Check whether a precomputed PWE can be used
+ * @pre: Context from sae_pwe_precomp_init() or %NULL
+ * @group: Finite cyclic group
+ * @addr1: Own MAC address
+ * @addr2: Peer MAC address
+ * @password: Password for hunting-and-pecking (used if @pt is %NULL)
+ * @password_len: Length of @password
+ * @pt: PT list for hash-to-element or %NULL for hunting-and-pecking
+ * Returns: 1 if the PWE in @pre was derived from the same parameters, 0 if not
+ */
+int sae_pwe_precomp_match(const struct sae_pwe_precomp *pre, int group,
+			  const u8 *addr1, const u8 *addr2,
+			  const u8 *password, size_t password_len,
+			  const struct sae_pt *pt)
+{
+	struct wpabuf *pt_bin;
+	int res;
+
+	if (!pre || !pre->derived || pre->group != group ||
+	    os_memcmp(pre->addr1, addr1, ETH_ALEN) != 0 ||
+	    os_memcmp(pre->addr2, addr2, ETH_ALEN) != 0 ||
+	    !pt != !pre->pt_bin)
+		return 0;
+
+	if (!pt)
+		return pre->password_len == password_len &&
+			os_memcmp_const(pre->password, password,
+					password_len) == 0;
+
+	pt = sae_pt_for_group(pt, group);
+	if (!pt)
+		return 0;
+	pt_bin = sae_pt_to_bin(pt);
+	res = pt_bin && wpabuf_len(pt_bin) == wpabuf_len(pre->pt_bin) &&
+		os_memcmp_const(wpabuf_head(pt_bin), wpabuf_head(pre->pt_bin),
+				wpabuf_len(pt_bin)) == 0;
+	wpabuf_clear_free(pt_bin);
+	return res;
+}
+
+
+/**
+ * sae_prepare_commit_precomp - Prepare commit using a precomputed PWE
+ * @sae: SAE data with the group already set
+ * @pre: Context for which sae_pwe_precomp_match() returned 1
+ * @pt: PT list (hash-to-element) or %NULL (hunting-and-pecking)
+ * @rejected_groups: Rejected groups for hash-to-element or %NULL
+ * @pk: SAE-PK parameters for hash-to-element or %NULL
+ * Returns: 0 on success, -1 on failure
+ */
+int sae_prepare_commit_precomp(struct sae_data *sae,
+			       const struct sae_pwe_precomp *pre,
+			       const struct sae_pt *pt, int *rejected_groups,
+			       const struct sae_pk *pk)
+{
+	if (!sae->tmp || sae->group != pre->group || !pre->derived)
+		return -1;
+
+	if (pt)
+		return sae_prepare_commit_h2e(sae, pt, pre->addr1, pre->addr2,
+					      rejected_groups, pk, pre->pwe);
+
+	if (sae_set_pwe_bin(sae, pre->pwe) < 0)
+		return -1;
+	sae->h2e = 0;
+	sae->pk = 0;
+	return sae_derive_commit(sae);
+}
+
+
+void sae_pwe_precomp_deinit(struct sae_pwe_precomp *pre)
+{
+	if (!pre)
+		return;
+	sae_clear_data(&pre->sae);
+	bin_clear_free(pre->password, pre->password_len);
+	os_free(pre->dummy_password);
+	wpabuf_clear_free(pre->pt_bin);
+	sae_deinit_pt(pre->pt);
+	forced_memzero(pre->pwe, sizeof(pre->pwe));
+	os_free(pre);
+}
+
+
 static int sae_derive_k_ecc(struct sae_data *sae, u8 *k)
 {
 	struct crypto_ec_point *K;
@@ -126,6 +126,21 @@ int sae_prepare_commit(const u8 *addr1, const u8 *addr2,
 int sae_prepare_commit_pt(struct sae_data *sae, const struct sae_pt *pt,
 			  const u8 *addr1, const u8 *addr2,
 			  int *rejected_groups, const struct sae_pk *pk);
+struct sae_pwe_precomp * sae_pwe_precomp_init(int group, const u8 *addr1,
+					      const u8 *addr2,
+					      const u8 *password,
+					      size_t password_len,
+					      const struct sae_pt *pt);
+int sae_pwe_precomp_derive(struct sae_pwe_precomp *pre);
+int sae_pwe_precomp_match(const struct sae_pwe_precomp *pre, int group,
+			  const u8 *addr1, const u8 *addr2,
+			  const u8 *password, size_t password_len,
+			  const struct sae_pt *pt);
+int sae_prepare_commit_precomp(struct sae_data *sae,
+			       const struct sae_pwe_precomp *pre,
+			       const struct sae_pt *pt, int *rejected_groups,
+			       const struct sae_pk *pk);
+void sae_pwe_precomp_deinit(struct sae_pwe_precomp *pre);
 int sae_process_commit(struct sae_data *sae);
 int sae_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		     const struct wpabuf *token, const char *identifier);
@@ -148,6 +163,18 @@ struct crypto_bignum *
 sae_derive_pwe_from_pt_ffc(const struct sae_pt *pt,
 			   const u8 *addr1, const u8 *addr2);
 void sae_deinit_pt(struct sae_pt *pt);
+struct wpabuf * sae_pt_to_bin(const struct sae_pt *pt);
+struct sae_pt * sae_pt_from_bin(int group, const u8 *ssid, size_t ssid_len,
+				const u8 *data, size_t len);
+struct sae_pt * sae_derive_pt_cached(int *groups, const u8 *ssid,
+				     size_t ssid_len,
+				     const u8 *password, size_t password_len,
+				     const char *identifier);
+void sae_pt_cache_flush(void);
+void sae_pt_cache_reserve(int entries);
+int sae_pt_cache_load(const char *fname);
+int sae_pt_cache_save(const char *fname, int force);
+int sae_pt_cache_status(char *buf, size_t buflen);
 
 /* sae_pk.c */
 #ifdef CONFIG_SAE_PK
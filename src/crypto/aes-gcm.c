@@ -12,6 +12,7 @@
 #include "common.h"
 #include "aes.h"
 #include "aes_wrap.h"
+#include "aes_hw.h"
 
 static void inc32(u8 *block)
 {
@@ -93,6 +94,113 @@ static void gf_mult(const u8 *x, const u8 *y, u8 *z)
 }
 
 
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+
+#ifdef AES_HW_X86
+AES_HW_TARGET_CLMUL
+static inline void clmul64(u64 a, u64 b, u64 *hi, u64 *lo)
+{
+	u64 r[2];
+	__m128i p;
+
+	p = _mm_clmulepi64_si128(_mm_loadl_epi64((const __m128i *) &a),
+				 _mm_loadl_epi64((const __m128i *) &b), 0x00);
+	_mm_storeu_si128((__m128i *) r, p);
+	*lo = r[0];
+	*hi = r[1];
+}
+#else /* AES_HW_X86 */
+static inline void clmul64(u64 a, u64 b, u64 *hi, u64 *lo)
+{
+	uint64x2_t p;
+
+	p = vreinterpretq_u64_p128(vmull_p64((poly64_t) a, (poly64_t) b));
+	*lo = vgetq_lane_u64(p, 0);
+	*hi = vgetq_lane_u64(p, 1);
+}
+#endif /* AES_HW_X86 */
+
+
+/* Multiplication in GF(2^128) using carry-less multiply instructions */
+AES_HW_TARGET_CLMUL
+static void gf_mult_clmul(const u8 *x, const u8 *y, u8 *z)
+{
+	u64 x1, x0, y1, y0, p3, p2, p1, p0, mh, ml, d;
+
+	x1 = WPA_GET_BE64(x);
+	x0 = WPA_GET_BE64(x + 8);
+	y1 = WPA_GET_BE64(y);
+	y0 = WPA_GET_BE64(y + 8);
+
+	/* 256-bit product of the operands in their bit-reflected form */
+	clmul64(x1, y1, &p3, &p2);
+	clmul64(x0, y0, &p1, &p0);
+	clmul64(x1, y0, &mh, &ml);
+	p2 ^= mh;
+	p1 ^= ml;
+	clmul64(x0, y1, &mh, &ml);
+	p2 ^= mh;
+	p1 ^= ml;
+
+	/* The product of reflected values is reflected and shifted by one */
+	p3 = (p3 << 1) | (p2 >> 63);
+	p2 = (p2 << 1) | (p1 >> 63);
+	p1 = (p1 << 1) | (p0 >> 63);
+	p0 <<= 1;
+
+	/* Reduce modulo x^128 + x^7 + x^2 + x + 1 (reflected) */
+	d = p1 ^ (p0 << 63) ^ (p0 << 62) ^ (p0 << 57);
+	p3 ^= d ^ (d >> 1) ^ (d >> 2) ^ (d >> 7);
+	p2 ^= p0 ^ (p0 >> 1) ^ (p0 >> 2) ^ (p0 >> 7) ^
+		(d << 63) ^ (d << 62) ^ (d << 57);
+
+	WPA_PUT_BE64(z, p3);
+	WPA_PUT_BE64(z + 8, p2);
+}
+
+#endif /* AES_HW_X86 || AES_HW_ARM */
+
+
+typedef void (*gf_mult_func)(const u8 *x, const u8 *y, u8 *z);
+
+#ifdef CONFIG_MODULE_TESTS
+static int ghash_clmul_disabled = 0;
+
+/**
+ * aes_gcm_test_clmul - Select the GHASH multiplication for module tests
+ * @enabled: Whether carry-less multiply instructions may be used
+ * Returns: 1 if the instructions are supported and used, 0 if not
+ */
+int aes_gcm_test_clmul(int enabled)
+{
+	ghash_clmul_disabled = !enabled;
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+	return enabled && aes_hw_cpu_clmul();
+#else /* AES_HW_X86 || AES_HW_ARM */
+	return 0;
+#endif /* AES_HW_X86 || AES_HW_ARM */
+}
+#endif /* CONFIG_MODULE_TESTS */
+
+
+static gf_mult_func ghash_gf_mult(void)
+{
+#ifdef CONFIG_MODULE_TESTS
+	if (ghash_clmul_disabled)
+		return gf_mult;
+#endif /* CONFIG_MODULE_TESTS */
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+	static int clmul = -1;
+
+	if (clmul < 0)
+		clmul = aes_hw_cpu_clmul();
+	if (clmul)
+		return gf_mult_clmul;
+#endif /* AES_HW_X86 || AES_HW_ARM */
+	return gf_mult;
+}
+
+
 static void ghash_start(u8 *y)
 {
 	/* Y_0 = 0^128 */
@@ -105,6 +213,7 @@ static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
 	size_t m, i;
 	const u8 *xpos = x;
 	u8 tmp[16];
+	gf_mult_func mult = ghash_gf_mult();
 
 	m = xlen / 16;
 
@@ -116,7 +225,7 @@ static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
 		/* dot operation:
 		 * multiplication operation for binary Galois (finite) field of
 		 * 2^128 elements */
-		gf_mult(y, h, tmp);
+		mult(y, h, tmp);
 		os_memcpy(y, tmp, 16);
 	}
 
@@ -132,7 +241,7 @@ static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
 		/* dot operation:
 		 * multiplication operation for binary Galois (finite) field of
 		 * 2^128 elements */
-		gf_mult(y, h, tmp);
+		mult(y, h, tmp);
 		os_memcpy(y, tmp, 16);
 	}
 
@@ -69,6 +69,7 @@ void * aes_decrypt_init(const u8 *key, size_t len)
 		return NULL;
 	}
 	rk[AES_PRIV_NR_POS] = res;
+	rk[AES_PRIV_HW_POS] = aes_hw_key_setup(rk, res);
 	return rk;
 }
 
@@ -151,7 +152,10 @@ d##3 = TD0(s##3) ^ TD1(s##2) ^ TD2(s##1) ^ TD3(s##0) ^ rk[4 * i + 3]
 int aes_decrypt(void *ctx, const u8 *crypt, u8 *plain)
 {
 	u32 *rk = ctx;
-	rijndaelDecrypt(ctx, rk[AES_PRIV_NR_POS], crypt, plain);
+	if (rk[AES_PRIV_HW_POS])
+		aes_hw_decrypt(rk, rk[AES_PRIV_NR_POS], crypt, plain);
+	else
+		rijndaelDecrypt(ctx, rk[AES_PRIV_NR_POS], crypt, plain);
 	return 0;
 }
 
@@ -112,6 +112,7 @@ void * aes_encrypt_init(const u8 *key, size_t len)
 		return NULL;
 	}
 	rk[AES_PRIV_NR_POS] = res;
+	rk[AES_PRIV_HW_POS] = aes_hw_key_setup(rk, res);
 	return rk;
 }
 
@@ -119,7 +120,10 @@ void * aes_encrypt_init(const u8 *key, size_t len)
 int aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 {
 	u32 *rk = ctx;
-	rijndaelEncrypt(ctx, rk[AES_PRIV_NR_POS], plain, crypt);
+	if (rk[AES_PRIV_HW_POS])
+		aes_hw_encrypt(rk, rk[AES_PRIV_NR_POS], plain, crypt);
+	else
+		rijndaelEncrypt(ctx, rk[AES_PRIV_NR_POS], plain, crypt);
 	return 0;
 }
 
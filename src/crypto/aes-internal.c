@@ -19,6 +19,7 @@
 #include "common.h"
 #include "crypto.h"
 #include "aes_i.h"
+#include "aes_hw.h"
 
 /*
  * rijndael-alg-fst.c
@@ -843,3 +844,125 @@ int rijndaelKeySetupEnc(u32 rk[], const u8 cipherKey[], int keyBits)
 
 	return -1;
 }
+
+
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+
+/**
+ * aes_hw_key_setup - Prepare a key schedule for AES instructions
+ * @rk: Key schedule from rijndaelKeySetupEnc() or the decryption variant
+ * @Nr: Number of rounds
+ * Returns: 1 if the key schedule was converted for aes_hw_encrypt() and
+ * aes_hw_decrypt(), 0 if the CPU does not support AES instructions
+ *
+ * The round keys are stored as 32-bit words in host byte order; the AES
+ * instructions take them as byte strings. The decryption key schedule is
+ * already in the form used by the Equivalent Inverse Cipher, which is what
+ * AESDEC/AESD expect, so both directions use the same conversion.
+ */
+int aes_hw_key_setup(u32 rk[], int Nr)
+{
+	static int aes_hw = -1;
+	u8 *pos = (u8 *) rk;
+	int i;
+
+	if (aes_hw < 0)
+		aes_hw = aes_hw_cpu_aes();
+	if (!aes_hw)
+		return 0;
+
+	for (i = 0; i < 4 * (Nr + 1); i++) {
+		u32 val = rk[i];
+
+		PUTU32(pos + 4 * i, val);
+	}
+
+	return 1;
+}
+
+#endif /* AES_HW_X86 || AES_HW_ARM */
+
+
+#ifdef AES_HW_X86
+
+AES_HW_TARGET_AES
+void aes_hw_encrypt(const u32 rk[], int Nr, const u8 pt[16], u8 ct[16])
+{
+	const __m128i *key = (const __m128i *) rk;
+	__m128i s;
+	int r;
+
+	s = _mm_xor_si128(_mm_loadu_si128((const __m128i *) pt),
+			  _mm_loadu_si128(key));
+	for (r = 1; r < Nr; r++)
+		s = _mm_aesenc_si128(s, _mm_loadu_si128(key + r));
+	s = _mm_aesenclast_si128(s, _mm_loadu_si128(key + Nr));
+	_mm_storeu_si128((__m128i *) ct, s);
+}
+
+
+AES_HW_TARGET_AES
+void aes_hw_decrypt(const u32 rk[], int Nr, const u8 ct[16], u8 pt[16])
+{
+	const __m128i *key = (const __m128i *) rk;
+	__m128i s;
+	int r;
+
+	s = _mm_xor_si128(_mm_loadu_si128((const __m128i *) ct),
+			  _mm_loadu_si128(key));
+	for (r = 1; r < Nr; r++)
+		s = _mm_aesdec_si128(s, _mm_loadu_si128(key + r));
+	s = _mm_aesdeclast_si128(s, _mm_loadu_si128(key + Nr));
+	_mm_storeu_si128((__m128i *) pt, s);
+}
+
+#elif defined(AES_HW_ARM)
+
+void aes_hw_encrypt(const u32 rk[], int Nr, const u8 pt[16], u8 ct[16])
+{
+	const u8 *key = (const u8 *) rk;
+	uint8x16_t s;
+	int r;
+
+	/* AESE includes AddRoundKey before SubBytes/ShiftRows */
+	s = vld1q_u8(pt);
+	for (r = 0; r < Nr - 1; r++)
+		s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(key + 16 * r)));
+	s = vaeseq_u8(s, vld1q_u8(key + 16 * (Nr - 1)));
+	s = veorq_u8(s, vld1q_u8(key + 16 * Nr));
+	vst1q_u8(ct, s);
+}
+
+
+void aes_hw_decrypt(const u32 rk[], int Nr, const u8 ct[16], u8 pt[16])
+{
+	const u8 *key = (const u8 *) rk;
+	uint8x16_t s;
+	int r;
+
+	s = vld1q_u8(ct);
+	for (r = 0; r < Nr - 1; r++)
+		s = vaesimcq_u8(vaesdq_u8(s, vld1q_u8(key + 16 * r)));
+	s = vaesdq_u8(s, vld1q_u8(key + 16 * (Nr - 1)));
+	s = veorq_u8(s, vld1q_u8(key + 16 * Nr));
+	vst1q_u8(pt, s);
+}
+
+#else /* AES_HW_X86 / AES_HW_ARM */
+
+int aes_hw_key_setup(u32 rk[], int Nr)
+{
+	return 0;
+}
+
+
+void aes_hw_encrypt(const u32 rk[], int Nr, const u8 pt[16], u8 ct[16])
+{
+}
+
+
+void aes_hw_decrypt(const u32 rk[], int Nr, const u8 ct[16], u8 pt[16])
+{
+}
+
+#endif /* AES_HW_X86 / AES_HW_ARM */
@@ -0,0 +1,72 @@
+/*
+ * AES and carry-less multiplication CPU instruction support
+ * Copyright (c) 2026, The Android Open Source Project
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef AES_HW_H
+#define AES_HW_H
+
+/*
+ * The x86 AES-NI/PCLMULQDQ kernels are compiled with per-function target
+ * attributes, so the rest of the build does not need -maes/-mpclmul and the
+ * instructions are only used when the CPU reports support for them at run
+ * time. The ARMv8 Crypto Extension intrinsics are available only when the
+ * compiler targets an architecture that includes them (e.g.,
+ * -march=armv8-a+crypto); the kernels are still used only after the kernel
+ * has confirmed CPU support through HWCAP.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES_HW_X86
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#define AES_HW_TARGET_AES __attribute__((target("sse2,aes")))
+#define AES_HW_TARGET_CLMUL __attribute__((target("sse2,pclmul")))
+#elif defined(__aarch64__) && defined(__linux__) && \
+	(defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define AES_HW_ARM
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define AES_HW_TARGET_AES
+#define AES_HW_TARGET_CLMUL
+#endif
+
+
+/**
+ * aes_hw_cpu_aes - Whether the CPU supports AES round instructions
+ * Returns: 1 if AES-NI (x86) or ARMv8 AES instructions can be used, 0 if not
+ */
+static inline int aes_hw_cpu_aes(void)
+{
+#if defined(AES_HW_X86)
+	return __builtin_cpu_supports("aes") &&
+		__builtin_cpu_supports("sse2");
+#elif defined(AES_HW_ARM)
+	return !!(getauxval(AT_HWCAP) & HWCAP_AES);
+#else
+	return 0;
+#endif
+}
+
+
+/**
+ * aes_hw_cpu_clmul - Whether the CPU supports 64x64 carry-less multiplication
+ * Returns: 1 if PCLMULQDQ (x86) or ARMv8 PMULL can be used, 0 if not
+ */
+static inline int aes_hw_cpu_clmul(void)
+{
+#if defined(AES_HW_X86)
+	return __builtin_cpu_supports("pclmul") &&
+		__builtin_cpu_supports("sse2");
+#elif defined(AES_HW_ARM)
+	return !!(getauxval(AT_HWCAP) & HWCAP_PMULL);
+#else
+	return 0;
+#endif
+}
+
+#endif /* AES_HW_H */
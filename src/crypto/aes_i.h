@@ -117,9 +117,13 @@ static inline u32 rotr(u32 val, int bits)
 (ct)[2] = (u8)((st) >>  8); (ct)[3] = (u8)(st); }
 #endif
 
-#define AES_PRIV_SIZE (4 * 4 * 15 + 4)
+#define AES_PRIV_SIZE (4 * 4 * 15 + 8)
 #define AES_PRIV_NR_POS (4 * 15)
+#define AES_PRIV_HW_POS (4 * 15 + 1)
 
 int rijndaelKeySetupEnc(u32 rk[], const u8 cipherKey[], int keyBits);
+int aes_hw_key_setup(u32 rk[], int Nr);
+void aes_hw_encrypt(const u32 rk[], int Nr, const u8 pt[16], u8 ct[16]);
+void aes_hw_decrypt(const u32 rk[], int Nr, const u8 ct[16], u8 pt[16]);
 
 #endif /* AES_I_H */
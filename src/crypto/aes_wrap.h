@@ -62,6 +62,9 @@ int __must_check aes_gcm_ad(const u8 *key, size_t key_len,
 int __must_check aes_gmac(const u8 *key, size_t key_len,
 			  const u8 *iv, size_t iv_len,
 			  const u8 *aad, size_t aad_len, u8 *tag);
+#ifdef CONFIG_MODULE_TESTS
+int aes_gcm_test_clmul(int enabled);
+#endif /* CONFIG_MODULE_TESTS */
 int __must_check aes_ccm_ae(const u8 *key, size_t key_len, const u8 *nonce,
 			    size_t M, const u8 *plain, size_t plain_len,
 			    const u8 *aad, size_t aad_len, u8 *crypt, u8 *auth);
@@ -0,0 +1,137 @@
+/*
+ * SHA1-based key derivation function (PBKDF2) for a batch of passphrases
+ * Copyright (c) 2026, The Android Open Source Project
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+#ifdef CONFIG_ELOOP_WORKERS
+#include <pthread.h>
+#endif /* CONFIG_ELOOP_WORKERS */
+
+#include "common.h"
+#include "sha1.h"
+#ifdef CONFIG_CRYPTO_INTERNAL
+#include "sha1_i.h"
+#endif /* CONFIG_CRYPTO_INTERNAL */
+
+
+static void pbkdf2_sha1_jobs(struct pbkdf2_sha1_job *jobs, size_t num,
+			     int iterations)
+{
+#ifdef CONFIG_CRYPTO_INTERNAL
+	pbkdf2_sha1_multi(jobs, num, iterations);
+#else /* CONFIG_CRYPTO_INTERNAL */
+	size_t i;
+
+	for (i = 0; i < num; i++)
+		jobs[i].result = pbkdf2_sha1(jobs[i].passphrase, jobs[i].ssid,
+					     jobs[i].ssid_len, iterations,
+					     jobs[i].buf, jobs[i].buflen);
+#endif /* CONFIG_CRYPTO_INTERNAL */
+}
+
+
+#ifdef CONFIG_ELOOP_WORKERS
+
+#define PBKDF2_SHA1_MAX_THREADS 64
+
+struct pbkdf2_sha1_thread {
+	pthread_t thread;
+	struct pbkdf2_sha1_job *jobs;
+	size_t num;
+	int iterations;
+};
+
+
+static void * pbkdf2_sha1_thread(void *arg)
+{
+	struct pbkdf2_sha1_thread *t = arg;
+
+	pbkdf2_sha1_jobs(t->jobs, t->num, t->iterations);
+	return NULL;
+}
+
+
+static void pbkdf2_sha1_jobs_threads(struct pbkdf2_sha1_job *jobs, size_t num,
+				     int iterations, int threads)
+{
+	struct pbkdf2_sha1_thread t[PBKDF2_SHA1_MAX_THREADS];
+	int started[PBKDF2_SHA1_MAX_THREADS];
+	size_t per_thread, pos;
+	int i;
+
+	if (threads <= 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		threads = cpus > 0 ? cpus : 1;
+	}
+	if (threads > PBKDF2_SHA1_MAX_THREADS)
+		threads = PBKDF2_SHA1_MAX_THREADS;
+	if ((size_t) threads > num)
+		threads = num;
+	if (threads <= 1) {
+		pbkdf2_sha1_jobs(jobs, num, iterations);
+		return;
+	}
+
+	per_thread = (num + threads - 1) / threads;
+	for (i = 0, pos = 0; i < threads; i++, pos += per_thread) {
+		t[i].jobs = &jobs[pos];
+		t[i].num = pos >= num ? 0 :
+			(pos + per_thread > num ? num - pos : per_thread);
+		t[i].iterations = iterations;
+		/* The calling thread takes the first share of the work */
+		started[i] = i > 0 && t[i].num &&
+			pthread_create(&t[i].thread, NULL, pbkdf2_sha1_thread,
+				       &t[i]) == 0;
+	}
+
+	pbkdf2_sha1_jobs(t[0].jobs, t[0].num, iterations);
+	for (i = 1; i < threads; i++) {
+		if (started[i])
+			pthread_join(t[i].thread, NULL);
+		else if (t[i].num)
+			pbkdf2_sha1_jobs(t[i].jobs, t[i].num, iterations);
+	}
+}
+
+#endif /* CONFIG_ELOOP_WORKERS */
+
+
+/**
+ * pbkdf2_sha1_batch - Derive keys for a number of passphrases with PBKDF2
+ * @jobs: Array of derivations; the result field is set for each entry
+ * @num: Number of entries in jobs
+ * @iterations: Number of iterations to run
+ * @threads: Maximum number of threads to use or 0 for one per online CPU
+ * Returns: 0 if all keys were derived, -1 if any of the derivations failed
+ *
+ * This gives the same results as calling pbkdf2_sha1() for each entry, but is
+ * faster for a large number of passphrases. In builds with
+ * CONFIG_ELOOP_WORKERS, the entries are split between threads. With the
+ * internal crypto implementation, four output blocks are computed at a time
+ * with a vectorized SHA1 when the compiler targets SSE2 or NEON.
+ */
+int pbkdf2_sha1_batch(struct pbkdf2_sha1_job *jobs, size_t num,
+		      int iterations, int threads)
+{
+	size_t i;
+
+	if (!num)
+		return 0;
+
+#ifdef CONFIG_ELOOP_WORKERS
+	pbkdf2_sha1_jobs_threads(jobs, num, iterations, threads);
+#else /* CONFIG_ELOOP_WORKERS */
+	pbkdf2_sha1_jobs(jobs, num, iterations);
+#endif /* CONFIG_ELOOP_WORKERS */
+
+	for (i = 0; i < num; i++) {
+		if (jobs[i].result)
+			return -1;
+	}
+	return 0;
+}
@@ -9,7 +9,299 @@
 #include "includes.h"
 
 #include "common.h"
+#include "crypto.h"
 #include "sha1.h"
+#ifdef CONFIG_CRYPTO_INTERNAL
+#include "sha1_i.h"
+#endif /* CONFIG_CRYPTO_INTERNAL */
+
+
+#ifdef CONFIG_CRYPTO_INTERNAL
+
+/*
+ * With the internal SHA1 implementation, the HMAC key schedule (SHA1 state
+ * after processing K xor ipad and K xor opad) can be computed once per
+ * passphrase instead of once per iteration. Each of the remaining iterations
+ * then needs only two SHA1 compression function calls on pre-padded
+ * single-block messages instead of four hashes with full HMAC processing.
+ */
+
+static void pbkdf2_sha1_pad(const u8 *key, size_t key_len, u8 pad,
+			    struct SHA1Context *ctx)
+{
+	u8 block[64];
+	size_t i;
+
+	os_memset(block, pad, sizeof(block));
+	for (i = 0; i < key_len; i++)
+		block[i] ^= key[i];
+	SHA1Init(ctx);
+	SHA1Update(ctx, block, sizeof(block));
+	forced_memzero(block, sizeof(block));
+}
+
+
+/* Prepare a single SHA1 block for a 20-octet message following one already
+ * processed 64-octet block (the HMAC pad) */
+static void pbkdf2_sha1_block_init(u8 *block)
+{
+	os_memset(block + SHA1_MAC_LEN, 0, 64 - SHA1_MAC_LEN);
+	block[SHA1_MAC_LEN] = 0x80;
+	WPA_PUT_BE32(block + 60, (64 + SHA1_MAC_LEN) * 8);
+}
+
+
+static void pbkdf2_sha1_state_to_bin(const u32 *state, u8 *out)
+{
+	int i;
+
+	for (i = 0; i < 5; i++)
+		WPA_PUT_BE32(out + 4 * i, state[i]);
+}
+
+
+/* Compute the HMAC key schedule for the passphrase and U1 = PRF(P, S || i) */
+static int pbkdf2_sha1_u1(const char *passphrase, const u8 *ssid,
+			  size_t ssid_len, unsigned int count,
+			  struct SHA1Context *ictx, struct SHA1Context *octx,
+			  u8 *u1)
+{
+	struct SHA1Context ctx;
+	u8 key[SHA1_MAC_LEN], count_buf[4], tmp[SHA1_MAC_LEN];
+	const u8 *pw = (const u8 *) passphrase;
+	size_t pw_len = os_strlen(passphrase);
+
+	if (pw_len > 64) {
+		if (sha1_vector(1, &pw, &pw_len, key))
+			return -1;
+		pw = key;
+		pw_len = SHA1_MAC_LEN;
+	}
+	pbkdf2_sha1_pad(pw, pw_len, 0x36, ictx);
+	pbkdf2_sha1_pad(pw, pw_len, 0x5c, octx);
+
+	WPA_PUT_BE32(count_buf, count);
+	ctx = *ictx;
+	SHA1Update(&ctx, ssid, ssid_len);
+	SHA1Update(&ctx, count_buf, sizeof(count_buf));
+	SHA1Final(tmp, &ctx);
+	ctx = *octx;
+	SHA1Update(&ctx, tmp, SHA1_MAC_LEN);
+	SHA1Final(u1, &ctx);
+
+	forced_memzero(&ctx, sizeof(ctx));
+	forced_memzero(tmp, sizeof(tmp));
+	forced_memzero(key, sizeof(key));
+	return 0;
+}
+
+
+static int pbkdf2_sha1_f(const char *passphrase, const u8 *ssid,
+			 size_t ssid_len, int iterations, unsigned int count,
+			 u8 *digest)
+{
+	struct SHA1Context ictx, octx;
+	u8 iblock[64], oblock[64];
+	u32 state[5];
+	int i, j;
+
+	/* U1 = PRF(P, S || i) */
+	if (pbkdf2_sha1_u1(passphrase, ssid, ssid_len, count, &ictx, &octx,
+			   iblock))
+		return -1;
+	os_memcpy(digest, iblock, SHA1_MAC_LEN);
+
+	/* Uc = PRF(P, Uc-1) */
+	pbkdf2_sha1_block_init(iblock);
+	pbkdf2_sha1_block_init(oblock);
+	for (i = 1; i < iterations; i++) {
+		os_memcpy(state, ictx.state, sizeof(state));
+		SHA1Transform(state, iblock);
+		pbkdf2_sha1_state_to_bin(state, oblock);
+		os_memcpy(state, octx.state, sizeof(state));
+		SHA1Transform(state, oblock);
+		pbkdf2_sha1_state_to_bin(state, iblock);
+		for (j = 0; j < SHA1_MAC_LEN; j++)
+			digest[j] ^= iblock[j];
+	}
+
+	forced_memzero(&ictx, sizeof(ictx));
+	forced_memzero(&octx, sizeof(octx));
+	forced_memzero(iblock, sizeof(iblock));
+	forced_memzero(oblock, sizeof(oblock));
+	forced_memzero(state, sizeof(state));
+	return 0;
+}
+
+
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+
+/*
+ * Multi-buffer SHA1: four independent PBKDF2 blocks are processed in the
+ * lanes of 128-bit vectors. The generic vector extension of the compiler maps
+ * this to SSE2 on x86 and to NEON on ARM.
+ */
+#define PBKDF2_SHA1_LANES 4
+
+typedef u32 pbkdf2_v4 __attribute__((vector_size(16)));
+
+#define PBKDF2_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+struct pbkdf2_sha1_lane {
+	struct pbkdf2_sha1_job *job;
+	unsigned int count;
+};
+
+
+#define PBKDF2_V4(x) ((pbkdf2_v4) { (x), (x), (x), (x) })
+
+#define PBKDF2_W(i) \
+	((i) < 16 ? w[(i)] : \
+	 (w[(i) & 15] = PBKDF2_ROL(w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^ \
+				   w[((i) + 2) & 15] ^ w[(i) & 15], 1)))
+
+#define PBKDF2_ROUND(f, k) \
+	do { \
+		t = PBKDF2_ROL(a, 5) + (f) + e + PBKDF2_V4(k) + PBKDF2_W(i); \
+		e = d; \
+		d = c; \
+		c = PBKDF2_ROL(b, 30); \
+		b = a; \
+		a = t; \
+	} while (0)
+
+
+static void pbkdf2_sha1_transform_x4(pbkdf2_v4 *state, pbkdf2_v4 *w)
+{
+	pbkdf2_v4 a = state[0], b = state[1], c = state[2], d = state[3],
+		e = state[4], t;
+	int i;
+
+	for (i = 0; i < 20; i++)
+		PBKDF2_ROUND(d ^ (b & (c ^ d)), 0x5a827999);
+	for (; i < 40; i++)
+		PBKDF2_ROUND(b ^ c ^ d, 0x6ed9eba1);
+	for (; i < 60; i++)
+		PBKDF2_ROUND((b & c) | (d & (b | c)), 0x8f1bbcdc);
+	for (; i < 80; i++)
+		PBKDF2_ROUND(b ^ c ^ d, 0xca62c1d6);
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+
+/* Compute F(P, S, c, i) for up to PBKDF2_SHA1_LANES blocks in parallel */
+static void pbkdf2_sha1_f_x4(struct pbkdf2_sha1_lane *lane, size_t num,
+			     int iterations)
+{
+	struct SHA1Context ictx, octx;
+	pbkdf2_v4 istate[5], ostate[5], u[5], digest[5], state[5], w[16];
+	u8 u1[SHA1_MAC_LEN], out[SHA1_MAC_LEN];
+	size_t l, plen;
+	int i, j;
+
+	os_memset(istate, 0, sizeof(istate));
+	os_memset(ostate, 0, sizeof(ostate));
+	os_memset(u, 0, sizeof(u));
+	for (l = 0; l < num; l++) {
+		struct pbkdf2_sha1_job *job = lane[l].job;
+
+		if (pbkdf2_sha1_u1(job->passphrase, job->ssid, job->ssid_len,
+				   lane[l].count, &ictx, &octx, u1)) {
+			job->result = -1;
+			continue;
+		}
+		for (j = 0; j < 5; j++) {
+			istate[j][l] = ictx.state[j];
+			ostate[j][l] = octx.state[j];
+			u[j][l] = WPA_GET_BE32(u1 + 4 * j);
+		}
+	}
+	os_memcpy(digest, u, sizeof(digest));
+
+	for (i = 1; i < iterations; i++) {
+		for (j = 0; j < 2; j++) {
+			os_memcpy(w, u, sizeof(u));
+			os_memset(&w[5], 0, 11 * sizeof(w[0]));
+			w[5] = PBKDF2_V4(0x80000000);
+			w[15] = PBKDF2_V4((64 + SHA1_MAC_LEN) * 8);
+			os_memcpy(state, j ? ostate : istate, sizeof(state));
+			pbkdf2_sha1_transform_x4(state, w);
+			os_memcpy(u, state, sizeof(u));
+		}
+		for (j = 0; j < 5; j++)
+			digest[j] ^= u[j];
+	}
+
+	for (l = 0; l < num; l++) {
+		struct pbkdf2_sha1_job *job = lane[l].job;
+		size_t pos = (lane[l].count - 1) * SHA1_MAC_LEN;
+
+		for (j = 0; j < 5; j++)
+			WPA_PUT_BE32(out + 4 * j, digest[j][l]);
+		plen = job->buflen - pos;
+		if (plen > SHA1_MAC_LEN)
+			plen = SHA1_MAC_LEN;
+		os_memcpy(job->buf + pos, out, plen);
+	}
+
+	forced_memzero(&ictx, sizeof(ictx));
+	forced_memzero(&octx, sizeof(octx));
+	forced_memzero(u1, sizeof(u1));
+	forced_memzero(out, sizeof(out));
+	forced_memzero(istate, sizeof(istate));
+	forced_memzero(ostate, sizeof(ostate));
+	forced_memzero(u, sizeof(u));
+	forced_memzero(digest, sizeof(digest));
+	forced_memzero(state, sizeof(state));
+	forced_memzero(w, sizeof(w));
+}
+
+
+void pbkdf2_sha1_multi(struct pbkdf2_sha1_job *jobs, size_t num,
+		       int iterations)
+{
+	struct pbkdf2_sha1_lane lane[PBKDF2_SHA1_LANES];
+	size_t i, used = 0;
+	unsigned int count;
+
+	/* Each SHA1_MAC_LEN octets of output of each job uses one lane */
+	for (i = 0; i < num; i++) {
+		jobs[i].result = 0;
+		for (count = 1; (count - 1) * SHA1_MAC_LEN < jobs[i].buflen;
+		     count++) {
+			lane[used].job = &jobs[i];
+			lane[used].count = count;
+			if (++used == PBKDF2_SHA1_LANES) {
+				pbkdf2_sha1_f_x4(lane, used, iterations);
+				used = 0;
+			}
+		}
+	}
+	if (used)
+		pbkdf2_sha1_f_x4(lane, used, iterations);
+}
+
+#else /* __GNUC__ && (__SSE2__ || __ARM_NEON) */
+
+void pbkdf2_sha1_multi(struct pbkdf2_sha1_job *jobs, size_t num,
+		       int iterations)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++)
+		jobs[i].result = pbkdf2_sha1(jobs[i].passphrase, jobs[i].ssid,
+					     jobs[i].ssid_len, iterations,
+					     jobs[i].buf, jobs[i].buflen);
+}
+
+#endif /* __GNUC__ && (__SSE2__ || __ARM_NEON) */
+
+#else /* CONFIG_CRYPTO_INTERNAL */
 
 static int pbkdf2_sha1_f(const char *passphrase, const u8 *ssid,
 			 size_t ssid_len, int iterations, unsigned int count,
@@ -54,6 +346,8 @@ static int pbkdf2_sha1_f(const char *passphrase, const u8 *ssid,
 	return 0;
 }
 
+#endif /* CONFIG_CRYPTO_INTERNAL */
+
 
 /**
  * pbkdf2_sha1 - SHA1-based key derivation function (PBKDF2) for IEEE 802.11i
@@ -90,3 +384,4 @@ int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 
 	return 0;
 }
+
@@ -86,12 +86,36 @@ struct tls_config {
 	int cert_in_cb;
 	const char *openssl_ciphers;
 	unsigned int tls_session_lifetime;
+	unsigned int tls_session_cache_size;
+	const char *tls_session_cache_file;
+	/* Identity of the server configuration; sessions are resumed only
+	 * through contexts with the same identity */
+	const u8 *tls_session_cache_ctx;
+	size_t tls_session_cache_ctx_len;
 	unsigned int crl_reload_interval;
 	unsigned int tls_flags;
 
 	void (*event_cb)(void *ctx, enum tls_event ev,
 			 union tls_event_data *data);
 	void *cb_ctx;
+
+	/* Optional functions for running slow operations (e.g., CRL reload)
+	 * in the background; see eloop_submit_work() and eloop_cancel_work().
+	 * Without these, the operations are done synchronously. */
+	int (*submit_work)(void (*work)(void *eloop_ctx, void *user_ctx),
+			   void (*done)(void *eloop_ctx, void *user_ctx),
+			   void *eloop_data, void *user_data);
+	int (*cancel_work)(void (*work)(void *eloop_ctx, void *user_ctx),
+			   void *eloop_data, void *user_data);
+
+	/* Optional functions for watching file changes (e.g., OCSP stapling
+	 * response updates); see eloop_register_read_sock() and
+	 * eloop_unregister_read_sock(). Without these, files are polled. */
+	int (*register_read_sock)(int sock,
+				  void (*handler)(int sock, void *eloop_ctx,
+						  void *sock_ctx),
+				  void *eloop_data, void *user_data);
+	void (*unregister_read_sock)(int sock);
 };
 
 #define TLS_CONN_ALLOW_SIGN_RSA_MD5 BIT(0)
@@ -650,6 +674,39 @@ tls_connection_get_success_data(struct tls_connection *conn);
 
 void tls_connection_remove_session(struct tls_connection *conn);
 
+/**
+ * tls_get_session_cache_status - Get shared session cache status
+ * @tls_ctx: TLS context data from tls_init()
+ * @buf: Buffer for the text status
+ * @buflen: Maximum buffer length
+ * Returns: Number of bytes written to buf or -1 if the shared server session
+ * cache (tls_config::tls_session_cache_size) is not in use
+ */
+int tls_get_session_cache_status(void *tls_ctx, char *buf, size_t buflen);
+
+/**
+ * tls_get_cert_store_status - Get trusted certificate store status
+ * @tls_ctx: TLS context data from tls_init()
+ * @buf: Buffer for the text status
+ * @buflen: Maximum buffer length
+ * Returns: Number of bytes written to buf or -1 on failure
+ *
+ * The status includes the number of certificates and CRLs in the store and
+ * statistics on the periodic reloading (tls_config::crl_reload_interval) that
+ * is done in the background.
+ */
+int tls_get_cert_store_status(void *tls_ctx, char *buf, size_t buflen);
+
+/**
+ * tls_get_ocsp_stapling_status - Get OCSP stapling response cache status
+ * @tls_ctx: TLS context data from tls_init()
+ * @buf: Buffer for the text status
+ * @buflen: Maximum buffer length
+ * Returns: Number of bytes written to buf or -1 if no OCSP stapling response
+ * (tls_connection_params::ocsp_stapling_response) is configured
+ */
+int tls_get_ocsp_stapling_status(void *tls_ctx, char *buf, size_t buflen);
+
 /**
  * tls_get_tls_unique - Fetch "tls-unique" for channel binding
  * @conn: Connection context data from tls_connection_init()
@@ -1784,3 +1784,21 @@ tls_connection_get_success_data(struct tls_connection *conn)
 void tls_connection_remove_session(struct tls_connection *conn)
 {
 }
+
+
+int tls_get_session_cache_status(void *tls_ctx, char *buf, size_t buflen)
+{
+	return -1;
+}
+
+
+int tls_get_cert_store_status(void *tls_ctx, char *buf, size_t buflen)
+{
+	return -1;
+}
+
+
+int tls_get_ocsp_stapling_status(void *tls_ctx, char *buf, size_t buflen)
+{
+	return -1;
+}
@@ -30,8 +30,16 @@
 #ifndef OPENSSL_NO_DH
 #include <openssl/dh.h>
 #endif
+#ifndef CONFIG_NATIVE_WINDOWS
+#include <fcntl.h>
+#endif /* CONFIG_NATIVE_WINDOWS */
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif /* __linux__ */
 
 #include "common.h"
+#include "utils/list.h"
 #include "crypto.h"
 #include "sha1.h"
 #include "sha256.h"
@@ -239,23 +247,55 @@ struct tls_context {
 			 union tls_event_data *data);
 	void *cb_ctx;
 	int cert_in_cb;
-	char *ocsp_stapling_response;
 };
 
 static struct tls_context *tls_global = NULL;
 
+#ifdef HAVE_OCSP
+struct tls_data;
+struct tls_ocsp_cache;
+static void tls_ocsp_cache_free(struct tls_data *data,
+				struct tls_ocsp_cache *cache);
+#endif /* HAVE_OCSP */
+
 
 struct tls_data {
 	SSL_CTX *ssl;
 	unsigned int tls_session_lifetime;
+	unsigned int shared_session_cache:1;
+	/* Session ID context base for the shared session cache */
+	u8 session_cache_ctx[SHA256_MAC_LEN];
 	int check_crl;
 	int check_crl_strict;
 	char *ca_cert;
 	unsigned int crl_reload_interval;
 	struct os_reltime crl_last_reload;
+	struct tls_crl_reload *crl_reload; /* pending background reload */
+	int (*submit_work)(void (*work)(void *eloop_ctx, void *user_ctx),
+			   void (*done)(void *eloop_ctx, void *user_ctx),
+			   void *eloop_data, void *user_data);
+	int (*cancel_work)(void (*work)(void *eloop_ctx, void *user_ctx),
+			   void *eloop_data, void *user_data);
+	int (*register_read_sock)(int sock,
+				  void (*handler)(int sock, void *eloop_ctx,
+						  void *sock_ctx),
+				  void *eloop_data, void *user_data);
+	void (*unregister_read_sock)(int sock);
+	struct tls_ocsp_cache *ocsp_cache;
+	unsigned int crl_reloads;
+	unsigned int crl_reload_failures;
+	struct os_reltime crl_load_time; /* duration of the last reload */
 	char *check_cert_subject;
 };
 
+struct tls_crl_reload {
+	char *ca_cert;
+	int check_crl;
+	X509_STORE *store;
+	unsigned long err;
+	struct os_reltime load_time;
+};
+
 struct tls_connection {
 	struct tls_context *context;
 	struct tls_data *data;
@@ -346,22 +386,18 @@ static void tls_show_errors(int level, const char *func, const char *txt)
 #endif /* CONFIG_NO_STDOUT_DEBUG */
 
 
+/* This is called from a worker thread, so any errors are left in the
+ * (per-thread) OpenSSL error queue for the caller to report. */
 static X509_STORE * tls_crl_cert_reload(const char *ca_cert, int check_crl)
 {
 	int flags;
 	X509_STORE *store;
 
 	store = X509_STORE_new();
-	if (!store) {
-		wpa_printf(MSG_DEBUG,
-			   "OpenSSL: %s - failed to allocate new certificate store",
-			   __func__);
+	if (!store)
 		return NULL;
-	}
 
 	if (ca_cert && X509_STORE_load_locations(store, ca_cert, NULL) != 1) {
-		tls_show_errors(MSG_WARNING, __func__,
-				"Failed to load root certificates");
 		X509_STORE_free(store);
 		return NULL;
 	}
@@ -376,6 +412,124 @@ static X509_STORE * tls_crl_cert_reload(const char *ca_cert, int check_crl)
 }
 
 
+static void tls_cert_store_count(X509_STORE *store, unsigned int *certs,
+				 unsigned int *crls)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	STACK_OF(X509_OBJECT) *objs;
+	int i;
+#endif /* >= 1.1.0 */
+
+	*certs = 0;
+	*crls = 0;
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	objs = store ? X509_STORE_get0_objects(store) : NULL;
+	for (i = 0; objs && i < sk_X509_OBJECT_num(objs); i++) {
+		switch (X509_OBJECT_get_type(sk_X509_OBJECT_value(objs, i))) {
+		case X509_LU_X509:
+			(*certs)++;
+			break;
+		case X509_LU_CRL:
+			(*crls)++;
+			break;
+		default:
+			break;
+		}
+	}
+#endif /* >= 1.1.0 */
+}
+
+
+static void tls_crl_reload_free(struct tls_crl_reload *reload)
+{
+	if (!reload)
+		return;
+	X509_STORE_free(reload->store);
+	os_free(reload->ca_cert);
+	os_free(reload);
+}
+
+
+static void tls_crl_reload_work(void *eloop_ctx, void *user_ctx)
+{
+	struct tls_crl_reload *reload = user_ctx;
+	struct os_reltime start, end;
+
+	os_get_reltime(&start);
+	reload->store = tls_crl_cert_reload(reload->ca_cert,
+					    reload->check_crl);
+	if (!reload->store)
+		reload->err = ERR_get_error();
+	ERR_clear_error();
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &reload->load_time);
+}
+
+
+static void tls_crl_reload_done(void *eloop_ctx, void *user_ctx)
+{
+	struct tls_data *data = eloop_ctx;
+	struct tls_crl_reload *reload = user_ctx;
+	unsigned int certs, crls;
+
+	data->crl_reload = NULL;
+	data->crl_load_time = reload->load_time;
+	/* Wait for the full interval before retrying a failed reload to avoid
+	 * reparsing a broken file for every new connection */
+	os_get_reltime(&data->crl_last_reload);
+
+	if (!reload->store) {
+		data->crl_reload_failures++;
+		wpa_printf(MSG_ERROR,
+			   "OpenSSL: Error replacing X509 store with ca_cert file: %s",
+			   reload->err ? ERR_error_string(reload->err, NULL) :
+			   "failed to allocate new certificate store");
+	} else {
+		tls_cert_store_count(reload->store, &certs, &crls);
+		/* Connections that have not yet verified the peer certificate
+		 * will use the new store */
+		SSL_CTX_set_cert_store(data->ssl, reload->store);
+		reload->store = NULL;
+		data->crl_reloads++;
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Replaced X509 store with ca_cert file (%u certificates, %u CRLs, loaded in %ld.%06ld s)",
+			   certs, crls, (long) reload->load_time.sec,
+			   (long) reload->load_time.usec);
+	}
+
+	tls_crl_reload_free(reload);
+}
+
+
+static void tls_crl_reload_start(struct tls_data *data)
+{
+	struct tls_crl_reload *reload;
+
+	wpa_printf(MSG_DEBUG, "OpenSSL: Reloading X509 store with ca_cert file");
+	reload = os_zalloc(sizeof(*reload));
+	if (!reload)
+		return;
+	reload->check_crl = data->check_crl;
+	if (data->ca_cert) {
+		reload->ca_cert = os_strdup(data->ca_cert);
+		if (!reload->ca_cert) {
+			os_free(reload);
+			return;
+		}
+	}
+
+	data->crl_reload = reload;
+	if (!data->submit_work ||
+	    data->submit_work(tls_crl_reload_work, tls_crl_reload_done,
+			      data, reload) < 0) {
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Could not start background X509 store reload - load it synchronously");
+		tls_crl_reload_work(data, reload);
+		tls_crl_reload_done(data, reload);
+	}
+}
+
+
 #ifdef CONFIG_NATIVE_WINDOWS
 
 /* Windows CryptoAPI and access to certificate stores */
@@ -976,6 +1130,444 @@ static void remove_session_cb(SSL_CTX *ctx, SSL_SESSION *sess)
 }
 
 
+/*
+ * Process wide server session cache. This replaces the per-SSL_CTX OpenSSL
+ * session cache when tls_session_cache_size is set so that a session created
+ * through one BSS or the RADIUS server can be resumed through any other TLS
+ * context in the same process. Optionally, sessions with success data are
+ * stored into a file when the cache is freed and restored on the next start.
+ */
+
+#define TLS_SESSION_CACHE_HASH_SIZE 1024
+#define TLS_SESSION_CACHE_FILE_MAGIC "hapdtlsc"
+#define TLS_SESSION_CACHE_FILE_VERSION 1
+
+struct tls_session_cache_entry {
+	struct dl_list list; /* LRU order, most recently used first */
+	struct tls_session_cache_entry *hnext;
+	SSL_SESSION *sess;
+	unsigned int id_len;
+	u8 id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+};
+
+struct tls_session_cache {
+	unsigned int users;
+	unsigned int max_entries;
+	unsigned int num_entries;
+	char *file;
+	struct dl_list lru;
+	struct tls_session_cache_entry *hash[TLS_SESSION_CACHE_HASH_SIZE];
+
+	/* Statistics */
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long stored;
+	unsigned long evicted;
+	unsigned long expired;
+	unsigned long loaded;
+};
+
+static struct tls_session_cache *tls_session_cache = NULL;
+
+
+static unsigned int tls_session_cache_hash(const u8 *id, unsigned int len)
+{
+	/* Session IDs are random, so the first octets are good enough */
+	if (len < 2)
+		return len ? id[0] : 0;
+	return (id[0] | (id[1] << 8)) % TLS_SESSION_CACHE_HASH_SIZE;
+}
+
+
+static struct tls_session_cache_entry *
+tls_session_cache_find(const u8 *id, unsigned int len,
+		       struct tls_session_cache_entry ***prev)
+{
+	struct tls_session_cache_entry **pos;
+
+	pos = &tls_session_cache->hash[tls_session_cache_hash(id, len)];
+	while (*pos) {
+		if ((*pos)->id_len == len && os_memcmp((*pos)->id, id, len) == 0)
+			break;
+		pos = &(*pos)->hnext;
+	}
+	if (prev)
+		*prev = pos;
+	return *pos;
+}
+
+
+static void tls_session_cache_free_entry(struct tls_session_cache_entry *e)
+{
+	struct tls_session_cache_entry **prev;
+
+	if (tls_session_cache_find(e->id, e->id_len, &prev) == e)
+		*prev = e->hnext;
+	dl_list_del(&e->list);
+	tls_session_cache->num_entries--;
+	remove_session_cb(NULL, e->sess);
+	SSL_SESSION_free(e->sess);
+	os_free(e);
+}
+
+
+static int tls_session_expired(SSL_SESSION *sess, long now)
+{
+	return SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess) <=
+		now;
+}
+
+
+static int tls_session_cache_add(SSL_SESSION *sess)
+{
+	struct tls_session_cache_entry *e;
+	const unsigned char *id;
+	unsigned int id_len;
+
+	id = SSL_SESSION_get_id(sess, &id_len);
+	if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+		return -1;
+
+	e = tls_session_cache_find(id, id_len, NULL);
+	if (e) {
+		if (e->sess == sess)
+			return -1;
+		tls_session_cache_free_entry(e);
+	}
+
+	while (tls_session_cache->num_entries >=
+	       tls_session_cache->max_entries) {
+		e = dl_list_last(&tls_session_cache->lru,
+				 struct tls_session_cache_entry, list);
+		if (!e)
+			break;
+		tls_session_cache->evicted++;
+		tls_session_cache_free_entry(e);
+	}
+
+	e = os_zalloc(sizeof(*e));
+	if (!e)
+		return -1;
+	e->sess = sess;
+	e->id_len = id_len;
+	os_memcpy(e->id, id, id_len);
+	e->hnext = tls_session_cache->hash[tls_session_cache_hash(id, id_len)];
+	tls_session_cache->hash[tls_session_cache_hash(id, id_len)] = e;
+	dl_list_add(&tls_session_cache->lru, &e->list);
+	tls_session_cache->num_entries++;
+	return 0;
+}
+
+
+static int tls_session_cache_new_cb(SSL *ssl, SSL_SESSION *sess)
+{
+	if (!tls_session_cache || tls_session_cache_add(sess) < 0)
+		return 0;
+	tls_session_cache->stored++;
+	wpa_printf(MSG_DEBUG, "OpenSSL: Added session %p to the shared cache",
+		   sess);
+	/* The cache entry keeps the reference to the session */
+	return 1;
+}
+
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L || \
+	(defined(LIBRESSL_VERSION_NUMBER) && \
+	 LIBRESSL_VERSION_NUMBER < 0x20700000L)
+static SSL_SESSION * tls_session_cache_get_cb(SSL *ssl, unsigned char *id,
+					      int len, int *copy)
+#else
+static SSL_SESSION * tls_session_cache_get_cb(SSL *ssl,
+					      const unsigned char *id,
+					      int len, int *copy)
+#endif
+{
+	struct tls_session_cache_entry *e;
+
+	*copy = 0;
+	if (!tls_session_cache || len <= 0)
+		return NULL;
+
+	e = tls_session_cache_find(id, len, NULL);
+	if (e && tls_session_expired(e->sess, (long) time(NULL))) {
+		tls_session_cache->expired++;
+		tls_session_cache_free_entry(e);
+		e = NULL;
+	}
+	if (!e) {
+		tls_session_cache->misses++;
+		return NULL;
+	}
+
+	tls_session_cache->hits++;
+	dl_list_del(&e->list);
+	dl_list_add(&tls_session_cache->lru, &e->list);
+	/* Let OpenSSL take its own reference to the session */
+	*copy = 1;
+	return e->sess;
+}
+
+
+static void tls_session_cache_remove_cb(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+	struct tls_session_cache_entry *e;
+	const unsigned char *id;
+	unsigned int id_len;
+
+	if (!tls_session_cache) {
+		remove_session_cb(ctx, sess);
+		return;
+	}
+
+	id = SSL_SESSION_get_id(sess, &id_len);
+	e = tls_session_cache_find(id, id_len, NULL);
+	if (e && e->sess == sess) {
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Remove session %p from the shared cache",
+			   sess);
+		tls_session_cache_free_entry(e);
+	} else {
+		remove_session_cb(ctx, sess);
+	}
+}
+
+
+static FILE * tls_session_cache_fopen(const char *fname)
+{
+#ifdef CONFIG_NATIVE_WINDOWS
+	return fopen(fname, "wb");
+#else /* CONFIG_NATIVE_WINDOWS */
+	/* The file contains session master secrets */
+	int fd;
+	FILE *f;
+
+	fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		return NULL;
+	f = fdopen(fd, "wb");
+	if (!f)
+		close(fd);
+	return f;
+#endif /* CONFIG_NATIVE_WINDOWS */
+}
+
+
+static void tls_session_cache_write_u32(FILE *f, u32 val)
+{
+	u8 buf[4];
+
+	WPA_PUT_BE32(buf, val);
+	fwrite(buf, 4, 1, f);
+}
+
+
+static void tls_session_cache_save(void)
+{
+	struct tls_session_cache_entry *e;
+	const struct wpabuf *data;
+	long now = (long) time(NULL);
+	unsigned int count = 0;
+	char *tmp;
+	size_t len;
+	FILE *f;
+	int err;
+
+	len = os_strlen(tls_session_cache->file) + 5;
+	tmp = os_malloc(len);
+	if (!tmp)
+		return;
+	os_snprintf(tmp, len, "%s.tmp", tls_session_cache->file);
+	f = tls_session_cache_fopen(tmp);
+	if (!f) {
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Could not write TLS session cache file %s: %s",
+			   tmp, strerror(errno));
+		os_free(tmp);
+		return;
+	}
+
+	fwrite(TLS_SESSION_CACHE_FILE_MAGIC, 8, 1, f);
+	tls_session_cache_write_u32(f, TLS_SESSION_CACHE_FILE_VERSION);
+
+	/* Oldest first so that the LRU order is restored on load */
+	dl_list_for_each_reverse(e, &tls_session_cache->lru,
+				 struct tls_session_cache_entry, list) {
+		unsigned char *der = NULL;
+		int der_len;
+
+		data = tls_ex_idx_session >= 0 ?
+			SSL_SESSION_get_ex_data(e->sess, tls_ex_idx_session) :
+			NULL;
+		/* Sessions without success data cannot be resumed */
+		if (!data || tls_session_expired(e->sess, now))
+			continue;
+		der_len = i2d_SSL_SESSION(e->sess, &der);
+		if (der_len <= 0)
+			continue;
+		tls_session_cache_write_u32(f, der_len);
+		fwrite(der, der_len, 1, f);
+		tls_session_cache_write_u32(f, wpabuf_len(data));
+		fwrite(wpabuf_head(data), wpabuf_len(data), 1, f);
+		bin_clear_free(der, der_len);
+		count++;
+	}
+
+	err = ferror(f);
+	if (fclose(f) != 0 || err ||
+	    rename(tmp, tls_session_cache->file) != 0) {
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Failed to write TLS session cache file %s",
+			   tls_session_cache->file);
+		unlink(tmp);
+	} else {
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Stored %u session(s) into %s",
+			   count, tls_session_cache->file);
+	}
+	os_free(tmp);
+}
+
+
+static void tls_session_cache_load(void)
+{
+	char *buf;
+	size_t len, pos;
+	long now = (long) time(NULL);
+
+	buf = os_readfile(tls_session_cache->file, &len);
+	if (!buf)
+		return;
+	if (len < 12 ||
+	    os_memcmp(buf, TLS_SESSION_CACHE_FILE_MAGIC, 8) != 0 ||
+	    WPA_GET_BE32((u8 *) buf + 8) != TLS_SESSION_CACHE_FILE_VERSION) {
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Ignore unrecognized TLS session cache file %s",
+			   tls_session_cache->file);
+		goto out;
+	}
+
+	for (pos = 12; pos + 4 <= len; ) {
+		const unsigned char *der;
+		u32 der_len, data_len;
+		SSL_SESSION *sess;
+		struct wpabuf *data;
+
+		der_len = WPA_GET_BE32((u8 *) buf + pos);
+		pos += 4;
+		if (der_len > len - pos || len - pos - der_len < 4)
+			break;
+		der = (const unsigned char *) buf + pos;
+		pos += der_len;
+		data_len = WPA_GET_BE32((u8 *) buf + pos);
+		pos += 4;
+		if (data_len > len - pos)
+			break;
+
+		sess = d2i_SSL_SESSION(NULL, &der, der_len);
+		pos += data_len;
+		if (!sess)
+			continue;
+		if (tls_session_expired(sess, now) || tls_ex_idx_session < 0) {
+			SSL_SESSION_free(sess);
+			continue;
+		}
+		data = wpabuf_alloc_copy(buf + pos - data_len, data_len);
+		if (!data ||
+		    SSL_SESSION_set_ex_data(sess, tls_ex_idx_session,
+					    data) != 1) {
+			wpabuf_free(data);
+			SSL_SESSION_free(sess);
+			continue;
+		}
+		if (tls_session_cache_add(sess) < 0) {
+			remove_session_cb(NULL, sess);
+			SSL_SESSION_free(sess);
+			continue;
+		}
+		tls_session_cache->loaded++;
+	}
+
+	wpa_printf(MSG_DEBUG, "OpenSSL: Loaded %lu session(s) from %s",
+		   tls_session_cache->loaded, tls_session_cache->file);
+out:
+	bin_clear_free(buf, len);
+}
+
+
+static int tls_session_cache_set_ctx(struct tls_data *data,
+				     const struct tls_config *conf)
+{
+	const u8 *addr[1];
+	size_t len[1];
+
+	/* Without a configuration identity from the caller, sessions are not
+	 * shared with other contexts or over restarts. */
+	if (!conf->tls_session_cache_ctx)
+		return os_get_random(data->session_cache_ctx,
+				     sizeof(data->session_cache_ctx));
+
+	addr[0] = conf->tls_session_cache_ctx;
+	len[0] = conf->tls_session_cache_ctx_len;
+	return sha256_vector(1, addr, len, data->session_cache_ctx);
+}
+
+
+static int tls_session_cache_init(const struct tls_config *conf)
+{
+	if (tls_session_cache) {
+		/* Shared with all TLS contexts; use the largest size */
+		if (conf->tls_session_cache_size >
+		    tls_session_cache->max_entries)
+			tls_session_cache->max_entries =
+				conf->tls_session_cache_size;
+		if (conf->tls_session_cache_file &&
+		    (!tls_session_cache->file ||
+		     os_strcmp(conf->tls_session_cache_file,
+			       tls_session_cache->file) != 0))
+			wpa_printf(MSG_INFO,
+				   "OpenSSL: TLS session cache already in use - ignore tls_session_cache_file=%s",
+				   conf->tls_session_cache_file);
+		tls_session_cache->users++;
+		return 0;
+	}
+
+	tls_session_cache = os_zalloc(sizeof(*tls_session_cache));
+	if (!tls_session_cache)
+		return -1;
+	tls_session_cache->users = 1;
+	tls_session_cache->max_entries = conf->tls_session_cache_size;
+	dl_list_init(&tls_session_cache->lru);
+	if (conf->tls_session_cache_file) {
+		tls_session_cache->file =
+			os_strdup(conf->tls_session_cache_file);
+		if (tls_session_cache->file)
+			tls_session_cache_load();
+	}
+	wpa_printf(MSG_DEBUG,
+		   "OpenSSL: Initialized shared TLS session cache (size %u)",
+		   tls_session_cache->max_entries);
+	return 0;
+}
+
+
+static void tls_session_cache_deinit(void)
+{
+	struct tls_session_cache_entry *e;
+
+	if (!tls_session_cache || --tls_session_cache->users > 0)
+		return;
+
+	if (tls_session_cache->file)
+		tls_session_cache_save();
+	while ((e = dl_list_first(&tls_session_cache->lru,
+				  struct tls_session_cache_entry, list)))
+		tls_session_cache_free_entry(e);
+	os_free(tls_session_cache->file);
+	os_free(tls_session_cache);
+	tls_session_cache = NULL;
+}
+
+
 void * tls_init(const struct tls_config *conf)
 {
 	struct tls_data *data;
@@ -1067,6 +1659,14 @@ void * tls_init(const struct tls_config *conf)
 	if (conf) {
 		data->tls_session_lifetime = conf->tls_session_lifetime;
 		data->crl_reload_interval = conf->crl_reload_interval;
+		if (conf->submit_work && conf->cancel_work) {
+			data->submit_work = conf->submit_work;
+			data->cancel_work = conf->cancel_work;
+		}
+		if (conf->register_read_sock && conf->unregister_read_sock) {
+			data->register_read_sock = conf->register_read_sock;
+			data->unregister_read_sock = conf->unregister_read_sock;
+		}
 	}
 
 	SSL_CTX_set_options(ssl, SSL_OP_NO_SSLv2);
@@ -1084,6 +1684,16 @@ void * tls_init(const struct tls_config *conf)
 
 	SSL_CTX_set_info_callback(ssl, ssl_info_cb);
 	SSL_CTX_set_app_data(ssl, context);
+
+	if (tls_ex_idx_session < 0) {
+		tls_ex_idx_session = SSL_SESSION_get_ex_new_index(
+			0, NULL, NULL, NULL, NULL);
+		if (tls_ex_idx_session < 0) {
+			tls_deinit(data);
+			return NULL;
+		}
+	}
+
 	if (data->tls_session_lifetime > 0) {
 		SSL_CTX_set_quiet_shutdown(ssl, 1);
 		/*
@@ -1091,22 +1701,30 @@ void * tls_init(const struct tls_config *conf)
 		 * by the per-EAP method context in tls_connection_set_verify().
 		 */
 		SSL_CTX_set_session_id_context(ssl, (u8 *) "hostapd", 7);
-		SSL_CTX_set_session_cache_mode(ssl, SSL_SESS_CACHE_SERVER);
 		SSL_CTX_set_timeout(ssl, data->tls_session_lifetime);
-		SSL_CTX_sess_set_remove_cb(ssl, remove_session_cb);
+		if (conf && conf->tls_session_cache_size > 0 &&
+		    tls_session_cache_set_ctx(data, conf) == 0 &&
+		    tls_session_cache_init(conf) == 0) {
+			data->shared_session_cache = 1;
+			SSL_CTX_set_session_id_context(
+				ssl, data->session_cache_ctx,
+				sizeof(data->session_cache_ctx));
+			SSL_CTX_set_session_cache_mode(
+				ssl, SSL_SESS_CACHE_SERVER |
+				SSL_SESS_CACHE_NO_INTERNAL);
+			SSL_CTX_sess_set_new_cb(ssl, tls_session_cache_new_cb);
+			SSL_CTX_sess_set_get_cb(ssl, tls_session_cache_get_cb);
+			SSL_CTX_sess_set_remove_cb(ssl,
+						   tls_session_cache_remove_cb);
+		} else {
+			SSL_CTX_set_session_cache_mode(ssl,
+						       SSL_SESS_CACHE_SERVER);
+			SSL_CTX_sess_set_remove_cb(ssl, remove_session_cb);
+		}
 	} else {
 		SSL_CTX_set_session_cache_mode(ssl, SSL_SESS_CACHE_OFF);
 	}
 
-	if (tls_ex_idx_session < 0) {
-		tls_ex_idx_session = SSL_SESSION_get_ex_new_index(
-			0, NULL, NULL, NULL, NULL);
-		if (tls_ex_idx_session < 0) {
-			tls_deinit(data);
-			return NULL;
-		}
-	}
-
 #ifndef OPENSSL_NO_ENGINE
 	wpa_printf(MSG_DEBUG, "ENGINE: Loading builtin engines");
 	ENGINE_load_builtin_engines();
@@ -1148,8 +1766,17 @@ void tls_deinit(void *ssl_ctx)
 		os_free(context);
 	if (data->tls_session_lifetime > 0)
 		SSL_CTX_flush_sessions(ssl, 0);
+	if (data->crl_reload) {
+		data->cancel_work(tls_crl_reload_work, data, data->crl_reload);
+		tls_crl_reload_free(data->crl_reload);
+	}
+#ifdef HAVE_OCSP
+	tls_ocsp_cache_free(data, data->ocsp_cache);
+#endif /* HAVE_OCSP */
 	os_free(data->ca_cert);
 	SSL_CTX_free(ssl);
+	if (data->shared_session_cache)
+		tls_session_cache_deinit();
 
 	tls_openssl_ref_count--;
 	if (tls_openssl_ref_count == 0) {
@@ -1164,8 +1791,6 @@ void tls_deinit(void *ssl_ctx)
 		ERR_free_strings();
 		EVP_cleanup();
 #endif /* < 1.1.0 */
-		os_free(tls_global->ocsp_stapling_response);
-		tls_global->ocsp_stapling_response = NULL;
 		os_free(tls_global);
 		tls_global = NULL;
 	}
@@ -1563,27 +2188,17 @@ struct tls_connection * tls_connection_init(void *ssl_ctx)
 	SSL_CTX *ssl = data->ssl;
 	struct tls_connection *conn;
 	long options;
-	X509_STORE *new_cert_store;
 	struct os_reltime now;
 	struct tls_context *context = SSL_CTX_get_app_data(ssl);
 
-	/* Replace X509 store if it is time to update CRL. */
-	if (data->crl_reload_interval > 0 && os_get_reltime(&now) == 0 &&
+	/* Start replacing the X509 store if it is time to update CRL. The new
+	 * store is loaded in the background and this connection continues to
+	 * use the current one. */
+	if (data->crl_reload_interval > 0 && !data->crl_reload &&
+	    os_get_reltime(&now) == 0 &&
 	    os_reltime_expired(&now, &data->crl_last_reload,
-			       data->crl_reload_interval)) {
-		wpa_printf(MSG_INFO,
-			   "OpenSSL: Flushing X509 store with ca_cert file");
-		new_cert_store = tls_crl_cert_reload(data->ca_cert,
-						     data->check_crl);
-		if (!new_cert_store) {
-			wpa_printf(MSG_ERROR,
-				   "OpenSSL: Error replacing X509 store with ca_cert file");
-		} else {
-			/* Replace old store */
-			SSL_CTX_set_cert_store(ssl, new_cert_store);
-			data->crl_last_reload = now;
-		}
-	}
+			       data->crl_reload_interval))
+		tls_crl_reload_start(data);
 
 	conn = os_zalloc(sizeof(*conn));
 	if (conn == NULL)
@@ -3261,6 +3876,23 @@ int tls_connection_set_verify(void *ssl_ctx, struct tls_connection *conn,
 		SSL_set_session_id_context(conn->ssl,
 					   (const unsigned char *) &counter,
 					   sizeof(counter));
+	} else if (session_ctx && data->shared_session_cache) {
+		/*
+		 * Sessions from all contexts are in the same cache, so bind
+		 * them to the configuration of this context. OpenSSL does not
+		 * resume a session that has a different session id context.
+		 */
+		const u8 *addr[2];
+		size_t len[2];
+		u8 sid_ctx[SHA256_MAC_LEN];
+
+		addr[0] = data->session_cache_ctx;
+		len[0] = sizeof(data->session_cache_ctx);
+		addr[1] = session_ctx;
+		len[1] = session_ctx_len;
+		if (sha256_vector(2, addr, len, sid_ctx) < 0)
+			return -1;
+		SSL_set_session_id_context(conn->ssl, sid_ctx, sizeof(sid_ctx));
 	} else if (session_ctx) {
 		SSL_set_session_id_context(conn->ssl, session_ctx,
 					   session_ctx_len);
@@ -4980,34 +5612,326 @@ static int ocsp_resp_cb(SSL *s, void *arg)
 }
 
 
+/* Allowed clock skew (in seconds) for the thisUpdate/nextUpdate validity
+ * check when loading a stapling response */
+#define TLS_OCSP_MAX_SKEW 300
+
+struct tls_ocsp_cache {
+	char *file;
+	const char *fname; /* file name part of file */
+	u8 *resp; /* DER encoded OCSPResponse or %NULL if none is available */
+	size_t resp_len;
+	os_time_t next_update; /* earliest nextUpdate or 0 if not included */
+
+	/* File identity for detecting changes when inotify is not available */
+	time_t mtime;
+	off_t size;
+	ino_t ino;
+	struct os_reltime last_check;
+	int inotify_fd;
+
+	unsigned int loads;
+	unsigned int load_failures;
+	unsigned int stapled;
+	unsigned int expired;
+};
+
+
+static int tls_ocsp_resp_check(const u8 *der, size_t len,
+			       os_time_t *next_update)
+{
+	const unsigned char *p = der;
+	OCSP_RESPONSE *rsp;
+	OCSP_BASICRESP *basic = NULL;
+	OCSP_SINGLERESP *single;
+	ASN1_GENERALIZEDTIME *this_upd, *next_upd;
+	struct os_time now;
+	os_time_t t;
+	int i, status, day, sec, ret = -1;
+
+	*next_update = 0;
+	rsp = d2i_OCSP_RESPONSE(NULL, &p, len);
+	if (!rsp) {
+		tls_show_errors(MSG_INFO, __func__,
+				"Failed to parse OCSP stapling response");
+		return -1;
+	}
+
+	status = OCSP_response_status(rsp);
+	if (status != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: OCSP stapling response has responder error %d (%s)",
+			   status, OCSP_response_status_str(status));
+		goto fail;
+	}
+
+	basic = OCSP_response_get1_basic(rsp);
+	if (!basic || OCSP_resp_count(basic) <= 0) {
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: No certificate status in OCSP stapling response");
+		goto fail;
+	}
+
+	os_get_time(&now);
+	for (i = 0; i < OCSP_resp_count(basic); i++) {
+		single = OCSP_resp_get0(basic, i);
+		if (!single ||
+		    OCSP_single_get0_status(single, NULL, NULL, &this_upd,
+					    &next_upd) < 0)
+			goto fail;
+		if (!OCSP_check_validity(this_upd, next_upd, TLS_OCSP_MAX_SKEW,
+					 -1)) {
+			tls_show_errors(MSG_INFO, __func__,
+					"OCSP stapling response is not within its validity period");
+			goto fail;
+		}
+		if (!next_upd)
+			continue;
+		if (!ASN1_TIME_diff(&day, &sec, NULL, next_upd))
+			goto fail;
+		t = now.sec + (os_time_t) day * 24 * 60 * 60 + sec;
+		if (!*next_update || t < *next_update)
+			*next_update = t;
+	}
+
+	ret = 0;
+fail:
+	if (ret)
+		ERR_clear_error();
+	OCSP_BASICRESP_free(basic);
+	OCSP_RESPONSE_free(rsp);
+	return ret;
+}
+
+
+static int tls_ocsp_cache_load(struct tls_ocsp_cache *cache)
+{
+	struct stat st;
+	char *buf;
+	size_t len;
+	os_time_t next_update;
+
+	if (stat(cache->file, &st) == 0) {
+		cache->mtime = st.st_mtime;
+		cache->size = st.st_size;
+		cache->ino = st.st_ino;
+	} else {
+		cache->mtime = 0;
+		cache->size = 0;
+		cache->ino = 0;
+	}
+
+	buf = os_readfile(cache->file, &len);
+	if (!buf ||
+	    tls_ocsp_resp_check((const u8 *) buf, len, &next_update) < 0) {
+		/* Keep the previous response, if any, until its nextUpdate
+		 * time in case the file is only temporarily unusable */
+		cache->load_failures++;
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Could not load OCSP stapling response from %s%s",
+			   cache->file,
+			   cache->resp ? " - keep using the previous response" :
+			   "");
+		os_free(buf);
+		return -1;
+	}
+
+	os_free(cache->resp);
+	cache->resp = (u8 *) buf;
+	cache->resp_len = len;
+	cache->next_update = next_update;
+	cache->loads++;
+	wpa_printf(MSG_DEBUG,
+		   "OpenSSL: Loaded OCSP stapling response (%zu bytes) from %s",
+		   len, cache->file);
+	return 0;
+}
+
+
+static void tls_ocsp_cache_check_file(struct tls_ocsp_cache *cache)
+{
+	struct os_reltime now;
+	struct stat st;
+
+	/* Changes are reported by inotify when it is available. Otherwise,
+	 * check whether the file has been modified at most about once per second.
+	 */
+	if (cache->inotify_fd >= 0)
+		return;
+	os_get_reltime(&now);
+	if (!os_reltime_expired(&now, &cache->last_check, 1))
+		return;
+	cache->last_check = now;
+
+	if (stat(cache->file, &st) == 0) {
+		if (st.st_mtime == cache->mtime && st.st_size == cache->size &&
+		    st.st_ino == cache->ino)
+			return;
+	} else if (!cache->mtime && !cache->size && !cache->ino) {
+		return;
+	}
+
+	tls_ocsp_cache_load(cache);
+}
+
+
+#ifdef __linux__
+
+static void tls_ocsp_cache_inotify(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct tls_ocsp_cache *cache = eloop_ctx;
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *pos;
+	int changed = 0;
+
+	while ((len = read(sock, buf, sizeof(buf))) > 0) {
+		for (pos = buf; pos < buf + len;
+		     pos += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *) pos;
+			if (ev->len && os_strcmp(ev->name, cache->fname) == 0)
+				changed = 1;
+		}
+	}
+
+	if (changed) {
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: OCSP stapling response file %s changed",
+			   cache->file);
+		tls_ocsp_cache_load(cache);
+	}
+}
+
+
+static void tls_ocsp_cache_watch(struct tls_data *data,
+				 struct tls_ocsp_cache *cache)
+{
+	char *dir, *pos;
+	int fd;
+
+	/* The socket can be watched only with the caller's event loop */
+	if (!data->register_read_sock)
+		return;
+
+	/* Watch the directory to notice the file being replaced, e.g., with
+	 * openssl ocsp -respout writing to a temporary file and renaming it */
+	dir = os_strdup(cache->file);
+	if (!dir)
+		return;
+	pos = os_strrchr(dir, '/');
+	if (pos) {
+		pos[pos == dir ? 1 : 0] = '\0';
+	} else {
+		os_free(dir);
+		dir = os_strdup(".");
+		if (!dir)
+			return;
+	}
+
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0 ||
+	    inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+	    data->register_read_sock(fd, tls_ocsp_cache_inotify, cache,
+				     NULL) < 0) {
+		wpa_printf(MSG_DEBUG,
+			   "OpenSSL: Could not watch %s for OCSP stapling response changes (%s) - check modification time instead",
+			   dir, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+	}
+
+	cache->inotify_fd = fd;
+	os_free(dir);
+}
+
+#endif /* __linux__ */
+
+
+static struct tls_ocsp_cache * tls_ocsp_cache_init(struct tls_data *data,
+						   const char *file)
+{
+	struct tls_ocsp_cache *cache;
+	const char *pos;
+
+	cache = os_zalloc(sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->inotify_fd = -1;
+	cache->file = os_strdup(file);
+	if (!cache->file) {
+		os_free(cache);
+		return NULL;
+	}
+	pos = os_strrchr(cache->file, '/');
+	cache->fname = pos ? pos + 1 : cache->file;
+
+	/* A missing or invalid file is not fatal since it may be provided
+	 * later */
+	tls_ocsp_cache_load(cache);
+	os_get_reltime(&cache->last_check);
+#ifdef __linux__
+	tls_ocsp_cache_watch(data, cache);
+#endif /* __linux__ */
+
+	return cache;
+}
+
+
+static void tls_ocsp_cache_free(struct tls_data *data,
+				struct tls_ocsp_cache *cache)
+{
+	if (!cache)
+		return;
+#ifdef __linux__
+	if (cache->inotify_fd >= 0) {
+		data->unregister_read_sock(cache->inotify_fd);
+		close(cache->inotify_fd);
+	}
+#endif /* __linux__ */
+	os_free(cache->resp);
+	os_free(cache->file);
+	os_free(cache);
+}
+
+
 static int ocsp_status_cb(SSL *s, void *arg)
 {
+	struct tls_data *data = arg;
+	struct tls_ocsp_cache *cache = data->ocsp_cache;
+	struct os_time now;
 	char *tmp;
-	char *resp;
-	size_t len;
 
-	if (tls_global->ocsp_stapling_response == NULL) {
+	if (!cache) {
 		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - no response configured");
 		return SSL_TLSEXT_ERR_OK;
 	}
 
-	resp = os_readfile(tls_global->ocsp_stapling_response, &len);
-	if (resp == NULL) {
-		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - could not read response file");
+	tls_ocsp_cache_check_file(cache);
+	if (!cache->resp) {
+		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - no valid response available");
 		/* TODO: Build OCSPResponse with responseStatus = internalError
 		 */
 		return SSL_TLSEXT_ERR_OK;
 	}
+
+	if (cache->next_update && os_get_time(&now) == 0 &&
+	    now.sec > cache->next_update) {
+		cache->expired++;
+		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - cached response has expired");
+		return SSL_TLSEXT_ERR_OK;
+	}
+
 	wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - send cached response");
-	tmp = OPENSSL_malloc(len);
-	if (tmp == NULL) {
-		os_free(resp);
+	tmp = OPENSSL_malloc(cache->resp_len);
+	if (tmp == NULL)
 		return SSL_TLSEXT_ERR_ALERT_FATAL;
-	}
 
-	os_memcpy(tmp, resp, len);
-	os_free(resp);
-	SSL_set_tlsext_status_ocsp_resp(s, tmp, len);
+	os_memcpy(tmp, cache->resp, cache->resp_len);
+	SSL_set_tlsext_status_ocsp_resp(s, tmp, cache->resp_len);
+	cache->stapled++;
 
 	return SSL_TLSEXT_ERR_OK;
 }
@@ -5527,13 +6451,19 @@ int tls_global_set_params(void *tls_ctx,
 
 #ifdef HAVE_OCSP
 	SSL_CTX_set_tlsext_status_cb(ssl_ctx, ocsp_status_cb);
-	SSL_CTX_set_tlsext_status_arg(ssl_ctx, ssl_ctx);
-	os_free(tls_global->ocsp_stapling_response);
-	if (params->ocsp_stapling_response)
-		tls_global->ocsp_stapling_response =
-			os_strdup(params->ocsp_stapling_response);
-	else
-		tls_global->ocsp_stapling_response = NULL;
+	SSL_CTX_set_tlsext_status_arg(ssl_ctx, data);
+	if (!params->ocsp_stapling_response || !data->ocsp_cache ||
+	    os_strcmp(data->ocsp_cache->file,
+		      params->ocsp_stapling_response) != 0) {
+		tls_ocsp_cache_free(data, data->ocsp_cache);
+		data->ocsp_cache = NULL;
+		if (params->ocsp_stapling_response) {
+			data->ocsp_cache = tls_ocsp_cache_init(
+				data, params->ocsp_stapling_response);
+			if (!data->ocsp_cache)
+				return -1;
+		}
+	}
 #endif /* HAVE_OCSP */
 
 	openssl_debug_dump_ctx(ssl_ctx);
@@ -5735,6 +6665,107 @@ void tls_connection_remove_session(struct tls_connection *conn)
 }
 
 
+int tls_get_session_cache_status(void *tls_ctx, char *buf, size_t buflen)
+{
+	struct tls_data *data = tls_ctx;
+	struct tls_session_cache *cache = tls_session_cache;
+	int ret;
+
+	if (!data || !data->shared_session_cache || !cache)
+		return -1;
+
+	ret = os_snprintf(buf, buflen,
+			  "entries=%u\n"
+			  "max_entries=%u\n"
+			  "hits=%lu\n"
+			  "misses=%lu\n"
+			  "stored=%lu\n"
+			  "evicted=%lu\n"
+			  "expired=%lu\n"
+			  "loaded=%lu\n",
+			  cache->num_entries, cache->max_entries,
+			  cache->hits, cache->misses, cache->stored,
+			  cache->evicted, cache->expired, cache->loaded);
+	if (os_snprintf_error(buflen, ret))
+		return -1;
+	return ret;
+}
+
+
+int tls_get_cert_store_status(void *tls_ctx, char *buf, size_t buflen)
+{
+	struct tls_data *data = tls_ctx;
+	unsigned int certs, crls;
+	struct os_reltime now, age;
+	int ret;
+
+	if (!data)
+		return -1;
+
+	tls_cert_store_count(SSL_CTX_get_cert_store(data->ssl), &certs, &crls);
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &data->crl_last_reload, &age);
+
+	ret = os_snprintf(buf, buflen,
+			  "certificates=%u\n"
+			  "crls=%u\n"
+			  "crl_reload_interval=%u\n"
+			  "reloads=%u\n"
+			  "reload_failures=%u\n"
+			  "reload_pending=%d\n"
+			  "last_reload_age=%ld\n"
+			  "last_load_time=%ld.%06ld\n",
+			  certs, crls, data->crl_reload_interval,
+			  data->crl_reloads, data->crl_reload_failures,
+			  !!data->crl_reload,
+			  data->crl_reload_interval ? (long) age.sec : 0,
+			  (long) data->crl_load_time.sec,
+			  (long) data->crl_load_time.usec);
+	if (os_snprintf_error(buflen, ret))
+		return -1;
+	return ret;
+}
+
+
+int tls_get_ocsp_stapling_status(void *tls_ctx, char *buf, size_t buflen)
+{
+#ifdef HAVE_OCSP
+	struct tls_data *data = tls_ctx;
+	struct tls_ocsp_cache *cache = data ? data->ocsp_cache : NULL;
+	struct os_time now;
+	int ret;
+
+	if (!cache)
+		return -1;
+
+	os_get_time(&now);
+	ret = os_snprintf(buf, buflen,
+			  "file=%s\n"
+			  "response=%d\n"
+			  "response_len=%zu\n"
+			  "next_update=%ld\n"
+			  "valid=%d\n"
+			  "inotify=%d\n"
+			  "loads=%u\n"
+			  "load_failures=%u\n"
+			  "stapled=%u\n"
+			  "expired=%u\n",
+			  cache->file, !!cache->resp, cache->resp_len,
+			  (long) cache->next_update,
+			  cache->resp && (!cache->next_update ||
+					  now.sec <= cache->next_update),
+			  cache->inotify_fd >= 0,
+			  cache->loads, cache->load_failures,
+			  cache->stapled, cache->expired);
+	if (os_snprintf_error(buflen, ret))
+		return -1;
+	return ret;
+#else /* HAVE_OCSP */
+	return -1;
+#endif /* HAVE_OCSP */
+}
+
+
 int tls_get_tls_unique(struct tls_connection *conn, u8 *buf, size_t max_len)
 {
 	size_t len;
@@ -338,6 +338,8 @@ struct hostapd_hw_modes {
  * @parent_tsf: Time when the Beacon/Probe Response frame was received in terms
  * of TSF of the BSS specified by %tsf_bssid.
  * @tsf_bssid: The BSS that %parent_tsf TSF time refers to.
+ * @ie_index: Index of the IEs (ie_len) built during scan result processing;
+ *	driver wrappers leave this %NULL
  * @ie_len: length of the following IE field in octets
  * @beacon_ie_len: length of the following Beacon IE field in octets
  *
@@ -370,6 +372,7 @@ struct wpa_scan_res {
 	int snr;
 	u64 parent_tsf;
 	u8 tsf_bssid[ETH_ALEN];
+	struct ie_index *ie_index;
 	size_t ie_len;
 	size_t beacon_ie_len;
 	/* Followed by ie_len + beacon_ie_len octets of IE data */
@@ -2892,6 +2895,25 @@ struct wpa_driver_ops {
 	 */
 	 struct wpa_scan_results * (*get_scan_results2)(void *priv);
 
+	/**
+	 * get_scan_results_cb - Fetch the latest scan results one at a time
+	 * @priv: private driver interface data
+	 * @cb: Function to call for each scan result
+	 * @ctx: Context data for cb
+	 * Returns: Number of scan results delivered on success, -1 on failure
+	 *
+	 * This is an optional streaming alternative to get_scan_results2().
+	 * The scan result passed to cb is owned by the driver wrapper and is
+	 * valid only for the duration of the call. cb is called with
+	 * res == NULL if the driver had to restart the fetch, e.g., due to an
+	 * inconsistent dump; results delivered before that should be
+	 * discarded. cb must not issue driver commands.
+	 */
+	int (*get_scan_results_cb)(void *priv,
+				   void (*cb)(void *ctx,
+					      struct wpa_scan_res *res),
+				   void *ctx);
+
 	/**
 	 * set_country - Set country
 	 * @priv: Private driver interface data
@@ -17,8 +17,10 @@ void wpa_scan_results_free(struct wpa_scan_results *res)
 	if (res == NULL)
 		return;
 
-	for (i = 0; i < res->num; i++)
+	for (i = 0; i < res->num; i++) {
+		os_free(res->res[i]->ie_index);
 		os_free(res->res[i]);
+	}
 	os_free(res->res);
 	os_free(res);
 }
@@ -997,6 +997,113 @@ struct wpa_scan_results * wpa_driver_nl80211_get_scan_results(void *priv)
 }
 
 
+struct nl80211_bss_stream_arg {
+	struct wpa_driver_nl80211_data *drv;
+	struct nl80211_noise_info *noise;
+	void (*cb)(void *ctx, struct wpa_scan_res *res);
+	void *ctx;
+	struct wpa_scan_res assoc;
+	int assoc_seen;
+	unsigned int num;
+	size_t max_len;
+};
+
+static int bss_info_stream_handler(struct nl_msg *msg, void *arg)
+{
+	struct nl80211_bss_stream_arg *_arg = arg;
+	struct wpa_scan_res *r;
+	size_t len;
+
+	r = nl80211_parse_bss_info(_arg->drv, msg);
+	if (!r)
+		return NL_SKIP;
+
+	len = sizeof(*r) + r->ie_len + r->beacon_ie_len;
+	if (len > _arg->max_len)
+		_arg->max_len = len;
+	_arg->num++;
+	if (_arg->noise)
+		nl80211_update_scan_res_noise(r, _arg->noise);
+	if (r->flags & WPA_SCAN_ASSOCIATED) {
+		/* Commands cannot be sent while the dump is in progress, so
+		 * postpone the state mismatch check until the end. */
+		os_memcpy(&_arg->assoc, r, sizeof(*r));
+		_arg->assoc_seen = 1;
+	}
+	_arg->cb(_arg->ctx, r);
+	os_free(r);
+
+	return NL_SKIP;
+}
+
+
+/**
+ * wpa_driver_nl80211_get_scan_results_cb - Stream the latest scan results
+ * @priv: Pointer to private nl80211 data from wpa_driver_nl80211_init()
+ * @cb: Callback function to call for each BSS in the dump
+ * @ctx: Context data for cb
+ * Returns: Number of delivered BSSes on success, -1 on failure
+ *
+ * Each BSS is parsed from its own NL80211_CMD_GET_SCAN dump message and handed
+ * to cb before the next message is processed, so only a single scan result
+ * entry is allocated at a time.
+ */
+int wpa_driver_nl80211_get_scan_results_cb(
+	void *priv, void (*cb)(void *ctx, struct wpa_scan_res *res), void *ctx)
+{
+	struct i802_bss *bss = priv;
+	struct wpa_driver_nl80211_data *drv = bss->drv;
+	struct nl80211_noise_info info;
+	struct nl80211_bss_stream_arg arg;
+	struct nl_msg *msg;
+	int ret;
+	int count = 0;
+
+	os_memset(&arg, 0, sizeof(arg));
+	arg.drv = drv;
+	arg.cb = cb;
+	arg.ctx = ctx;
+	if (nl80211_get_noise_for_scan_results(drv, &info) == 0)
+		arg.noise = &info;
+
+try_again:
+	if (!(msg = nl80211_cmd_msg(drv->first_bss, NLM_F_DUMP,
+				    NL80211_CMD_GET_SCAN)))
+		return -1;
+
+	ret = send_and_recv_msgs(drv, msg, bss_info_stream_handler, &arg,
+				 NULL, NULL);
+	if (ret == -EAGAIN) {
+		count++;
+		if (count >= 10) {
+			wpa_printf(MSG_INFO,
+				   "nl80211: Failed to receive consistent scan result dump");
+		} else {
+			wpa_printf(MSG_DEBUG,
+				   "nl80211: Failed to receive consistent scan result dump - try again");
+			/* Tell the consumer to drop what it got so far */
+			cb(ctx, NULL);
+			arg.num = 0;
+			arg.assoc_seen = 0;
+			goto try_again;
+		}
+	}
+	if (ret != 0) {
+		wpa_printf(MSG_DEBUG, "nl80211: Scan result fetch failed: ret=%d (%s)",
+			   ret, strerror(-ret));
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG,
+		   "nl80211: Streamed scan results (%u BSSes, largest entry %zu bytes)",
+		   arg.num, arg.max_len);
+	if (arg.assoc_seen)
+		nl80211_check_bss_status(drv, &arg.assoc);
+
+	return arg.num;
+}
+
+
 struct nl80211_dump_scan_ctx {
 	struct wpa_driver_nl80211_data *drv;
 	int idx;
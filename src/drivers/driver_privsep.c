@@ -196,6 +196,7 @@ wpa_driver_privsep_get_scan_results2(void *priv)
 			os_free(r);
 			break;
 		}
+		r->ie_index = NULL;
 
 		results->res[results->num++] = r;
 	}
@@ -98,6 +98,15 @@ struct eap_server_erp_key {
 struct eapol_callbacks {
 	int (*get_eap_user)(void *ctx, const u8 *identity, size_t identity_len,
 			    int phase2, struct eap_user *user);
+	/* Optional; returns 1 if the lookup is pending and session_ctx will be
+	 * passed to the pending callback once get_eap_user() can be called
+	 * without blocking */
+	int (*prefetch_eap_user)(void *ctx, const u8 *identity,
+				 size_t identity_len, int phase2,
+				 void *session_ctx);
+	/* Optional; called when session_ctx is removed so that no pending
+	 * callback is made for it after that */
+	void (*cancel_eap_user_prefetch)(void *ctx, void *session_ctx);
 	const char * (*get_eap_req_id_text)(void *ctx, size_t *len);
 	void (*log_msg)(void *ctx, const char *msg);
 	int (*get_erp_send_reauth_start)(void *ctx);
@@ -184,6 +184,29 @@ int eap_user_get(struct eap_sm *sm, const u8 *identity, size_t identity_len,
 }
 
 
+/**
+ * eap_user_prefetch - Start fetching user information in the background
+ * @sm: Pointer to EAP state machine allocated with eap_server_sm_init()
+ * @identity: Identity (User-Name) of the user
+ * @identity_len: Length of identity in bytes
+ * @phase2: 0 = EAP phase1 user, 1 = EAP phase2 (tunneled) user
+ * Returns: 1 if the lookup is pending, 0 if eap_user_get() can be called
+ * without blocking
+ *
+ * When 1 is returned, eap_sm_pending_cb() is called for this state machine
+ * once the user information is available.
+ */
+int eap_user_prefetch(struct eap_sm *sm, const u8 *identity,
+		      size_t identity_len, int phase2)
+{
+	if (!sm || !sm->eapol_cb || !sm->eapol_cb->prefetch_eap_user)
+		return 0;
+
+	return sm->eapol_cb->prefetch_eap_user(sm->eapol_ctx, identity,
+					       identity_len, phase2, sm) == 1;
+}
+
+
 void eap_log_msg(struct eap_sm *sm, const char *fmt, ...)
 {
 	va_list ap;
@@ -1892,6 +1915,8 @@ void eap_server_sm_deinit(struct eap_sm *sm)
 	if (sm == NULL)
 		return;
 	wpa_printf(MSG_DEBUG, "EAP: Server state machine removed");
+	if (sm->eapol_cb && sm->eapol_cb->cancel_eap_user_prefetch)
+		sm->eapol_cb->cancel_eap_user_prefetch(sm->eapol_ctx, sm);
 	if (sm->m && sm->eap_method_priv)
 		sm->m->reset(sm, sm->eap_method_priv);
 	wpabuf_free(sm->eap_if.eapReqData);
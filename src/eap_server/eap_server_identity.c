@@ -132,11 +132,23 @@ static void eap_identity_process(struct eap_sm *sm, void *priv,
 	sm->identity = os_malloc(len ? len : 1);
 	if (sm->identity == NULL) {
 		data->state = FAILURE;
-	} else {
-		os_memcpy(sm->identity, pos, len);
-		sm->identity_len = len;
-		data->state = SUCCESS;
+		return;
+	}
+	os_memcpy(sm->identity, pos, len);
+	sm->identity_len = len;
+
+	/* Allow the user database lookup for the phase 1 identity to complete
+	 * in the background; this response is processed again once it is
+	 * done. */
+	if (sm->currentMethod == EAP_TYPE_IDENTITY &&
+	    eap_user_prefetch(sm, sm->identity, sm->identity_len, 0)) {
+		wpa_printf(MSG_DEBUG,
+			   "EAP-Identity: User lookup pending - wait for completion");
+		sm->method_pending = METHOD_PENDING_WAIT;
+		return;
 	}
+
+	data->state = SUCCESS;
 }
 
 
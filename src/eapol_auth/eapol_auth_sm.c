@@ -1027,6 +1027,30 @@ static int eapol_sm_get_eap_user(void *ctx, const u8 *identity,
 }
 
 
+static int eapol_sm_prefetch_eap_user(void *ctx, const u8 *identity,
+				      size_t identity_len, int phase2,
+				      void *session_ctx)
+{
+	struct eapol_state_machine *sm = ctx;
+
+	if (!sm->eapol->cb.prefetch_eap_user)
+		return 0;
+	return sm->eapol->cb.prefetch_eap_user(sm->eapol->conf.ctx, identity,
+					       identity_len, phase2,
+					       session_ctx);
+}
+
+
+static void eapol_sm_cancel_eap_user_prefetch(void *ctx, void *session_ctx)
+{
+	struct eapol_state_machine *sm = ctx;
+
+	if (sm->eapol->cb.cancel_eap_user_prefetch)
+		sm->eapol->cb.cancel_eap_user_prefetch(sm->eapol->conf.ctx,
+						       session_ctx);
+}
+
+
 static const char * eapol_sm_get_eap_req_id_text(void *ctx, size_t *len)
 {
 	struct eapol_state_machine *sm = ctx;
@@ -1067,6 +1091,8 @@ static int eapol_sm_erp_add_key(void *ctx, struct eap_server_erp_key *erp)
 static const struct eapol_callbacks eapol_cb =
 {
 	eapol_sm_get_eap_user,
+	eapol_sm_prefetch_eap_user,
+	eapol_sm_cancel_eap_user_prefetch,
 	eapol_sm_get_eap_req_id_text,
 	NULL,
 	eapol_sm_get_erp_send_reauth_start,
@@ -1243,6 +1269,8 @@ struct eapol_authenticator * eapol_auth_init(struct eapol_auth_config *conf,
 	eapol->cb.aaa_send = cb->aaa_send;
 	eapol->cb.finished = cb->finished;
 	eapol->cb.get_eap_user = cb->get_eap_user;
+	eapol->cb.prefetch_eap_user = cb->prefetch_eap_user;
+	eapol->cb.cancel_eap_user_prefetch = cb->cancel_eap_user_prefetch;
 	eapol->cb.sta_entry_alive = cb->sta_entry_alive;
 	eapol->cb.logger = cb->logger;
 	eapol->cb.set_port_authorized = cb->set_port_authorized;
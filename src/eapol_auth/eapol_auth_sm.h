@@ -49,6 +49,10 @@ struct eapol_auth_cb {
 			 int remediation);
 	int (*get_eap_user)(void *ctx, const u8 *identity, size_t identity_len,
 			    int phase2, struct eap_user *user);
+	int (*prefetch_eap_user)(void *ctx, const u8 *identity,
+				 size_t identity_len, int phase2,
+				 void *session_ctx);
+	void (*cancel_eap_user_prefetch)(void *ctx, void *session_ctx);
 	int (*sta_entry_alive)(void *ctx, const u8 *addr);
 	void (*logger)(void *ctx, const u8 *addr, eapol_logger_level level,
 		       const char *txt);
@@ -6,9 +6,12 @@
  * See README for more details.
  */
 
+#define WPA_DEBUG_MODULE WPA_DEBUG_MODULE_RADIUS
+
 #include "includes.h"
 
 #include "common.h"
+#include "list.h"
 #include "radius.h"
 #include "radius_client.h"
 #include "eloop.h"
@@ -33,14 +36,28 @@
  */
 #define RADIUS_CLIENT_MAX_FAILOVER 3
 
+/**
+ * RADIUS_CLIENT_MIN_WAIT - RADIUS client minimum adaptive retry timeout
+ *
+ * Lower limit for the first retry timeout in seconds when it is derived from
+ * the measured round-trip time of the server.
+ */
+#define RADIUS_CLIENT_MIN_WAIT 1
+
 /**
  * RADIUS_CLIENT_MAX_ENTRIES - RADIUS client maximum pending messages
  *
- * Maximum number of entries in retransmit list (oldest entries will be
- * removed, if this limit is exceeded).
+ * Default maximum number of entries in retransmit list (oldest entries will be
+ * removed, if this limit is exceeded). This can be changed with
+ * struct hostapd_radius_servers::max_pending.
  */
 #define RADIUS_CLIENT_MAX_ENTRIES 30
 
+/**
+ * RADIUS_CLIENT_MAX_SOCKS - RADIUS client maximum sockets per server
+ */
+#define RADIUS_CLIENT_MAX_SOCKS 16
+
 /**
  * RADIUS_CLIENT_NUM_FAILOVER - RADIUS client failover point
  *
@@ -142,9 +159,36 @@ struct radius_msg_list {
 	/* TODO: server config with failover to backup server(s) */
 
 	/**
-	 * next - Next message in the list
+	 * sock_idx - Index of the socket in the socket pool
+	 *
+	 * The request is in the identifier table of this socket and all
+	 * transmissions of it use this socket.
+	 */
+	size_t sock_idx;
+
+	/**
+	 * list - Entry in struct radius_client_data::msgs
 	 */
-	struct radius_msg_list *next;
+	struct dl_list list;
+};
+
+
+/**
+ * struct radius_client_sock - RADIUS client socket pool entry
+ *
+ * Each socket has its own local port, so the RADIUS Identifier of a pending
+ * request needs to be unique only among the requests sent on the same socket.
+ */
+struct radius_client_sock {
+	/**
+	 * sock - Socket connected to the current server or -1
+	 */
+	int sock;
+
+	/**
+	 * ids - Pending requests indexed by RADIUS Identifier
+	 */
+	struct radius_msg_list *ids[256];
 };
 
 
@@ -218,15 +262,43 @@ struct radius_client_data {
 	size_t num_acct_handlers;
 
 	/**
-	 * msgs - Pending outgoing RADIUS messages
+	 * auth_socks - Socket pool for RADIUS authentication messages
+	 *
+	 * The first entry is auth_sock and the others are additional sockets
+	 * connected to the same server.
+	 */
+	struct radius_client_sock *auth_socks;
+
+	/**
+	 * num_auth_socks - Number of entries in auth_socks
 	 */
-	struct radius_msg_list *msgs;
+	size_t num_auth_socks;
+
+	/**
+	 * acct_socks - Socket pool for RADIUS accounting messages
+	 */
+	struct radius_client_sock *acct_socks;
+
+	/**
+	 * num_acct_socks - Number of entries in acct_socks
+	 */
+	size_t num_acct_socks;
+
+	/**
+	 * msgs - Pending outgoing RADIUS messages, newest first
+	 */
+	struct dl_list msgs;
 
 	/**
 	 * num_msgs - Number of pending messages in the msgs list
 	 */
 	size_t num_msgs;
 
+	/**
+	 * max_msgs - Maximum number of pending messages
+	 */
+	size_t max_msgs;
+
 	/**
 	 * next_radius_identifier - Next RADIUS message identifier to use
 	 */
@@ -253,6 +325,8 @@ static int radius_client_init_acct(struct radius_client_data *radius);
 static int radius_client_init_auth(struct radius_client_data *radius);
 static void radius_client_auth_failover(struct radius_client_data *radius);
 static void radius_client_acct_failover(struct radius_client_data *radius);
+static int radius_client_disable_pmtu_discovery(int s);
+static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx);
 
 
 static void radius_client_msg_free(struct radius_msg_list *req)
@@ -262,6 +336,138 @@ static void radius_client_msg_free(struct radius_msg_list *req)
 }
 
 
+static struct radius_client_sock *
+radius_client_socks(struct radius_client_data *radius, RadiusType msg_type,
+		    size_t *num)
+{
+	if (msg_type == RADIUS_ACCT || msg_type == RADIUS_ACCT_INTERIM) {
+		*num = radius->num_acct_socks;
+		return radius->acct_socks;
+	}
+	*num = radius->num_auth_socks;
+	return radius->auth_socks;
+}
+
+
+static void radius_client_id_unlink(struct radius_client_data *radius,
+				    struct radius_msg_list *entry)
+{
+	struct radius_client_sock *socks;
+	size_t num;
+	u8 id = radius_msg_get_hdr(entry->msg)->identifier;
+
+	socks = radius_client_socks(radius, entry->msg_type, &num);
+	if (entry->sock_idx < num && socks[entry->sock_idx].ids[id] == entry)
+		socks[entry->sock_idx].ids[id] = NULL;
+}
+
+
+/* Remove a pending message from the retransmit list and free it */
+static void radius_client_msg_remove(struct radius_client_data *radius,
+				     struct radius_msg_list *entry)
+{
+	radius_client_id_unlink(radius, entry);
+	dl_list_del(&entry->list);
+	radius->num_msgs--;
+	radius_client_msg_free(entry);
+}
+
+
+/*
+ * Select a socket on which the identifier of the message is not in use and
+ * add the message to the identifier table of that socket. If the identifier
+ * is in use on all sockets, the pending message using it on the first socket
+ * is removed to avoid matching a new reply from the RADIUS server with an old
+ * request.
+ */
+static void radius_client_id_link(struct radius_client_data *radius,
+				  struct radius_msg_list *entry)
+{
+	struct radius_client_sock *socks;
+	size_t num, i;
+	u8 id = radius_msg_get_hdr(entry->msg)->identifier;
+
+	socks = radius_client_socks(radius, entry->msg_type, &num);
+	for (i = 0; i < num; i++) {
+		if (socks[i].sock >= 0 && !socks[i].ids[id])
+			break;
+	}
+	if (i == num) {
+		i = 0;
+		if (socks[0].ids[id]) {
+			hostapd_logger(radius->ctx, socks[0].ids[id]->addr,
+				       HOSTAPD_MODULE_RADIUS,
+				       HOSTAPD_LEVEL_DEBUG,
+				       "Removing pending RADIUS message, "
+				       "since its id (%d) is reused", id);
+			radius_client_msg_remove(radius, socks[0].ids[id]);
+		}
+	}
+
+	entry->sock_idx = i;
+	socks[i].ids[id] = entry;
+}
+
+
+static int radius_client_msg_sock(struct radius_client_data *radius,
+				  struct radius_msg_list *entry)
+{
+	struct radius_client_sock *socks;
+	size_t num;
+
+	socks = radius_client_socks(radius, entry->msg_type, &num);
+	if (entry->sock_idx >= num || socks[entry->sock_idx].sock < 0) {
+		/* The socket of the request was closed and could not be
+		 * reopened. Move the identifier to a socket that is used for
+		 * sending so that the reply can be matched. */
+		radius_client_id_unlink(radius, entry);
+		radius_client_id_link(radius, entry);
+	}
+	if (entry->sock_idx < num && socks[entry->sock_idx].sock >= 0)
+		return socks[entry->sock_idx].sock;
+	return entry->msg_type == RADIUS_AUTH ? radius->auth_sock :
+		radius->acct_sock;
+}
+
+
+/* First retransmission timeout in seconds based on the server RTT estimate */
+static int radius_client_first_wait(struct hostapd_radius_server *serv)
+{
+	int wait;
+
+	if (!serv || !serv->srtt)
+		return RADIUS_CLIENT_FIRST_WAIT;
+
+	wait = (serv->srtt + 4 * serv->rttvar + 999) / 1000;
+	if (wait < RADIUS_CLIENT_MIN_WAIT)
+		wait = RADIUS_CLIENT_MIN_WAIT;
+	if (wait > RADIUS_CLIENT_MAX_WAIT)
+		wait = RADIUS_CLIENT_MAX_WAIT;
+	return wait;
+}
+
+
+static void radius_client_update_rtt(struct hostapd_radius_server *serv,
+				     int rtt)
+{
+	int delta;
+
+	/* RFC 6298 smoothing with alpha = 1/8 and beta = 1/4 */
+	if (!serv->srtt) {
+		serv->srtt = rtt;
+		serv->rttvar = rtt / 2;
+	} else {
+		delta = serv->srtt - rtt;
+		if (delta < 0)
+			delta = -delta;
+		serv->rttvar = (3 * serv->rttvar + delta) / 4;
+		serv->srtt = (7 * serv->srtt + rtt) / 8;
+	}
+	if (!serv->srtt)
+		serv->srtt = 1;
+}
+
+
 /**
  * radius_client_register - Register a RADIUS client RX handler
  * @radius: RADIUS client context from radius_client_init()
@@ -427,6 +633,7 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 			   "RADIUS: No valid socket for retransmission");
 		return 1;
 	}
+	s = radius_client_msg_sock(radius, entry);
 
 	if (entry->msg_type == RADIUS_ACCT &&
 	    radius_msg_get_attr_ptr(entry->msg, RADIUS_ATTR_ACCT_DELAY_TIME,
@@ -441,7 +648,10 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 		 * changes.
 		 */
 		hdr = radius_msg_get_hdr(entry->msg);
+		radius_client_id_unlink(radius, entry);
 		hdr->identifier = radius_client_get_id(radius);
+		radius_client_id_link(radius, entry);
+		s = radius_client_msg_sock(radius, entry);
 
 		/* Update Acct-Delay-Time to show wait time in queue */
 		delay_time = now - entry->first_try;
@@ -492,18 +702,17 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 	struct radius_client_data *radius = eloop_ctx;
 	struct os_reltime now;
 	os_time_t first;
-	struct radius_msg_list *entry, *prev, *tmp;
+	struct radius_msg_list *entry, *next;
 	int auth_failover = 0, acct_failover = 0;
 	size_t prev_num_msgs;
-	int s;
+	int s, res;
 
-	entry = radius->msgs;
-	if (!entry)
+	if (dl_list_empty(&radius->msgs))
 		return;
 
 	os_get_reltime(&now);
 
-	while (entry) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (now.sec >= entry->next_try) {
 			s = entry->msg_type == RADIUS_AUTH ? radius->auth_sock :
 				radius->acct_sock;
@@ -516,7 +725,6 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 					auth_failover++;
 			}
 		}
-		entry = entry->next;
 	}
 
 	if (auth_failover)
@@ -525,42 +733,40 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 	if (acct_failover)
 		radius_client_acct_failover(radius);
 
-	entry = radius->msgs;
 	first = 0;
-
-	prev = NULL;
+	entry = dl_list_first(&radius->msgs, struct radius_msg_list, list);
 	while (entry) {
-		prev_num_msgs = radius->num_msgs;
-		if (now.sec >= entry->next_try &&
-		    radius_client_retransmit(radius, entry, now.sec)) {
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
-			continue;
-		}
+		next = dl_list_entry(entry->list.next, struct radius_msg_list,
+				     list);
+		if (&next->list == &radius->msgs)
+			next = NULL;
 
+		prev_num_msgs = radius->num_msgs;
+		res = now.sec >= entry->next_try &&
+			radius_client_retransmit(radius, entry, now.sec);
 		if (prev_num_msgs != radius->num_msgs) {
+			/* Other messages were removed, so the next pointer
+			 * may no longer be valid */
+			if (res)
+				radius_client_msg_remove(radius, entry);
 			wpa_printf(MSG_DEBUG,
 				   "RADIUS: Message removed from queue - restart from beginning");
-			entry = radius->msgs;
-			prev = NULL;
+			first = 0;
+			entry = dl_list_first(&radius->msgs,
+					      struct radius_msg_list, list);
 			continue;
 		}
 
-		if (first == 0 || entry->next_try < first)
+		if (res) {
+			radius_client_msg_remove(radius, entry);
+		} else if (first == 0 || entry->next_try < first) {
 			first = entry->next_try;
+		}
 
-		prev = entry;
-		entry = entry->next;
+		entry = next;
 	}
 
-	if (radius->msgs) {
+	if (!dl_list_empty(&radius->msgs)) {
 		if (first < now.sec)
 			first = now.sec;
 		eloop_cancel_timeout(radius_client_timer, radius, NULL);
@@ -588,7 +794,7 @@ static void radius_client_auth_failover(struct radius_client_data *radius)
 		       hostapd_ip_txt(&old->addr, abuf, sizeof(abuf)),
 		       old->port);
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_AUTH)
 			old->timeouts++;
 	}
@@ -617,7 +823,7 @@ static void radius_client_acct_failover(struct radius_client_data *radius)
 		       hostapd_ip_txt(&old->addr, abuf, sizeof(abuf)),
 		       old->port);
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_ACCT ||
 		    entry->msg_type == RADIUS_ACCT_INTERIM)
 			old->timeouts++;
@@ -641,12 +847,12 @@ static void radius_client_update_timeout(struct radius_client_data *radius)
 
 	eloop_cancel_timeout(radius_client_timer, radius, NULL);
 
-	if (radius->msgs == NULL) {
+	if (dl_list_empty(&radius->msgs)) {
 		return;
 	}
 
 	first = 0;
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (first == 0 || entry->next_try < first)
 			first = entry->next_try;
 	}
@@ -662,26 +868,24 @@ static void radius_client_update_timeout(struct radius_client_data *radius)
 }
 
 
-static void radius_client_list_add(struct radius_client_data *radius,
-				   struct radius_msg *msg,
-				   RadiusType msg_type,
-				   const u8 *shared_secret,
-				   size_t shared_secret_len, const u8 *addr)
+static struct radius_msg_list *
+radius_client_list_add(struct radius_client_data *radius,
+		       struct radius_msg *msg, RadiusType msg_type,
+		       const u8 *shared_secret, size_t shared_secret_len,
+		       const u8 *addr, struct hostapd_radius_server *serv)
 {
-	struct radius_msg_list *entry, *prev;
+	struct radius_msg_list *entry, *oldest;
 
 	if (eloop_terminated()) {
 		/* No point in adding entries to retransmit queue since event
 		 * loop has already been terminated. */
-		radius_msg_free(msg);
-		return;
+		return NULL;
 	}
 
 	entry = os_zalloc(sizeof(*entry));
 	if (entry == NULL) {
 		wpa_printf(MSG_INFO, "RADIUS: Failed to add packet into retransmit list");
-		radius_msg_free(msg);
-		return;
+		return NULL;
 	}
 
 	if (addr)
@@ -692,29 +896,26 @@ static void radius_client_list_add(struct radius_client_data *radius,
 	entry->shared_secret_len = shared_secret_len;
 	os_get_reltime(&entry->last_attempt);
 	entry->first_try = entry->last_attempt.sec;
-	entry->next_try = entry->first_try + RADIUS_CLIENT_FIRST_WAIT;
+	entry->next_try = entry->first_try + radius_client_first_wait(serv);
 	entry->attempts = 1;
 	entry->accu_attempts = 1;
-	entry->next_wait = RADIUS_CLIENT_FIRST_WAIT * 2;
+	entry->next_wait = radius_client_first_wait(serv) * 2;
 	if (entry->next_wait > RADIUS_CLIENT_MAX_WAIT)
 		entry->next_wait = RADIUS_CLIENT_MAX_WAIT;
-	entry->next = radius->msgs;
-	radius->msgs = entry;
+	dl_list_add(&radius->msgs, &entry->list);
+	radius->num_msgs++;
+	radius_client_id_link(radius, entry);
 	radius_client_update_timeout(radius);
 
-	if (radius->num_msgs >= RADIUS_CLIENT_MAX_ENTRIES) {
+	if (radius->num_msgs > radius->max_msgs) {
 		wpa_printf(MSG_INFO, "RADIUS: Removing the oldest un-ACKed packet due to retransmit list limits");
-		prev = NULL;
-		while (entry->next) {
-			prev = entry;
-			entry = entry->next;
-		}
-		if (prev) {
-			prev->next = NULL;
-			radius_client_msg_free(entry);
-		}
-	} else
-		radius->num_msgs++;
+		oldest = dl_list_last(&radius->msgs, struct radius_msg_list,
+				      list);
+		if (oldest && oldest != entry)
+			radius_client_msg_remove(radius, oldest);
+	}
+
+	return entry;
 }
 
 
@@ -753,6 +954,8 @@ int radius_client_send(struct radius_client_data *radius,
 	char *name;
 	int s, res;
 	struct wpabuf *buf;
+	struct hostapd_radius_server *serv;
+	struct radius_msg_list *entry;
 
 	if (msg_type == RADIUS_ACCT || msg_type == RADIUS_ACCT_INTERIM) {
 		if (conf->acct_server && radius->acct_sock < 0)
@@ -772,6 +975,7 @@ int radius_client_send(struct radius_client_data *radius,
 		name = "accounting";
 		s = radius->acct_sock;
 		conf->acct_server->requests++;
+		serv = conf->acct_server;
 	} else {
 		if (conf->auth_server && radius->auth_sock < 0)
 			radius_client_init_auth(radius);
@@ -790,6 +994,7 @@ int radius_client_send(struct radius_client_data *radius,
 		name = "authentication";
 		s = radius->auth_sock;
 		conf->auth_server->requests++;
+		serv = conf->auth_server;
 	}
 
 	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
@@ -798,14 +1003,18 @@ int radius_client_send(struct radius_client_data *radius,
 	if (conf->msg_dumps)
 		radius_msg_dump(msg);
 
+	entry = radius_client_list_add(radius, msg, msg_type, shared_secret,
+				       shared_secret_len, addr, serv);
+	if (entry)
+		s = radius_client_msg_sock(radius, entry);
+
 	buf = radius_msg_get_buf(msg);
 	res = send(s, wpabuf_head(buf), wpabuf_len(buf), 0);
+	if (!entry)
+		radius_msg_free(msg);
 	if (res < 0)
 		radius_client_handle_send_error(radius, s, msg_type);
 
-	radius_client_list_add(radius, msg, msg_type, shared_secret,
-			       shared_secret_len, addr);
-
 	return 0;
 }
 
@@ -823,7 +1032,9 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 	struct radius_hdr *hdr;
 	struct radius_rx_handler *handlers;
 	size_t num_handlers, i;
-	struct radius_msg_list *req, *prev_req;
+	struct radius_msg_list *req;
+	struct radius_client_sock *socks;
+	size_t num_socks;
 	struct os_reltime now;
 	struct hostapd_radius_server *rconf;
 	int invalid_authenticator = 0;
@@ -886,20 +1097,15 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		break;
 	}
 
-	prev_req = NULL;
-	req = radius->msgs;
-	while (req) {
-		/* TODO: also match by src addr:port of the packet when using
-		 * alternative RADIUS servers (?) */
-		if ((req->msg_type == msg_type ||
-		     (req->msg_type == RADIUS_ACCT_INTERIM &&
-		      msg_type == RADIUS_ACCT)) &&
-		    radius_msg_get_hdr(req->msg)->identifier ==
-		    hdr->identifier)
+	/* TODO: also match by src addr:port of the packet when using
+	 * alternative RADIUS servers (?) */
+	req = NULL;
+	socks = radius_client_socks(radius, msg_type, &num_socks);
+	for (i = 0; i < num_socks; i++) {
+		if (socks[i].sock == sock) {
+			req = socks[i].ids[hdr->identifier];
 			break;
-
-		prev_req = req;
-		req = req->next;
+		}
 	}
 
 	if (req == NULL) {
@@ -920,12 +1126,15 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		       "request, round trip time %d.%02d sec",
 		       roundtrip / 100, roundtrip % 100);
 	rconf->round_trip_time = roundtrip;
+	/* Only use unambiguous samples (Karn's algorithm) */
+	if (req->accu_attempts == 1)
+		radius_client_update_rtt(
+			rconf, (now.sec - req->last_attempt.sec) * 1000 +
+			(now.usec - req->last_attempt.usec) / 1000);
 
 	/* Remove ACKed RADIUS packet from retransmit list */
-	if (prev_req)
-		prev_req->next = req->next;
-	else
-		radius->msgs = req->next;
+	radius_client_id_unlink(radius, req);
+	dl_list_del(&req->list);
 	radius->num_msgs--;
 
 	for (i = 0; i < num_handlers; i++) {
@@ -971,41 +1180,13 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
  * @radius: RADIUS client context from radius_client_init()
  * Returns: Allocated identifier
  *
- * This function is used to fetch a unique (among pending requests) identifier
- * for a new RADIUS message.
+ * This function is used to fetch an identifier for a new RADIUS message. The
+ * identifier is made unique among pending requests when the message is sent
+ * by selecting a socket from the socket pool on which it is not in use.
  */
 u8 radius_client_get_id(struct radius_client_data *radius)
 {
-	struct radius_msg_list *entry, *prev, *_remove;
-	u8 id = radius->next_radius_identifier++;
-
-	/* remove entries with matching id from retransmit list to avoid
-	 * using new reply from the RADIUS server with an old request */
-	entry = radius->msgs;
-	prev = NULL;
-	while (entry) {
-		if (radius_msg_get_hdr(entry->msg)->identifier == id) {
-			hostapd_logger(radius->ctx, entry->addr,
-				       HOSTAPD_MODULE_RADIUS,
-				       HOSTAPD_LEVEL_DEBUG,
-				       "Removing pending RADIUS message, "
-				       "since its id (%d) is reused", id);
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-			_remove = entry;
-		} else {
-			_remove = NULL;
-			prev = entry;
-		}
-		entry = entry->next;
-
-		if (_remove)
-			radius_client_msg_free(_remove);
-	}
-
-	return id;
+	return radius->next_radius_identifier++;
 }
 
 
@@ -1016,32 +1197,18 @@ u8 radius_client_get_id(struct radius_client_data *radius)
  */
 void radius_client_flush(struct radius_client_data *radius, int only_auth)
 {
-	struct radius_msg_list *entry, *prev, *tmp;
+	struct radius_msg_list *entry, *tmp;
 
 	if (!radius)
 		return;
 
-	prev = NULL;
-	entry = radius->msgs;
-
-	while (entry) {
-		if (!only_auth || entry->msg_type == RADIUS_AUTH) {
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
-		} else {
-			prev = entry;
-			entry = entry->next;
-		}
+	dl_list_for_each_safe(entry, tmp, &radius->msgs,
+			      struct radius_msg_list, list) {
+		if (!only_auth || entry->msg_type == RADIUS_AUTH)
+			radius_client_msg_remove(radius, entry);
 	}
 
-	if (radius->msgs == NULL)
+	if (dl_list_empty(&radius->msgs))
 		eloop_cancel_timeout(radius_client_timer, radius, NULL);
 }
 
@@ -1055,7 +1222,7 @@ static void radius_client_update_acct_msgs(struct radius_client_data *radius,
 	if (!radius)
 		return;
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_ACCT) {
 			entry->shared_secret = shared_secret;
 			entry->shared_secret_len = shared_secret_len;
@@ -1066,6 +1233,69 @@ static void radius_client_update_acct_msgs(struct radius_client_data *radius,
 }
 
 
+static void radius_client_close_socks(struct radius_client_sock *socks,
+				      size_t num)
+{
+	size_t i;
+
+	if (!socks)
+		return;
+
+	/* The first socket is owned by the caller */
+	socks[0].sock = -1;
+	for (i = 1; i < num; i++) {
+		if (socks[i].sock < 0)
+			continue;
+		eloop_unregister_read_sock(socks[i].sock);
+		close(socks[i].sock);
+		socks[i].sock = -1;
+	}
+}
+
+
+static void radius_client_open_socks(struct radius_client_data *radius,
+				     int auth, int sel_sock,
+				     const struct sockaddr *addr,
+				     socklen_t addrlen,
+				     const struct sockaddr *cl_addr,
+				     socklen_t cl_addrlen)
+{
+	RadiusType msg_type = auth ? RADIUS_AUTH : RADIUS_ACCT;
+	struct radius_client_sock *socks;
+	size_t num, i;
+	int s;
+
+	socks = radius_client_socks(radius, msg_type, &num);
+	radius_client_close_socks(socks, num);
+	if (!socks)
+		return;
+	socks[0].sock = sel_sock;
+
+	for (i = 1; i < num; i++) {
+		s = socket(addr->sa_family, SOCK_DGRAM, 0);
+		if (s < 0) {
+			wpa_printf(MSG_INFO, "RADIUS: socket[pool]: %s",
+				   strerror(errno));
+			break;
+		}
+		if (addr->sa_family == AF_INET)
+			radius_client_disable_pmtu_discovery(s);
+		if ((cl_addr && bind(s, cl_addr, cl_addrlen) < 0) ||
+		    connect(s, addr, addrlen) < 0 ||
+		    eloop_register_read_sock(s, radius_client_receive, radius,
+					     (void *) msg_type)) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS: Could not set up additional %s socket: %s",
+				   auth ? "authentication" : "accounting",
+				   strerror(errno));
+			close(s);
+			break;
+		}
+		socks[i].sock = s;
+	}
+}
+
+
 static int
 radius_change_server(struct radius_client_data *radius,
 		     struct hostapd_radius_server *nserv,
@@ -1076,8 +1306,8 @@ radius_change_server(struct radius_client_data *radius,
 #ifdef CONFIG_IPV6
 	struct sockaddr_in6 serv6, claddr6;
 #endif /* CONFIG_IPV6 */
-	struct sockaddr *addr, *cl_addr;
-	socklen_t addrlen, claddrlen;
+	struct sockaddr *addr, *cl_addr = NULL;
+	socklen_t addrlen, claddrlen = 0;
 	char abuf[50];
 	int sel_sock;
 	struct radius_msg_list *entry;
@@ -1120,16 +1350,21 @@ radius_change_server(struct radius_client_data *radius,
 	}
 
 	/* Reset retry counters */
-	for (entry = radius->msgs; oserv && entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
+		if (!oserv)
+			break;
 		if ((auth && entry->msg_type != RADIUS_AUTH) ||
 		    (!auth && entry->msg_type != RADIUS_ACCT))
 			continue;
-		entry->next_try = entry->first_try + RADIUS_CLIENT_FIRST_WAIT;
+		entry->next_try = entry->first_try +
+			radius_client_first_wait(nserv);
 		entry->attempts = 0;
-		entry->next_wait = RADIUS_CLIENT_FIRST_WAIT * 2;
+		entry->next_wait = radius_client_first_wait(nserv) * 2;
+		if (entry->next_wait > RADIUS_CLIENT_MAX_WAIT)
+			entry->next_wait = RADIUS_CLIENT_MAX_WAIT;
 	}
 
-	if (radius->msgs) {
+	if (!dl_list_empty(&radius->msgs)) {
 		eloop_cancel_timeout(radius_client_timer, radius, NULL);
 		eloop_register_timeout(RADIUS_CLIENT_FIRST_WAIT, 0,
 				       radius_client_timer, radius, NULL);
@@ -1210,6 +1445,9 @@ radius_change_server(struct radius_client_data *radius,
 		return -1;
 	}
 
+	radius_client_open_socks(radius, auth, sel_sock, addr, addrlen,
+				 cl_addr, claddrlen);
+
 #ifndef CONFIG_NATIVE_WINDOWS
 	switch (nserv->addr.af) {
 	case AF_INET:
@@ -1306,6 +1544,7 @@ static int radius_client_disable_pmtu_discovery(int s)
 static void radius_close_auth_sockets(struct radius_client_data *radius)
 {
 	radius->auth_sock = -1;
+	radius_client_close_socks(radius->auth_socks, radius->num_auth_socks);
 
 	if (radius->auth_serv_sock >= 0) {
 		eloop_unregister_read_sock(radius->auth_serv_sock);
@@ -1325,6 +1564,7 @@ static void radius_close_auth_sockets(struct radius_client_data *radius)
 static void radius_close_acct_sockets(struct radius_client_data *radius)
 {
 	radius->acct_sock = -1;
+	radius_client_close_socks(radius->acct_socks, radius->num_acct_socks);
 
 	if (radius->acct_serv_sock >= 0) {
 		eloop_unregister_read_sock(radius->acct_serv_sock);
@@ -1467,6 +1707,7 @@ struct radius_client_data *
 radius_client_init(void *ctx, struct hostapd_radius_servers *conf)
 {
 	struct radius_client_data *radius;
+	size_t num_socks, i;
 
 	radius = os_zalloc(sizeof(struct radius_client_data));
 	if (radius == NULL)
@@ -1477,6 +1718,22 @@ radius_client_init(void *ctx, struct hostapd_radius_servers *conf)
 	radius->auth_serv_sock = radius->acct_serv_sock =
 		radius->auth_serv_sock6 = radius->acct_serv_sock6 =
 		radius->auth_sock = radius->acct_sock = -1;
+	dl_list_init(&radius->msgs);
+	radius->max_msgs = conf->max_pending > 0 ? conf->max_pending :
+		RADIUS_CLIENT_MAX_ENTRIES;
+
+	num_socks = conf->num_client_socks > 0 ? conf->num_client_socks : 1;
+	if (num_socks > RADIUS_CLIENT_MAX_SOCKS)
+		num_socks = RADIUS_CLIENT_MAX_SOCKS;
+	radius->auth_socks = os_calloc(num_socks, sizeof(*radius->auth_socks));
+	radius->acct_socks = os_calloc(num_socks, sizeof(*radius->acct_socks));
+	if (!radius->auth_socks || !radius->acct_socks) {
+		radius_client_deinit(radius);
+		return NULL;
+	}
+	for (i = 0; i < num_socks; i++)
+		radius->auth_socks[i].sock = radius->acct_socks[i].sock = -1;
+	radius->num_auth_socks = radius->num_acct_socks = num_socks;
 
 	if (conf->auth_server && radius_client_init_auth(radius)) {
 		radius_client_deinit(radius);
@@ -1512,6 +1769,8 @@ void radius_client_deinit(struct radius_client_data *radius)
 	eloop_cancel_timeout(radius_retry_primary_timer, radius, NULL);
 
 	radius_client_flush(radius, 0);
+	os_free(radius->auth_socks);
+	os_free(radius->acct_socks);
 	os_free(radius->auth_handlers);
 	os_free(radius->acct_handlers);
 	os_free(radius);
@@ -1531,11 +1790,10 @@ void radius_client_deinit(struct radius_client_data *radius)
 void radius_client_flush_auth(struct radius_client_data *radius,
 			      const u8 *addr)
 {
-	struct radius_msg_list *entry, *prev, *tmp;
+	struct radius_msg_list *entry, *tmp;
 
-	prev = NULL;
-	entry = radius->msgs;
-	while (entry) {
+	dl_list_for_each_safe(entry, tmp, &radius->msgs,
+			      struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_AUTH &&
 		    os_memcmp(entry->addr, addr, ETH_ALEN) == 0) {
 			hostapd_logger(radius->ctx, addr,
@@ -1543,21 +1801,8 @@ void radius_client_flush_auth(struct radius_client_data *radius,
 				       HOSTAPD_LEVEL_DEBUG,
 				       "Removing pending RADIUS authentication"
 				       " message for removed client");
-
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
-			continue;
+			radius_client_msg_remove(radius, entry);
 		}
-
-		prev = entry;
-		entry = entry->next;
 	}
 }
 
@@ -1571,7 +1816,8 @@ static int radius_client_dump_auth_server(char *buf, size_t buflen,
 	char abuf[50];
 
 	if (cli) {
-		for (msg = cli->msgs; msg; msg = msg->next) {
+		dl_list_for_each(msg, &cli->msgs, struct radius_msg_list,
+				 list) {
 			if (msg->msg_type == RADIUS_AUTH)
 				pending++;
 		}
@@ -1620,7 +1866,8 @@ static int radius_client_dump_acct_server(char *buf, size_t buflen,
 	char abuf[50];
 
 	if (cli) {
-		for (msg = cli->msgs; msg; msg = msg->next) {
+		dl_list_for_each(msg, &cli->msgs, struct radius_msg_list,
+				 list) {
 			if (msg->msg_type == RADIUS_ACCT ||
 			    msg->msg_type == RADIUS_ACCT_INTERIM)
 				pending++;
@@ -1701,9 +1948,106 @@ int radius_client_get_mib(struct radius_client_data *radius, char *buf,
 }
 
 
+/* Replace the socket pool of one message type with a pool of a different size
+ * and move the pending requests of that type to the new pool */
+static int radius_client_resize_socks(struct radius_client_data *radius,
+				      int auth, size_t num)
+{
+	struct radius_client_sock *socks, **pool;
+	size_t *pool_num, i;
+	struct radius_msg_list *entry;
+
+	pool = auth ? &radius->auth_socks : &radius->acct_socks;
+	pool_num = auth ? &radius->num_auth_socks : &radius->num_acct_socks;
+	if (*pool_num == num)
+		return 0;
+
+	socks = os_calloc(num, sizeof(*socks));
+	if (!socks)
+		return -1;
+	for (i = 0; i < num; i++)
+		socks[i].sock = -1;
+	radius_client_close_socks(*pool, *pool_num);
+	os_free(*pool);
+	*pool = socks;
+	*pool_num = num;
+
+	wpa_printf(MSG_DEBUG, "RADIUS: Use %u %s socket(s)",
+		   (unsigned int) num, auth ? "authentication" : "accounting");
+	if (auth && radius->auth_sock >= 0)
+		radius_client_init_auth(radius);
+	else if (!auth && radius->acct_sock >= 0)
+		radius_client_init_acct(radius);
+	if (auth)
+		socks[0].sock = radius->auth_sock;
+	else
+		socks[0].sock = radius->acct_sock;
+
+	/* Oldest first, so that the newest request keeps an identifier that
+	 * is used on all sockets of the new pool */
+	dl_list_for_each_reverse(entry, &radius->msgs, struct radius_msg_list,
+				 list) {
+		if ((entry->msg_type == RADIUS_AUTH) == !!auth)
+			radius_client_id_link(radius, entry);
+	}
+
+	return 0;
+}
+
+
 void radius_client_reconfig(struct radius_client_data *radius,
 			    struct hostapd_radius_servers *conf)
 {
-	if (radius)
+	size_t num_socks;
+
+	if (radius) {
 		radius->conf = conf;
+		radius->max_msgs = conf->max_pending > 0 ? conf->max_pending :
+			RADIUS_CLIENT_MAX_ENTRIES;
+
+		num_socks = conf->num_client_socks > 0 ?
+			conf->num_client_socks : 1;
+		if (num_socks > RADIUS_CLIENT_MAX_SOCKS)
+			num_socks = RADIUS_CLIENT_MAX_SOCKS;
+		if (radius_client_resize_socks(radius, 1, num_socks) < 0 ||
+		    radius_client_resize_socks(radius, 0, num_socks) < 0)
+			wpa_printf(MSG_INFO,
+				   "RADIUS: Could not change the number of client sockets");
+	}
 }
+
+
+#ifdef CONFIG_MODULE_TESTS
+
+static void radius_client_receive_socks(struct radius_client_data *radius,
+					struct radius_client_sock *socks,
+					size_t num, RadiusType msg_type)
+{
+	size_t i;
+	u8 c;
+
+	for (i = 0; i < num; i++) {
+		while (socks[i].sock >= 0 &&
+		       recv(socks[i].sock, &c, 1, MSG_PEEK | MSG_DONTWAIT) >= 0)
+			radius_client_receive(socks[i].sock, radius,
+					      (void *) msg_type);
+	}
+}
+
+
+/**
+ * radius_client_receive_pending - Process already received RADIUS responses
+ * @radius: RADIUS client context from radius_client_init()
+ *
+ * Module tests run from within an event loop callback, so they cannot wait
+ * for the event loop to call the socket handlers.
+ */
+void radius_client_receive_pending(struct radius_client_data *radius)
+{
+	radius_client_receive_socks(radius, radius->auth_socks,
+				    radius->num_auth_socks, RADIUS_AUTH);
+	radius_client_receive_socks(radius, radius->acct_socks,
+				    radius->num_acct_socks, RADIUS_ACCT);
+}
+
+#endif /* CONFIG_MODULE_TESTS */
@@ -58,6 +58,19 @@ struct hostapd_radius_server {
 	 */
 	int round_trip_time;
 
+	/**
+	 * srtt - Smoothed round-trip time in milliseconds (0 = not measured)
+	 *
+	 * This is used to set the first retransmission timeout for requests
+	 * to this server.
+	 */
+	int srtt;
+
+	/**
+	 * rttvar - Round-trip time variation in milliseconds
+	 */
+	int rttvar;
+
 	/**
 	 * requests - radiusAuthClientAccessRequests or radiusAccClientRequests
 	 */
@@ -174,6 +187,23 @@ struct hostapd_radius_servers {
 	 * force_client_addr - Whether to force client (local) address
 	 */
 	int force_client_addr;
+
+	/**
+	 * num_client_socks - Number of sockets to use per server
+	 *
+	 * Each socket has its own local port and RADIUS Identifier space, so
+	 * up to 256 requests per socket can be pending at the same time.
+	 * 0 means one socket.
+	 */
+	int num_client_socks;
+
+	/**
+	 * max_pending - Maximum number of pending requests
+	 *
+	 * The oldest pending request is dropped when this limit is reached.
+	 * 0 means the default limit of 30.
+	 */
+	int max_pending;
 };
 
 
@@ -258,5 +288,8 @@ int radius_client_get_mib(struct radius_client_data *radius, char *buf,
 			  size_t buflen);
 void radius_client_reconfig(struct radius_client_data *radius,
 			    struct hostapd_radius_servers *conf);
+#ifdef CONFIG_MODULE_TESTS
+void radius_client_receive_pending(struct radius_client_data *radius);
+#endif /* CONFIG_MODULE_TESTS */
 
 #endif /* RADIUS_CLIENT_H */
@@ -6,6 +6,8 @@
  * See README for more details.
  */
 
+#define WPA_DEBUG_MODULE WPA_DEBUG_MODULE_RADIUS
+
 #include "includes.h"
 #include <net/if.h>
 #ifdef CONFIG_SQLITE
@@ -31,10 +33,15 @@
 #define RADIUS_SESSION_MAINTAIN 5
 
 /**
- * RADIUS_MAX_SESSION - Maximum number of active sessions
+ * RADIUS_MAX_SESSION - Default maximum number of active sessions
  */
 #define RADIUS_MAX_SESSION 1000
 
+/**
+ * RADIUS_SESSION_HASH_MAX - Maximum number of session hash buckets
+ */
+#define RADIUS_SESSION_HASH_MAX 65536
+
 static const struct eapol_callbacks radius_server_eapol_cb;
 
 struct radius_client;
@@ -67,7 +74,8 @@ struct radius_server_counters {
  * struct radius_session - Internal RADIUS server data for a session
  */
 struct radius_session {
-	struct radius_session *next;
+	struct dl_list list; /* radius_client::sessions */
+	struct radius_session *hnext; /* radius_server_data::sess_hash */
 	struct radius_client *client;
 	struct radius_server_data *server;
 	unsigned int sess_id;
@@ -95,6 +103,24 @@ struct radius_session {
 	u32 t_c_timestamp; /* Last read T&C timestamp from user DB */
 };
 
+/**
+ * struct radius_deferred_req - Access-Request waiting for a user lookup
+ *
+ * A new session is not created until the user entry for the User-Name
+ * attribute is available. If the lookup was started asynchronously with the
+ * prefetch_eap_user() callback, the request is stored here and processed
+ * again from radius_server_eap_pending_cb().
+ */
+struct radius_deferred_req {
+	struct dl_list list;
+	struct radius_client *client;
+	struct radius_msg *msg;
+	char *from_addr;
+	int from_port;
+	struct sockaddr_storage from;
+	socklen_t fromlen;
+};
+
 /**
  * struct radius_client - Internal RADIUS server data for a client
  */
@@ -108,7 +134,7 @@ struct radius_client {
 #endif /* CONFIG_IPV6 */
 	char *shared_secret;
 	int shared_secret_len;
-	struct radius_session *sessions;
+	struct dl_list sessions; /* struct radius_session */
 	struct radius_server_counters counters;
 
 	u8 next_dac_identifier;
@@ -156,10 +182,39 @@ struct radius_server_data {
 	 */
 	int num_sess;
 
+	/**
+	 * max_sess - Maximum number of active sessions
+	 */
+	int max_sess;
+
+	/**
+	 * sess_hash - Active sessions hashed by session identifier
+	 *
+	 * The session identifier is used as the State attribute value, so
+	 * this allows requests continuing an authentication exchange to be
+	 * mapped to their session without walking through all sessions.
+	 */
+	struct radius_session **sess_hash;
+
+	/**
+	 * sess_hash_mask - Number of sess_hash buckets minus one
+	 */
+	unsigned int sess_hash_mask;
+
 	const char *erp_domain;
 
 	struct dl_list erp_keys; /* struct eap_server_erp_key */
 
+	/**
+	 * deferred - Requests waiting for a user lookup to complete
+	 */
+	struct dl_list deferred; /* struct radius_deferred_req */
+
+	/**
+	 * num_deferred - Number of entries in the deferred list
+	 */
+	unsigned int num_deferred;
+
 	/**
 	 * ipv6 - Whether to enable IPv6 support in the RADIUS server
 	 */
@@ -194,6 +249,22 @@ struct radius_server_data {
 	int (*get_eap_user)(void *ctx, const u8 *identity, size_t identity_len,
 			    int phase2, struct eap_user *user);
 
+	/**
+	 * prefetch_eap_user - Optional callback for starting a user lookup
+	 *
+	 * See struct radius_server_conf::prefetch_eap_user.
+	 */
+	int (*prefetch_eap_user)(void *ctx, const u8 *identity,
+				 size_t identity_len, int phase2,
+				 void *session_ctx);
+
+	/**
+	 * cancel_eap_user_prefetch - Optional callback for stopping lookups
+	 *
+	 * See struct radius_server_conf::cancel_eap_user_prefetch.
+	 */
+	void (*cancel_eap_user_prefetch)(void *ctx, void *session_ctx);
+
 	/**
 	 * eap_req_id_text - Optional data for EAP-Request/Identity
 	 *
@@ -367,27 +438,56 @@ radius_server_get_client(struct radius_server_data *data, struct in_addr *addr,
 }
 
 
+static struct radius_session **
+radius_server_sess_bucket(struct radius_server_data *data,
+			  unsigned int sess_id)
+{
+	/* Session identifiers are allocated sequentially, so the low order
+	 * bits distribute them evenly over the buckets. */
+	return &data->sess_hash[sess_id & data->sess_hash_mask];
+}
+
+
 static struct radius_session *
-radius_server_get_session(struct radius_client *client, unsigned int sess_id)
+radius_server_get_session(struct radius_server_data *data,
+			  struct radius_client *client, unsigned int sess_id)
 {
-	struct radius_session *sess = client->sessions;
+	struct radius_session *sess;
 
+	sess = *radius_server_sess_bucket(data, sess_id);
 	while (sess) {
-		if (sess->sess_id == sess_id) {
+		if (sess->sess_id == sess_id && sess->client == client)
 			break;
-		}
-		sess = sess->next;
+		sess = sess->hnext;
 	}
 
 	return sess;
 }
 
 
+static void radius_server_sess_hash_del(struct radius_server_data *data,
+					struct radius_session *sess)
+{
+	struct radius_session **pos;
+
+	pos = radius_server_sess_bucket(data, sess->sess_id);
+	while (*pos) {
+		if (*pos == sess) {
+			*pos = sess->hnext;
+			break;
+		}
+		pos = &(*pos)->hnext;
+	}
+}
+
+
 static void radius_server_session_free(struct radius_server_data *data,
 				       struct radius_session *sess)
 {
 	eloop_cancel_timeout(radius_server_session_timeout, data, sess);
 	eloop_cancel_timeout(radius_server_session_remove_timeout, data, sess);
+	dl_list_del(&sess->list);
+	radius_server_sess_hash_del(data, sess);
 	eap_server_sm_deinit(sess->eap);
 	radius_msg_free(sess->last_msg);
 	os_free(sess->last_from_addr);
@@ -399,39 +499,13 @@ static void radius_server_session_free(struct radius_server_data *data,
 }
 
 
-static void radius_server_session_remove(struct radius_server_data *data,
-					 struct radius_session *sess)
-{
-	struct radius_client *client = sess->client;
-	struct radius_session *session, *prev;
-
-	eloop_cancel_timeout(radius_server_session_remove_timeout, data, sess);
-
-	prev = NULL;
-	session = client->sessions;
-	while (session) {
-		if (session == sess) {
-			if (prev == NULL) {
-				client->sessions = sess->next;
-			} else {
-				prev->next = sess->next;
-			}
-			radius_server_session_free(data, sess);
-			break;
-		}
-		prev = session;
-		session = session->next;
-	}
-}
-
-
 static void radius_server_session_remove_timeout(void *eloop_ctx,
 						 void *timeout_ctx)
 {
 	struct radius_server_data *data = eloop_ctx;
 	struct radius_session *sess = timeout_ctx;
 	RADIUS_DEBUG("Removing completed session 0x%x", sess->sess_id);
-	radius_server_session_remove(data, sess);
+	radius_server_session_free(data, sess);
 }
 
 
@@ -441,7 +515,7 @@ static void radius_server_session_timeout(void *eloop_ctx, void *timeout_ctx)
 	struct radius_session *sess = timeout_ctx;
 
 	RADIUS_DEBUG("Timing out authentication session 0x%x", sess->sess_id);
-	radius_server_session_remove(data, sess);
+	radius_server_session_free(data, sess);
 }
 
 
@@ -449,9 +523,9 @@ static struct radius_session *
 radius_server_new_session(struct radius_server_data *data,
 			  struct radius_client *client)
 {
-	struct radius_session *sess;
+	struct radius_session *sess, **bucket;
 
-	if (data->num_sess >= RADIUS_MAX_SESSION) {
+	if (data->num_sess >= data->max_sess) {
 		RADIUS_DEBUG("Maximum number of existing session - no room "
 			     "for a new session");
 		return NULL;
@@ -464,8 +538,10 @@ radius_server_new_session(struct radius_server_data *data,
 	sess->server = data;
 	sess->client = client;
 	sess->sess_id = data->next_sess_id++;
-	sess->next = client->sessions;
-	client->sessions = sess;
+	dl_list_add(&client->sessions, &sess->list);
+	bucket = radius_server_sess_bucket(data, sess->sess_id);
+	sess->hnext = *bucket;
+	*bucket = sess;
 	eloop_register_timeout(RADIUS_SESSION_TIMEOUT, 0,
 			       radius_server_session_timeout, data, sess);
 	data->num_sess++;
@@ -613,14 +689,14 @@ radius_server_get_new_session(struct radius_server_data *data,
 
 	sess->username = os_malloc(user_len * 4 + 1);
 	if (sess->username == NULL) {
-		radius_server_session_remove(data, sess);
+		radius_server_session_free(data, sess);
 		return NULL;
 	}
 	printf_encode(sess->username, user_len * 4 + 1, user, user_len);
 
 	sess->nas_ip = os_strdup(from_addr);
 	if (sess->nas_ip == NULL) {
-		radius_server_session_remove(data, sess);
+		radius_server_session_free(data, sess);
 		return NULL;
 	}
 
@@ -648,7 +724,7 @@ radius_server_get_new_session(struct radius_server_data *data,
 	if (sess->eap == NULL) {
 		RADIUS_DEBUG("Failed to initialize EAP state machine for the "
 			     "new session");
-		radius_server_session_remove(data, sess);
+		radius_server_session_free(data, sess);
 		return NULL;
 	}
 	sess->eap_if = eap_get_interface(sess->eap);
@@ -1339,6 +1415,97 @@ static void radius_server_hs20_t_c_check(struct radius_session *sess,
 }
 
 
+static void radius_server_free_deferred(struct radius_server_data *data,
+					struct radius_deferred_req *req)
+{
+	/* Stop a pending lookup and release a result that the request did not
+	 * use, so that the freed pointer is not matched later */
+	if (data->cancel_eap_user_prefetch)
+		data->cancel_eap_user_prefetch(data->conf_ctx, req);
+	radius_msg_free(req->msg);
+	os_free(req->from_addr);
+	os_free(req);
+}
+
+
+static void radius_server_flush_deferred(struct radius_server_data *data)
+{
+	struct radius_deferred_req *req;
+
+	while ((req = dl_list_first(&data->deferred,
+				    struct radius_deferred_req, list))) {
+		dl_list_del(&req->list);
+		radius_server_free_deferred(data, req);
+	}
+	data->num_deferred = 0;
+}
+
+
+/*
+ * Returns: 0 if the request is to be processed now, 1 if it was stored to wait
+ * for a pending user lookup (msg is then owned by the deferred entry), or -1
+ * if the request is to be dropped as a retransmission of a stored request.
+ */
+static int radius_server_defer_request(struct radius_server_data *data,
+				       struct radius_client *client,
+				       struct radius_msg *msg,
+				       struct sockaddr *from,
+				       socklen_t fromlen,
+				       const char *from_addr, int from_port)
+{
+	struct radius_deferred_req *req;
+	struct radius_hdr *hdr = radius_msg_get_hdr(msg);
+	u8 *user;
+	size_t user_len;
+
+	if (!data->prefetch_eap_user ||
+	    radius_msg_get_attr_ptr(msg, RADIUS_ATTR_USER_NAME, &user,
+				    &user_len, NULL) < 0)
+		return 0;
+
+	dl_list_for_each(req, &data->deferred, struct radius_deferred_req,
+			 list) {
+		struct radius_hdr *rhdr = radius_msg_get_hdr(req->msg);
+
+		if (req->client == client && req->from_port == from_port &&
+		    rhdr->identifier == hdr->identifier &&
+		    os_memcmp(rhdr->authenticator, hdr->authenticator,
+			      16) == 0) {
+			RADIUS_DEBUG("Duplicate message from %s while user lookup is pending",
+				     from_addr);
+			data->counters.dup_access_requests++;
+			client->counters.dup_access_requests++;
+			return -1;
+		}
+	}
+
+	if (data->num_deferred >= data->max_sess)
+		return 0;
+
+	req = os_zalloc(sizeof(*req));
+	if (!req)
+		return 0;
+	req->from_addr = os_strdup(from_addr);
+	if (!req->from_addr ||
+	    data->prefetch_eap_user(data->conf_ctx, user, user_len, 0,
+				    req) != 1) {
+		os_free(req->from_addr);
+		os_free(req);
+		return 0;
+	}
+
+	RADIUS_DEBUG("Deferring new session until user lookup completes");
+	req->client = client;
+	req->msg = msg;
+	req->from_port = from_port;
+	req->fromlen = fromlen;
+	os_memcpy(&req->from, from, fromlen);
+	dl_list_add_tail(&data->deferred, &req->list);
+	data->num_deferred++;
+	return 1;
+}
+
+
 static int radius_server_request(struct radius_server_data *data,
 				 struct radius_msg *msg,
 				 struct sockaddr *from, socklen_t fromlen,
@@ -1362,7 +1529,7 @@ static int radius_server_request(struct radius_server_data *data,
 		state_included = res >= 0;
 		if (res == sizeof(statebuf)) {
 			state = WPA_GET_BE32(statebuf);
-			sess = radius_server_get_session(client, state);
+			sess = radius_server_get_session(data, client, state);
 		} else {
 			sess = NULL;
 		}
@@ -1376,6 +1543,11 @@ static int radius_server_request(struct radius_server_data *data,
 				     from_addr, from_port);
 		return -1;
 	} else {
+		res = radius_server_defer_request(data, client, msg, from,
+						  fromlen, from_addr,
+						  from_port);
+		if (res)
+			return res > 0 ? -2 : -1;
 		sess = radius_server_get_new_session(data, client, msg,
 						     from_addr);
 		if (sess == NULL) {
@@ -1985,16 +2157,13 @@ static int radius_server_open_socket6(int port)
 
 
 static void radius_server_free_sessions(struct radius_server_data *data,
-					struct radius_session *sessions)
+					struct dl_list *sessions)
 {
 	struct radius_session *session, *prev;
 
-	session = sessions;
-	while (session) {
-		prev = session;
-		session = session->next;
-		radius_server_session_free(data, prev);
-	}
+	dl_list_for_each_safe(session, prev, sessions, struct radius_session,
+			      list)
+		radius_server_session_free(data, session);
 }
 
 
@@ -2008,7 +2177,7 @@ static void radius_server_free_clients(struct radius_server_data *data,
 		prev = client;
 		client = client->next;
 
-		radius_server_free_sessions(data, prev->sessions);
+		radius_server_free_sessions(data, &prev->sessions);
 		os_free(prev->shared_secret);
 		radius_msg_free(prev->pending_dac_coa_req);
 		radius_msg_free(prev->pending_dac_disconnect_req);
@@ -2122,6 +2291,7 @@ radius_server_read_clients(const char *client_file, int ipv6)
 			failed = 1;
 			break;
 		}
+		dl_list_init(&entry->sessions);
 		entry->shared_secret = os_strdup(pos);
 		if (entry->shared_secret == NULL) {
 			failed = 1;
@@ -2184,6 +2354,7 @@ struct radius_server_data *
 radius_server_init(struct radius_server_conf *conf)
 {
 	struct radius_server_data *data;
+	unsigned int hash_size;
 
 #ifndef CONFIG_IPV6
 	if (conf->ipv6) {
@@ -2200,12 +2371,25 @@ radius_server_init(struct radius_server_conf *conf)
 	data->auth_sock = -1;
 	data->acct_sock = -1;
 	dl_list_init(&data->erp_keys);
+	dl_list_init(&data->deferred);
 	os_get_reltime(&data->start_time);
 	data->conf_ctx = conf->conf_ctx;
+	data->max_sess = conf->max_sessions > 0 ? conf->max_sessions :
+		RADIUS_MAX_SESSION;
+	hash_size = 16;
+	while (hash_size < (unsigned int) data->max_sess &&
+	       hash_size < RADIUS_SESSION_HASH_MAX)
+		hash_size <<= 1;
+	data->sess_hash = os_calloc(hash_size, sizeof(struct radius_session *));
+	if (!data->sess_hash)
+		goto fail;
+	data->sess_hash_mask = hash_size - 1;
 	conf->eap_cfg->backend_auth = true;
 	conf->eap_cfg->eap_server = 1;
 	data->ipv6 = conf->ipv6;
 	data->get_eap_user = conf->get_eap_user;
+	data->prefetch_eap_user = conf->prefetch_eap_user;
+	data->cancel_eap_user_prefetch = conf->cancel_eap_user_prefetch;
 	if (conf->eap_req_id_text) {
 		data->eap_req_id_text = os_malloc(conf->eap_req_id_text_len);
 		if (!data->eap_req_id_text)
@@ -2338,6 +2522,7 @@ void radius_server_deinit(struct radius_server_data *data)
 		close(data->acct_sock);
 	}
 
+	radius_server_flush_deferred(data);
 	radius_server_free_clients(data, data->clients);
 
 	os_free(data->eap_req_id_text);
@@ -2355,6 +2540,7 @@ void radius_server_deinit(struct radius_server_data *data)
 
 	radius_server_erp_flush(data);
 
+	os_free(data->sess_hash);
 	os_free(data);
 }
 
@@ -2527,6 +2713,31 @@ static int radius_server_get_eap_user(void *ctx, const u8 *identity,
 }
 
 
+static int radius_server_prefetch_eap_user(void *ctx, const u8 *identity,
+					   size_t identity_len, int phase2,
+					   void *session_ctx)
+{
+	struct radius_session *sess = ctx;
+	struct radius_server_data *data = sess->server;
+
+	if (!data->prefetch_eap_user)
+		return 0;
+	return data->prefetch_eap_user(data->conf_ctx, identity, identity_len,
+				       phase2, session_ctx);
+}
+
+
+static void radius_server_cancel_eap_user_prefetch(void *ctx,
+						   void *session_ctx)
+{
+	struct radius_session *sess = ctx;
+	struct radius_server_data *data = sess->server;
+
+	if (data->cancel_eap_user_prefetch)
+		data->cancel_eap_user_prefetch(data->conf_ctx, session_ctx);
+}
+
+
 static const char * radius_server_get_eap_req_id_text(void *ctx, size_t *len)
 {
 	struct radius_session *sess = ctx;
@@ -2579,6 +2790,8 @@ static int radius_server_erp_add_key(void *ctx, struct eap_server_erp_key *erp)
 static const struct eapol_callbacks radius_server_eapol_cb =
 {
 	.get_eap_user = radius_server_get_eap_user,
+	.prefetch_eap_user = radius_server_prefetch_eap_user,
+	.cancel_eap_user_prefetch = radius_server_cancel_eap_user_prefetch,
 	.get_eap_req_id_text = radius_server_get_eap_req_id_text,
 	.log_msg = radius_server_log_msg,
 #ifdef CONFIG_ERP
@@ -2602,13 +2815,33 @@ void radius_server_eap_pending_cb(struct radius_server_data *data, void *ctx)
 {
 	struct radius_client *cli;
 	struct radius_session *s, *sess = NULL;
+	struct radius_deferred_req *req;
 	struct radius_msg *msg;
 
 	if (data == NULL)
 		return;
 
+	dl_list_for_each(req, &data->deferred, struct radius_deferred_req,
+			 list) {
+		if (req != ctx)
+			continue;
+		dl_list_del(&req->list);
+		data->num_deferred--;
+		RADIUS_DEBUG("User lookup completed for deferred request from %s",
+			     req->from_addr);
+		if (radius_server_request(data, req->msg,
+					  (struct sockaddr *) &req->from,
+					  req->fromlen, req->client,
+					  req->from_addr, req->from_port,
+					  NULL) == -2)
+			req->msg = NULL; /* msg was stored with the session */
+		radius_server_free_deferred(data, req);
+		return;
+	}
+
 	for (cli = data->clients; cli; cli = cli->next) {
-		for (s = cli->sessions; s; s = s->next) {
+		dl_list_for_each(s, &cli->sessions, struct radius_session,
+				 list) {
 			if (s->eap == ctx && s->last_msg) {
 				sess = s;
 				break;
@@ -2844,3 +3077,24 @@ int radius_server_dac_request(struct radius_server_data *data, const char *req)
 	return -1;
 #endif /* CONFIG_SQLITE */
 }
+
+
+#ifdef CONFIG_MODULE_TESTS
+
+/**
+ * radius_server_receive_pending - Process already received RADIUS requests
+ * @data: RADIUS server context from radius_server_init()
+ *
+ * Module tests run from within an event loop callback, so they cannot wait
+ * for the event loop to call the socket handlers.
+ */
+void radius_server_receive_pending(struct radius_server_data *data)
+{
+	u8 c;
+
+	while (data->auth_sock >= 0 &&
+	       recv(data->auth_sock, &c, 1, MSG_PEEK | MSG_DONTWAIT) >= 0)
+		radius_server_receive_auth(data->auth_sock, data, NULL);
+}
+
+#endif /* CONFIG_MODULE_TESTS */
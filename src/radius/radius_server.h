@@ -58,6 +58,13 @@ struct radius_server_conf {
 	 */
 	int ipv6;
 
+	/**
+	 * max_sessions - Maximum number of active sessions
+	 *
+	 * 0 means the default limit (1000) is used.
+	 */
+	int max_sessions;
+
 	/**
 	 * get_eap_user - Callback for fetching EAP user information
 	 * @ctx: Context data from conf_ctx
@@ -75,6 +82,33 @@ struct radius_server_conf {
 	int (*get_eap_user)(void *ctx, const u8 *identity, size_t identity_len,
 			    int phase2, struct eap_user *user);
 
+	/**
+	 * prefetch_eap_user - Optional callback for starting a user lookup
+	 * @ctx: Context data from conf_ctx
+	 * @identity: User identity
+	 * @identity_len: identity buffer length in octets
+	 * @phase2: Whether this is for Phase 2 identity
+	 * @session_ctx: Context to pass to radius_server_eap_pending_cb()
+	 * Returns: 1 if the lookup is pending, 0 if get_eap_user() can be
+	 * called without blocking
+	 *
+	 * If 1 is returned, radius_server_eap_pending_cb() is called with
+	 * session_ctx once the lookup has been completed.
+	 */
+	int (*prefetch_eap_user)(void *ctx, const u8 *identity,
+				 size_t identity_len, int phase2,
+				 void *session_ctx);
+
+	/**
+	 * cancel_eap_user_prefetch - Optional callback for stopping lookups
+	 * @ctx: Context data from conf_ctx
+	 * @session_ctx: session_ctx from an earlier prefetch_eap_user() call
+	 *
+	 * This is called when the session or deferred request is removed, so
+	 * that radius_server_eap_pending_cb() is not called for it anymore.
+	 */
+	void (*cancel_eap_user_prefetch)(void *ctx, void *session_ctx);
+
 	/**
 	 * eap_req_id_text - Optional data for EAP-Request/Identity
 	 *
@@ -118,4 +152,8 @@ int radius_server_get_mib(struct radius_server_data *data, char *buf,
 void radius_server_eap_pending_cb(struct radius_server_data *data, void *ctx);
 int radius_server_dac_request(struct radius_server_data *data, const char *req);
 
+#ifdef CONFIG_MODULE_TESTS
+void radius_server_receive_pending(struct radius_server_data *data);
+#endif /* CONFIG_MODULE_TESTS */
+
 #endif /* RADIUS_SERVER_H */
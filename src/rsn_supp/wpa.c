@@ -7,6 +7,8 @@
  * See README for more details.
  */
 
+#define WPA_DEBUG_MODULE WPA_DEBUG_MODULE_WPA
+
 #include "includes.h"
 
 #include "common.h"
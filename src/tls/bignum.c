@@ -9,6 +9,7 @@
 #include "includes.h"
 
 #include "common.h"
+#include "utils/const_time.h"
 #include "bignum.h"
 
 #ifdef CONFIG_INTERNAL_LIBTOMMATH
@@ -204,6 +205,253 @@ int bignum_mulmod(const struct bignum *a, const struct bignum *b,
 }
 
 
+#if defined(CONFIG_INTERNAL_LIBTOMMATH) && !defined(LTM_FAST)
+
+/*
+ * Modular exponentiation with an odd modulus using Montgomery multiplication
+ * and a fixed window. Without LTM_FAST, the integrated LibTomMath uses only
+ * DIGIT_BIT bits of each digit and Barrett reduction for all moduli, so DH and
+ * RSA operations are done here with full machine word limbs instead. The
+ * sequence of operations and memory accesses depends only on the lengths of
+ * the operands and not on the value of the exponent. With LTM_FAST,
+ * mp_exptmod() uses its own Montgomery reduction and comba multiplication,
+ * which is faster than this, so it is used as-is.
+ */
+
+#ifdef __SIZEOF_INT128__
+typedef u64 mont_limb;
+typedef unsigned __int128 mont_dlimb;
+#else /* __SIZEOF_INT128__ */
+typedef u32 mont_limb;
+typedef u64 mont_dlimb;
+#endif /* __SIZEOF_INT128__ */
+
+#define MONT_LIMB_BITS (sizeof(mont_limb) * 8)
+#define MONT_MAX_BITS 16384
+
+struct mont_ctx {
+	size_t n; /* number of limbs in the modulus */
+	const mont_limb *m; /* modulus, least significant limb first */
+	mont_limb m0inv; /* -m^-1 mod 2^MONT_LIMB_BITS */
+	mont_limb *t; /* n + 2 limbs of temporary space */
+};
+
+
+static mont_limb mont_limb_inv(mont_limb m0)
+{
+	mont_limb x = m0; /* m0 * m0 = 1 mod 8 for any odd m0 */
+	unsigned int bits;
+
+	/* Newton iteration doubles the number of correct low bits */
+	for (bits = 3; bits < MONT_LIMB_BITS; bits *= 2)
+		x *= 2 - m0 * x;
+	return (mont_limb) 0 - x;
+}
+
+
+static void mont_from_bin(mont_limb *r, size_t n, const u8 *buf, size_t len)
+{
+	size_t i;
+
+	os_memset(r, 0, n * sizeof(mont_limb));
+	for (i = 0; i < len && i / sizeof(mont_limb) < n; i++)
+		r[i / sizeof(mont_limb)] |= (mont_limb) buf[len - 1 - i] <<
+			(8 * (i % sizeof(mont_limb)));
+}
+
+
+static void mont_to_bin(const mont_limb *a, size_t n, u8 *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[len - 1 - i] = i / sizeof(mont_limb) < n ?
+			a[i / sizeof(mont_limb)] >>
+			(8 * (i % sizeof(mont_limb))) : 0;
+}
+
+
+/* r = a * b * 2^(-n * MONT_LIMB_BITS) mod m; r may be the same as a or b */
+static void mont_mul(struct mont_ctx *ctx, mont_limb *r, const mont_limb *a,
+		     const mont_limb *b)
+{
+	size_t i, j, n = ctx->n;
+	const mont_limb *m = ctx->m;
+	mont_limb *t = ctx->t;
+	mont_limb u, borrow, keep;
+	mont_dlimb c;
+
+	os_memset(t, 0, (n + 2) * sizeof(mont_limb));
+	for (i = 0; i < n; i++) {
+		/* t += a * b[i] */
+		c = 0;
+		for (j = 0; j < n; j++) {
+			c += (mont_dlimb) a[j] * b[i] + t[j];
+			t[j] = (mont_limb) c;
+			c >>= MONT_LIMB_BITS;
+		}
+		c += t[n];
+		t[n] = (mont_limb) c;
+		t[n + 1] = (mont_limb) (c >> MONT_LIMB_BITS);
+
+		/* t = (t + u * m) / 2^MONT_LIMB_BITS */
+		u = t[0] * ctx->m0inv;
+		c = (mont_dlimb) u * m[0] + t[0];
+		c >>= MONT_LIMB_BITS;
+		for (j = 1; j < n; j++) {
+			c += (mont_dlimb) u * m[j] + t[j];
+			t[j - 1] = (mont_limb) c;
+			c >>= MONT_LIMB_BITS;
+		}
+		c += t[n];
+		t[n - 1] = (mont_limb) c;
+		t[n] = t[n + 1] + (mont_limb) (c >> MONT_LIMB_BITS);
+	}
+
+	/* t < 2m; r = t - m unless that would be negative */
+	borrow = 0;
+	for (j = 0; j < n; j++) {
+		c = (mont_dlimb) t[j] - m[j] - borrow;
+		r[j] = (mont_limb) c;
+		borrow = (mont_limb) (c >> MONT_LIMB_BITS) & 1;
+	}
+	keep = (mont_limb) 0 - (borrow & (t[n] ^ 1));
+	for (j = 0; j < n; j++)
+		r[j] = (t[j] & keep) | (r[j] & ~keep);
+}
+
+
+/* Copy table[idx] to r without an index dependent memory access pattern */
+static void mont_select(mont_limb *r, const mont_limb *table, size_t n,
+			unsigned int entries, unsigned int idx)
+{
+	unsigned int i;
+	size_t j;
+	mont_limb mask;
+
+	os_memset(r, 0, n * sizeof(mont_limb));
+	for (i = 0; i < entries; i++) {
+		mask = (mont_limb) 0 - (mont_limb) (const_time_eq(i, idx) & 1);
+		for (j = 0; j < n; j++)
+			r[j] |= table[i * n + j] & mask;
+	}
+}
+
+
+static unsigned int mont_exp_bits(const u8 *e, size_t e_len, size_t pos,
+				  unsigned int count)
+{
+	unsigned int val = 0, i;
+	size_t bit;
+
+	for (i = count; i > 0; i--) {
+		bit = pos + i - 1;
+		val <<= 1;
+		if (bit < e_len * 8)
+			val |= (e[e_len - 1 - bit / 8] >> (bit % 8)) & 1;
+	}
+	return val;
+}
+
+
+/* Returns 1 if the operands are not supported, 0 on success, -1 on error */
+static int bignum_exptmod_mont(mp_int *a, mp_int *b, mp_int *c, mp_int *d)
+{
+	struct mont_ctx ctx;
+	mp_int tmp;
+	u8 *buf = NULL, *e = NULL;
+	mont_limb *mem = NULL, *m, *x, *y, *r2, *table;
+	size_t n, m_len, e_len, buf_len, mem_len, pos, win_count;
+	unsigned int win, entries, i;
+	int ret = -1;
+
+	if (b->sign == MP_NEG || c->sign == MP_NEG || mp_iseven(c) ||
+	    mp_cmp_d(c, 1) != MP_GT || mp_count_bits(c) > MONT_MAX_BITS)
+		return 1;
+
+	m_len = mp_unsigned_bin_size(c);
+	e_len = mp_unsigned_bin_size(b);
+	n = (m_len + sizeof(mont_limb) - 1) / sizeof(mont_limb);
+	win = e_len > 64 ? 5 : 4;
+	entries = 1 << win;
+	buf_len = n * sizeof(mont_limb);
+	/* m, x, y, r2, table, and n + 2 limbs for mont_ctx::t */
+	mem_len = ((5 + entries) * n + 2) * sizeof(mont_limb);
+
+	if (mp_init(&tmp) != MP_OKAY)
+		return -1;
+	buf = os_malloc(buf_len);
+	e = os_malloc(e_len > 0 ? e_len : 1);
+	mem = os_zalloc(mem_len);
+	if (!buf || !e || !mem)
+		goto fail;
+	m = mem;
+	x = m + n;
+	y = x + n;
+	r2 = y + n;
+	table = r2 + n;
+	ctx.n = n;
+	ctx.m = m;
+	ctx.t = table + entries * n;
+
+	if (mp_to_unsigned_bin(c, buf) != MP_OKAY)
+		goto fail;
+	mont_from_bin(m, n, buf, m_len);
+	ctx.m0inv = mont_limb_inv(m[0]);
+	if (mp_to_unsigned_bin(b, e) != MP_OKAY)
+		goto fail;
+
+	/* r2 = 2^(2 * n * MONT_LIMB_BITS) mod m */
+	if (mp_2expt(&tmp, 2 * n * MONT_LIMB_BITS) != MP_OKAY ||
+	    mp_mod(&tmp, c, &tmp) != MP_OKAY ||
+	    mp_to_unsigned_bin(&tmp, buf) != MP_OKAY)
+		goto fail;
+	mont_from_bin(r2, n, buf, mp_unsigned_bin_size(&tmp));
+
+	/* y = a mod m */
+	if (mp_mod(a, c, &tmp) != MP_OKAY ||
+	    mp_to_unsigned_bin(&tmp, buf) != MP_OKAY)
+		goto fail;
+	mont_from_bin(y, n, buf, mp_unsigned_bin_size(&tmp));
+
+	/* table[i] = a^i in the Montgomery domain */
+	os_memset(x, 0, n * sizeof(mont_limb));
+	x[0] = 1;
+	mont_mul(&ctx, table, r2, x);
+	mont_mul(&ctx, &table[n], y, r2);
+	for (i = 2; i < entries; i++)
+		mont_mul(&ctx, &table[i * n], &table[(i - 1) * n], &table[n]);
+
+	os_memcpy(x, table, n * sizeof(mont_limb));
+	win_count = (e_len * 8 + win - 1) / win;
+	for (pos = win_count; pos > 0; pos--) {
+		for (i = 0; i < win; i++)
+			mont_mul(&ctx, x, x, x);
+		mont_select(y, table, n, entries,
+			    mont_exp_bits(e, e_len, (pos - 1) * win, win));
+		mont_mul(&ctx, x, x, y);
+	}
+
+	/* Convert out of the Montgomery domain */
+	os_memset(y, 0, n * sizeof(mont_limb));
+	y[0] = 1;
+	mont_mul(&ctx, x, x, y);
+	mont_to_bin(x, n, buf, buf_len);
+	if (mp_read_unsigned_bin(d, buf, buf_len) != MP_OKAY)
+		goto fail;
+
+	ret = 0;
+fail:
+	mp_clear(&tmp);
+	bin_clear_free(buf, buf_len);
+	bin_clear_free(e, e_len > 0 ? e_len : 1);
+	bin_clear_free(mem, mem_len);
+	return ret;
+}
+
+#endif /* CONFIG_INTERNAL_LIBTOMMATH && !LTM_FAST */
+
+
 /**
  * bignum_exptmod - Modular exponentiation: d = a^b (mod c)
  * @a: Bignum from bignum_init(); base
@@ -214,6 +462,38 @@ int bignum_mulmod(const struct bignum *a, const struct bignum *b,
  */
 int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 		   const struct bignum *c, struct bignum *d)
+{
+#if defined(CONFIG_INTERNAL_LIBTOMMATH) && !defined(LTM_FAST)
+	int res;
+
+	res = bignum_exptmod_mont((mp_int *) a, (mp_int *) b, (mp_int *) c,
+				  (mp_int *) d);
+	if (res < 0) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		return -1;
+	}
+	if (res == 0)
+		return 0;
+#endif /* CONFIG_INTERNAL_LIBTOMMATH && !LTM_FAST */
+
+	return bignum_exptmod_ltm(a, b, c, d);
+}
+
+
+/**
+ * bignum_exptmod_ltm - Modular exponentiation with LibTomMath mp_exptmod()
+ * @a: Bignum from bignum_init(); base
+ * @b: Bignum from bignum_init(); exponent
+ * @c: Bignum from bignum_init(); modulus
+ * @d: Bignum from bignum_init(); used to store the result of a^b (mod c)
+ * Returns: 0 on success, -1 on failure
+ *
+ * This is used by bignum_exptmod() for operands that the internal Montgomery
+ * implementation does not support (even modulus) and for all operands in
+ * LTM_FAST builds. It is available separately for comparison in tests.
+ */
+int bignum_exptmod_ltm(const struct bignum *a, const struct bignum *b,
+		       const struct bignum *c, struct bignum *d)
 {
 	if (mp_exptmod((mp_int *) a, (mp_int *) b, (mp_int *) c, (mp_int *) d)
 	    != MP_OKAY) {
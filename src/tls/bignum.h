@@ -28,5 +28,7 @@ int bignum_mulmod(const struct bignum *a, const struct bignum *b,
 		  const struct bignum *c, struct bignum *d);
 int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 		   const struct bignum *c, struct bignum *d);
+int bignum_exptmod_ltm(const struct bignum *a, const struct bignum *b,
+		       const struct bignum *c, struct bignum *d);
 
 #endif /* BIGNUM_H */
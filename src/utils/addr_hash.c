@@ -0,0 +1,254 @@
+/*
+ * Hash table for entries indexed by a MAC address
+ * Copyright (c) 2026, The Android Open Source Project
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "addr_hash.h"
+
+#define ADDR_HASH_MIN_SIZE 16
+
+
+static const u8 * addr_hash_addr(const struct addr_hash *hash,
+				 const struct addr_hash_node *node)
+{
+	return (const u8 *) node + hash->addr_offset;
+}
+
+
+#define ROTL64(x, b) (u64) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND					\
+	do {						\
+		v0 += v1; v1 = ROTL64(v1, 13);		\
+		v1 ^= v0; v0 = ROTL64(v0, 32);		\
+		v2 += v3; v3 = ROTL64(v3, 16);		\
+		v3 ^= v2;				\
+		v0 += v3; v3 = ROTL64(v3, 21);		\
+		v3 ^= v0;				\
+		v2 += v1; v1 = ROTL64(v1, 17);		\
+		v1 ^= v2; v2 = ROTL64(v2, 32);		\
+	} while (0)
+
+/* SipHash-2-4 of the six octet address */
+static size_t addr_hash_idx(const struct addr_hash *hash, const u8 *addr)
+{
+	u64 v0 = hash->key[0] ^ 0x736f6d6570736575ULL;
+	u64 v1 = hash->key[1] ^ 0x646f72616e646f6dULL;
+	u64 v2 = hash->key[0] ^ 0x6c7967656e657261ULL;
+	u64 v3 = hash->key[1] ^ 0x7465646279746573ULL;
+	u64 b;
+
+	b = ((u64) ETH_ALEN << 56) | ((u64) addr[5] << 40) |
+		((u64) addr[4] << 32) | WPA_GET_LE32(addr);
+	v3 ^= b;
+	SIPROUND;
+	SIPROUND;
+	v0 ^= b;
+	v2 ^= 0xff;
+	SIPROUND;
+	SIPROUND;
+	SIPROUND;
+	SIPROUND;
+
+	return (size_t) (v0 ^ v1 ^ v2 ^ v3) & (hash->size - 1);
+}
+
+
+static int addr_hash_resize(struct addr_hash *hash, size_t size)
+{
+	struct addr_hash_node **old = hash->buckets, *node, *next;
+	size_t old_size = hash->size, i, idx;
+
+	hash->buckets = os_calloc(size, sizeof(*hash->buckets));
+	if (!hash->buckets) {
+		hash->buckets = old;
+		return -1;
+	}
+	hash->size = size;
+	hash->resizes++;
+
+	for (i = 0; i < old_size; i++) {
+		for (node = old[i]; node; node = next) {
+			next = node->next;
+			idx = addr_hash_idx(hash, addr_hash_addr(hash, node));
+			node->next = hash->buckets[idx];
+			hash->buckets[idx] = node;
+		}
+	}
+	os_free(old);
+
+	return 0;
+}
+
+
+/**
+ * addr_hash_add - Add an entry into a hash table
+ * @hash: Hash table
+ * @addr_offset: Offset of the entry address from @node; use
+ *	ADDR_HASH_ADDR_OFFSET()
+ * @node: Hash table node of the entry
+ * Returns: 0 on success, -1 on failure (table could not be allocated)
+ */
+int addr_hash_add(struct addr_hash *hash, long addr_offset,
+		  struct addr_hash_node *node)
+{
+	size_t idx;
+
+	if (!hash->buckets) {
+		if (os_get_random((u8 *) hash->key, sizeof(hash->key)) < 0) {
+			hash->key[0] = ((u64) os_random() << 32) ^ os_random();
+			hash->key[1] = ((u64) os_random() << 32) ^ os_random();
+		}
+		hash->addr_offset = addr_offset;
+		hash->buckets = os_calloc(ADDR_HASH_MIN_SIZE,
+					  sizeof(*hash->buckets));
+		if (!hash->buckets)
+			return -1;
+		hash->size = ADDR_HASH_MIN_SIZE;
+	} else if (hash->count >= hash->size) {
+		/* Keep the load factor at most one; failure to grow only makes
+		 * the chains longer */
+		addr_hash_resize(hash, hash->size * 2);
+	}
+
+	idx = addr_hash_idx(hash, addr_hash_addr(hash, node));
+	node->next = hash->buckets[idx];
+	hash->buckets[idx] = node;
+	hash->count++;
+
+	return 0;
+}
+
+
+/**
+ * addr_hash_del - Remove an entry from a hash table
+ * @hash: Hash table
+ * @node: Hash table node of the entry
+ * Returns: 0 on success, -1 if the entry was not found
+ */
+int addr_hash_del(struct addr_hash *hash, struct addr_hash_node *node)
+{
+	struct addr_hash_node **pos;
+
+	if (!hash->buckets)
+		return -1;
+
+	pos = &hash->buckets[addr_hash_idx(hash, addr_hash_addr(hash, node))];
+	while (*pos && *pos != node)
+		pos = &(*pos)->next;
+	if (!*pos)
+		return -1;
+	*pos = node->next;
+	node->next = NULL;
+	hash->count--;
+
+	if (hash->size > ADDR_HASH_MIN_SIZE && hash->count < hash->size / 4)
+		addr_hash_resize(hash, hash->size / 2);
+
+	return 0;
+}
+
+
+/**
+ * addr_hash_get - Find the first entry with the specified address
+ * @hash: Hash table
+ * @addr: Address to search for
+ * Returns: Hash table node of the entry or %NULL if not found
+ */
+struct addr_hash_node * addr_hash_get(const struct addr_hash *hash,
+				      const u8 *addr)
+{
+	struct addr_hash_node *node;
+
+	if (!hash->buckets)
+		return NULL;
+
+	for (node = hash->buckets[addr_hash_idx(hash, addr)]; node;
+	     node = node->next) {
+		if (os_memcmp(addr_hash_addr(hash, node), addr, ETH_ALEN) == 0)
+			return node;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * addr_hash_get_next - Find the next entry with the same address
+ * @hash: Hash table
+ * @node: Entry returned by addr_hash_get() or addr_hash_get_next()
+ * Returns: Next entry with the same address as @node or %NULL if none
+ */
+struct addr_hash_node * addr_hash_get_next(const struct addr_hash *hash,
+					   struct addr_hash_node *node)
+{
+	const u8 *addr = addr_hash_addr(hash, node);
+
+	for (node = node->next; node; node = node->next) {
+		if (os_memcmp(addr_hash_addr(hash, node), addr, ETH_ALEN) == 0)
+			return node;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * addr_hash_deinit - Free the hash table buckets
+ * @hash: Hash table
+ *
+ * The entries themselves are owned by the caller and are not freed.
+ */
+void addr_hash_deinit(struct addr_hash *hash)
+{
+	os_free(hash->buckets);
+	hash->buckets = NULL;
+	hash->size = 0;
+	hash->count = 0;
+}
+
+
+/**
+ * addr_hash_stats - Write hash table occupancy statistics
+ * @hash: Hash table
+ * @name: Name of the table to use as the line prefix
+ * @buf: Buffer for the text
+ * @buflen: Length of @buf
+ * Returns: Number of bytes written or -1 on failure
+ *
+ * The chains field lists the number of buckets with 0, 1, ..., 7 and more
+ * than 7 entries.
+ */
+int addr_hash_stats(const struct addr_hash *hash, const char *name,
+		    char *buf, size_t buflen)
+{
+	unsigned int hist[9];
+	size_t i, len, max_len = 0;
+	struct addr_hash_node *node;
+	int ret;
+
+	os_memset(hist, 0, sizeof(hist));
+	for (i = 0; i < hash->size; i++) {
+		len = 0;
+		for (node = hash->buckets[i]; node; node = node->next)
+			len++;
+		hist[len < 8 ? len : 8]++;
+		if (len > max_len)
+			max_len = len;
+	}
+
+	ret = os_snprintf(buf, buflen,
+			  "%s: size=%zu entries=%zu max_chain=%zu resizes=%u chains=%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+			  name, hash->size, hash->count, max_len,
+			  hash->resizes, hist[0], hist[1], hist[2], hist[3],
+			  hist[4], hist[5], hist[6], hist[7], hist[8]);
+	if (os_snprintf_error(buflen, ret))
+		return -1;
+	return ret;
+}
@@ -0,0 +1,57 @@
+/*
+ * Hash table for entries indexed by a MAC address
+ * Copyright (c) 2026, The Android Open Source Project
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef ADDR_HASH_H
+#define ADDR_HASH_H
+
+/*
+ * The table is intrusive: each entry embeds a struct addr_hash_node and stores
+ * the address at a fixed offset from that node. The bucket index is derived
+ * with a per-table random key over all six octets of the address, so chain
+ * lengths do not depend on which addresses peers choose to use. The table
+ * grows and shrinks with the number of entries. A zeroed struct addr_hash is
+ * a valid empty table; buckets are allocated on the first addition.
+ */
+
+struct addr_hash_node {
+	struct addr_hash_node *next;
+};
+
+struct addr_hash {
+	struct addr_hash_node **buckets;
+	size_t size; /* number of buckets; power of two */
+	size_t count;
+	long addr_offset; /* offset of the address from the node */
+	u64 key[2];
+	unsigned int resizes;
+};
+
+#define addr_hash_entry(node, type, member) \
+	((type *) ((char *) (node) - offsetof(type, member)))
+
+/**
+ * ADDR_HASH_ADDR_OFFSET - Offset of the address from the hash node
+ * @type: Type of the entry
+ * @node: Name of the struct addr_hash_node member
+ * @addr: Name of the address member
+ */
+#define ADDR_HASH_ADDR_OFFSET(type, node, addr) \
+	((long) offsetof(type, addr) - (long) offsetof(type, node))
+
+int addr_hash_add(struct addr_hash *hash, long addr_offset,
+		  struct addr_hash_node *node);
+int addr_hash_del(struct addr_hash *hash, struct addr_hash_node *node);
+struct addr_hash_node * addr_hash_get(const struct addr_hash *hash,
+				      const u8 *addr);
+struct addr_hash_node * addr_hash_get_next(const struct addr_hash *hash,
+					   struct addr_hash_node *node);
+void addr_hash_deinit(struct addr_hash *hash);
+int addr_hash_stats(const struct addr_hash *hash, const char *name,
+		    char *buf, size_t buflen);
+
+#endif /* ADDR_HASH_H */
@@ -32,13 +32,29 @@
 #endif /* CONFIG_ELOOP_POLL */
 
 #ifdef CONFIG_ELOOP_EPOLL
+#include <poll.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #endif /* CONFIG_ELOOP_EPOLL */
 
 #ifdef CONFIG_ELOOP_KQUEUE
 #include <sys/event.h>
 #endif /* CONFIG_ELOOP_KQUEUE */
 
+#ifdef CONFIG_ELOOP_WORKERS
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#else /* __linux__ */
+#include <fcntl.h>
+#endif /* __linux__ */
+
+#ifndef ELOOP_WORKERS_MAX
+#define ELOOP_WORKERS_MAX 4
+#endif /* ELOOP_WORKERS_MAX */
+#endif /* CONFIG_ELOOP_WORKERS */
+
 struct eloop_sock {
 	int sock;
 	void *eloop_data;
@@ -52,6 +68,10 @@ struct eloop_sock {
 struct eloop_timeout {
 	struct dl_list list;
 	struct os_reltime time;
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	size_t heap_idx;
+	unsigned int seq;
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
 	void *eloop_data;
 	void *user_data;
 	eloop_timeout_handler handler;
@@ -67,6 +87,35 @@ struct eloop_signal {
 	int signaled;
 };
 
+struct eloop_work {
+	struct dl_list list;
+	void *eloop_data;
+	void *user_data;
+	eloop_work_handler work;
+	eloop_work_handler done;
+#ifdef CONFIG_ELOOP_WORKERS
+	int cancelled; /* protected by work_lock */
+#endif /* CONFIG_ELOOP_WORKERS */
+};
+
+#ifdef CONFIG_ELOOP_EPOLL
+/*
+ * Per-fd epoll registration. A single fd can have a handler for each event
+ * type. gen is stored in the epoll event data and changes whenever the fd is
+ * added to the epoll set, so that events reported for an fd that has been
+ * closed and reused can be detected.
+ */
+struct eloop_epoll_fd {
+	struct eloop_sock sock[3]; /* indexed by eloop_event_type */
+	u32 gen;
+	int registered;
+};
+
+/* Event data generation of internal fds (timerfd and signal wakeup) */
+#define ELOOP_EPOLL_GEN_INTERNAL 0
+#define ELOOP_EPOLL_INTERNAL_FDS 2
+#endif /* CONFIG_ELOOP_EPOLL */
+
 struct eloop_sock_table {
 	size_t count;
 	struct eloop_sock *table;
@@ -86,14 +135,20 @@ struct eloop_data {
 #endif /* CONFIG_ELOOP_POLL */
 #if defined(CONFIG_ELOOP_EPOLL) || defined(CONFIG_ELOOP_KQUEUE)
 	int max_fd;
-	struct eloop_sock *fd_table;
 #endif /* CONFIG_ELOOP_EPOLL || CONFIG_ELOOP_KQUEUE */
 #ifdef CONFIG_ELOOP_EPOLL
+	struct eloop_epoll_fd *fd_table;
 	int epollfd;
 	size_t epoll_max_event_num;
 	struct epoll_event *epoll_events;
+	u32 epoll_gen;
+	int timerfd; /* -1 if not available */
+	int timer_armed;
+	struct os_reltime timer_time;
+	int wakeupfd; /* eventfd written by signal handlers or -1 */
 #endif /* CONFIG_ELOOP_EPOLL */
 #ifdef CONFIG_ELOOP_KQUEUE
+	struct eloop_sock *fd_table;
 	int kqueuefd;
 	size_t kqueue_nevents;
 	struct kevent *kqueue_events;
@@ -102,7 +157,39 @@ struct eloop_data {
 	struct eloop_sock_table writers;
 	struct eloop_sock_table exceptions;
 
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	/* Binary min-heap of timeouts ordered by expiration time */
+	struct eloop_timeout **timeout_heap;
+	size_t timeout_count;
+	size_t timeout_heap_size;
+	/* Timeouts hashed by (handler, eloop_data, user_data) */
+	struct dl_list *timeout_hash;
+	size_t timeout_hash_size; /* power of two */
+	unsigned int timeout_seq;
+#else /* CONFIG_ELOOP_TIMEOUT_HEAP */
 	struct dl_list timeout;
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
+
+	/* Work not yet started (or, without CONFIG_ELOOP_WORKERS, waiting for
+	 * its zero timeout) */
+	struct dl_list work_queue;
+#ifdef CONFIG_ELOOP_WORKERS
+	/* The work lists and counters below are protected by work_lock */
+	pthread_mutex_t work_lock;
+	pthread_cond_t work_cond; /* new work or shutdown */
+	pthread_cond_t work_cancel_cond; /* cancelled work has returned */
+	struct dl_list work_running;
+	struct dl_list work_done; /* waiting for the done callback */
+	unsigned int work_queued;
+	unsigned int work_idle;
+	int work_shutdown;
+	pthread_t work_threads[ELOOP_WORKERS_MAX];
+	unsigned int work_threads_num;
+	/* Submitted, but not completed or cancelled; eloop thread only */
+	unsigned int work_pending;
+	int work_fd[2]; /* completion notification (same eventfd or a pipe) */
+	int work_sock_registered;
+#endif /* CONFIG_ELOOP_WORKERS */
 
 	size_t signal_count;
 	struct eloop_signal *signals;
@@ -160,17 +247,222 @@ static void eloop_trace_sock_remove_ref(struct eloop_sock_table *table)
 #endif /* WPA_TRACE */
 
 
+#ifdef CONFIG_ELOOP_EPOLL
+
+static u32 eloop_epoll_events(eloop_event_type type)
+{
+	switch (type) {
+	case EVENT_TYPE_READ:
+		return EPOLLIN;
+	case EVENT_TYPE_WRITE:
+		return EPOLLOUT;
+	/*
+	 * Exceptions are always checked when using epoll, but I suppose it's
+	 * possible that someone registered a socket *only* for exception
+	 * handling.
+	 */
+	case EVENT_TYPE_EXCEPTION:
+		return EPOLLERR | EPOLLHUP;
+	}
+
+	return 0;
+}
+
+
+static u32 eloop_epoll_next_gen(void)
+{
+	if (++eloop.epoll_gen == ELOOP_EPOLL_GEN_INTERNAL)
+		eloop.epoll_gen++;
+	return eloop.epoll_gen;
+}
+
+
+/* Sync the epoll registration of sock with the handlers in fd_table */
+static int eloop_epoll_update(int sock)
+{
+	struct eloop_epoll_fd *efd = &eloop.fd_table[sock];
+	struct epoll_event ev;
+	int i, op, res, used = 0;
+
+	os_memset(&ev, 0, sizeof(ev));
+	for (i = EVENT_TYPE_READ; i <= EVENT_TYPE_EXCEPTION; i++) {
+		if (efd->sock[i].handler) {
+			ev.events |= eloop_epoll_events(i);
+			used = 1;
+		}
+	}
+
+	if (!used) {
+		if (!efd->registered)
+			return 0;
+		op = EPOLL_CTL_DEL;
+	} else if (efd->registered) {
+		op = EPOLL_CTL_MOD;
+	} else {
+		op = EPOLL_CTL_ADD;
+		efd->gen = eloop_epoll_next_gen();
+	}
+
+	ev.data.u64 = ((u64) efd->gen << 32) | (u32) sock;
+	res = epoll_ctl(eloop.epollfd, op, sock, &ev);
+	if (res < 0 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+		/* The fd was closed without being unregistered and the number
+		 * has been reused, so the kernel dropped the old entry. */
+		op = EPOLL_CTL_ADD;
+		efd->gen = eloop_epoll_next_gen();
+		ev.data.u64 = ((u64) efd->gen << 32) | (u32) sock;
+		res = epoll_ctl(eloop.epollfd, op, sock, &ev);
+	}
+	if (res < 0) {
+		wpa_printf(MSG_ERROR, "%s: epoll_ctl(%s) for fd=%d failed: %s",
+			   __func__, op == EPOLL_CTL_ADD ? "ADD" :
+			   (op == EPOLL_CTL_MOD ? "MOD" : "DEL"),
+			   sock, strerror(errno));
+		if (op == EPOLL_CTL_DEL)
+			efd->registered = 0;
+		return -1;
+	}
+	efd->registered = op != EPOLL_CTL_DEL;
+
+	return 0;
+}
+
+
+static int eloop_epoll_add_internal(int fd)
+{
+	struct epoll_event ev;
+
+	os_memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u64 = ((u64) ELOOP_EPOLL_GEN_INTERNAL << 32) | (u32) fd;
+	return epoll_ctl(eloop.epollfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+
+static void eloop_epoll_init_internal(void)
+{
+	/* Use the same clock as os_get_reltime() when available */
+#ifdef CLOCK_BOOTTIME
+	eloop.timerfd = timerfd_create(CLOCK_BOOTTIME,
+				       TFD_NONBLOCK | TFD_CLOEXEC);
+	if (eloop.timerfd < 0)
+#endif /* CLOCK_BOOTTIME */
+		eloop.timerfd = timerfd_create(CLOCK_MONOTONIC,
+					       TFD_NONBLOCK | TFD_CLOEXEC);
+	if (eloop.timerfd >= 0 && eloop_epoll_add_internal(eloop.timerfd) < 0) {
+		close(eloop.timerfd);
+		eloop.timerfd = -1;
+	}
+	if (eloop.timerfd < 0)
+		wpa_printf(MSG_DEBUG,
+			   "eloop: timerfd not available - use epoll_wait() timeout");
+
+	eloop.wakeupfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (eloop.wakeupfd >= 0 &&
+	    eloop_epoll_add_internal(eloop.wakeupfd) < 0) {
+		close(eloop.wakeupfd);
+		eloop.wakeupfd = -1;
+	}
+}
+
+
+/* Called from signal handlers; must be async-signal-safe */
+static void eloop_epoll_wakeup(void)
+{
+	int err = errno;
+	u64 val = 1;
+
+	if (eloop.wakeupfd >= 0 &&
+	    write(eloop.wakeupfd, &val, sizeof(val)) < 0) {
+		/* Counter overflow; a wakeup is already pending */
+	}
+	errno = err;
+}
+
+
+/*
+ * Arm the timerfd for the first pending timeout and return the timeout to use
+ * for epoll_wait() in milliseconds.
+ */
+static int eloop_epoll_timeout(struct eloop_timeout *timeout,
+			       struct os_reltime *tv)
+{
+	struct itimerspec its;
+
+	if (!timeout)
+		return -1;
+	if (tv->sec == 0 && tv->usec == 0)
+		return 0;
+
+	if (eloop.timerfd >= 0) {
+		if (eloop.timer_armed &&
+		    eloop.timer_time.sec == timeout->time.sec &&
+		    eloop.timer_time.usec == timeout->time.usec)
+			return -1;
+
+		os_memset(&its, 0, sizeof(its));
+		its.it_value.tv_sec = tv->sec;
+		its.it_value.tv_nsec = tv->usec * 1000L;
+		if (timerfd_settime(eloop.timerfd, 0, &its, NULL) == 0) {
+			eloop.timer_armed = 1;
+			eloop.timer_time = timeout->time;
+			return -1;
+		}
+	}
+
+	/* Round up to avoid waking up before the timeout has expired */
+	return tv->sec * 1000 + (tv->usec + 999) / 1000;
+}
+
+
+static void eloop_epoll_internal_event(int fd)
+{
+	u64 val;
+
+	if (read(fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		wpa_printf(MSG_DEBUG, "eloop: read(internal fd=%d): %s",
+			   fd, strerror(errno));
+	if (fd == eloop.timerfd)
+		eloop.timer_armed = 0;
+}
+
+#endif /* CONFIG_ELOOP_EPOLL */
+
+
 int eloop_init(void)
 {
 	os_memset(&eloop, 0, sizeof(eloop));
+#ifndef CONFIG_ELOOP_TIMEOUT_HEAP
 	dl_list_init(&eloop.timeout);
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
+	dl_list_init(&eloop.work_queue);
+#ifdef CONFIG_ELOOP_WORKERS
+	dl_list_init(&eloop.work_running);
+	dl_list_init(&eloop.work_done);
+	eloop.work_fd[0] = eloop.work_fd[1] = -1;
+	if (pthread_mutex_init(&eloop.work_lock, NULL) ||
+	    pthread_cond_init(&eloop.work_cond, NULL) ||
+	    pthread_cond_init(&eloop.work_cancel_cond, NULL)) {
+		wpa_printf(MSG_ERROR, "%s: pthread init failed", __func__);
+		return -1;
+	}
+#endif /* CONFIG_ELOOP_WORKERS */
 #ifdef CONFIG_ELOOP_EPOLL
-	eloop.epollfd = epoll_create1(0);
+	eloop.timerfd = -1;
+	eloop.wakeupfd = -1;
+	eloop.epollfd = epoll_create1(EPOLL_CLOEXEC);
 	if (eloop.epollfd < 0) {
 		wpa_printf(MSG_ERROR, "%s: epoll_create1 failed. %s",
 			   __func__, strerror(errno));
 		return -1;
 	}
+	eloop.epoll_events = os_calloc(8, sizeof(struct epoll_event));
+	if (!eloop.epoll_events) {
+		close(eloop.epollfd);
+		return -1;
+	}
+	eloop.epoll_max_event_num = 8;
+	eloop_epoll_init_internal();
 #endif /* CONFIG_ELOOP_EPOLL */
 #ifdef CONFIG_ELOOP_KQUEUE
 	eloop.kqueuefd = kqueue();
@@ -192,38 +484,6 @@ int eloop_init(void)
 }
 
 
-#ifdef CONFIG_ELOOP_EPOLL
-static int eloop_sock_queue(int sock, eloop_event_type type)
-{
-	struct epoll_event ev;
-
-	os_memset(&ev, 0, sizeof(ev));
-	switch (type) {
-	case EVENT_TYPE_READ:
-		ev.events = EPOLLIN;
-		break;
-	case EVENT_TYPE_WRITE:
-		ev.events = EPOLLOUT;
-		break;
-	/*
-	 * Exceptions are always checked when using epoll, but I suppose it's
-	 * possible that someone registered a socket *only* for exception
-	 * handling.
-	 */
-	case EVENT_TYPE_EXCEPTION:
-		ev.events = EPOLLERR | EPOLLHUP;
-		break;
-	}
-	ev.data.fd = sock;
-	if (epoll_ctl(eloop.epollfd, EPOLL_CTL_ADD, sock, &ev) < 0) {
-		wpa_printf(MSG_ERROR, "%s: epoll_ctl(ADD) for fd=%d failed: %s",
-			   __func__, sock, strerror(errno));
-		return -1;
-	}
-	return 0;
-}
-#endif /* CONFIG_ELOOP_EPOLL */
-
 
 #ifdef CONFIG_ELOOP_KQUEUE
 
@@ -256,6 +516,11 @@ static int eloop_sock_queue(int sock, eloop_event_type type)
 #endif /* CONFIG_ELOOP_KQUEUE */
 
 
+#ifdef CONFIG_ELOOP_EPOLL
+static void eloop_sock_table_remove_sock(struct eloop_sock_table *table,
+					 int sock);
+#endif /* CONFIG_ELOOP_EPOLL */
+
 static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
                                      int sock, eloop_sock_handler handler,
                                      void *eloop_data, void *user_data)
@@ -263,11 +528,14 @@ static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
 #ifdef CONFIG_ELOOP_EPOLL
 	struct epoll_event *temp_events;
 #endif /* CONFIG_ELOOP_EPOLL */
+#ifdef CONFIG_ELOOP_EPOLL
+	struct eloop_epoll_fd *temp_table;
+#endif /* CONFIG_ELOOP_EPOLL */
 #ifdef CONFIG_ELOOP_KQUEUE
 	struct kevent *temp_events;
-#endif /* CONFIG_ELOOP_EPOLL */
-#if defined(CONFIG_ELOOP_EPOLL) || defined(CONFIG_ELOOP_KQUEUE)
 	struct eloop_sock *temp_table;
+#endif /* CONFIG_ELOOP_KQUEUE */
+#if defined(CONFIG_ELOOP_EPOLL) || defined(CONFIG_ELOOP_KQUEUE)
 	size_t next;
 #endif /* CONFIG_ELOOP_EPOLL || CONFIG_ELOOP_KQUEUE */
 	struct eloop_sock *tmp;
@@ -281,6 +549,23 @@ static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
 	if (table == NULL)
 		return -1;
 
+#ifdef CONFIG_ELOOP_SELECT
+	if (sock >= FD_SETSIZE) {
+		wpa_printf(MSG_ERROR,
+			   "eloop: sock=%d does not fit in select() fd_set (FD_SETSIZE=%d) - use CONFIG_ELOOP_EPOLL",
+			   sock, FD_SETSIZE);
+		return -1;
+	}
+#endif /* CONFIG_ELOOP_SELECT */
+#ifdef CONFIG_ELOOP_EPOLL
+	if (sock < eloop.max_fd && eloop.fd_table[sock].sock[table->type].handler) {
+		wpa_printf(MSG_ERROR,
+			   "eloop: sock=%d already registered for event type %d",
+			   sock, table->type);
+		return -1;
+	}
+#endif /* CONFIG_ELOOP_EPOLL */
+
 #ifdef CONFIG_ELOOP_POLL
 	if ((size_t) new_max_sock >= eloop.max_pollfd_map) {
 		struct pollfd **nmap;
@@ -306,7 +591,21 @@ static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
 		eloop.pollfds = n;
 	}
 #endif /* CONFIG_ELOOP_POLL */
-#if defined(CONFIG_ELOOP_EPOLL) || defined(CONFIG_ELOOP_KQUEUE)
+#ifdef CONFIG_ELOOP_EPOLL
+	if (new_max_sock >= eloop.max_fd) {
+		next = new_max_sock + 16;
+		temp_table = os_realloc_array(eloop.fd_table, next,
+					      sizeof(struct eloop_epoll_fd));
+		if (temp_table == NULL)
+			return -1;
+
+		os_memset(&temp_table[eloop.max_fd], 0,
+			  (next - eloop.max_fd) * sizeof(struct eloop_epoll_fd));
+		eloop.max_fd = next;
+		eloop.fd_table = temp_table;
+	}
+#endif /* CONFIG_ELOOP_EPOLL */
+#ifdef CONFIG_ELOOP_KQUEUE
 	if (new_max_sock >= eloop.max_fd) {
 		next = new_max_sock + 16;
 		temp_table = os_realloc_array(eloop.fd_table, next,
@@ -317,10 +616,11 @@ static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
 		eloop.max_fd = next;
 		eloop.fd_table = temp_table;
 	}
-#endif /* CONFIG_ELOOP_EPOLL || CONFIG_ELOOP_KQUEUE */
+#endif /* CONFIG_ELOOP_KQUEUE */
 
 #ifdef CONFIG_ELOOP_EPOLL
-	if (eloop.count + 1 > eloop.epoll_max_event_num) {
+	if (eloop.count + 1 + ELOOP_EPOLL_INTERNAL_FDS >
+	    eloop.epoll_max_event_num) {
 		next = eloop.epoll_max_event_num == 0 ? 8 :
 			eloop.epoll_max_event_num * 2;
 		temp_events = os_realloc_array(eloop.epoll_events, next,
@@ -372,12 +672,20 @@ static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
 	table->changed = 1;
 	eloop_trace_sock_add_ref(table);
 
-#if defined(CONFIG_ELOOP_EPOLL) || defined(CONFIG_ELOOP_KQUEUE)
+#ifdef CONFIG_ELOOP_EPOLL
+	os_memcpy(&eloop.fd_table[sock].sock[table->type],
+		  &table->table[table->count - 1], sizeof(struct eloop_sock));
+	if (eloop_epoll_update(sock) < 0) {
+		eloop_sock_table_remove_sock(table, sock);
+		return -1;
+	}
+#endif /* CONFIG_ELOOP_EPOLL */
+#ifdef CONFIG_ELOOP_KQUEUE
 	if (eloop_sock_queue(sock, table->type) < 0)
 		return -1;
 	os_memcpy(&eloop.fd_table[sock], &table->table[table->count - 1],
 		  sizeof(struct eloop_sock));
-#endif /* CONFIG_ELOOP_EPOLL || CONFIG_ELOOP_KQUEUE */
+#endif /* CONFIG_ELOOP_KQUEUE */
 	return 0;
 }
 
@@ -410,12 +718,9 @@ static void eloop_sock_table_remove_sock(struct eloop_sock_table *table,
 	table->changed = 1;
 	eloop_trace_sock_add_ref(table);
 #ifdef CONFIG_ELOOP_EPOLL
-	if (epoll_ctl(eloop.epollfd, EPOLL_CTL_DEL, sock, NULL) < 0) {
-		wpa_printf(MSG_ERROR, "%s: epoll_ctl(DEL) for fd=%d failed: %s",
-			   __func__, sock, strerror(errno));
-		return;
-	}
-	os_memset(&eloop.fd_table[sock], 0, sizeof(struct eloop_sock));
+	os_memset(&eloop.fd_table[sock].sock[table->type], 0,
+		  sizeof(struct eloop_sock));
+	eloop_epoll_update(sock);
 #endif /* CONFIG_ELOOP_EPOLL */
 #ifdef CONFIG_ELOOP_KQUEUE
 	EV_SET(&ke, sock, event_type_kevent_filter(table->type), EV_DELETE, 0,
@@ -615,19 +920,42 @@ static void eloop_sock_table_dispatch(struct eloop_sock_table *table,
 #ifdef CONFIG_ELOOP_EPOLL
 static void eloop_sock_table_dispatch(struct epoll_event *events, int nfds)
 {
-	struct eloop_sock *table;
-	int i;
+	static const u32 dispatch_events[] = {
+		[EVENT_TYPE_READ] = EPOLLIN | EPOLLERR | EPOLLHUP,
+		[EVENT_TYPE_WRITE] = EPOLLOUT | EPOLLERR | EPOLLHUP,
+		[EVENT_TYPE_EXCEPTION] = EPOLLERR | EPOLLHUP,
+	};
+	struct eloop_sock *es;
+	int i, type;
 
+	/*
+	 * Handlers may register and unregister sockets, so the fd table is
+	 * looked up again for each call. Events for fds that have been removed
+	 * or re-added to the epoll set since epoll_wait() are skipped based on
+	 * the generation, so the whole batch can be processed.
+	 */
 	for (i = 0; i < nfds; i++) {
-		table = &eloop.fd_table[events[i].data.fd];
-		if (table->handler == NULL)
+		int fd = (int) (u32) events[i].data.u64;
+		u32 gen = events[i].data.u64 >> 32;
+
+		if (gen == ELOOP_EPOLL_GEN_INTERNAL) {
+			eloop_epoll_internal_event(fd);
 			continue;
-		table->handler(table->sock, table->eloop_data,
-			       table->user_data);
-		if (eloop.readers.changed ||
-		    eloop.writers.changed ||
-		    eloop.exceptions.changed)
-			break;
+		}
+
+		for (type = EVENT_TYPE_READ; type <= EVENT_TYPE_EXCEPTION;
+		     type++) {
+			if (fd >= eloop.max_fd ||
+			    !eloop.fd_table[fd].registered ||
+			    eloop.fd_table[fd].gen != gen)
+				break;
+			if (!(events[i].events & dispatch_events[type]))
+				continue;
+			es = &eloop.fd_table[fd].sock[type];
+			if (es->handler)
+				es->handler(es->sock, es->eloop_data,
+					    es->user_data);
+		}
 	}
 }
 #endif /* CONFIG_ELOOP_EPOLL */
@@ -769,117 +1097,232 @@ void eloop_unregister_sock(int sock, eloop_event_type type)
 }
 
 
-int eloop_register_timeout(unsigned int secs, unsigned int usecs,
-			   eloop_timeout_handler handler,
-			   void *eloop_data, void *user_data)
-{
-	struct eloop_timeout *timeout, *tmp;
-	os_time_t now_sec;
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
 
-	timeout = os_zalloc(sizeof(*timeout));
-	if (timeout == NULL)
-		return -1;
-	if (os_get_reltime(&timeout->time) < 0) {
-		os_free(timeout);
-		return -1;
-	}
-	now_sec = timeout->time.sec;
-	timeout->time.sec += secs;
-	if (timeout->time.sec < now_sec) {
-		/*
-		 * Integer overflow - assume long enough timeout to be assumed
-		 * to be infinite, i.e., the timeout would never happen.
-		 */
-		wpa_printf(MSG_DEBUG, "ELOOP: Too long timeout (secs=%u) to "
-			   "ever happen - ignore it", secs);
-		os_free(timeout);
+static int eloop_timeout_before(struct eloop_timeout *a,
+				struct eloop_timeout *b)
+{
+	if (os_reltime_before(&a->time, &b->time))
+		return 1;
+	if (os_reltime_before(&b->time, &a->time))
 		return 0;
-	}
-	timeout->time.usec += usecs;
-	while (timeout->time.usec >= 1000000) {
-		timeout->time.sec++;
-		timeout->time.usec -= 1000000;
-	}
-	timeout->eloop_data = eloop_data;
-	timeout->user_data = user_data;
-	timeout->handler = handler;
-	wpa_trace_add_ref(timeout, eloop, eloop_data);
-	wpa_trace_add_ref(timeout, user, user_data);
-	wpa_trace_record(timeout);
-
-	/* Maintain timeouts in order of increasing time */
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (os_reltime_before(&timeout->time, &tmp->time)) {
-			dl_list_add(tmp->list.prev, &timeout->list);
-			return 0;
-		}
-	}
-	dl_list_add_tail(&eloop.timeout, &timeout->list);
-
-	return 0;
+	/* Same expiration time - maintain the order of registration */
+	return (int) (a->seq - b->seq) < 0;
 }
 
 
-static void eloop_remove_timeout(struct eloop_timeout *timeout)
+static void eloop_heap_set(size_t idx, struct eloop_timeout *timeout)
 {
-	dl_list_del(&timeout->list);
-	wpa_trace_remove_ref(timeout, eloop, timeout->eloop_data);
-	wpa_trace_remove_ref(timeout, user, timeout->user_data);
-	os_free(timeout);
+	eloop.timeout_heap[idx] = timeout;
+	timeout->heap_idx = idx;
 }
 
 
-int eloop_cancel_timeout(eloop_timeout_handler handler,
-			 void *eloop_data, void *user_data)
+static void eloop_heap_sift_up(size_t idx)
 {
-	struct eloop_timeout *timeout, *prev;
-	int removed = 0;
+	struct eloop_timeout *timeout = eloop.timeout_heap[idx];
 
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
-		if (timeout->handler == handler &&
-		    (timeout->eloop_data == eloop_data ||
-		     eloop_data == ELOOP_ALL_CTX) &&
-		    (timeout->user_data == user_data ||
-		     user_data == ELOOP_ALL_CTX)) {
-			eloop_remove_timeout(timeout);
-			removed++;
-		}
-	}
+	while (idx > 0) {
+		size_t parent = (idx - 1) / 2;
 
-	return removed;
+		if (!eloop_timeout_before(timeout, eloop.timeout_heap[parent]))
+			break;
+		eloop_heap_set(idx, eloop.timeout_heap[parent]);
+		idx = parent;
+	}
+	eloop_heap_set(idx, timeout);
 }
 
 
-int eloop_cancel_timeout_one(eloop_timeout_handler handler,
-			     void *eloop_data, void *user_data,
-			     struct os_reltime *remaining)
+static void eloop_heap_sift_down(size_t idx)
 {
-	struct eloop_timeout *timeout, *prev;
-	int removed = 0;
-	struct os_reltime now;
+	struct eloop_timeout *timeout = eloop.timeout_heap[idx];
 
-	os_get_reltime(&now);
-	remaining->sec = remaining->usec = 0;
+	for (;;) {
+		size_t child = 2 * idx + 1;
 
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
-		if (timeout->handler == handler &&
-		    (timeout->eloop_data == eloop_data) &&
-		    (timeout->user_data == user_data)) {
-			removed = 1;
-			if (os_reltime_before(&now, &timeout->time))
-				os_reltime_sub(&timeout->time, &now, remaining);
-			eloop_remove_timeout(timeout);
+		if (child >= eloop.timeout_count)
+			break;
+		if (child + 1 < eloop.timeout_count &&
+		    eloop_timeout_before(eloop.timeout_heap[child + 1],
+					 eloop.timeout_heap[child]))
+			child++;
+		if (!eloop_timeout_before(eloop.timeout_heap[child], timeout))
 			break;
+		eloop_heap_set(idx, eloop.timeout_heap[child]);
+		idx = child;
+	}
+	eloop_heap_set(idx, timeout);
+}
+
+
+static struct dl_list * eloop_timeout_bucket(eloop_timeout_handler handler,
+					     void *eloop_data, void *user_data)
+{
+	uintptr_t val[3];
+	unsigned int hash = 0;
+	int i;
+
+	if (!eloop.timeout_hash)
+		return NULL;
+
+	val[0] = (uintptr_t) handler;
+	val[1] = (uintptr_t) eloop_data;
+	val[2] = (uintptr_t) user_data;
+	for (i = 0; i < 3; i++) {
+		hash ^= (unsigned int) (val[i] ^ (val[i] >> 16 >> 16));
+		hash *= 0x9e3779b1U;
+		hash ^= hash >> 15;
+	}
+
+	return &eloop.timeout_hash[hash & (eloop.timeout_hash_size - 1)];
+}
+
+
+static int eloop_timeout_hash_resize(size_t size)
+{
+	struct dl_list *hash;
+	size_t i;
+
+	hash = os_calloc(size, sizeof(*hash));
+	if (!hash)
+		return -1;
+	for (i = 0; i < size; i++)
+		dl_list_init(&hash[i]);
+
+	os_free(eloop.timeout_hash);
+	eloop.timeout_hash = hash;
+	eloop.timeout_hash_size = size;
+
+	for (i = 0; i < eloop.timeout_count; i++) {
+		struct eloop_timeout *timeout = eloop.timeout_heap[i];
+
+		dl_list_add_tail(eloop_timeout_bucket(timeout->handler,
+						      timeout->eloop_data,
+						      timeout->user_data),
+				 &timeout->list);
+	}
+
+	return 0;
+}
+
+
+static int eloop_insert_timeout(struct eloop_timeout *timeout)
+{
+	if (eloop.timeout_count == eloop.timeout_heap_size) {
+		struct eloop_timeout **heap;
+		size_t size;
+
+		size = eloop.timeout_heap_size ? eloop.timeout_heap_size * 2 :
+			16;
+		heap = os_realloc_array(eloop.timeout_heap, size,
+					sizeof(*heap));
+		if (!heap)
+			return -1;
+		eloop.timeout_heap = heap;
+		eloop.timeout_heap_size = size;
+	}
+
+	if (eloop.timeout_count >= 2 * eloop.timeout_hash_size &&
+	    eloop_timeout_hash_resize(eloop.timeout_hash_size ?
+				      eloop.timeout_hash_size * 2 : 16) < 0 &&
+	    !eloop.timeout_hash)
+		return -1;
+
+	timeout->seq = eloop.timeout_seq++;
+	dl_list_add_tail(eloop_timeout_bucket(timeout->handler,
+					      timeout->eloop_data,
+					      timeout->user_data),
+			 &timeout->list);
+	eloop_heap_set(eloop.timeout_count++, timeout);
+	eloop_heap_sift_up(timeout->heap_idx);
+
+	return 0;
+}
+
+
+static void eloop_unlink_timeout(struct eloop_timeout *timeout)
+{
+	size_t idx = timeout->heap_idx;
+	struct eloop_timeout *last;
+
+	dl_list_del(&timeout->list);
+	last = eloop.timeout_heap[--eloop.timeout_count];
+	if (last == timeout)
+		return;
+
+	eloop_heap_set(idx, last);
+	if (idx > 0 &&
+	    eloop_timeout_before(last, eloop.timeout_heap[(idx - 1) / 2]))
+		eloop_heap_sift_up(idx);
+	else
+		eloop_heap_sift_down(idx);
+}
+
+
+static struct eloop_timeout * eloop_first_timeout(void)
+{
+	return eloop.timeout_count ? eloop.timeout_heap[0] : NULL;
+}
+
+
+static struct eloop_timeout * eloop_find_timeout(eloop_timeout_handler handler,
+						 void *eloop_data,
+						 void *user_data)
+{
+	struct eloop_timeout *tmp, *found = NULL;
+	struct dl_list *bucket;
+
+	bucket = eloop_timeout_bucket(handler, eloop_data, user_data);
+	if (!bucket)
+		return NULL;
+
+	/* Return the first one to expire to match the sorted list behavior */
+	dl_list_for_each(tmp, bucket, struct eloop_timeout, list) {
+		if (tmp->handler == handler &&
+		    tmp->eloop_data == eloop_data &&
+		    tmp->user_data == user_data &&
+		    (!found || eloop_timeout_before(tmp, found)))
+			found = tmp;
+	}
+
+	return found;
+}
+
+#else /* CONFIG_ELOOP_TIMEOUT_HEAP */
+
+static int eloop_insert_timeout(struct eloop_timeout *timeout)
+{
+	struct eloop_timeout *tmp;
+
+	/* Maintain timeouts in order of increasing time */
+	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
+		if (os_reltime_before(&timeout->time, &tmp->time)) {
+			dl_list_add(tmp->list.prev, &timeout->list);
+			return 0;
 		}
 	}
-	return removed;
+	dl_list_add_tail(&eloop.timeout, &timeout->list);
+
+	return 0;
 }
 
 
-int eloop_is_timeout_registered(eloop_timeout_handler handler,
-				void *eloop_data, void *user_data)
+static void eloop_unlink_timeout(struct eloop_timeout *timeout)
+{
+	dl_list_del(&timeout->list);
+}
+
+
+static struct eloop_timeout * eloop_first_timeout(void)
+{
+	return dl_list_first(&eloop.timeout, struct eloop_timeout, list);
+}
+
+
+static struct eloop_timeout * eloop_find_timeout(eloop_timeout_handler handler,
+						 void *eloop_data,
+						 void *user_data)
 {
 	struct eloop_timeout *tmp;
 
@@ -887,13 +1330,152 @@ int eloop_is_timeout_registered(eloop_timeout_handler handler,
 		if (tmp->handler == handler &&
 		    tmp->eloop_data == eloop_data &&
 		    tmp->user_data == user_data)
-			return 1;
+			return tmp;
 	}
 
+	return NULL;
+}
+
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
+
+
+int eloop_register_timeout(unsigned int secs, unsigned int usecs,
+			   eloop_timeout_handler handler,
+			   void *eloop_data, void *user_data)
+{
+	struct eloop_timeout *timeout;
+	os_time_t now_sec;
+
+	timeout = os_zalloc(sizeof(*timeout));
+	if (timeout == NULL)
+		return -1;
+	if (os_get_reltime(&timeout->time) < 0) {
+		os_free(timeout);
+		return -1;
+	}
+	now_sec = timeout->time.sec;
+	timeout->time.sec += secs;
+	if (timeout->time.sec < now_sec) {
+		/*
+		 * Integer overflow - assume long enough timeout to be assumed
+		 * to be infinite, i.e., the timeout would never happen.
+		 */
+		wpa_printf(MSG_DEBUG, "ELOOP: Too long timeout (secs=%u) to "
+			   "ever happen - ignore it", secs);
+		os_free(timeout);
+		return 0;
+	}
+	timeout->time.usec += usecs;
+	while (timeout->time.usec >= 1000000) {
+		timeout->time.sec++;
+		timeout->time.usec -= 1000000;
+	}
+	timeout->eloop_data = eloop_data;
+	timeout->user_data = user_data;
+	timeout->handler = handler;
+
+	if (eloop_insert_timeout(timeout) < 0) {
+		os_free(timeout);
+		return -1;
+	}
+
+	wpa_trace_add_ref(timeout, eloop, eloop_data);
+	wpa_trace_add_ref(timeout, user, user_data);
+	wpa_trace_record(timeout);
+
 	return 0;
 }
 
 
+static void eloop_remove_timeout(struct eloop_timeout *timeout)
+{
+	eloop_unlink_timeout(timeout);
+	wpa_trace_remove_ref(timeout, eloop, timeout->eloop_data);
+	wpa_trace_remove_ref(timeout, user, timeout->user_data);
+	os_free(timeout);
+}
+
+
+static int eloop_cancel_timeout_list(struct dl_list *list,
+				     eloop_timeout_handler handler,
+				     void *eloop_data, void *user_data)
+{
+	struct eloop_timeout *timeout, *prev;
+	int removed = 0;
+
+	dl_list_for_each_safe(timeout, prev, list, struct eloop_timeout, list) {
+		if (timeout->handler == handler &&
+		    (timeout->eloop_data == eloop_data ||
+		     eloop_data == ELOOP_ALL_CTX) &&
+		    (timeout->user_data == user_data ||
+		     user_data == ELOOP_ALL_CTX)) {
+			eloop_remove_timeout(timeout);
+			removed++;
+		}
+	}
+
+	return removed;
+}
+
+
+int eloop_cancel_timeout(eloop_timeout_handler handler,
+			 void *eloop_data, void *user_data)
+{
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	struct dl_list *bucket;
+	int removed = 0;
+	size_t i;
+
+	if (eloop_data != ELOOP_ALL_CTX && user_data != ELOOP_ALL_CTX) {
+		bucket = eloop_timeout_bucket(handler, eloop_data, user_data);
+		if (!bucket)
+			return 0;
+		return eloop_cancel_timeout_list(bucket, handler, eloop_data,
+						 user_data);
+	}
+
+	/* Wildcard context matches may be in any bucket */
+	for (i = 0; i < eloop.timeout_hash_size; i++)
+		removed += eloop_cancel_timeout_list(&eloop.timeout_hash[i],
+						     handler, eloop_data,
+						     user_data);
+
+	return removed;
+#else /* CONFIG_ELOOP_TIMEOUT_HEAP */
+	return eloop_cancel_timeout_list(&eloop.timeout, handler, eloop_data,
+					 user_data);
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
+}
+
+
+int eloop_cancel_timeout_one(eloop_timeout_handler handler,
+			     void *eloop_data, void *user_data,
+			     struct os_reltime *remaining)
+{
+	struct eloop_timeout *timeout;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	remaining->sec = remaining->usec = 0;
+
+	timeout = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!timeout)
+		return 0;
+
+	if (os_reltime_before(&now, &timeout->time))
+		os_reltime_sub(&timeout->time, &now, remaining);
+	eloop_remove_timeout(timeout);
+	return 1;
+}
+
+
+int eloop_is_timeout_registered(eloop_timeout_handler handler,
+				void *eloop_data, void *user_data)
+{
+	return eloop_find_timeout(handler, eloop_data, user_data) != NULL;
+}
+
+
 int eloop_deplete_timeout(unsigned int req_secs, unsigned int req_usecs,
 			  eloop_timeout_handler handler, void *eloop_data,
 			  void *user_data)
@@ -901,28 +1483,22 @@ int eloop_deplete_timeout(unsigned int req_secs, unsigned int req_usecs,
 	struct os_reltime now, requested, remaining;
 	struct eloop_timeout *tmp;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data) {
-			requested.sec = req_secs;
-			requested.usec = req_usecs;
-			os_get_reltime(&now);
-			os_reltime_sub(&tmp->time, &now, &remaining);
-			if (os_reltime_before(&requested, &remaining)) {
-				eloop_cancel_timeout(handler, eloop_data,
-						     user_data);
-				eloop_register_timeout(requested.sec,
-						       requested.usec,
-						       handler, eloop_data,
-						       user_data);
-				return 1;
-			}
-			return 0;
-		}
+	tmp = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!tmp)
+		return -1;
+
+	requested.sec = req_secs;
+	requested.usec = req_usecs;
+	os_get_reltime(&now);
+	os_reltime_sub(&tmp->time, &now, &remaining);
+	if (os_reltime_before(&requested, &remaining)) {
+		eloop_cancel_timeout(handler, eloop_data, user_data);
+		eloop_register_timeout(requested.sec, requested.usec,
+				       handler, eloop_data, user_data);
+		return 1;
 	}
 
-	return -1;
+	return 0;
 }
 
 
@@ -933,28 +1509,382 @@ int eloop_replenish_timeout(unsigned int req_secs, unsigned int req_usecs,
 	struct os_reltime now, requested, remaining;
 	struct eloop_timeout *tmp;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data) {
-			requested.sec = req_secs;
-			requested.usec = req_usecs;
-			os_get_reltime(&now);
-			os_reltime_sub(&tmp->time, &now, &remaining);
-			if (os_reltime_before(&remaining, &requested)) {
-				eloop_cancel_timeout(handler, eloop_data,
-						     user_data);
-				eloop_register_timeout(requested.sec,
-						       requested.usec,
-						       handler, eloop_data,
-						       user_data);
-				return 1;
-			}
-			return 0;
+	tmp = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!tmp)
+		return -1;
+
+	requested.sec = req_secs;
+	requested.usec = req_usecs;
+	os_get_reltime(&now);
+	os_reltime_sub(&tmp->time, &now, &remaining);
+	if (os_reltime_before(&remaining, &requested)) {
+		eloop_cancel_timeout(handler, eloop_data, user_data);
+		eloop_register_timeout(requested.sec, requested.usec,
+				       handler, eloop_data, user_data);
+		return 1;
+	}
+
+	return 0;
+}
+
+
+static int eloop_work_match(struct eloop_work *w, eloop_work_handler work,
+			    void *eloop_data, void *user_data)
+{
+	return w->work == work &&
+		(w->eloop_data == eloop_data || eloop_data == ELOOP_ALL_CTX) &&
+		(w->user_data == user_data || user_data == ELOOP_ALL_CTX);
+}
+
+
+#ifdef CONFIG_ELOOP_WORKERS
+
+static void eloop_work_notify(void)
+{
+#ifdef __linux__
+	u64 val = 1;
+#else /* __linux__ */
+	u8 val = 0;
+#endif /* __linux__ */
+
+	/* A full pipe means that a notification is already pending */
+	if (write(eloop.work_fd[1], &val, sizeof(val)) < 0 && errno != EAGAIN)
+		wpa_printf(MSG_ERROR, "eloop: work notification failed: %s",
+			   strerror(errno));
+}
+
+
+static void * eloop_worker_thread(void *arg)
+{
+	struct eloop_work *w;
+
+	pthread_mutex_lock(&eloop.work_lock);
+	for (;;) {
+		while (!eloop.work_shutdown &&
+		       dl_list_empty(&eloop.work_queue)) {
+			eloop.work_idle++;
+			pthread_cond_wait(&eloop.work_cond, &eloop.work_lock);
+			eloop.work_idle--;
+		}
+		if (eloop.work_shutdown)
+			break;
+
+		w = dl_list_first(&eloop.work_queue, struct eloop_work, list);
+		dl_list_del(&w->list);
+		eloop.work_queued--;
+		dl_list_add_tail(&eloop.work_running, &w->list);
+		pthread_mutex_unlock(&eloop.work_lock);
+
+		w->work(w->eloop_data, w->user_data);
+
+		/* The entry is freed in the eloop thread since os_free() is not
+		 * necessarily thread safe */
+		pthread_mutex_lock(&eloop.work_lock);
+		dl_list_del(&w->list);
+		dl_list_add_tail(&eloop.work_done, &w->list);
+		if (w->cancelled)
+			pthread_cond_broadcast(&eloop.work_cancel_cond);
+		else
+			eloop_work_notify();
+	}
+	pthread_mutex_unlock(&eloop.work_lock);
+
+	return NULL;
+}
+
+
+/* Must be called with work_lock held */
+static int eloop_work_start_thread(void)
+{
+	sigset_t all, old;
+	int ret;
+
+	/* Signals are delivered to the eloop thread only; the mask is
+	 * inherited so that there is no window in the new thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	ret = pthread_create(&eloop.work_threads[eloop.work_threads_num], NULL,
+			     eloop_worker_thread, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (ret) {
+		wpa_printf(MSG_ERROR, "eloop: Failed to start worker thread: %s",
+			   strerror(ret));
+		return -1;
+	}
+	eloop.work_threads_num++;
+	wpa_printf(MSG_DEBUG, "eloop: Started worker thread %u",
+		   eloop.work_threads_num);
+
+	return 0;
+}
+
+
+static void eloop_work_complete(int sock, void *eloop_ctx, void *sock_ctx);
+
+static void eloop_work_update_sock(void)
+{
+	if (eloop.work_pending && !eloop.work_sock_registered) {
+		if (eloop_register_read_sock(eloop.work_fd[0],
+					     eloop_work_complete,
+					     NULL, NULL) == 0)
+			eloop.work_sock_registered = 1;
+	} else if (!eloop.work_pending && eloop.work_sock_registered) {
+		eloop_unregister_read_sock(eloop.work_fd[0]);
+		eloop.work_sock_registered = 0;
+	}
+}
+
+
+static void eloop_work_complete(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct eloop_work *w;
+	u64 buf;
+
+	while (read(sock, &buf, sizeof(buf)) > 0)
+		;
+
+	/* Take one entry at a time since the done callbacks may submit or
+	 * cancel work */
+	for (;;) {
+		pthread_mutex_lock(&eloop.work_lock);
+		w = dl_list_first(&eloop.work_done, struct eloop_work, list);
+		if (w)
+			dl_list_del(&w->list);
+		pthread_mutex_unlock(&eloop.work_lock);
+		if (!w)
+			break;
+
+		if (!w->cancelled) {
+			eloop.work_pending--;
+			if (w->done)
+				w->done(w->eloop_data, w->user_data);
 		}
+		os_free(w);
 	}
 
-	return -1;
+	eloop_work_update_sock();
+}
+
+
+static int eloop_work_init_fd(void)
+{
+#ifdef __linux__
+	int fd;
+
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fd < 0) {
+		wpa_printf(MSG_ERROR, "eloop: eventfd failed: %s",
+			   strerror(errno));
+		return -1;
+	}
+	eloop.work_fd[0] = eloop.work_fd[1] = fd;
+#else /* __linux__ */
+	int i;
+
+	if (pipe(eloop.work_fd) < 0) {
+		wpa_printf(MSG_ERROR, "eloop: pipe failed: %s",
+			   strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < 2; i++) {
+		if (fcntl(eloop.work_fd[i], F_SETFL, O_NONBLOCK) < 0 ||
+		    fcntl(eloop.work_fd[i], F_SETFD, FD_CLOEXEC) < 0)
+			wpa_printf(MSG_INFO, "eloop: fcntl failed: %s",
+				   strerror(errno));
+	}
+#endif /* __linux__ */
+
+	return 0;
+}
+
+#else /* CONFIG_ELOOP_WORKERS */
+
+static void eloop_work_run(void *eloop_ctx, void *user_ctx)
+{
+	struct eloop_work *w = user_ctx;
+
+	dl_list_del(&w->list);
+	w->work(w->eloop_data, w->user_data);
+	if (w->done)
+		w->done(w->eloop_data, w->user_data);
+	os_free(w);
+}
+
+#endif /* CONFIG_ELOOP_WORKERS */
+
+
+int eloop_submit_work(eloop_work_handler work, eloop_work_handler done,
+		      void *eloop_data, void *user_data)
+{
+	struct eloop_work *w;
+
+	w = os_zalloc(sizeof(*w));
+	if (!w)
+		return -1;
+	w->work = work;
+	w->done = done;
+	w->eloop_data = eloop_data;
+	w->user_data = user_data;
+
+#ifdef CONFIG_ELOOP_WORKERS
+	if (eloop.work_fd[0] < 0 && eloop_work_init_fd() < 0) {
+		os_free(w);
+		return -1;
+	}
+
+	pthread_mutex_lock(&eloop.work_lock);
+	dl_list_add_tail(&eloop.work_queue, &w->list);
+	eloop.work_queued++;
+	/* Start threads on demand; failing to add one is not fatal as long as
+	 * there is at least one thread to run the queued work */
+	if (eloop.work_queued > eloop.work_idle &&
+	    eloop.work_threads_num < ELOOP_WORKERS_MAX &&
+	    eloop_work_start_thread() < 0 && eloop.work_threads_num == 0) {
+		dl_list_del(&w->list);
+		eloop.work_queued--;
+		pthread_mutex_unlock(&eloop.work_lock);
+		os_free(w);
+		return -1;
+	}
+	pthread_cond_signal(&eloop.work_cond);
+	pthread_mutex_unlock(&eloop.work_lock);
+
+	eloop.work_pending++;
+	eloop_work_update_sock();
+#else /* CONFIG_ELOOP_WORKERS */
+	if (eloop_register_timeout(0, 0, eloop_work_run, NULL, w) < 0) {
+		os_free(w);
+		return -1;
+	}
+	dl_list_add_tail(&eloop.work_queue, &w->list);
+#endif /* CONFIG_ELOOP_WORKERS */
+
+	return 0;
+}
+
+
+int eloop_cancel_work(eloop_work_handler work, void *eloop_data,
+		      void *user_data)
+{
+	struct eloop_work *w, *prev;
+	int removed = 0;
+#ifdef CONFIG_ELOOP_WORKERS
+	int running;
+
+	pthread_mutex_lock(&eloop.work_lock);
+	dl_list_for_each_safe(w, prev, &eloop.work_queue, struct eloop_work,
+			      list) {
+		if (eloop_work_match(w, work, eloop_data, user_data)) {
+			dl_list_del(&w->list);
+			eloop.work_queued--;
+			os_free(w);
+			removed++;
+		}
+	}
+	dl_list_for_each_safe(w, prev, &eloop.work_done, struct eloop_work,
+			      list) {
+		if (!w->cancelled &&
+		    eloop_work_match(w, work, eloop_data, user_data)) {
+			dl_list_del(&w->list);
+			os_free(w);
+			removed++;
+		}
+	}
+	dl_list_for_each(w, &eloop.work_running, struct eloop_work, list) {
+		if (!w->cancelled &&
+		    eloop_work_match(w, work, eloop_data, user_data)) {
+			w->cancelled = 1;
+			removed++;
+		}
+	}
+
+	/* The caller may free the context data once this returns, so wait
+	 * for the matching work functions that are already running */
+	for (;;) {
+		running = 0;
+		dl_list_for_each(w, &eloop.work_running, struct eloop_work,
+				 list) {
+			if (w->cancelled)
+				running = 1;
+		}
+		if (!running)
+			break;
+		pthread_cond_wait(&eloop.work_cancel_cond, &eloop.work_lock);
+	}
+	dl_list_for_each_safe(w, prev, &eloop.work_done, struct eloop_work,
+			      list) {
+		if (w->cancelled) {
+			dl_list_del(&w->list);
+			os_free(w);
+		}
+	}
+	pthread_mutex_unlock(&eloop.work_lock);
+
+	eloop.work_pending -= removed;
+	eloop_work_update_sock();
+#else /* CONFIG_ELOOP_WORKERS */
+	dl_list_for_each_safe(w, prev, &eloop.work_queue, struct eloop_work,
+			      list) {
+		if (eloop_work_match(w, work, eloop_data, user_data)) {
+			eloop_cancel_timeout(eloop_work_run, NULL, w);
+			dl_list_del(&w->list);
+			os_free(w);
+			removed++;
+		}
+	}
+#endif /* CONFIG_ELOOP_WORKERS */
+
+	return removed;
+}
+
+
+static void eloop_work_deinit(void)
+{
+	struct eloop_work *w;
+#ifdef CONFIG_ELOOP_WORKERS
+	unsigned int i;
+
+	pthread_mutex_lock(&eloop.work_lock);
+	eloop.work_shutdown = 1;
+	pthread_cond_broadcast(&eloop.work_cond);
+	pthread_mutex_unlock(&eloop.work_lock);
+	for (i = 0; i < eloop.work_threads_num; i++)
+		pthread_join(eloop.work_threads[i], NULL);
+	eloop.work_threads_num = 0;
+
+	/* All threads have returned, so running work is now in work_done */
+	while ((w = dl_list_first(&eloop.work_done, struct eloop_work,
+				  list))) {
+		dl_list_del(&w->list);
+		dl_list_add_tail(&eloop.work_queue, &w->list);
+	}
+#endif /* CONFIG_ELOOP_WORKERS */
+
+	while ((w = dl_list_first(&eloop.work_queue, struct eloop_work,
+				  list))) {
+		wpa_printf(MSG_INFO, "ELOOP: remaining work: eloop_data=%p user_data=%p work=%p done=%p",
+			   w->eloop_data, w->user_data, w->work, w->done);
+#ifndef CONFIG_ELOOP_WORKERS
+		eloop_cancel_timeout(eloop_work_run, NULL, w);
+#endif /* CONFIG_ELOOP_WORKERS */
+		dl_list_del(&w->list);
+		os_free(w);
+	}
+
+#ifdef CONFIG_ELOOP_WORKERS
+	if (eloop.work_sock_registered)
+		eloop_unregister_read_sock(eloop.work_fd[0]);
+	eloop.work_sock_registered = 0;
+	eloop.work_pending = 0;
+	if (eloop.work_fd[0] >= 0)
+		close(eloop.work_fd[0]);
+	if (eloop.work_fd[1] >= 0 && eloop.work_fd[1] != eloop.work_fd[0])
+		close(eloop.work_fd[1]);
+	eloop.work_fd[0] = eloop.work_fd[1] = -1;
+	pthread_cond_destroy(&eloop.work_cancel_cond);
+	pthread_cond_destroy(&eloop.work_cond);
+	pthread_mutex_destroy(&eloop.work_lock);
+#endif /* CONFIG_ELOOP_WORKERS */
 }
 
 
@@ -992,6 +1922,12 @@ static void eloop_handle_signal(int sig)
 			break;
 		}
 	}
+
+#ifdef CONFIG_ELOOP_EPOLL
+	/* Wake up epoll_wait() even if the signal was received just before
+	 * entering it */
+	eloop_epoll_wakeup();
+#endif /* CONFIG_ELOOP_EPOLL */
 }
 
 
@@ -1074,7 +2010,7 @@ void eloop_run(void)
 	struct timeval _tv;
 #endif /* CONFIG_ELOOP_SELECT */
 #ifdef CONFIG_ELOOP_EPOLL
-	int timeout_ms = -1;
+	int timeout_ms;
 #endif /* CONFIG_ELOOP_EPOLL */
 #ifdef CONFIG_ELOOP_KQUEUE
 	struct timespec ts;
@@ -1091,7 +2027,7 @@ void eloop_run(void)
 #endif /* CONFIG_ELOOP_SELECT */
 
 	while (!eloop.terminate &&
-	       (!dl_list_empty(&eloop.timeout) || eloop.readers.count > 0 ||
+	       (eloop_first_timeout() || eloop.readers.count > 0 ||
 		eloop.writers.count > 0 || eloop.exceptions.count > 0)) {
 		struct eloop_timeout *timeout;
 
@@ -1108,17 +2044,16 @@ void eloop_run(void)
 				break;
 		}
 
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_first_timeout();
 		if (timeout) {
 			os_get_reltime(&now);
 			if (os_reltime_before(&now, &timeout->time))
 				os_reltime_sub(&timeout->time, &now, &tv);
 			else
 				tv.sec = tv.usec = 0;
-#if defined(CONFIG_ELOOP_POLL) || defined(CONFIG_ELOOP_EPOLL)
+#ifdef CONFIG_ELOOP_POLL
 			timeout_ms = tv.sec * 1000 + tv.usec / 1000;
-#endif /* defined(CONFIG_ELOOP_POLL) || defined(CONFIG_ELOOP_EPOLL) */
+#endif /* CONFIG_ELOOP_POLL */
 #ifdef CONFIG_ELOOP_SELECT
 			_tv.tv_sec = tv.sec;
 			_tv.tv_usec = tv.usec;
@@ -1145,12 +2080,9 @@ void eloop_run(void)
 			     timeout ? &_tv : NULL);
 #endif /* CONFIG_ELOOP_SELECT */
 #ifdef CONFIG_ELOOP_EPOLL
-		if (eloop.count == 0) {
-			res = 0;
-		} else {
-			res = epoll_wait(eloop.epollfd, eloop.epoll_events,
-					 eloop.count, timeout_ms);
-		}
+		timeout_ms = eloop_epoll_timeout(timeout, &tv);
+		res = epoll_wait(eloop.epollfd, eloop.epoll_events,
+				 eloop.epoll_max_event_num, timeout_ms);
 #endif /* CONFIG_ELOOP_EPOLL */
 #ifdef CONFIG_ELOOP_KQUEUE
 		if (eloop.count == 0) {
@@ -1188,8 +2120,7 @@ void eloop_run(void)
 
 
 		/* check if some registered timeouts have occurred */
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_first_timeout();
 		if (timeout) {
 			os_get_reltime(&now);
 			if (!os_reltime_before(&now, &timeout->time)) {
@@ -1206,6 +2137,7 @@ void eloop_run(void)
 		if (res <= 0)
 			continue;
 
+#ifndef CONFIG_ELOOP_EPOLL
 		if (eloop.readers.changed ||
 		    eloop.writers.changed ||
 		    eloop.exceptions.changed) {
@@ -1218,6 +2150,7 @@ void eloop_run(void)
 			  */
 			continue;
 		}
+#endif /* CONFIG_ELOOP_EPOLL */
 
 #ifdef CONFIG_ELOOP_POLL
 		eloop_sock_table_dispatch(&eloop.readers, &eloop.writers,
@@ -1256,12 +2189,13 @@ void eloop_terminate(void)
 
 void eloop_destroy(void)
 {
-	struct eloop_timeout *timeout, *prev;
+	struct eloop_timeout *timeout;
 	struct os_reltime now;
 
+	eloop_work_deinit();
+
 	os_get_reltime(&now);
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
+	while ((timeout = eloop_first_timeout())) {
 		int sec, usec;
 		sec = timeout->time.sec - now.sec;
 		usec = timeout->time.usec - now.usec;
@@ -1282,6 +2216,10 @@ void eloop_destroy(void)
 	eloop_sock_table_destroy(&eloop.writers);
 	eloop_sock_table_destroy(&eloop.exceptions);
 	os_free(eloop.signals);
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	os_free(eloop.timeout_heap);
+	os_free(eloop.timeout_hash);
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
 
 #ifdef CONFIG_ELOOP_POLL
 	os_free(eloop.pollfds);
@@ -1292,6 +2230,10 @@ void eloop_destroy(void)
 #endif /* CONFIG_ELOOP_EPOLL || CONFIG_ELOOP_KQUEUE */
 #ifdef CONFIG_ELOOP_EPOLL
 	os_free(eloop.epoll_events);
+	if (eloop.timerfd >= 0)
+		close(eloop.timerfd);
+	if (eloop.wakeupfd >= 0)
+		close(eloop.wakeupfd);
 	close(eloop.epollfd);
 #endif /* CONFIG_ELOOP_EPOLL */
 #ifdef CONFIG_ELOOP_KQUEUE
@@ -1309,7 +2251,7 @@ int eloop_terminated(void)
 
 void eloop_wait_for_read_sock(int sock)
 {
-#ifdef CONFIG_ELOOP_POLL
+#if defined(CONFIG_ELOOP_POLL) || defined(CONFIG_ELOOP_EPOLL)
 	struct pollfd pfd;
 
 	if (sock < 0)
@@ -1319,14 +2261,14 @@ void eloop_wait_for_read_sock(int sock)
 	pfd.fd = sock;
 	pfd.events = POLLIN;
 
-	poll(&pfd, 1, -1);
-#endif /* CONFIG_ELOOP_POLL */
-#if defined(CONFIG_ELOOP_SELECT) || defined(CONFIG_ELOOP_EPOLL)
 	/*
-	 * We can use epoll() here. But epoll() requres 4 system calls.
-	 * epoll_create1(), epoll_ctl() for ADD, epoll_wait, and close() for
-	 * epoll fd. So select() is better for performance here.
+	 * With epoll, poll() is used here instead of a temporary epoll fd,
+	 * which would need four system calls, and instead of select(), which
+	 * cannot handle fds beyond FD_SETSIZE.
 	 */
+	poll(&pfd, 1, -1);
+#endif /* CONFIG_ELOOP_POLL || CONFIG_ELOOP_EPOLL */
+#ifdef CONFIG_ELOOP_SELECT
 	fd_set rfds;
 
 	if (sock < 0)
@@ -1335,7 +2277,7 @@ void eloop_wait_for_read_sock(int sock)
 	FD_ZERO(&rfds);
 	FD_SET(sock, &rfds);
 	select(sock + 1, &rfds, NULL, NULL, NULL);
-#endif /* defined(CONFIG_ELOOP_SELECT) || defined(CONFIG_ELOOP_EPOLL) */
+#endif /* CONFIG_ELOOP_SELECT */
 #ifdef CONFIG_ELOOP_KQUEUE
 	int kfd;
 	struct kevent ke1, ke2;
@@ -65,6 +65,13 @@ typedef void (*eloop_timeout_handler)(void *eloop_ctx, void *user_ctx);
  */
 typedef void (*eloop_signal_handler)(int sig, void *signal_ctx);
 
+/**
+ * eloop_work_handler - eloop offloaded work callback type
+ * @eloop_ctx: Registered callback context data (eloop_data)
+ * @user_ctx: Registered callback context data (user_data)
+ */
+typedef void (*eloop_work_handler)(void *eloop_ctx, void *user_ctx);
+
 /**
  * eloop_init() - Initialize global event loop data
  * Returns: 0 on success, -1 on failure
@@ -256,6 +263,50 @@ int eloop_replenish_timeout(unsigned int req_secs, unsigned int req_usecs,
 			    eloop_timeout_handler handler, void *eloop_data,
 			    void *user_data);
 
+/**
+ * eloop_submit_work - Run a function outside the event loop
+ * @work: Function to run
+ * @done: Callback function to be called from the event loop once @work has
+ * returned or %NULL if no completion notification is needed
+ * @eloop_data: Callback context data (eloop_ctx)
+ * @user_data: Callback context data (user_ctx)
+ * Returns: 0 on success, -1 on failure
+ *
+ * Queue a potentially slow operation (e.g., a database query or a key
+ * derivation) so that it does not block processing of other events. When
+ * built with CONFIG_ELOOP_WORKERS, @work is called in one of a small pool of
+ * worker threads and @done is called from the event loop thread once it has
+ * returned. Without worker thread support, both are called from the event
+ * loop (from a zero timeout), so callers see the same ordering in both cases.
+ *
+ * @work must not call any eloop_* functions and must not access data that is
+ * used from the event loop thread while the work is pending. Results are
+ * expected to be stored in the context data and processed in @done. Note that
+ * the os_malloc() family is not thread safe in WPA_TRACE builds.
+ *
+ * Pending work keeps eloop_run() from returning in the same way as registered
+ * sockets and timeouts do.
+ */
+int eloop_submit_work(eloop_work_handler work, eloop_work_handler done,
+		      void *eloop_data, void *user_data);
+
+/**
+ * eloop_cancel_work - Cancel submitted work
+ * @work: Matching work function that was used when submitting the work
+ * @eloop_data: Matching eloop_data or %ELOOP_ALL_CTX to match all
+ * @user_data: Matching user_data or %ELOOP_ALL_CTX to match all
+ * Returns: Number of cancelled work items
+ *
+ * Cancel matching work that was submitted with eloop_submit_work() and for
+ * which the done callback has not yet been called. Work that has not yet
+ * started is dropped. If a matching work function is currently running in a
+ * worker thread, this function waits for it to return. In either case, the
+ * done callback will not be called, so the context data can be freed after
+ * this call in the same way as after eloop_cancel_timeout().
+ */
+int eloop_cancel_work(eloop_work_handler work, void *eloop_data,
+		      void *user_data);
+
 /**
  * eloop_register_signal - Register handler for signals
  * @sig: Signal number (e.g., SIGHUP)
@@ -7,6 +7,10 @@
  */
 
 #include "utils/includes.h"
+#ifdef CONFIG_DEBUG_BINLOG
+#include <pthread.h>
+#include <sys/wait.h>
+#endif /* CONFIG_DEBUG_BINLOG */
 
 #include "utils/common.h"
 #include "utils/const_time.h"
@@ -18,6 +22,7 @@
 #include "utils/ip_addr.h"
 #include "utils/eloop.h"
 #include "utils/json.h"
+#include "utils/addr_hash.h"
 #include "utils/module_tests.h"
 
 
@@ -250,6 +255,113 @@ static int int_array_tests(void)
 }
 
 
+struct addr_hash_test_entry {
+	u8 addr[ETH_ALEN];
+	struct addr_hash_node hnode;
+};
+
+
+static int addr_hash_tests(void)
+{
+	struct addr_hash hash;
+	struct addr_hash_test_entry *entries, *e;
+	struct addr_hash_node *node;
+	const unsigned int num = 1000;
+	long offset = ADDR_HASH_ADDR_OFFSET(struct addr_hash_test_entry, hnode,
+					    addr);
+	unsigned int i, count;
+	u8 addr[ETH_ALEN];
+	char buf[200];
+	int errors = 0;
+
+	wpa_printf(MSG_INFO, "addr_hash tests");
+
+	os_memset(&hash, 0, sizeof(hash));
+	os_memset(addr, 0, ETH_ALEN);
+	if (addr_hash_get(&hash, addr))
+		errors++;
+
+	entries = os_calloc(num + 1, sizeof(*entries));
+	if (!entries)
+		return -1;
+
+	/* Only the last octet differs in the first half and only the first
+	 * octet in the second half */
+	for (i = 0; i < num; i++) {
+		e = &entries[i];
+		if (i < num / 2)
+			WPA_PUT_BE16(&e->addr[4], i);
+		else
+			WPA_PUT_BE16(&e->addr[0], i);
+		if (addr_hash_add(&hash, offset, &e->hnode) < 0) {
+			errors++;
+			goto out;
+		}
+	}
+	/* Duplicate address */
+	os_memcpy(entries[num].addr, entries[7].addr, ETH_ALEN);
+	if (addr_hash_add(&hash, offset, &entries[num].hnode) < 0) {
+		errors++;
+		goto out;
+	}
+
+	if (hash.count != num + 1 || hash.size < num / 2 ||
+	    (hash.size & (hash.size - 1)))
+		errors++;
+
+	for (i = 0; i < num; i++) {
+		node = addr_hash_get(&hash, entries[i].addr);
+		if (!node)
+			errors++;
+		else if (os_memcmp(addr_hash_entry(node,
+						   struct addr_hash_test_entry,
+						   hnode)->addr,
+				   entries[i].addr, ETH_ALEN) != 0)
+			errors++;
+	}
+
+	count = 0;
+	for (node = addr_hash_get(&hash, entries[7].addr); node;
+	     node = addr_hash_get_next(&hash, node))
+		count++;
+	if (count != 2)
+		errors++;
+
+	if (addr_hash_stats(&hash, "test", buf, sizeof(buf)) < 0 ||
+	    os_strncmp(buf, "test: size=", 11) != 0)
+		errors++;
+	wpa_printf(MSG_INFO, "addr_hash: %s", buf);
+
+	/* Shrink back down while removing entries */
+	for (i = 0; i <= num; i++) {
+		if (i % 10 == 0 && i < num)
+			continue;
+		if (addr_hash_del(&hash, &entries[i].hnode) < 0)
+			errors++;
+	}
+	if (addr_hash_del(&hash, &entries[1].hnode) == 0)
+		errors++;
+	if (hash.count != num / 10 || hash.size > num / 10 * 4)
+		errors++;
+	for (i = 0; i < num; i++) {
+		node = addr_hash_get(&hash, entries[i].addr);
+		if (i % 10 == 0 ? !node : !!node)
+			errors++;
+	}
+
+out:
+	addr_hash_deinit(&hash);
+	os_free(entries);
+
+	if (errors) {
+		wpa_printf(MSG_ERROR, "%d addr_hash test(s) failed", errors);
+		return -1;
+	}
+
+	return 0;
+}
+
+
 static int ext_password_tests(void)
 {
 	struct ext_password_data *data;
@@ -821,6 +933,200 @@ static void eloop_tests_start(int close_in_timeout)
 }
 
 
+#define ELOOP_BENCH_SOCKS 128
+#define ELOOP_BENCH_EVENTS 2000
+#define ELOOP_BENCH_TIMEOUTS 200
+
+struct eloop_bench {
+	int pipefd[ELOOP_BENCH_SOCKS][2];
+	int sv[2];
+	unsigned int rw_calls[2];
+	unsigned int events;
+	unsigned int timeouts;
+	struct os_reltime sent;
+	struct os_reltime expires;
+	os_time_t sock_usec;
+	os_time_t timeout_usec;
+};
+
+
+static const char * eloop_bench_backend(void)
+{
+#if defined(CONFIG_ELOOP_EPOLL)
+	return "epoll";
+#elif defined(CONFIG_ELOOP_POLL)
+	return "poll";
+#elif defined(CONFIG_ELOOP_KQUEUE)
+	return "kqueue";
+#else
+	return "select";
+#endif
+}
+
+
+static os_time_t eloop_bench_usec_since(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static void eloop_bench_send(struct eloop_bench *b)
+{
+	os_get_reltime(&b->sent);
+	if (write(b->pipefd[b->events % ELOOP_BENCH_SOCKS][1], "B", 1) != 1)
+		wpa_printf(MSG_INFO, "eloop benchmark: write: %s",
+			   strerror(errno));
+}
+
+
+static void eloop_bench_timeout(void *eloop_data, void *user_ctx);
+
+static void eloop_bench_register_timeout(struct eloop_bench *b)
+{
+	os_get_reltime(&b->expires);
+	b->expires.usec += 1000;
+	if (b->expires.usec >= 1000000) {
+		b->expires.sec++;
+		b->expires.usec -= 1000000;
+	}
+	eloop_register_timeout(0, 1000, eloop_bench_timeout, b, NULL);
+}
+
+
+static void eloop_bench_finish(struct eloop_bench *b)
+{
+	int i;
+
+	for (i = 0; i < ELOOP_BENCH_SOCKS; i++) {
+		eloop_unregister_read_sock(b->pipefd[i][0]);
+		close(b->pipefd[i][0]);
+		close(b->pipefd[i][1]);
+	}
+	eloop_unregister_read_sock(b->sv[0]);
+	eloop_unregister_sock(b->sv[0], EVENT_TYPE_WRITE);
+	close(b->sv[0]);
+	close(b->sv[1]);
+
+	if (b->rw_calls[0] != 1 || b->rw_calls[1] != 1)
+		wpa_printf(MSG_ERROR,
+			   "eloop benchmark: FAIL - read/write handler calls %u/%u for the same socket",
+			   b->rw_calls[0], b->rw_calls[1]);
+
+	wpa_printf(MSG_INFO,
+		   "eloop benchmark (%s): %u sockets, %u events, avg dispatch latency %u.%02u usec; %u timeouts, avg lateness %u usec",
+		   eloop_bench_backend(), ELOOP_BENCH_SOCKS, b->events,
+		   (unsigned int) (b->sock_usec / b->events),
+		   (unsigned int) (b->sock_usec * 100 / b->events % 100),
+		   b->timeouts,
+		   (unsigned int) (b->timeout_usec / b->timeouts));
+	os_free(b);
+}
+
+
+static void eloop_bench_timeout(void *eloop_data, void *user_ctx)
+{
+	struct eloop_bench *b = eloop_data;
+
+	b->timeout_usec += eloop_bench_usec_since(&b->expires);
+	if (++b->timeouts == ELOOP_BENCH_TIMEOUTS) {
+		eloop_bench_finish(b);
+		return;
+	}
+
+	eloop_bench_register_timeout(b);
+}
+
+
+static void eloop_bench_read(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct eloop_bench *b = eloop_ctx;
+	char buf[1];
+
+	b->sock_usec += eloop_bench_usec_since(&b->sent);
+	if (read(sock, buf, sizeof(buf)) < 0)
+		wpa_printf(MSG_INFO, "eloop benchmark: read: %s",
+			   strerror(errno));
+	if (++b->events < ELOOP_BENCH_EVENTS) {
+		eloop_bench_send(b);
+		return;
+	}
+
+	/* Socket dispatch done; measure timeout accuracy next */
+	eloop_bench_register_timeout(b);
+}
+
+
+static void eloop_bench_sv_read(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct eloop_bench *b = eloop_ctx;
+	char buf[1];
+
+	b->rw_calls[0]++;
+	if (read(sock, buf, sizeof(buf)) < 0)
+		wpa_printf(MSG_INFO, "eloop benchmark: read: %s",
+			   strerror(errno));
+}
+
+
+static void eloop_bench_sv_write(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct eloop_bench *b = eloop_ctx;
+
+	b->rw_calls[1]++;
+	eloop_unregister_sock(sock, EVENT_TYPE_WRITE);
+}
+
+
+static void eloop_bench_run(void *eloop_data, void *user_ctx)
+{
+	struct eloop_bench *b;
+	int i;
+
+	b = os_zalloc(sizeof(*b));
+	if (!b)
+		return;
+
+	for (i = 0; i < ELOOP_BENCH_SOCKS; i++) {
+		if (pipe(b->pipefd[i]) < 0)
+			break;
+		if (eloop_register_read_sock(b->pipefd[i][0], eloop_bench_read,
+					     b, NULL) < 0) {
+			close(b->pipefd[i][0]);
+			close(b->pipefd[i][1]);
+			break;
+		}
+	}
+	if (i < ELOOP_BENCH_SOCKS) {
+		wpa_printf(MSG_ERROR,
+			   "eloop benchmark: FAIL - could not register pipe %d",
+			   i);
+		while (--i >= 0) {
+			eloop_unregister_read_sock(b->pipefd[i][0]);
+			close(b->pipefd[i][0]);
+			close(b->pipefd[i][1]);
+		}
+		os_free(b);
+		return;
+	}
+
+	/* The same socket registered for both read and write events */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, b->sv) < 0 ||
+	    eloop_register_read_sock(b->sv[0], eloop_bench_sv_read, b,
+				     NULL) < 0 ||
+	    eloop_register_sock(b->sv[0], EVENT_TYPE_WRITE,
+				eloop_bench_sv_write, b, NULL) < 0 ||
+	    write(b->sv[1], "S", 1) != 1)
+		wpa_printf(MSG_ERROR,
+			   "eloop benchmark: FAIL - could not register read and write handler for the same socket");
+
+	eloop_bench_send(b);
+}
+
+
 static void eloop_tests_run(void *eloop_data, void *user_ctx)
 {
 	eloop_tests_start(1);
@@ -837,6 +1143,171 @@ static int eloop_tests(void)
 	 * separate verification of the results from the debug log.
 	 */
 	eloop_register_timeout(0, 0, eloop_tests_run, NULL, NULL);
+	/* Run the benchmark once the blocking parts of the tests are done */
+	eloop_register_timeout(0, 500000, eloop_bench_run, NULL, NULL);
+
+	return 0;
+}
+
+
+static void eloop_test_dummy_cb(void *eloop_data, void *user_ctx)
+{
+	wpa_printf(MSG_ERROR, "%s: FAIL - should not have called this function",
+		   __func__);
+}
+
+
+static int eloop_timeout_tests(void)
+{
+	static int ctx[100];
+	struct os_reltime remaining;
+	unsigned int i;
+	int errors = 0;
+
+	wpa_printf(MSG_INFO, "eloop timeout tests");
+
+	for (i = 0; i < ARRAY_SIZE(ctx); i++) {
+		if (eloop_register_timeout(1000 + i, 0, eloop_test_dummy_cb,
+					   &ctx[i], &ctx[i % 2]) < 0)
+			errors++;
+	}
+
+	if (!eloop_is_timeout_registered(eloop_test_dummy_cb, &ctx[10],
+					 &ctx[0]) ||
+	    eloop_is_timeout_registered(eloop_test_dummy_cb, &ctx[10],
+					&ctx[1]))
+		errors++;
+
+	if (eloop_cancel_timeout_one(eloop_test_dummy_cb, &ctx[11], &ctx[1],
+				     &remaining) != 1 ||
+	    remaining.sec < 1009 || remaining.sec > 1011 ||
+	    eloop_is_timeout_registered(eloop_test_dummy_cb, &ctx[11],
+					&ctx[1]) ||
+	    eloop_cancel_timeout_one(eloop_test_dummy_cb, &ctx[11], &ctx[1],
+				     &remaining) != 0)
+		errors++;
+
+	if (eloop_deplete_timeout(5, 0, eloop_test_dummy_cb, &ctx[12],
+				  &ctx[0]) != 1 ||
+	    eloop_deplete_timeout(5000, 0, eloop_test_dummy_cb, &ctx[12],
+				  &ctx[0]) != 0 ||
+	    eloop_replenish_timeout(2000, 0, eloop_test_dummy_cb, &ctx[13],
+				    &ctx[1]) != 1 ||
+	    eloop_replenish_timeout(10, 0, eloop_test_dummy_cb, &ctx[13],
+				    &ctx[1]) != 0 ||
+	    eloop_deplete_timeout(5, 0, eloop_test_dummy_cb, &ctx[11],
+				  &ctx[1]) != -1)
+		errors++;
+
+	if (eloop_cancel_timeout(eloop_test_dummy_cb, ELOOP_ALL_CTX,
+				 &ctx[0]) != 50 ||
+	    eloop_cancel_timeout(eloop_test_dummy_cb, &ctx[13],
+				 ELOOP_ALL_CTX) != 1 ||
+	    eloop_cancel_timeout(eloop_test_dummy_cb, ELOOP_ALL_CTX,
+				 ELOOP_ALL_CTX) != 48 ||
+	    eloop_is_timeout_registered(eloop_test_dummy_cb, &ctx[99],
+					&ctx[1]))
+		errors++;
+
+	if (errors) {
+		wpa_printf(MSG_ERROR, "%d eloop timeout test(s) failed",
+			   errors);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+#define ELOOP_WORK_TEST_ITEMS 8
+
+struct eloop_work_test {
+	unsigned int in[ELOOP_WORK_TEST_ITEMS];
+	unsigned int out[ELOOP_WORK_TEST_ITEMS];
+	unsigned int done;
+	unsigned int errors;
+};
+
+static struct eloop_work_test eloop_work_test;
+
+
+static void eloop_work_test_work(void *eloop_ctx, void *user_ctx)
+{
+	struct eloop_work_test *t = eloop_ctx;
+	unsigned int *in = user_ctx;
+
+	os_sleep(0, 2000);
+	t->out[in - t->in] = *in * *in;
+}
+
+
+static void eloop_work_test_done(void *eloop_ctx, void *user_ctx)
+{
+	struct eloop_work_test *t = eloop_ctx;
+	unsigned int *in = user_ctx;
+
+	if (in == &t->in[ELOOP_WORK_TEST_ITEMS - 1]) {
+		wpa_printf(MSG_ERROR,
+			   "eloop work: FAIL - done callback for cancelled work");
+		t->errors++;
+	}
+	if (t->out[in - t->in] != *in * *in) {
+		wpa_printf(MSG_ERROR,
+			   "eloop work: FAIL - done callback before work");
+		t->errors++;
+	}
+	t->done++;
+}
+
+
+static void eloop_work_test_check(void *eloop_data, void *user_ctx)
+{
+	struct eloop_work_test *t = eloop_data;
+
+	if (t->done != ELOOP_WORK_TEST_ITEMS - 1 || t->errors)
+		wpa_printf(MSG_ERROR,
+			   "eloop work: FAIL - %u done callbacks, %u errors",
+			   t->done, t->errors);
+	else
+		wpa_printf(MSG_INFO, "eloop work: all done callbacks called");
+}
+
+
+static int eloop_work_tests(void)
+{
+	struct eloop_work_test *t = &eloop_work_test;
+	unsigned int i;
+	int errors = 0;
+
+	wpa_printf(MSG_INFO, "eloop work tests");
+
+	os_memset(t, 0, sizeof(*t));
+	for (i = 0; i < ELOOP_WORK_TEST_ITEMS; i++) {
+		t->in[i] = i + 1;
+		if (eloop_submit_work(eloop_work_test_work,
+				      eloop_work_test_done, t, &t->in[i]) < 0)
+			errors++;
+	}
+
+	/* Cancelling waits for the work function if it has already started, so
+	 * the last item is cancelled regardless of its state */
+	if (eloop_cancel_work(eloop_work_test_work, t,
+			      &t->in[ELOOP_WORK_TEST_ITEMS - 1]) != 1 ||
+	    eloop_cancel_work(eloop_work_test_work, t,
+			      &t->in[ELOOP_WORK_TEST_ITEMS - 1]) != 0 ||
+	    eloop_cancel_work(eloop_work_test_done, ELOOP_ALL_CTX,
+			      ELOOP_ALL_CTX) != 0)
+		errors++;
+
+	if (errors) {
+		wpa_printf(MSG_ERROR, "%d eloop work test(s) failed", errors);
+		eloop_cancel_work(eloop_work_test_work, ELOOP_ALL_CTX,
+				  ELOOP_ALL_CTX);
+		return -1;
+	}
+
+	/* Completion is reported from the event loop */
+	eloop_register_timeout(0, 200000, eloop_work_test_check, t, NULL);
 
 	return 0;
 }
@@ -1209,6 +1680,270 @@ static int const_time_tests(void)
 }
 
 
+#ifndef CONFIG_NO_STDOUT_DEBUG
+
+static int debug_level_eval(int *count)
+{
+	(*count)++;
+	return *count;
+}
+
+
+static int debug_level_tests(void)
+{
+	int level = wpa_debug_level;
+	int module_level = wpa_debug_get_module_level(WPA_DEBUG_MODULE_DEFAULT);
+	int count = 0, ret = -1;
+	const u8 data[] = { 1, 2, 3 };
+
+	wpa_printf(MSG_INFO, "debug level tests");
+
+	if (wpa_debug_module_from_str("SAE") != WPA_DEBUG_MODULE_SAE ||
+	    wpa_debug_module_from_str("radius") != WPA_DEBUG_MODULE_RADIUS ||
+	    wpa_debug_module_from_str("foo") != -1 ||
+	    os_strcmp(wpa_debug_module_str(WPA_DEBUG_MODULE_WPA), "wpa") != 0)
+		goto fail;
+
+	/* Arguments of disabled messages are not evaluated */
+	wpa_debug_level = MSG_ERROR;
+	wpa_debug_set_module_level(WPA_DEBUG_MODULE_DEFAULT, -1);
+	if (!wpa_debug_enabled(MSG_DEBUG)) {
+		wpa_printf(MSG_DEBUG, "debug level test %d",
+			   debug_level_eval(&count));
+		wpa_hexdump(MSG_DEBUG, "debug level test", data,
+			    debug_level_eval(&count));
+		if (count != 0)
+			goto fail;
+	}
+
+	/* Module level enables more verbose messages for the module */
+	wpa_debug_set_module_level(WPA_DEBUG_MODULE_DEFAULT, MSG_DEBUG);
+	if (wpa_debug_get_module_level(WPA_DEBUG_MODULE_DEFAULT) != MSG_DEBUG ||
+	    wpa_debug_enabled(MSG_MSGDUMP) ||
+	    (MSG_DEBUG >= WPA_DEBUG_MIN_LEVEL && !wpa_debug_enabled(MSG_DEBUG)))
+		goto fail;
+	wpa_printf(MSG_DEBUG, "debug level test %d", debug_level_eval(&count));
+	if (MSG_DEBUG >= WPA_DEBUG_MIN_LEVEL && count != 1)
+		goto fail;
+
+	wpa_debug_set_module_level(WPA_DEBUG_MODULE_DEFAULT, -1);
+	if (wpa_debug_get_module_level(WPA_DEBUG_MODULE_DEFAULT) != -1)
+		goto fail;
+
+	ret = 0;
+fail:
+	wpa_debug_level = level;
+	wpa_debug_set_module_level(WPA_DEBUG_MODULE_DEFAULT, module_level);
+	if (ret)
+		wpa_printf(MSG_ERROR, "debug level test failed");
+	return ret;
+}
+
+#endif /* CONFIG_NO_STDOUT_DEBUG */
+
+
+#ifdef CONFIG_DEBUG_BINLOG
+
+static void * binlog_test_thread(void *arg)
+{
+	wpa_printf(MSG_INFO, "binlog thread %d", 1);
+	return NULL;
+}
+
+
+static int binlog_check_msg(const u8 *pos, size_t len)
+{
+	u8 expect[50], *e = expect;
+	s64 ival = -5;
+	u64 uval = 1234567890123ULL;
+	u16 slen;
+
+	/* Values are stored in host byte order */
+	*e++ = 'i';
+	os_memcpy(e, &ival, 8);
+	e += 8;
+	*e++ = 's';
+	slen = 3;
+	os_memcpy(e, &slen, 2);
+	e += 2;
+	os_memcpy(e, "abc", 3);
+	e += 3;
+	*e++ = 'u';
+	os_memcpy(e, &uval, 8);
+	e += 8;
+	*e++ = 's';
+	slen = 2;
+	os_memcpy(e, &slen, 2);
+	e += 2;
+	os_memcpy(e, "xy", 2);
+	e += 2;
+
+	return len >= (size_t) (e - expect) &&
+		os_memcmp(pos, expect, e - expect) == 0;
+}
+
+
+static int binlog_tests(void)
+{
+	char fname[] = "/tmp/wpa_binlog_module_test_XXXXXX";
+	const char *fmt = "binlog test %d %s %llu %.2s";
+	const u8 data[] = { 1, 2, 3 };
+	int level = wpa_debug_level, show_keys = wpa_debug_show_keys;
+	unsigned int fmts = 0, msgs = 0, hexdumps = 0, threads = 0, i;
+	u32 fmt_id = 0, rlen, id;
+	char *buf = NULL;
+	size_t len, pos;
+	pthread_t thread;
+	int ret = -1;
+	u16 thr;
+
+	wpa_printf(MSG_INFO, "binlog tests");
+
+	ret = mkstemp(fname);
+	if (ret < 0)
+		return -1;
+	close(ret);
+	ret = -1;
+	if (wpa_debug_open_binlog(fname) < 0) {
+		unlink(fname);
+		return -1;
+	}
+	wpa_debug_level = MSG_EXCESSIVE;
+	wpa_debug_show_keys = 0;
+	for (i = 0; i < 3; i++)
+		wpa_printf(MSG_DEBUG, "binlog test %d %s %llu %.2s",
+			   -5, "abc", 1234567890123ULL, "xyz");
+	wpa_hexdump(MSG_DEBUG, "binlog hexdump", data, sizeof(data));
+	wpa_hexdump_key(MSG_DEBUG, "binlog hexdump", data, sizeof(data));
+	if (pthread_create(&thread, NULL, binlog_test_thread, NULL) == 0)
+		pthread_join(thread, NULL);
+	wpa_debug_show_keys = show_keys;
+	wpa_debug_level = level;
+	wpa_debug_close_binlog();
+
+	buf = os_readfile(fname, &len);
+	if (!buf || len < 16 || os_memcmp(buf, "WPABLOG\n", 8) != 0)
+		goto fail;
+
+	for (pos = 16; pos + 24 <= len; pos += rlen) {
+		const u8 *rec = (const u8 *) buf + pos;
+
+		os_memcpy(&rlen, rec, 4);
+		os_memcpy(&thr, rec + 6, 2);
+		os_memcpy(&id, rec + 8, 4);
+		if (rlen < 24 || rlen % 8 || rlen > len - pos)
+			goto fail;
+		if (thr)
+			threads++;
+		switch (rec[4]) {
+		case 1: /* format string */
+			if (os_strcmp((const char *) rec + 24, fmt) == 0) {
+				fmts++;
+				fmt_id = id;
+			}
+			break;
+		case 2: /* message */
+			if (id == fmt_id &&
+			    binlog_check_msg(rec + 24, rlen - 24))
+				msgs++;
+			break;
+		case 4: /* hexdump */
+			hexdumps++;
+			break;
+		}
+	}
+
+	if (pos != len || fmts != 1 || msgs != 3 || hexdumps != 2 ||
+	    threads != 2)
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "binlog module test failure");
+	os_free(buf);
+	unlink(fname);
+	return ret;
+}
+
+static int binlog_has_fmt(const char *buf, size_t len, const char *fmt)
+{
+	size_t pos, flen = os_strlen(fmt) + 1;
+
+	for (pos = 0; pos + flen <= len; pos++) {
+		if (os_memcmp(buf + pos, fmt, flen) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+
+static int binlog_fork_tests(void)
+{
+	char fname[] = "/tmp/wpa_binlog_module_test_XXXXXX";
+	int level = wpa_debug_level, ret = -1, status, found = 0, i;
+	char *buf = NULL;
+	size_t len;
+	pid_t pid;
+
+	wpa_printf(MSG_INFO, "binlog fork tests");
+
+	ret = mkstemp(fname);
+	if (ret < 0)
+		return -1;
+	close(ret);
+	ret = -1;
+	if (wpa_debug_open_binlog(fname) < 0) {
+		unlink(fname);
+		return -1;
+	}
+	wpa_debug_level = MSG_EXCESSIVE;
+	wpa_printf(MSG_DEBUG, "binlog parent %d", 1);
+
+	pid = fork();
+	if (pid == 0) {
+		/* The child needs its own writer thread to get the record to
+		 * the file without closing the log */
+		wpa_printf(MSG_DEBUG, "binlog child %d", 2);
+		for (i = 0; i < 50; i++) {
+			buf = os_readfile(fname, &len);
+			found = buf && binlog_has_fmt(buf, len, "binlog child %d");
+			os_free(buf);
+			if (found)
+				break;
+			os_sleep(0, 20000);
+		}
+		wpa_debug_close_binlog();
+		_exit(found ? 0 : 1);
+	}
+	if (pid < 0 || waitpid(pid, &status, 0) != pid ||
+	    !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		wpa_debug_level = level;
+		wpa_debug_close_binlog();
+		goto fail;
+	}
+
+	wpa_printf(MSG_DEBUG, "binlog parent %d", 3);
+	wpa_debug_level = level;
+	wpa_debug_close_binlog();
+
+	buf = os_readfile(fname, &len);
+	if (!buf || !binlog_has_fmt(buf, len, "binlog parent %d") ||
+	    !binlog_has_fmt(buf, len, "binlog child %d"))
+		goto fail;
+
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_ERROR, "binlog fork module test failure");
+	os_free(buf);
+	unlink(fname);
+	return ret;
+}
+
+#endif /* CONFIG_DEBUG_BINLOG */
+
+
 int utils_module_tests(void)
 {
 	int ret = 0;
@@ -1225,10 +1960,23 @@ int utils_module_tests(void)
 	    wpabuf_tests() < 0 ||
 	    ip_addr_tests() < 0 ||
 	    eloop_tests() < 0 ||
+	    eloop_timeout_tests() < 0 ||
+	    eloop_work_tests() < 0 ||
 	    json_tests() < 0 ||
 	    const_time_tests() < 0 ||
-	    int_array_tests() < 0)
+	    int_array_tests() < 0 ||
+	    addr_hash_tests() < 0)
+		ret = -1;
+
+#ifndef CONFIG_NO_STDOUT_DEBUG
+	if (debug_level_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_NO_STDOUT_DEBUG */
+
+#ifdef CONFIG_DEBUG_BINLOG
+	if (binlog_tests() < 0 || binlog_fork_tests() < 0)
 		ret = -1;
+#endif /* CONFIG_DEBUG_BINLOG */
 
 	return ret;
 }
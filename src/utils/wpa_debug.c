@@ -31,10 +31,105 @@ int wpa_debug_level = MSG_INFO;
 int wpa_debug_show_keys = 0;
 int wpa_debug_timestamp = 0;
 int wpa_debug_syslog = 0;
+#ifdef CONFIG_DEBUG_BINLOG
+/* Set by wpa_debug_open_binlog() while the binary debug log is in use */
+void (*wpa_debug_binlog_printf)(int level, const char *fmt, va_list ap) = NULL;
+void (*wpa_debug_binlog_hexdump)(int level, const char *title, const void *buf,
+				 size_t len, int show, int ascii) = NULL;
+#endif /* CONFIG_DEBUG_BINLOG */
 #ifndef CONFIG_NO_STDOUT_DEBUG
 static FILE *out_file = NULL;
 #endif /* CONFIG_NO_STDOUT_DEBUG */
 
+#define WPA_DEBUG_MODULE_LEVEL_UNSET (MSG_ERROR + 1)
+
+/* Indexed by enum wpa_debug_module */
+static const char * const wpa_debug_module_names[NUM_WPA_DEBUG_MODULES] = {
+	"default", "sae", "radius", "wpa"
+};
+
+/* Levels configured with wpa_debug_set_module_level() */
+static int wpa_debug_module_override[NUM_WPA_DEBUG_MODULES] = {
+	WPA_DEBUG_MODULE_LEVEL_UNSET, WPA_DEBUG_MODULE_LEVEL_UNSET,
+	WPA_DEBUG_MODULE_LEVEL_UNSET, WPA_DEBUG_MODULE_LEVEL_UNSET
+};
+
+/* Levels used by wpa_debug_enabled(); also includes Linux tracing */
+int wpa_debug_module_level[NUM_WPA_DEBUG_MODULES] = {
+	WPA_DEBUG_MODULE_LEVEL_UNSET, WPA_DEBUG_MODULE_LEVEL_UNSET,
+	WPA_DEBUG_MODULE_LEVEL_UNSET, WPA_DEBUG_MODULE_LEVEL_UNSET
+};
+
+
+static void wpa_debug_update_module_levels(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_WPA_DEBUG_MODULES; i++) {
+		wpa_debug_module_level[i] = wpa_debug_module_override[i];
+#ifdef CONFIG_DEBUG_LINUX_TRACING
+		/* Linux tracing records messages of all levels */
+		if (wpa_debug_tracing_file)
+			wpa_debug_module_level[i] = MSG_EXCESSIVE;
+#endif /* CONFIG_DEBUG_LINUX_TRACING */
+	}
+}
+
+
+int wpa_debug_module_from_str(const char *name)
+{
+	int i;
+
+	for (i = 0; i < NUM_WPA_DEBUG_MODULES; i++) {
+		if (os_strcasecmp(name, wpa_debug_module_names[i]) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+
+const char * wpa_debug_module_str(int module)
+{
+	if (module < 0 || module >= NUM_WPA_DEBUG_MODULES)
+		return "?";
+	return wpa_debug_module_names[module];
+}
+
+
+/**
+ * wpa_debug_get_module_level - Get the debug level configured for a module
+ * @module: Debug module (enum wpa_debug_module)
+ * Returns: Debug level (MSG_*) or -1 if no level is configured for the module
+ */
+int wpa_debug_get_module_level(int module)
+{
+	if (module < 0 || module >= NUM_WPA_DEBUG_MODULES ||
+	    wpa_debug_module_override[module] == WPA_DEBUG_MODULE_LEVEL_UNSET)
+		return -1;
+	return wpa_debug_module_override[module];
+}
+
+
+/**
+ * wpa_debug_set_module_level - Configure the debug level for a module
+ * @module: Debug module (enum wpa_debug_module)
+ * @level: Debug level (MSG_*) or -1 to use only wpa_debug_level
+ *
+ * Messages from the module are shown if their level is at least @level or
+ * wpa_debug_level, i.e., this can be used to get more verbose debug output
+ * from a single module.
+ */
+void wpa_debug_set_module_level(int module, int level)
+{
+	if (module < 0 || module >= NUM_WPA_DEBUG_MODULES)
+		return;
+	if (level < MSG_EXCESSIVE || level > MSG_ERROR)
+		level = WPA_DEBUG_MODULE_LEVEL_UNSET;
+	wpa_debug_module_override[module] = level;
+	wpa_debug_update_module_levels();
+}
+
 
 #ifdef CONFIG_ANDROID_LOG
 
@@ -193,6 +288,7 @@ int wpa_debug_open_linux_tracing(void)
 		printf("failed to fdopen()\n");
 		return -1;
 	}
+	wpa_debug_update_module_levels();
 
 	return 0;
 }
@@ -204,27 +300,45 @@ void wpa_debug_close_linux_tracing(void)
 		return;
 	fclose(wpa_debug_tracing_file);
 	wpa_debug_tracing_file = NULL;
+	wpa_debug_update_module_levels();
 }
 
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
 
+static int wpa_debug_output(int module, int level)
+{
+	return level >= wpa_debug_level ||
+		level >= wpa_debug_module_override[module];
+}
+
+
 /**
- * wpa_printf - conditional printf
+ * _wpa_printf - Debug print backend for wpa_printf()
+ * @module: Debug module (enum wpa_debug_module) of the caller
  * @level: priority level (MSG_*) of the message
  * @fmt: printf format string, followed by optional arguments
  *
- * This function is used to print conditional debugging and error messages. The
- * output may be directed to stdout, stderr, and/or syslog based on
- * configuration.
+ * This is called by the wpa_printf() macro after wpa_debug_enabled() has
+ * accepted the message. The output may be directed to stdout, stderr, and/or
+ * syslog based on configuration.
  *
  * Note: New line '\n' is added to the end of the text when printing to stdout.
  */
-void wpa_printf(int level, const char *fmt, ...)
+void _wpa_printf(int module, int level, const char *fmt, ...)
 {
 	va_list ap;
+	int output = wpa_debug_output(module, level);
 
-	if (level >= wpa_debug_level) {
+#ifdef CONFIG_DEBUG_BINLOG
+	if (output && wpa_debug_binlog_printf) {
+		va_start(ap, fmt);
+		wpa_debug_binlog_printf(level, fmt, ap);
+		va_end(ap);
+		output = 0;
+	}
+#endif /* CONFIG_DEBUG_BINLOG */
+	if (output) {
 #ifdef CONFIG_ANDROID_LOG
 		va_start(ap, fmt);
 		__android_log_vprint(wpa_to_android_level(level),
@@ -269,8 +383,9 @@ void wpa_printf(int level, const char *fmt, ...)
 }
 
 
-static void _wpa_hexdump(int level, const char *title, const u8 *buf,
-			 size_t len, int show, int only_syslog)
+static void wpa_hexdump_output(int module, int level, const char *title,
+			       const u8 *buf, size_t len, int show,
+			       int only_syslog)
 {
 	size_t i;
 
@@ -292,8 +407,14 @@ static void _wpa_hexdump(int level, const char *title, const u8 *buf,
 	}
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
-	if (level < wpa_debug_level)
+	if (!wpa_debug_output(module, level))
+		return;
+#ifdef CONFIG_DEBUG_BINLOG
+	if (wpa_debug_binlog_hexdump) {
+		wpa_debug_binlog_hexdump(level, title, buf, len, show, 0);
 		return;
+	}
+#endif /* CONFIG_DEBUG_BINLOG */
 #ifdef CONFIG_ANDROID_LOG
 	{
 		const char *display;
@@ -396,20 +517,26 @@ static void _wpa_hexdump(int level, const char *title, const u8 *buf,
 #endif /* CONFIG_ANDROID_LOG */
 }
 
-void wpa_hexdump(int level, const char *title, const void *buf, size_t len)
-{
-	_wpa_hexdump(level, title, buf, len, 1, 0);
-}
-
-
-void wpa_hexdump_key(int level, const char *title, const void *buf, size_t len)
+/**
+ * _wpa_hexdump - Hex dump backend for wpa_hexdump() and wpa_hexdump_key()
+ * @module: Debug module (enum wpa_debug_module) of the caller
+ * @level: priority level (MSG_*) of the message
+ * @title: title of for the message
+ * @buf: data buffer to be dumped
+ * @len: length of the buf
+ * @key: Whether buf contains keys that are shown only with
+ *	wpa_debug_show_keys
+ */
+void _wpa_hexdump(int module, int level, const char *title, const void *buf,
+		  size_t len, int key)
 {
-	_wpa_hexdump(level, title, buf, len, wpa_debug_show_keys, 0);
+	wpa_hexdump_output(module, level, title, buf, len,
+			   !key || wpa_debug_show_keys, 0);
 }
 
 
-static void _wpa_hexdump_ascii(int level, const char *title, const void *buf,
-			       size_t len, int show)
+static void wpa_hexdump_ascii_output(int module, int level, const char *title,
+				     const void *buf, size_t len, int show)
 {
 	size_t i, llen;
 	const u8 *pos = buf;
@@ -434,14 +561,20 @@ static void _wpa_hexdump_ascii(int level, const char *title, const void *buf,
 	}
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
-	if (level < wpa_debug_level)
+	if (!wpa_debug_output(module, level))
 		return;
+#ifdef CONFIG_DEBUG_BINLOG
+	if (wpa_debug_binlog_hexdump) {
+		wpa_debug_binlog_hexdump(level, title, buf, len, show, 1);
+		return;
+	}
+#endif /* CONFIG_DEBUG_BINLOG */
 #ifdef CONFIG_ANDROID_LOG
-	_wpa_hexdump(level, title, buf, len, show, 0);
+	wpa_hexdump_output(module, level, title, buf, len, show, 0);
 #else /* CONFIG_ANDROID_LOG */
 #ifdef CONFIG_DEBUG_SYSLOG
 	if (wpa_debug_syslog)
-		_wpa_hexdump(level, title, buf, len, show, 1);
+		wpa_hexdump_output(module, level, title, buf, len, show, 1);
 #endif /* CONFIG_DEBUG_SYSLOG */
 	wpa_debug_print_timestamp();
 #ifdef CONFIG_DEBUG_FILE
@@ -521,17 +654,21 @@ file_done:
 }
 
 
-void wpa_hexdump_ascii(int level, const char *title, const void *buf,
-		       size_t len)
-{
-	_wpa_hexdump_ascii(level, title, buf, len, 1);
-}
-
-
-void wpa_hexdump_ascii_key(int level, const char *title, const void *buf,
-			   size_t len)
+/**
+ * _wpa_hexdump_ascii - Hex dump backend for wpa_hexdump_ascii{,_key}()
+ * @module: Debug module (enum wpa_debug_module) of the caller
+ * @level: priority level (MSG_*) of the message
+ * @title: title of for the message
+ * @buf: data buffer to be dumped
+ * @len: length of the buf
+ * @key: Whether buf contains keys that are shown only with
+ *	wpa_debug_show_keys
+ */
+void _wpa_hexdump_ascii(int module, int level, const char *title,
+			const void *buf, size_t len, int key)
 {
-	_wpa_hexdump_ascii(level, title, buf, len, wpa_debug_show_keys);
+	wpa_hexdump_ascii_output(module, level, title, buf, len,
+				 !key || wpa_debug_show_keys);
 }
 
 
@@ -636,15 +773,35 @@ void wpa_debug_setup_stdout(void)
 #ifndef CONFIG_NO_WPA_MSG
 static wpa_msg_cb_func wpa_msg_cb = NULL;
 static wpa_msg_cb_func wpa_msg_hidl_cb = NULL;
+static int wpa_msg_cb_min_level = MSG_EXCESSIVE;
+int wpa_msg_cb_level = MSG_ERROR + 1;
+
+static void wpa_msg_update_cb_level(void)
+{
+	if (wpa_msg_hidl_cb)
+		wpa_msg_cb_level = MSG_EXCESSIVE;
+	else if (wpa_msg_cb)
+		wpa_msg_cb_level = wpa_msg_cb_min_level;
+	else
+		wpa_msg_cb_level = MSG_ERROR + 1;
+}
 
 void wpa_msg_register_cb(wpa_msg_cb_func func)
 {
 	wpa_msg_cb = func;
+	wpa_msg_update_cb_level();
 }
 
 void wpa_msg_register_hidl_cb(wpa_msg_cb_func func)
 {
 	wpa_msg_hidl_cb = func;
+	wpa_msg_update_cb_level();
+}
+
+void wpa_msg_set_cb_level(int level)
+{
+	wpa_msg_cb_min_level = level;
+	wpa_msg_update_cb_level();
 }
 
 static wpa_msg_get_ifname_func wpa_msg_ifname_cb = NULL;
@@ -663,6 +820,9 @@ void wpa_msg(void *ctx, int level, const char *fmt, ...)
 	int len;
 	char prefix[130];
 
+	if (!wpa_debug_enabled(level) && !wpa_msg_cb_enabled(level))
+		return;
+
 	va_start(ap, fmt);
 	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
 	va_end(ap);
@@ -702,7 +862,7 @@ void wpa_msg_ctrl(void *ctx, int level, const char *fmt, ...)
 	int buflen;
 	int len;
 
-	if (!wpa_msg_cb && !wpa_msg_hidl_cb)
+	if (!wpa_msg_cb_enabled(level))
 		return;
 
 	va_start(ap, fmt);
@@ -733,6 +893,9 @@ void wpa_msg_global(void *ctx, int level, const char *fmt, ...)
 	int buflen;
 	int len;
 
+	if (!wpa_debug_enabled(level) && !wpa_msg_cb_enabled(level))
+		return;
+
 	va_start(ap, fmt);
 	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
 	va_end(ap);
@@ -762,7 +925,7 @@ void wpa_msg_global_ctrl(void *ctx, int level, const char *fmt, ...)
 	int buflen;
 	int len;
 
-	if (!wpa_msg_cb && !wpa_msg_hidl_cb)
+	if (!wpa_msg_cb_enabled(level))
 		return;
 
 	va_start(ap, fmt);
@@ -793,6 +956,9 @@ void wpa_msg_no_global(void *ctx, int level, const char *fmt, ...)
 	int buflen;
 	int len;
 
+	if (!wpa_debug_enabled(level) && !wpa_msg_cb_enabled(level))
+		return;
+
 	va_start(ap, fmt);
 	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
 	va_end(ap);
@@ -823,6 +989,9 @@ void wpa_msg_global_only(void *ctx, int level, const char *fmt, ...)
 	int buflen;
 	int len;
 
+	if (!wpa_debug_enabled(level) && !wpa_msg_cb_enabled(level))
+		return;
+
 	va_start(ap, fmt);
 	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
 	va_end(ap);
@@ -23,8 +23,42 @@ enum {
 	MSG_EXCESSIVE, MSG_MSGDUMP, MSG_DEBUG, MSG_INFO, MSG_WARNING, MSG_ERROR
 };
 
+/*
+ * Debug modules allow the debug level to be lowered for a subset of the
+ * code without enabling verbose debugging everywhere. A source file selects
+ * its module by defining WPA_DEBUG_MODULE before including this header.
+ */
+enum wpa_debug_module {
+	WPA_DEBUG_MODULE_DEFAULT,
+	WPA_DEBUG_MODULE_SAE,
+	WPA_DEBUG_MODULE_RADIUS,
+	WPA_DEBUG_MODULE_WPA,
+	NUM_WPA_DEBUG_MODULES
+};
+
+#ifndef WPA_DEBUG_MODULE
+#define WPA_DEBUG_MODULE WPA_DEBUG_MODULE_DEFAULT
+#endif /* WPA_DEBUG_MODULE */
+
+/*
+ * Debug messages below this level are removed at compile time
+ * (CONFIG_DEBUG_MIN_LEVEL build option).
+ */
+#ifndef WPA_DEBUG_MIN_LEVEL
+#define WPA_DEBUG_MIN_LEVEL MSG_EXCESSIVE
+#endif /* WPA_DEBUG_MIN_LEVEL */
+
+/* Lowest level enabled per module in addition to wpa_debug_level */
+extern int wpa_debug_module_level[NUM_WPA_DEBUG_MODULES];
+
+int wpa_debug_module_from_str(const char *name);
+const char * wpa_debug_module_str(int module);
+int wpa_debug_get_module_level(int module);
+void wpa_debug_set_module_level(int module, int level);
+
 #ifdef CONFIG_NO_STDOUT_DEBUG
 
+#define wpa_debug_enabled(level) 0
 #define wpa_debug_print_timestamp() do { } while (0)
 #define wpa_printf(args...) do { } while (0)
 #define wpa_hexdump(l,t,b,le) do { } while (0)
@@ -45,6 +79,20 @@ static inline int wpa_debug_reopen_file(void)
 
 #else /* CONFIG_NO_STDOUT_DEBUG */
 
+/**
+ * wpa_debug_enabled - Check whether a debug message would be shown
+ * @level: priority level (MSG_*) of the message
+ *
+ * The debug print macros below use this to skip evaluating the message
+ * arguments when the message would be discarded. It evaluates to true if
+ * @level is enabled either globally or for the debug module of the calling
+ * source file.
+ */
+#define wpa_debug_enabled(level)					\
+	((level) >= WPA_DEBUG_MIN_LEVEL &&				\
+	 ((level) >= wpa_debug_level ||					\
+	  (level) >= wpa_debug_module_level[WPA_DEBUG_MODULE]))
+
 int wpa_debug_open_file(const char *path);
 int wpa_debug_reopen_file(void);
 void wpa_debug_close_file(void);
@@ -70,8 +118,14 @@ void wpa_debug_print_timestamp(void);
  *
  * Note: New line '\n' is added to the end of the text when printing to stdout.
  */
-void wpa_printf(int level, const char *fmt, ...)
-PRINTF_FORMAT(2, 3);
+void _wpa_printf(int module, int level, const char *fmt, ...)
+PRINTF_FORMAT(3, 4);
+
+#define wpa_printf(level, ...)						\
+	do {								\
+		if (wpa_debug_enabled(level))				\
+			_wpa_printf(WPA_DEBUG_MODULE, (level), __VA_ARGS__); \
+	} while (0)
 
 /**
  * wpa_hexdump - conditional hex dump
@@ -84,14 +138,19 @@ PRINTF_FORMAT(2, 3);
  * output may be directed to stdout, stderr, and/or syslog based on
  * configuration. The contents of buf is printed out has hex dump.
  */
-void wpa_hexdump(int level, const char *title, const void *buf, size_t len);
+#define wpa_hexdump(level, title, buf, len)				\
+	do {								\
+		if (wpa_debug_enabled(level))				\
+			_wpa_hexdump(WPA_DEBUG_MODULE, (level), (title), \
+				     (buf), (len), 0);			\
+	} while (0)
 
-static inline void wpa_hexdump_buf(int level, const char *title,
-				   const struct wpabuf *buf)
-{
-	wpa_hexdump(level, title, buf ? wpabuf_head(buf) : NULL,
-		    buf ? wpabuf_len(buf) : 0);
-}
+#define wpa_hexdump_buf(level, title, buf)				\
+	do {								\
+		if (wpa_debug_enabled(level))				\
+			_wpa_hexdump_buf(WPA_DEBUG_MODULE, (level), (title), \
+					 (buf), 0);			\
+	} while (0)
 
 /**
  * wpa_hexdump_key - conditional hex dump, hide keys
@@ -106,14 +165,19 @@ static inline void wpa_hexdump_buf(int level, const char *title,
  * like wpa_hexdump(), but by default, does not include secret keys (passwords,
  * etc.) in debug output.
  */
-void wpa_hexdump_key(int level, const char *title, const void *buf, size_t len);
+#define wpa_hexdump_key(level, title, buf, len)			\
+	do {								\
+		if (wpa_debug_enabled(level))				\
+			_wpa_hexdump(WPA_DEBUG_MODULE, (level), (title), \
+				     (buf), (len), 1);			\
+	} while (0)
 
-static inline void wpa_hexdump_buf_key(int level, const char *title,
-				       const struct wpabuf *buf)
-{
-	wpa_hexdump_key(level, title, buf ? wpabuf_head(buf) : NULL,
-			buf ? wpabuf_len(buf) : 0);
-}
+#define wpa_hexdump_buf_key(level, title, buf)				\
+	do {								\
+		if (wpa_debug_enabled(level))				\
+			_wpa_hexdump_buf(WPA_DEBUG_MODULE, (level), (title), \
+					 (buf), 1);			\
+	} while (0)
 
 /**
  * wpa_hexdump_ascii - conditional hex dump
@@ -128,8 +192,12 @@ static inline void wpa_hexdump_buf_key(int level, const char *title,
  * the hex numbers and ASCII characters (for printable range) are shown. 16
  * bytes per line will be shown.
  */
-void wpa_hexdump_ascii(int level, const char *title, const void *buf,
-		       size_t len);
+#define wpa_hexdump_ascii(level, title, buf, len)			\
+	do {								\
+		if (wpa_debug_enabled(level))				\
+			_wpa_hexdump_ascii(WPA_DEBUG_MODULE, (level), (title), \
+					   (buf), (len), 0);		\
+	} while (0)
 
 /**
  * wpa_hexdump_ascii_key - conditional hex dump, hide keys
@@ -145,16 +213,39 @@ void wpa_hexdump_ascii(int level, const char *title, const void *buf,
  * bytes per line will be shown. This works like wpa_hexdump_ascii(), but by
  * default, does not include secret keys (passwords, etc.) in debug output.
  */
-void wpa_hexdump_ascii_key(int level, const char *title, const void *buf,
-			   size_t len);
+#define wpa_hexdump_ascii_key(level, title, buf, len)			\
+	do {								\
+		if (wpa_debug_enabled(level))				\
+			_wpa_hexdump_ascii(WPA_DEBUG_MODULE, (level), (title), \
+					   (buf), (len), 1);		\
+	} while (0)
+
+void _wpa_hexdump(int module, int level, const char *title, const void *buf,
+		  size_t len, int key);
+void _wpa_hexdump_ascii(int module, int level, const char *title,
+			const void *buf, size_t len, int key);
+
+static inline void _wpa_hexdump_buf(int module, int level, const char *title,
+				    const struct wpabuf *buf, int key)
+{
+	_wpa_hexdump(module, level, title, buf ? wpabuf_head(buf) : NULL,
+		     buf ? wpabuf_len(buf) : 0, key);
+}
 
 /*
  * wpa_dbg() behaves like wpa_msg(), but it can be removed from build to reduce
  * binary size. As such, it should be used with debugging messages that are not
  * needed in the control interface while wpa_msg() has to be used for anything
- * that needs to shown to control interface monitors.
+ * that needs to shown to control interface monitors. Unlike wpa_msg(), the
+ * arguments are not evaluated if neither the debug log nor any control
+ * interface monitor would receive the message.
  */
-#define wpa_dbg(args...) wpa_msg(args)
+#define wpa_dbg(ctx, level, ...)					\
+	do {								\
+		if ((level) >= WPA_DEBUG_MIN_LEVEL &&			\
+		    (wpa_debug_enabled(level) || wpa_msg_cb_enabled(level))) \
+			wpa_msg((ctx), (level), __VA_ARGS__);		\
+	} while (0)
 
 #endif /* CONFIG_NO_STDOUT_DEBUG */
 
@@ -169,7 +260,14 @@ void wpa_hexdump_ascii_key(int level, const char *title, const void *buf,
 #define wpa_msg_register_cb(f) do { } while (0)
 #define wpa_msg_register_hidl_cb(f) do { } while (0)
 #define wpa_msg_register_ifname_cb(f) do { } while (0)
+#define wpa_msg_set_cb_level(l) do { } while (0)
+#define wpa_msg_cb_enabled(level) 0
 #else /* CONFIG_NO_WPA_MSG */
+
+/* Lowest level that a registered wpa_msg() callback is interested in */
+extern int wpa_msg_cb_level;
+#define wpa_msg_cb_enabled(level) ((level) >= wpa_msg_cb_level)
+
 /**
  * wpa_msg - Conditional printf for default target and ctrl_iface monitors
  * @ctx: Pointer to context data; this is the ctx variable registered
@@ -276,6 +374,17 @@ typedef void (*wpa_msg_cb_func)(void *ctx, int level, enum wpa_msg_type type,
  */
 void wpa_msg_register_cb(wpa_msg_cb_func func);
 void wpa_msg_register_hidl_cb(wpa_msg_cb_func func);
+
+/**
+ * wpa_msg_set_cb_level - Set the lowest level the wpa_msg() callback uses
+ * @level: Lowest priority level (MSG_*) that the callback registered with
+ *	wpa_msg_register_cb() forwards; MSG_ERROR + 1 if it forwards nothing
+ *
+ * Messages below this level and below the debug level are discarded without
+ * being formatted. The default, MSG_EXCESSIVE, passes all messages to the
+ * callback.
+ */
+void wpa_msg_set_cb_level(int level);
 typedef const char * (*wpa_msg_get_ifname_func)(void *ctx);
 void wpa_msg_register_ifname_cb(wpa_msg_get_ifname_func func);
 
@@ -350,6 +459,30 @@ static inline void wpa_debug_close_linux_tracing(void)
 
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
+#ifdef CONFIG_DEBUG_BINLOG
+
+extern void (*wpa_debug_binlog_printf)(int level, const char *fmt,
+				       va_list ap);
+extern void (*wpa_debug_binlog_hexdump)(int level, const char *title,
+					const void *buf, size_t len, int show,
+					int ascii);
+
+int wpa_debug_open_binlog(const char *path);
+void wpa_debug_close_binlog(void);
+
+#else /* CONFIG_DEBUG_BINLOG */
+
+static inline int wpa_debug_open_binlog(const char *path)
+{
+	return -1;
+}
+
+static inline void wpa_debug_close_binlog(void)
+{
+}
+
+#endif /* CONFIG_DEBUG_BINLOG */
+
 
 #ifdef EAPOL_TEST
 #define WPA_ASSERT(a)						       \
@@ -0,0 +1,913 @@
+/*
+ * wpa_supplicant/hostapd / Binary debug log
+ * Copyright (c) 2026, The Android Open Source Project
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * When the binary debug log is enabled, wpa_printf() and the hexdump functions
+ * do not format their output. Instead, the format string is recorded once per
+ * thread and each message stores only a reference to it together with the raw
+ * argument values. Records are written to a per-thread single-producer,
+ * single-consumer ring buffer without locking and a background thread drains
+ * the ring buffers to the log file. wpa_supplicant/utils/binlog_decode.py
+ * converts the log file to the normal text format.
+ */
+
+#include "includes.h"
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+
+#include "common.h"
+
+/*
+ * The ring buffers are used from any thread, so they are allocated with the C
+ * library functions instead of os_malloc() which is not thread safe when
+ * built with WPA_TRACE.
+ */
+
+#ifndef WPA_DEBUG_BINLOG_RING_SIZE
+#define WPA_DEBUG_BINLOG_RING_SIZE (1024 * 1024)
+#endif /* WPA_DEBUG_BINLOG_RING_SIZE */
+
+/* Ring positions are masked with size - 1 */
+#if WPA_DEBUG_BINLOG_RING_SIZE <= 0 || \
+	(WPA_DEBUG_BINLOG_RING_SIZE & (WPA_DEBUG_BINLOG_RING_SIZE - 1)) != 0
+#error WPA_DEBUG_BINLOG_RING_SIZE must be a power of two
+#endif
+
+/* Maximum length of the fixed part of a record (header and arguments) */
+#define BINLOG_MAX_REC 2048
+/* Maximum length of hexdump data in a record */
+#define BINLOG_MAX_DATA (WPA_DEBUG_BINLOG_RING_SIZE / 8)
+/* Interval for draining the ring buffers in milliseconds */
+#define BINLOG_DRAIN_INTERVAL 100
+
+#define BINLOG_MAGIC "WPABLOG\n"
+#define BINLOG_VERSION 1
+
+enum binlog_rec_type {
+	BINLOG_REC_FMT = 1, /* id: string id, data: nul terminated string */
+	BINLOG_REC_MSG = 2, /* id: format string id, data: arguments */
+	BINLOG_REC_TEXT = 3, /* data: formatted message */
+	BINLOG_REC_HEXDUMP = 4, /* id: title id, data: binlog_hexdump + buf */
+	BINLOG_REC_DROPPED = 5, /* id: number of dropped records */
+};
+
+/* Argument tags in BINLOG_REC_MSG records */
+#define BINLOG_ARG_INT 'i' /* s64 */
+#define BINLOG_ARG_UINT 'u' /* u64 */
+#define BINLOG_ARG_DOUBLE 'd' /* double */
+#define BINLOG_ARG_STR 's' /* u16 length + string without nul */
+#define BINLOG_ARG_PTR 'p' /* u64 */
+
+/* Records and values are in host byte order; the file header has the magic,
+ * version, and a byte order marker. */
+struct binlog_file_hdr {
+	char magic[8];
+	u32 version;
+	u32 byte_order; /* 0x01020304 */
+};
+
+struct binlog_rec_hdr {
+	u32 len; /* including the header, padded to a multiple of 8 */
+	u8 type; /* enum binlog_rec_type */
+	u8 level;
+	u16 thread;
+	u32 id;
+	u32 usec;
+	u64 sec;
+};
+
+#define BINLOG_HEXDUMP_SHOW BIT(0)
+#define BINLOG_HEXDUMP_NULL BIT(1)
+#define BINLOG_HEXDUMP_ASCII BIT(2)
+
+struct binlog_hexdump {
+	u32 flags;
+	u32 len; /* original length */
+	u32 data_len; /* length of the data in the record */
+};
+
+struct binlog_fmt {
+	const char *ptr;
+	char *str;
+	u32 id;
+};
+
+struct binlog_ring {
+	struct binlog_ring *next;
+	u8 *buf;
+	size_t size;
+	size_t head; /* written by the producer */
+	size_t tail; /* written by the writer thread */
+	int done; /* producer thread has exited */
+	u16 thread;
+
+	/* Producer thread only */
+	struct binlog_fmt *fmts;
+	unsigned int fmts_size;
+	unsigned int num_fmts;
+	unsigned int dropped;
+};
+
+static int binlog_active;
+
+static int binlog_fd = -1;
+static pthread_t binlog_writer;
+static int binlog_writer_running; /* protected by binlog_lock */
+static int binlog_wake[2] = { -1, -1 };
+static int binlog_stop;
+static pthread_mutex_t binlog_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct binlog_ring *binlog_rings; /* protected by binlog_lock */
+static u16 binlog_threads;
+static u32 binlog_next_id = 1;
+static unsigned int binlog_gen;
+static pthread_key_t binlog_key;
+static int binlog_key_set;
+static int binlog_atfork_set;
+
+static __thread struct binlog_ring *binlog_thread_ring;
+static __thread unsigned int binlog_thread_gen;
+
+
+static void binlog_thread_exit(void *ptr)
+{
+	struct binlog_ring *ring = ptr;
+
+	/* The ring has already been freed if the log was closed */
+	pthread_mutex_lock(&binlog_lock);
+	if (ring == binlog_thread_ring && binlog_thread_gen == binlog_gen)
+		__atomic_store_n(&ring->done, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&binlog_lock);
+}
+
+
+static void binlog_ring_free(struct binlog_ring *ring)
+{
+	unsigned int i;
+
+	for (i = 0; i < ring->fmts_size; i++)
+		free(ring->fmts[i].str);
+	free(ring->fmts);
+	free(ring->buf);
+	free(ring);
+}
+
+
+static int binlog_start_writer(void);
+
+
+static struct binlog_ring * binlog_get_ring(void)
+{
+	struct binlog_ring *ring;
+	unsigned int gen = __atomic_load_n(&binlog_gen, __ATOMIC_ACQUIRE);
+
+	if (binlog_thread_ring && binlog_thread_gen == gen)
+		return binlog_thread_ring;
+	binlog_thread_ring = NULL;
+
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+	ring->size = WPA_DEBUG_BINLOG_RING_SIZE;
+	ring->buf = malloc(ring->size);
+	ring->fmts_size = 256;
+	ring->fmts = calloc(ring->fmts_size, sizeof(*ring->fmts));
+	if (!ring->buf || !ring->fmts) {
+		binlog_ring_free(ring);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&binlog_lock);
+	if (!binlog_active || binlog_gen != gen ||
+	    (!binlog_writer_running && binlog_start_writer() < 0)) {
+		pthread_mutex_unlock(&binlog_lock);
+		binlog_ring_free(ring);
+		return NULL;
+	}
+	ring->thread = binlog_threads++;
+	ring->next = binlog_rings;
+	binlog_rings = ring;
+	pthread_mutex_unlock(&binlog_lock);
+
+	pthread_setspecific(binlog_key, ring);
+	binlog_thread_ring = ring;
+	binlog_thread_gen = gen;
+	return ring;
+}
+
+
+static size_t binlog_ring_space(struct binlog_ring *ring)
+{
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+	return ring->size - (ring->head - tail);
+}
+
+
+static void binlog_ring_copy(struct binlog_ring *ring, size_t pos,
+			     const void *data, size_t len)
+{
+	size_t off = pos & (ring->size - 1);
+	size_t first = ring->size - off;
+
+	if (first > len)
+		first = len;
+	os_memcpy(ring->buf + off, data, first);
+	os_memcpy(ring->buf, (const u8 *) data + first, len - first);
+}
+
+
+static int binlog_commit(struct binlog_ring *ring, struct binlog_rec_hdr *hdr,
+			 const void *data, size_t data_len,
+			 const void *data2, size_t data2_len)
+{
+	static const u8 pad[8];
+	size_t len = sizeof(*hdr) + data_len + data2_len;
+	size_t padded = (len + 7) & ~(size_t) 7;
+	size_t head = ring->head, used;
+
+	if (binlog_ring_space(ring) < padded)
+		return -1;
+
+	hdr->len = padded;
+	hdr->thread = ring->thread;
+	binlog_ring_copy(ring, head, hdr, sizeof(*hdr));
+	head += sizeof(*hdr);
+	if (data_len)
+		binlog_ring_copy(ring, head, data, data_len);
+	head += data_len;
+	if (data2_len)
+		binlog_ring_copy(ring, head, data2, data2_len);
+	head += data2_len;
+	binlog_ring_copy(ring, head, pad, padded - len);
+	head += padded - len;
+
+	__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+	/* Wake up the writer thread when the ring gets half full */
+	used = ring->size - binlog_ring_space(ring);
+	if (used >= ring->size / 2 && used - padded < ring->size / 2) {
+		u8 b = 0;
+
+		if (write(binlog_wake[1], &b, 1) < 0) {
+			/* Periodic drain takes care of this */
+		}
+	}
+
+	return 0;
+}
+
+
+static void binlog_rec_init(struct binlog_rec_hdr *hdr, int type, int level,
+			    u32 id)
+{
+	struct os_time now;
+
+	os_get_time(&now);
+	os_memset(hdr, 0, sizeof(*hdr));
+	hdr->type = type;
+	hdr->level = level;
+	hdr->id = id;
+	hdr->sec = now.sec;
+	hdr->usec = now.usec;
+}
+
+
+static int binlog_report_dropped(struct binlog_ring *ring)
+{
+	struct binlog_rec_hdr hdr;
+
+	if (!ring->dropped)
+		return 0;
+	binlog_rec_init(&hdr, BINLOG_REC_DROPPED, MSG_ERROR, ring->dropped);
+	if (binlog_commit(ring, &hdr, NULL, 0, NULL, 0) < 0)
+		return -1;
+	ring->dropped = 0;
+	return 0;
+}
+
+
+static unsigned int binlog_fmt_hash(const char *ptr, unsigned int size)
+{
+	uintptr_t val = (uintptr_t) ptr;
+
+	return ((val >> 3) * 0x9e3779b1) & (size - 1);
+}
+
+
+static int binlog_fmt_grow(struct binlog_ring *ring)
+{
+	struct binlog_fmt *fmts, *f;
+	unsigned int size = ring->fmts_size * 2, i, h;
+
+	fmts = calloc(size, sizeof(*fmts));
+	if (!fmts)
+		return -1;
+	for (i = 0; i < ring->fmts_size; i++) {
+		f = &ring->fmts[i];
+		if (!f->ptr)
+			continue;
+		h = binlog_fmt_hash(f->ptr, size);
+		while (fmts[h].ptr)
+			h = (h + 1) & (size - 1);
+		fmts[h] = *f;
+	}
+	free(ring->fmts);
+	ring->fmts = fmts;
+	ring->fmts_size = size;
+	return 0;
+}
+
+
+/* Returns the id for a format string or a hexdump title, or 0 on failure */
+static u32 binlog_fmt_id(struct binlog_ring *ring, const char *ptr)
+{
+	struct binlog_rec_hdr hdr;
+	struct binlog_fmt *f;
+	unsigned int h;
+	size_t len;
+	char *str;
+
+	h = binlog_fmt_hash(ptr, ring->fmts_size);
+	while (ring->fmts[h].ptr) {
+		f = &ring->fmts[h];
+		/* The same pointer may have been used for a different string
+		 * if the caller uses a buffer instead of a string constant. */
+		if (f->ptr == ptr && os_strcmp(f->str, ptr) == 0)
+			return f->id;
+		if (f->ptr == ptr)
+			break;
+		h = (h + 1) & (ring->fmts_size - 1);
+	}
+
+	len = os_strlen(ptr) + 1;
+	str = malloc(len);
+	if (!str)
+		return 0;
+	os_memcpy(str, ptr, len);
+
+	binlog_rec_init(&hdr, BINLOG_REC_FMT, 0,
+			__atomic_fetch_add(&binlog_next_id, 1,
+					   __ATOMIC_RELAXED));
+	if (binlog_commit(ring, &hdr, str, len, NULL, 0) < 0) {
+		free(str);
+		return 0;
+	}
+
+	if (!ring->fmts[h].ptr) {
+		if (ring->num_fmts >= ring->fmts_size / 2 &&
+		    binlog_fmt_grow(ring) == 0) {
+			h = binlog_fmt_hash(ptr, ring->fmts_size);
+			while (ring->fmts[h].ptr)
+				h = (h + 1) & (ring->fmts_size - 1);
+		}
+		ring->num_fmts++;
+	}
+	f = &ring->fmts[h];
+	free(f->str);
+	f->ptr = ptr;
+	f->str = str;
+	f->id = hdr.id;
+	return f->id;
+}
+
+
+static int binlog_put(u8 **pos, u8 *end, u8 tag, const void *val,
+		      size_t len)
+{
+	if (end - *pos < (int) (1 + len))
+		return -1;
+	*(*pos)++ = tag;
+	os_memcpy(*pos, val, len);
+	*pos += len;
+	return 0;
+}
+
+
+static int binlog_put_int(u8 **pos, u8 *end, s64 val)
+{
+	return binlog_put(pos, end, BINLOG_ARG_INT, &val, sizeof(val));
+}
+
+
+static int binlog_put_str(u8 **pos, u8 *end, const char *str, int prec)
+{
+	size_t len;
+	u16 slen;
+
+	if (!str)
+		str = "(null)";
+	if (prec >= 0) {
+		for (len = 0; len < (size_t) prec && str[len]; len++)
+			;
+	} else {
+		len = os_strlen(str);
+	}
+	if (end - *pos < 3)
+		return -1;
+	if (len > (size_t) (end - *pos - 3))
+		len = end - *pos - 3; /* truncate */
+	slen = len;
+	if (binlog_put(pos, end, BINLOG_ARG_STR, &slen, sizeof(slen)) < 0)
+		return -1;
+	os_memcpy(*pos, str, len);
+	*pos += len;
+	return 0;
+}
+
+
+/*
+ * Store the arguments for a format string. Returns the length of the encoded
+ * arguments or -1 if the format string uses a conversion that is not
+ * supported.
+ */
+static int binlog_encode_args(u8 *buf, size_t size, const char *fmt,
+			      va_list ap)
+{
+	u8 *pos = buf, *end = buf + size;
+	const char *p;
+	int prec, lmod, ret = 0;
+
+	for (p = fmt; *p; p++) {
+		if (*p != '%')
+			continue;
+		p++;
+		if (*p == '%')
+			continue;
+
+		while (*p && os_strchr("-+ #0'", *p))
+			p++;
+		if (*p == '*') {
+			ret |= binlog_put_int(&pos, end, va_arg(ap, int));
+			p++;
+		} else {
+			while (*p >= '0' && *p <= '9')
+				p++;
+		}
+		prec = -1;
+		if (*p == '.') {
+			p++;
+			if (*p == '*') {
+				prec = va_arg(ap, int);
+				ret |= binlog_put_int(&pos, end, prec);
+				p++;
+			} else {
+				prec = 0;
+				while (*p >= '0' && *p <= '9')
+					prec = prec * 10 + *p++ - '0';
+			}
+		}
+
+		/* Length modifier: 0 = none, 1 = hh/h, 2 = l, 3 = ll/q/j,
+		 * 4 = z/t, 5 = L */
+		lmod = 0;
+		if (*p == 'h') {
+			lmod = 1;
+			if (*++p == 'h')
+				p++;
+		} else if (*p == 'l') {
+			lmod = 2;
+			if (*++p == 'l') {
+				lmod = 3;
+				p++;
+			}
+		} else if (*p == 'q' || *p == 'j') {
+			lmod = 3;
+			p++;
+		} else if (*p == 'z' || *p == 't') {
+			lmod = 4;
+			p++;
+		} else if (*p == 'L') {
+			lmod = 5;
+			p++;
+		}
+
+		switch (*p) {
+		case 'd':
+		case 'i':
+		case 'c': {
+			s64 val;
+
+			if (lmod == 2)
+				val = va_arg(ap, long);
+			else if (lmod == 3)
+				val = va_arg(ap, long long);
+			else if (lmod == 4)
+				val = va_arg(ap, ssize_t);
+			else
+				val = va_arg(ap, int);
+			ret |= binlog_put_int(&pos, end, val);
+			break;
+		}
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o': {
+			u64 val;
+
+			if (lmod == 2)
+				val = va_arg(ap, unsigned long);
+			else if (lmod == 3)
+				val = va_arg(ap, unsigned long long);
+			else if (lmod == 4)
+				val = va_arg(ap, size_t);
+			else
+				val = va_arg(ap, unsigned int);
+			ret |= binlog_put(&pos, end, BINLOG_ARG_UINT, &val,
+					  sizeof(val));
+			break;
+		}
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A': {
+			double val;
+
+			if (lmod == 5)
+				val = va_arg(ap, long double);
+			else
+				val = va_arg(ap, double);
+			ret |= binlog_put(&pos, end, BINLOG_ARG_DOUBLE, &val,
+					  sizeof(val));
+			break;
+		}
+		case 's':
+			ret |= binlog_put_str(&pos, end,
+					      va_arg(ap, const char *), prec);
+			break;
+		case 'p': {
+			u64 val = (uintptr_t) va_arg(ap, void *);
+
+			ret |= binlog_put(&pos, end, BINLOG_ARG_PTR, &val,
+					  sizeof(val));
+			break;
+		}
+		default:
+			return -1;
+		}
+
+		if (ret)
+			return -1;
+	}
+
+	return pos - buf;
+}
+
+
+static void binlog_vprintf(int level, const char *fmt, va_list ap)
+{
+	struct binlog_ring *ring;
+	struct binlog_rec_hdr hdr;
+	u8 buf[BINLOG_MAX_REC];
+	va_list ap2;
+	u32 id;
+	int len;
+
+	ring = binlog_get_ring();
+	if (!ring)
+		return;
+	if (binlog_report_dropped(ring) < 0)
+		goto dropped;
+
+	va_copy(ap2, ap);
+	len = binlog_encode_args(buf, sizeof(buf), fmt, ap2);
+	va_end(ap2);
+	if (len < 0) {
+		/* Not supported in binary form; store the formatted text */
+		len = vsnprintf((char *) buf, sizeof(buf), fmt, ap);
+		if (len < 0)
+			return;
+		if ((size_t) len >= sizeof(buf))
+			len = sizeof(buf) - 1;
+		binlog_rec_init(&hdr, BINLOG_REC_TEXT, level, 0);
+		if (binlog_commit(ring, &hdr, buf, len + 1, NULL, 0) < 0)
+			goto dropped;
+		return;
+	}
+
+	id = binlog_fmt_id(ring, fmt);
+	if (!id)
+		goto dropped;
+	binlog_rec_init(&hdr, BINLOG_REC_MSG, level, id);
+	if (binlog_commit(ring, &hdr, buf, len, NULL, 0) == 0)
+		return;
+dropped:
+	ring->dropped++;
+}
+
+
+static void binlog_hexdump(int level, const char *title, const void *buf,
+			   size_t len, int show, int ascii)
+{
+	struct binlog_ring *ring;
+	struct binlog_rec_hdr hdr;
+	struct binlog_hexdump hd;
+	size_t data_len = 0;
+	u32 id;
+
+	ring = binlog_get_ring();
+	if (!ring)
+		return;
+	if (binlog_report_dropped(ring) < 0)
+		goto dropped;
+
+	id = binlog_fmt_id(ring, title);
+	if (!id)
+		goto dropped;
+
+	hd.flags = ascii ? BINLOG_HEXDUMP_ASCII : 0;
+	hd.len = len;
+	if (!buf) {
+		hd.flags |= BINLOG_HEXDUMP_NULL;
+	} else if (show) {
+		hd.flags |= BINLOG_HEXDUMP_SHOW;
+		data_len = len > BINLOG_MAX_DATA ? BINLOG_MAX_DATA : len;
+	}
+
+	hd.data_len = data_len;
+	binlog_rec_init(&hdr, BINLOG_REC_HEXDUMP, level, id);
+	if (binlog_commit(ring, &hdr, &hd, sizeof(hd), buf, data_len) == 0)
+		return;
+dropped:
+	ring->dropped++;
+}
+
+
+static void binlog_write(const u8 *data, size_t len)
+{
+	ssize_t res;
+
+	while (len) {
+		res = write(binlog_fd, data, len);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			return;
+		data += res;
+		len -= res;
+	}
+}
+
+
+/* Must be called with binlog_lock held */
+static void binlog_drain_locked(void)
+{
+	struct binlog_ring *ring, **prev;
+	size_t head, tail, off, first;
+	int done;
+
+	prev = &binlog_rings;
+	while ((ring = *prev)) {
+		done = __atomic_load_n(&ring->done, __ATOMIC_ACQUIRE);
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		tail = ring->tail;
+		if (head != tail) {
+			off = tail & (ring->size - 1);
+			first = ring->size - off;
+			if (first > head - tail)
+				first = head - tail;
+			binlog_write(ring->buf + off, first);
+			binlog_write(ring->buf, head - tail - first);
+			__atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+		}
+		if (done) {
+			*prev = ring->next;
+			binlog_ring_free(ring);
+			continue;
+		}
+		prev = &ring->next;
+	}
+}
+
+
+static void binlog_drain(void)
+{
+	pthread_mutex_lock(&binlog_lock);
+	binlog_drain_locked();
+	pthread_mutex_unlock(&binlog_lock);
+}
+
+
+static void * binlog_writer_thread(void *arg)
+{
+	struct pollfd pfd;
+	u8 b[16];
+
+	pfd.fd = binlog_wake[0];
+	pfd.events = POLLIN;
+	while (!__atomic_load_n(&binlog_stop, __ATOMIC_ACQUIRE)) {
+		if (poll(&pfd, 1, BINLOG_DRAIN_INTERVAL) > 0) {
+			while (read(binlog_wake[0], b, sizeof(b)) > 0)
+				;
+		}
+		binlog_drain();
+	}
+
+	return NULL;
+}
+
+
+/* Must be called with binlog_lock held */
+static int binlog_start_writer(void)
+{
+	sigset_t set, oset;
+	int i, res;
+
+	if (pipe(binlog_wake) < 0)
+		return -1;
+	for (i = 0; i < 2; i++) {
+		if (fcntl(binlog_wake[i], F_SETFL, O_NONBLOCK) < 0 ||
+		    fcntl(binlog_wake[i], F_SETFD, FD_CLOEXEC) < 0)
+			goto fail;
+	}
+
+	binlog_stop = 0;
+	/* Signals are processed in the main thread */
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, &oset);
+	res = pthread_create(&binlog_writer, NULL, binlog_writer_thread, NULL);
+	pthread_sigmask(SIG_SETMASK, &oset, NULL);
+	if (res != 0)
+		goto fail;
+	binlog_writer_running = 1;
+	return 0;
+
+fail:
+	for (i = 0; i < 2; i++) {
+		close(binlog_wake[i]);
+		binlog_wake[i] = -1;
+	}
+	return -1;
+}
+
+
+static void binlog_atfork_prepare(void)
+{
+	pthread_mutex_lock(&binlog_lock);
+	/* Write out the pending records so that they are not left to both
+	 * processes */
+	if (binlog_active)
+		binlog_drain_locked();
+}
+
+
+static void binlog_atfork_parent(void)
+{
+	pthread_mutex_unlock(&binlog_lock);
+}
+
+
+static void binlog_atfork_child(void)
+{
+	struct binlog_ring *ring;
+	int i;
+
+	/*
+	 * Only the forking thread exists in the child process, so the writer
+	 * thread is gone, e.g., after os_daemonize(). Records that other
+	 * threads added after the drain in binlog_atfork_prepare() are written
+	 * by the parent, so drop them here and release the rings of the other
+	 * threads. The next record starts a new writer thread and gets a new
+	 * ring through the generation change. A child that only calls exec()
+	 * does not start a thread.
+	 */
+	if (binlog_active && binlog_writer_running) {
+		binlog_writer_running = 0;
+		for (i = 0; i < 2; i++) {
+			close(binlog_wake[i]);
+			binlog_wake[i] = -1;
+		}
+		for (ring = binlog_rings; ring; ring = ring->next) {
+			ring->tail = ring->head;
+			ring->done = 1;
+		}
+		binlog_gen++;
+	}
+	pthread_mutex_unlock(&binlog_lock);
+}
+
+
+/**
+ * wpa_debug_open_binlog - Start writing debug output to a binary log file
+ * @path: Path to the log file
+ * Returns: 0 on success, -1 on failure
+ *
+ * The log file can be converted to text with
+ * wpa_supplicant/utils/binlog_decode.py.
+ */
+int wpa_debug_open_binlog(const char *path)
+{
+	struct binlog_file_hdr hdr;
+
+	if (binlog_active)
+		wpa_debug_close_binlog();
+
+	binlog_fd = open(path, O_CREAT | O_TRUNC | O_WRONLY,
+			 S_IRUSR | S_IWUSR | S_IRGRP);
+	if (binlog_fd < 0) {
+		wpa_printf(MSG_ERROR, "Failed to open binary log file %s: %s",
+			   path, strerror(errno));
+		return -1;
+	}
+	os_memset(&hdr, 0, sizeof(hdr));
+	os_memcpy(hdr.magic, BINLOG_MAGIC, sizeof(hdr.magic));
+	hdr.version = BINLOG_VERSION;
+	hdr.byte_order = 0x01020304;
+	binlog_write((const u8 *) &hdr, sizeof(hdr));
+
+	if (!binlog_key_set) {
+		if (pthread_key_create(&binlog_key, binlog_thread_exit) != 0)
+			goto fail;
+		binlog_key_set = 1;
+	}
+	if (!binlog_atfork_set) {
+		if (pthread_atfork(binlog_atfork_prepare, binlog_atfork_parent,
+				   binlog_atfork_child) != 0)
+			goto fail;
+		binlog_atfork_set = 1;
+	}
+
+	if (fcntl(binlog_fd, F_SETFD, FD_CLOEXEC) < 0)
+		goto fail;
+
+	pthread_mutex_lock(&binlog_lock);
+	if (binlog_start_writer() < 0) {
+		pthread_mutex_unlock(&binlog_lock);
+		goto fail;
+	}
+	binlog_gen++;
+	binlog_active = 1;
+	pthread_mutex_unlock(&binlog_lock);
+	wpa_debug_binlog_hexdump = binlog_hexdump;
+	wpa_debug_binlog_printf = binlog_vprintf;
+	return 0;
+
+fail:
+	wpa_printf(MSG_ERROR, "Failed to start binary debug log");
+	close(binlog_fd);
+	binlog_fd = -1;
+	return -1;
+}
+
+
+/**
+ * wpa_debug_close_binlog - Stop the binary debug log
+ *
+ * All pending records are written to the log file. Other threads must not
+ * write debug output while this function is being called.
+ */
+void wpa_debug_close_binlog(void)
+{
+	struct binlog_ring *ring;
+	int i, running;
+
+	if (!binlog_active)
+		return;
+
+	wpa_debug_binlog_printf = NULL;
+	wpa_debug_binlog_hexdump = NULL;
+	pthread_mutex_lock(&binlog_lock);
+	binlog_active = 0;
+	/* Invalidate the per-thread ring pointers */
+	__atomic_add_fetch(&binlog_gen, 1, __ATOMIC_RELEASE);
+	running = binlog_writer_running;
+	binlog_writer_running = 0;
+	pthread_mutex_unlock(&binlog_lock);
+
+	/* After fork(), the writer thread may not have been started in this
+	 * process */
+	if (running) {
+		__atomic_store_n(&binlog_stop, 1, __ATOMIC_RELEASE);
+		if (write(binlog_wake[1], "", 1) < 0) {
+			/* The writer thread notices the stop flag on next
+			 * poll */
+		}
+		pthread_join(binlog_writer, NULL);
+	}
+	binlog_drain();
+
+	pthread_mutex_lock(&binlog_lock);
+	while ((ring = binlog_rings)) {
+		binlog_rings = ring->next;
+		binlog_ring_free(ring);
+	}
+	binlog_threads = 0;
+	pthread_mutex_unlock(&binlog_lock);
+	pthread_setspecific(binlog_key, NULL);
+	binlog_thread_ring = NULL;
+
+	for (i = 0; i < 2; i++) {
+		if (binlog_wake[i] >= 0)
+			close(binlog_wake[i]);
+		binlog_wake[i] = -1;
+	}
+	close(binlog_fd);
+	binlog_fd = -1;
+}
@@ -132,6 +132,7 @@ OBJS += src/utils/wpabuf.c
 OBJS += src/utils/bitfield.c
 OBJS += src/utils/ip_addr.c
 OBJS += src/utils/crc32.c
+OBJS += src/utils/addr_hash.c
 OBJS += wmm_ac.c
 OBJS += op_classes.c
 OBJS += rrm.c
@@ -192,6 +193,14 @@ ifdef CONFIG_ELOOP_EPOLL
 L_CFLAGS += -DCONFIG_ELOOP_EPOLL
 endif
 
+ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+L_CFLAGS += -DCONFIG_ELOOP_TIMEOUT_HEAP
+endif
+
+ifdef CONFIG_ELOOP_WORKERS
+L_CFLAGS += -DCONFIG_ELOOP_WORKERS
+endif
+
 ifdef CONFIG_EAPOL_TEST
 L_CFLAGS += -Werror -DEAPOL_TEST
 endif
@@ -1351,6 +1360,7 @@ ifneq ($(CONFIG_TLS), openssl)
 SHA1OBJS += src/crypto/sha1-pbkdf2.c
 endif
 endif
+SHA1OBJS += src/crypto/sha1-pbkdf2-batch.c
 ifdef NEED_T_PRF
 SHA1OBJS += src/crypto/sha1-tprf.c
 endif
@@ -1569,6 +1579,10 @@ L_CFLAGS += -DCONFIG_NO_WPA_MSG
 endif
 endif
 
+ifdef CONFIG_DEBUG_MIN_LEVEL
+L_CFLAGS += -DWPA_DEBUG_MIN_LEVEL=$(CONFIG_DEBUG_MIN_LEVEL)
+endif
+
 ifdef CONFIG_ANDROID_LOG
 L_CFLAGS += -DCONFIG_ANDROID_LOG
 endif
@@ -1613,6 +1627,11 @@ ifdef CONFIG_DEBUG_FILE
 L_CFLAGS += -DCONFIG_DEBUG_FILE
 endif
 
+ifdef CONFIG_DEBUG_BINLOG
+L_CFLAGS += -DCONFIG_DEBUG_BINLOG
+OBJS += src/utils/wpa_debug_binlog.c
+endif
+
 ifdef CONFIG_DELAYED_MIC_ERROR_REPORT
 L_CFLAGS += -DCONFIG_DELAYED_MIC_ERROR_REPORT
 endif
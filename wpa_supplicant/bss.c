@@ -19,6 +19,27 @@
 #include "scan.h"
 #include "bss.h"
 
+static struct dl_list * wpa_bss_hash(struct wpa_supplicant *wpa_s,
+				     const u8 *bssid)
+{
+	unsigned int hash;
+
+	/* BSSIDs of co-located BSSes often differ only in the last octets */
+	hash = bssid[5] ^ (bssid[4] << 3) ^ (bssid[3] << 5) ^
+		(bssid[2] << 1) ^ (bssid[1] << 4) ^ (bssid[0] << 2);
+	hash ^= hash >> 8;
+
+	return &wpa_s->bss_hash[hash % WPA_BSS_HASH_SIZE];
+}
+
+
+static struct dl_list * wpa_bss_id_hash(struct wpa_supplicant *wpa_s,
+					unsigned int id)
+{
+	return &wpa_s->bss_id_hash[id % WPA_BSS_HASH_SIZE];
+}
+
+
 static void wpa_bss_set_hessid(struct wpa_bss *bss)
 {
 #ifdef CONFIG_INTERWORKING
@@ -227,12 +248,15 @@ void wpa_bss_remove(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	wpa_bss_update_pending_connect(wpa_s, bss, NULL);
 	dl_list_del(&bss->list);
 	dl_list_del(&bss->list_id);
+	dl_list_del(&bss->list_hash);
+	dl_list_del(&bss->list_id_hash);
 	wpa_s->num_bss--;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Remove id %u BSSID " MACSTR
 		" SSID '%s' due to %s", bss->id, MAC2STR(bss->bssid),
 		wpa_ssid_txt(bss->ssid, bss->ssid_len), reason);
 	wpas_notify_bss_removed(wpa_s, bss->bssid, bss->id);
 	wpa_bss_anqp_free(bss->anqp);
+	os_free(bss->ie_index);
 	os_free(bss);
 }
 
@@ -251,7 +275,8 @@ struct wpa_bss * wpa_bss_get(struct wpa_supplicant *wpa_s, const u8 *bssid,
 	struct wpa_bss *bss;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, wpa_bss_hash(wpa_s, bssid), struct wpa_bss,
+			 list_hash) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
 		    bss->ssid_len == ssid_len &&
 		    os_memcmp(bss->ssid, ssid, ssid_len) == 0)
@@ -453,6 +478,7 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 	bss->ie_len = res->ie_len;
 	bss->beacon_ie_len = res->beacon_ie_len;
 	os_memcpy(bss->ies, res + 1, res->ie_len + res->beacon_ie_len);
+	bss->ie_index = ie_index_build(bss->ies, bss->ie_len);
 	wpa_bss_set_hessid(bss);
 
 	if (wpa_s->num_bss + 1 > wpa_s->conf->bss_max_count &&
@@ -465,6 +491,8 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
 	dl_list_add_tail(&wpa_s->bss_id, &bss->list_id);
+	dl_list_add_tail(wpa_bss_hash(wpa_s, bss->bssid), &bss->list_hash);
+	dl_list_add_tail(wpa_bss_id_hash(wpa_s, bss->id), &bss->list_id_hash);
 	wpa_s->num_bss++;
 	if (!is_zero_ether_addr(bss->hessid))
 		os_snprintf(extra, sizeof(extra), " HESSID " MACSTR,
@@ -661,6 +689,7 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	wpa_bss_copy_res(bss, res, fetch_time);
 	/* Move the entry to the end of the list */
 	dl_list_del(&bss->list);
+	dl_list_del(&bss->list_hash);
 #ifdef CONFIG_P2P
 	if (wpa_bss_get_vendor_ie(bss, P2P_IE_VENDOR_TYPE) &&
 	    !wpa_scan_get_vendor_ie(res, P2P_IE_VENDOR_TYPE)) {
@@ -686,6 +715,7 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 		struct wpa_bss *nbss;
 		struct dl_list *prev = bss->list_id.prev;
 		dl_list_del(&bss->list_id);
+		dl_list_del(&bss->list_id_hash);
 		nbss = os_realloc(bss, sizeof(*bss) + res->ie_len +
 				  res->beacon_ie_len);
 		if (nbss) {
@@ -706,10 +736,16 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 			bss->beacon_ie_len = res->beacon_ie_len;
 		}
 		dl_list_add(prev, &bss->list_id);
+		dl_list_add_tail(wpa_bss_id_hash(wpa_s, bss->id),
+				 &bss->list_id_hash);
 	}
-	if (changes & WPA_BSS_IES_CHANGED_FLAG)
+	if (changes & WPA_BSS_IES_CHANGED_FLAG) {
+		os_free(bss->ie_index);
+		bss->ie_index = ie_index_build(bss->ies, bss->ie_len);
 		wpa_bss_set_hessid(bss);
+	}
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
+	dl_list_add_tail(wpa_bss_hash(wpa_s, bss->bssid), &bss->list_hash);
 
 	notify_bss_changes(wpa_s, changes, bss);
 
@@ -842,6 +878,37 @@ void wpa_bss_update_scan_res(struct wpa_supplicant *wpa_s,
 }
 
 
+/**
+ * wpa_bss_update_sort - Sort the BSS entries of the current update round
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @compar: Comparison function for qsort() on an array of struct wpa_bss *
+ *
+ * wpa_bss_update_scan_res() is normally called with the scan results already
+ * sorted in preference order. When the results are merged in the order the
+ * driver reports them instead, this function is called before
+ * wpa_bss_update_end() to sort last_scan_res and to move the entries updated
+ * in this round to the end of the BSS list in the sorted order. This leaves
+ * both in the same order as if the sorted results had been merged.
+ */
+void wpa_bss_update_sort(struct wpa_supplicant *wpa_s,
+			 int (*compar)(const void *, const void *))
+{
+	size_t i;
+
+	if (!wpa_s->last_scan_res || wpa_s->last_scan_res_used == 0)
+		return;
+
+	qsort(wpa_s->last_scan_res, wpa_s->last_scan_res_used,
+	      sizeof(struct wpa_bss *), compar);
+	for (i = 0; i < wpa_s->last_scan_res_used; i++) {
+		struct wpa_bss *bss = wpa_s->last_scan_res[i];
+
+		dl_list_del(&bss->list);
+		dl_list_add_tail(&wpa_s->bss, &bss->list);
+	}
+}
+
+
 static int wpa_bss_included_in_scan(const struct wpa_bss *bss,
 				    const struct scan_info *info)
 {
@@ -960,8 +1027,14 @@ void wpa_bss_flush_by_age(struct wpa_supplicant *wpa_s, int age)
  */
 int wpa_bss_init(struct wpa_supplicant *wpa_s)
 {
+	unsigned int i;
+
 	dl_list_init(&wpa_s->bss);
 	dl_list_init(&wpa_s->bss_id);
+	for (i = 0; i < WPA_BSS_HASH_SIZE; i++) {
+		dl_list_init(&wpa_s->bss_hash[i]);
+		dl_list_init(&wpa_s->bss_id_hash[i]);
+	}
 	return 0;
 }
 
@@ -1009,7 +1082,9 @@ struct wpa_bss * wpa_bss_get_bssid(struct wpa_supplicant *wpa_s,
 	struct wpa_bss *bss;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
+	/* Hash buckets are kept in the same relative order as wpa_s->bss */
+	dl_list_for_each_reverse(bss, wpa_bss_hash(wpa_s, bssid),
+				 struct wpa_bss, list_hash) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0)
 			return bss;
 	}
@@ -1034,7 +1109,8 @@ struct wpa_bss * wpa_bss_get_bssid_latest(struct wpa_supplicant *wpa_s,
 	struct wpa_bss *bss, *found = NULL;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each_reverse(bss, wpa_bss_hash(wpa_s, bssid),
+				 struct wpa_bss, list_hash) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) != 0)
 			continue;
 		if (found == NULL ||
@@ -1084,7 +1160,8 @@ struct wpa_bss * wpa_bss_get_p2p_dev_addr(struct wpa_supplicant *wpa_s,
 struct wpa_bss * wpa_bss_get_id(struct wpa_supplicant *wpa_s, unsigned int id)
 {
 	struct wpa_bss *bss;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, wpa_bss_id_hash(wpa_s, id), struct wpa_bss,
+			 list_id_hash) {
 		if (bss->id == id)
 			return bss;
 	}
@@ -1126,6 +1203,8 @@ struct wpa_bss * wpa_bss_get_id_range(struct wpa_supplicant *wpa_s,
  */
 const u8 * wpa_bss_get_ie(const struct wpa_bss *bss, u8 ie)
 {
+	if (bss->ie_index)
+		return ie_index_get(bss->ie_index, wpa_bss_ie_ptr(bss), ie);
 	return get_ie(wpa_bss_ie_ptr(bss), bss->ie_len, ie);
 }
 
@@ -1141,6 +1220,8 @@ const u8 * wpa_bss_get_ie(const struct wpa_bss *bss, u8 ie)
  */
 const u8 * wpa_bss_get_ie_ext(const struct wpa_bss *bss, u8 ext)
 {
+	if (bss->ie_index)
+		return ie_index_get_ext(bss->ie_index, wpa_bss_ie_ptr(bss), ext);
 	return get_ie_ext(wpa_bss_ie_ptr(bss), bss->ie_len, ext);
 }
 
@@ -1160,6 +1241,8 @@ const u8 * wpa_bss_get_vendor_ie(const struct wpa_bss *bss, u32 vendor_type)
 	const struct element *elem;
 
 	ies = wpa_bss_ie_ptr(bss);
+	if (bss->ie_index)
+		return ie_index_get_vendor(bss->ie_index, ies, vendor_type);
 
 	for_each_element_id(elem, WLAN_EID_VENDOR_SPECIFIC, ies, bss->ie_len) {
 		if (elem->datalen >= 4 &&
@@ -1222,6 +1305,11 @@ struct wpabuf * wpa_bss_get_vendor_ie_multi(const struct wpa_bss *bss,
 	struct wpabuf *buf;
 	const u8 *end, *pos;
 
+	if (bss->ie_index)
+		return ie_index_get_vendor_multi(bss->ie_index,
+						 wpa_bss_ie_ptr(bss),
+						 vendor_type);
+
 	buf = wpabuf_alloc(bss->ie_len);
 	if (buf == NULL)
 		return NULL;
@@ -10,6 +10,7 @@
 #define BSS_H
 
 struct wpa_scan_res;
+struct ie_index;
 
 #define WPA_BSS_QUAL_INVALID		BIT(0)
 #define WPA_BSS_NOISE_INVALID		BIT(1)
@@ -78,6 +79,10 @@ struct wpa_bss {
 	struct dl_list list;
 	/** List entry for struct wpa_supplicant::bss_id */
 	struct dl_list list_id;
+	/** List entry for struct wpa_supplicant::bss_hash */
+	struct dl_list list_hash;
+	/** List entry for struct wpa_supplicant::bss_id_hash */
+	struct dl_list list_id_hash;
 	/** Unique identifier for this BSS entry */
 	unsigned int id;
 	/** Number of counts without seeing this BSS */
@@ -116,6 +121,8 @@ struct wpa_bss {
 	int snr;
 	/** ANQP data */
 	struct wpa_bss_anqp *anqp;
+	/** Index of the IEs from Probe Response (ie_len) or %NULL */
+	struct ie_index *ie_index;
 	/** Length of the following IE field in octets (from Probe Response) */
 	size_t ie_len;
 	/** Length of the following Beacon IE field in octets */
@@ -136,6 +143,8 @@ void wpa_bss_update_start(struct wpa_supplicant *wpa_s);
 void wpa_bss_update_scan_res(struct wpa_supplicant *wpa_s,
 			     struct wpa_scan_res *res,
 			     struct os_reltime *fetch_time);
+void wpa_bss_update_sort(struct wpa_supplicant *wpa_s,
+			 int (*compar)(const void *, const void *));
 void wpa_bss_remove(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 		    const char *reason);
 void wpa_bss_update_end(struct wpa_supplicant *wpa_s, struct scan_info *info,
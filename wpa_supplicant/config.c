@@ -3402,6 +3402,62 @@ void wpa_config_update_psk(struct wpa_ssid *ssid)
 }
 
 
+/**
+ * wpa_config_update_psks - Update WPA PSKs of a list of networks
+ * @ssid: First network in the list; the list is followed through ssid->next
+ *
+ * This is like calling wpa_config_update_psk() for each network that has a
+ * passphrase, but the PSKs are derived as a single batch which is
+ * considerably faster for a large number of networks.
+ */
+void wpa_config_update_psks(struct wpa_ssid *ssid)
+{
+#ifndef CONFIG_NO_PBKDF2
+	struct pbkdf2_sha1_job *jobs;
+	struct wpa_ssid *s;
+	size_t num = 0;
+
+	for (s = ssid; s; s = s->next) {
+		if (s->passphrase)
+			num++;
+	}
+	if (!num)
+		return;
+
+	jobs = os_calloc(num, sizeof(*jobs));
+	if (!jobs) {
+		for (s = ssid; s; s = s->next) {
+			if (s->passphrase)
+				wpa_config_update_psk(s);
+		}
+		return;
+	}
+
+	num = 0;
+	for (s = ssid; s; s = s->next) {
+		if (!s->passphrase)
+			continue;
+		jobs[num].passphrase = s->passphrase;
+		jobs[num].ssid = s->ssid;
+		jobs[num].ssid_len = s->ssid_len;
+		jobs[num].buf = s->psk;
+		jobs[num].buflen = PMK_LEN;
+		num++;
+	}
+	pbkdf2_sha1_batch(jobs, num, 4096, 0);
+	os_free(jobs);
+
+	for (s = ssid; s; s = s->next) {
+		if (!s->passphrase)
+			continue;
+		wpa_hexdump_key(MSG_MSGDUMP, "PSK (from passphrase)",
+				s->psk, PMK_LEN);
+		s->psk_set = 1;
+	}
+#endif /* CONFIG_NO_PBKDF2 */
+}
+
+
 static int wpa_config_set_cred_req_conn_capab(struct wpa_cred *cred,
 					      const char *value)
 {
@@ -5162,6 +5218,7 @@ static const struct global_parse_data global_fields[] = {
 	{ FUNC(initial_freq_list), 0},
 	{ INT(scan_cur_freq), 0 },
 	{ INT(scan_res_valid_for_connect), 0},
+	{ INT_RANGE(scan_res_stream, 0, 1), 0 },
 	{ INT(sched_scan_interval), 0 },
 	{ INT(sched_scan_start_delay), 0 },
 	{ INT(tdls_external_control), 0},
@@ -949,6 +949,18 @@ struct wpa_config {
 	 */
 	int scan_res_valid_for_connect;
 
+	/**
+	 * scan_res_stream - Merge scan results into the BSS table one by one
+	 *
+	 * 0 = Fetch the complete scan result list from the driver before
+	 *     updating the BSS table (default)
+	 * 1 = Merge each scan result into the BSS table as the driver reports
+	 *     it when no other component needs the full scan result list.
+	 *     This bounds the temporary memory use to a single scan result
+	 *     entry. Requires driver support (e.g., nl80211).
+	 */
+	int scan_res_stream;
+
 	/**
 	 * changed_parameters - Bitmap of changed parameters since last update
 	 */
@@ -1694,6 +1706,7 @@ char ** wpa_config_get_all(struct wpa_ssid *ssid, int get_keys);
 char * wpa_config_get(struct wpa_ssid *ssid, const char *var);
 char * wpa_config_get_no_key(struct wpa_ssid *ssid, const char *var);
 void wpa_config_update_psk(struct wpa_ssid *ssid);
+void wpa_config_update_psks(struct wpa_ssid *ssid);
 int wpa_config_add_prio_network(struct wpa_config *config,
 				struct wpa_ssid *ssid);
 int wpa_config_update_prio_list(struct wpa_config *config);
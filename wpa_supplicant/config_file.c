@@ -36,7 +36,8 @@ static int wpa_config_validate_network(struct wpa_ssid *ssid, int line)
 				   "passphrase configured.", line);
 			errors++;
 		}
-		wpa_config_update_psk(ssid);
+		/* PSK is derived by wpa_config_read() for all networks at
+		 * once */
 	}
 
 	if (ssid->disabled == 2)
@@ -294,7 +295,7 @@ struct wpa_config * wpa_config_read(const char *name, struct wpa_config *cfgp)
 	FILE *f;
 	char buf[512], *pos;
 	int errors = 0, line = 0;
-	struct wpa_ssid *ssid, *tail, *head;
+	struct wpa_ssid *ssid, *tail, *head, *first = NULL;
 	struct wpa_cred *cred, *cred_tail, *cred_head;
 	struct wpa_config *config;
 	int id = 0;
@@ -343,6 +344,8 @@ struct wpa_config * wpa_config_read(const char *name, struct wpa_config *cfgp)
 				tail->next = ssid;
 				tail = ssid;
 			}
+			if (!first)
+				first = ssid;
 			if (wpa_config_add_prio_network(config, ssid)) {
 				wpa_printf(MSG_ERROR, "Line %d: failed to add "
 					   "network block to priority list.",
@@ -384,6 +387,7 @@ struct wpa_config * wpa_config_read(const char *name, struct wpa_config *cfgp)
 
 	fclose(f);
 
+	wpa_config_update_psks(first);
 	config->ssid = head;
 	wpa_config_debug_dump_networks(config);
 	config->cred = cred_head;
@@ -1394,6 +1398,8 @@ static void wpa_config_write_global(FILE *f, struct wpa_config *config)
 	    DEFAULT_SCAN_RES_VALID_FOR_CONNECT)
 		fprintf(f, "scan_res_valid_for_connect=%d\n",
 			config->scan_res_valid_for_connect);
+	if (config->scan_res_stream)
+		fprintf(f, "scan_res_stream=%d\n", config->scan_res_stream);
 
 	if (config->sched_scan_interval)
 		fprintf(f, "sched_scan_interval=%u\n",
@@ -2622,8 +2622,10 @@ static int wpa_supplicant_ctrl_iface_log_level(struct wpa_supplicant *wpa_s,
 	char *pos, *end, *stamp;
 	int ret;
 
-	/* cmd: "LOG_LEVEL [<level>]" */
+	/* cmd: "LOG_LEVEL [<level>]" or "LOG_LEVEL <module>=<level>" */
 	if (*cmd == '\0') {
+		int module;
+
 		pos = buf;
 		end = buf + buflen;
 		ret = os_snprintf(pos, end - pos, "Current level: %s\n"
@@ -2631,14 +2633,48 @@ static int wpa_supplicant_ctrl_iface_log_level(struct wpa_supplicant *wpa_s,
 				  debug_level_str(wpa_debug_level),
 				  wpa_debug_timestamp);
 		if (os_snprintf_error(end - pos, ret))
-			ret = 0;
+			return 0;
+		pos += ret;
 
-		return ret;
+		for (module = 0; module < NUM_WPA_DEBUG_MODULES; module++) {
+			int level = wpa_debug_get_module_level(module);
+
+			if (level < 0)
+				continue;
+			ret = os_snprintf(pos, end - pos, "Module %s: %s\n",
+					  wpa_debug_module_str(module),
+					  debug_level_str(level));
+			if (os_snprintf_error(end - pos, ret))
+				break;
+			pos += ret;
+		}
+
+		return pos - buf;
 	}
 
 	while (*cmd == ' ')
 		cmd++;
 
+	if (os_strchr(cmd, '=')) {
+		char *val = os_strchr(cmd, '=');
+		int module, level;
+
+		*val++ = '\0';
+		module = wpa_debug_module_from_str(cmd);
+		if (module < 0)
+			return -1;
+		if (os_strcasecmp(val, "DEFAULT") == 0) {
+			level = -1;
+		} else {
+			level = str_to_debug_level(val);
+			if (level < 0)
+				return -1;
+		}
+		wpa_debug_set_module_level(module, level);
+		os_memcpy(buf, "OK\n", 3);
+		return 3;
+	}
+
 	stamp = os_strchr(cmd, ' ');
 	if (stamp) {
 		*stamp++ = '\0';
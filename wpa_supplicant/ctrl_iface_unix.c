@@ -682,6 +682,7 @@ havesock:
 	eloop_register_read_sock(priv->sock, wpa_supplicant_ctrl_iface_receive,
 				 wpa_s, priv);
 	wpa_msg_register_cb(wpa_supplicant_ctrl_iface_msg_cb);
+	ctrl_iface_update_msg_level();
 
 	os_free(buf);
 	return 0;
@@ -832,7 +833,6 @@ wpas_global_ctrl_iface_flush_queued_msg(struct wpa_global *global,
 void wpa_supplicant_ctrl_iface_deinit(struct wpa_supplicant *wpa_s,
 				      struct ctrl_iface_priv *priv)
 {
-	struct wpa_ctrl_dst *dst, *prev;
 	struct ctrl_iface_msg *msg, *prev_msg;
 	struct ctrl_iface_global_priv *gpriv;
 
@@ -897,11 +897,7 @@ void wpa_supplicant_ctrl_iface_deinit(struct wpa_supplicant *wpa_s,
 	}
 
 free_dst:
-	dl_list_for_each_safe(dst, prev, &priv->ctrl_dst, struct wpa_ctrl_dst,
-			      list) {
-		dl_list_del(&dst->list);
-		os_free(dst);
-	}
+	ctrl_iface_free_dsts(&priv->ctrl_dst);
 	dl_list_for_each_safe(msg, prev_msg, &priv->msg_queue,
 			      struct ctrl_iface_msg, list) {
 		dl_list_del(&msg->list);
@@ -1372,6 +1368,7 @@ wpa_supplicant_global_ctrl_iface_init(struct wpa_global *global)
 	}
 
 	wpa_msg_register_cb(wpa_supplicant_ctrl_iface_msg_cb);
+	ctrl_iface_update_msg_level();
 
 	return priv;
 }
@@ -1408,7 +1405,6 @@ static int wpas_ctrl_iface_global_reinit(struct wpa_global *global,
 void
 wpa_supplicant_global_ctrl_iface_deinit(struct ctrl_iface_global_priv *priv)
 {
-	struct wpa_ctrl_dst *dst, *prev;
 	struct ctrl_iface_msg *msg, *prev_msg;
 
 	if (priv->sock >= 0) {
@@ -1417,11 +1413,7 @@ wpa_supplicant_global_ctrl_iface_deinit(struct ctrl_iface_global_priv *priv)
 	}
 	if (priv->global->params.ctrl_interface)
 		unlink(priv->global->params.ctrl_interface);
-	dl_list_for_each_safe(dst, prev, &priv->ctrl_dst, struct wpa_ctrl_dst,
-			      list) {
-		dl_list_del(&dst->list);
-		os_free(dst);
-	}
+	ctrl_iface_free_dsts(&priv->ctrl_dst);
 	dl_list_for_each_safe(msg, prev_msg, &priv->msg_queue,
 			      struct ctrl_iface_msg, list) {
 		dl_list_del(&msg->list);
@@ -126,6 +126,9 @@ static inline int wpa_drv_stop_sched_scan(struct wpa_supplicant *wpa_s)
 
 struct wpa_scan_results *
 wpa_drv_get_scan_results2(struct wpa_supplicant *wpa_s);
+int wpa_drv_get_scan_results_cb(struct wpa_supplicant *wpa_s,
+				void (*cb)(void *ctx, struct wpa_scan_res *res),
+				void *ctx);
 
 static inline int wpa_drv_get_bssid(struct wpa_supplicant *wpa_s, u8 *bssid)
 {
@@ -2060,6 +2060,36 @@ static int wpa_supplicant_need_to_roam(struct wpa_supplicant *wpa_s,
 }
 
 
+/*
+ * Whether a component is about to consume the scan result list itself instead
+ * of using the BSS table, i.e., whether scan results cannot be streamed
+ * directly into the BSS table.
+ */
+static int wpas_scan_res_list_needed(struct wpa_supplicant *wpa_s,
+				     union wpa_event_data *data,
+				     int own_request)
+{
+#ifdef CONFIG_AP
+	if (wpa_s->ap_iface)
+		return 1;
+#endif /* CONFIG_AP */
+	if (own_request && wpa_s->scan_res_handler &&
+	    !(data && data->scan_info.external_scan))
+		return 1;
+#ifdef CONFIG_SME
+	if (wpa_s->sme.sched_obss_scan)
+		return 1;
+#endif /* CONFIG_SME */
+	if (wpa_s->beacon_rep_data.token)
+		return 1;
+	if (wpa_s->bgscan_priv)
+		return 1;
+	if (wpas_wps_searching(wpa_s))
+		return 1;
+	return 0;
+}
+
+
 /*
  * Return a negative value if no scan results could be fetched or if scan
  * results should not be shared with other virtual interfaces.
@@ -2087,9 +2117,13 @@ static int _wpa_supplicant_event_scan_results(struct wpa_supplicant *wpa_s,
 
 	wpa_supplicant_notify_scanning(wpa_s, 0);
 
-	scan_res = wpa_supplicant_get_scan_results(wpa_s,
-						   data ? &data->scan_info :
-						   NULL, 1);
+	if (wpa_s->conf->scan_res_stream &&
+	    !wpas_scan_res_list_needed(wpa_s, data, own_request))
+		scan_res = wpa_supplicant_stream_scan_results(
+			wpa_s, data ? &data->scan_info : NULL, 1);
+	else
+		scan_res = wpa_supplicant_get_scan_results(
+			wpa_s, data ? &data->scan_info : NULL, 1);
 	if (scan_res == NULL) {
 		if (wpa_s->conf->ap_scan == 2 || ap ||
 		    wpa_s->scan_res_handler == scan_only_handler)
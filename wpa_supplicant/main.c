@@ -78,6 +78,9 @@ static void usage(void)
 	       "  -I = additional configuration file\n"
 	       "  -K = include keys (passwords, etc.) in debug output\n"
 	       "  -L = show license (BSD)\n"
+#ifdef CONFIG_DEBUG_BINLOG
+	       "  -l = log output to a binary log file instead of stdout\n"
+#endif /* CONFIG_DEBUG_BINLOG */
 #ifdef CONFIG_P2P
 	       "  -m = Configuration file for the P2P Device interface\n"
 #endif /* CONFIG_P2P */
@@ -204,7 +207,7 @@ int main(int argc, char *argv[])
 
 	for (;;) {
 		c = getopt(argc, argv,
-			   "b:Bc:C:D:de:f:g:G:hi:I:KLMm:No:O:p:P:qsS:TtuvW");
+			   "b:Bc:C:D:de:f:g:G:hi:I:Kl:LMm:No:O:p:P:qsS:TtuvW");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -260,6 +263,11 @@ int main(int argc, char *argv[])
 		case 'K':
 			params.wpa_debug_show_keys++;
 			break;
+#ifdef CONFIG_DEBUG_BINLOG
+		case 'l':
+			params.wpa_debug_binlog_path = optarg;
+			break;
+#endif /* CONFIG_DEBUG_BINLOG */
 		case 'L':
 			license();
 			exitcode = 0;
@@ -262,6 +262,9 @@ struct mesh_rsn *mesh_rsn_auth_init(struct wpa_supplicant *wpa_s,
 		ret = wpa_auth_pmksa_add_entry(bss->wpa_auth,
 					       entry->pmksa_cache);
 		dl_list_del(&entry->list);
+		/* The PMKSA cache entry is not taken over on failure */
+		if (ret < 0)
+			os_free(entry->pmksa_cache);
 		os_free(entry);
 
 		if (ret < 0)
@@ -1778,6 +1778,7 @@ static void wpas_p2p_add_psk_list(struct wpa_supplicant *wpa_s,
 		hpsk->next = hapd->conf->ssid.wpa_psk;
 		hapd->conf->ssid.wpa_psk = hpsk;
 	}
+	hostapd_wpa_psk_index_update(&hapd->conf->ssid);
 }
 
 
@@ -8881,6 +8882,7 @@ static void wpas_p2p_remove_client_go(struct wpa_supplicant *wpa_s,
 			psk = psk->next;
 		}
 	}
+	hostapd_wpa_psk_index_update(&hapd->conf->ssid);
 
 	/* Disconnect from group */
 	if (iface_addr)
@@ -12,6 +12,7 @@
 #include "utils/eloop.h"
 #include "common/ieee802_11_defs.h"
 #include "common/wpa_ctrl.h"
+#include "crypto/random.h"
 #include "config.h"
 #include "wpa_supplicant_i.h"
 #include "driver_i.h"
@@ -1944,6 +1945,9 @@ const u8 * wpa_scan_get_ie(const struct wpa_scan_res *res, u8 ie)
 {
 	size_t ie_len = res->ie_len;
 
+	if (res->ie_index)
+		return ie_index_get(res->ie_index, (const u8 *) (res + 1), ie);
+
 	/* Use the Beacon frame IEs if res->ie_len is not available */
 	if (!ie_len)
 		ie_len = res->beacon_ie_len;
@@ -1968,6 +1972,8 @@ const u8 * wpa_scan_get_vendor_ie(const struct wpa_scan_res *res,
 	const struct element *elem;
 
 	ies = (const u8 *) (res + 1);
+	if (res->ie_index)
+		return ie_index_get_vendor(res->ie_index, ies, vendor_type);
 
 	for_each_element_id(elem, WLAN_EID_VENDOR_SPECIFIC, ies, res->ie_len) {
 		if (elem->datalen >= 4 &&
@@ -2030,6 +2036,11 @@ struct wpabuf * wpa_scan_get_vendor_ie_multi(const struct wpa_scan_res *res,
 	struct wpabuf *buf;
 	const u8 *end, *pos;
 
+	if (res->ie_index)
+		return ie_index_get_vendor_multi(res->ie_index,
+						 (const u8 *) (res + 1),
+						 vendor_type);
+
 	buf = wpabuf_alloc(res->ie_len);
 	if (buf == NULL)
 		return NULL;
@@ -2060,38 +2071,38 @@ struct wpabuf * wpa_scan_get_vendor_ie_multi(const struct wpa_scan_res *res,
 }
 
 
-/* Compare function for sorting scan results. Return >0 if @b is considered
- * better. */
-static int wpa_scan_result_compar(const void *a, const void *b)
+/* Attributes used for ordering scan results and BSS entries */
+struct scan_sort_key {
+	int wpa;
+	int privacy;
+	int level_dbm;
+	int snr;
+	int level;
+	int qual;
+	unsigned int est_throughput;
+	int freq;
+};
+
+
+static int scan_sort_key_compar(const struct scan_sort_key *wa,
+				const struct scan_sort_key *wb)
 {
 #define MIN(a,b) a < b ? a : b
-	struct wpa_scan_res **_wa = (void *) a;
-	struct wpa_scan_res **_wb = (void *) b;
-	struct wpa_scan_res *wa = *_wa;
-	struct wpa_scan_res *wb = *_wb;
-	int wpa_a, wpa_b;
 	int snr_a, snr_b, snr_a_full, snr_b_full;
 
 	/* WPA/WPA2 support preferred */
-	wpa_a = wpa_scan_get_vendor_ie(wa, WPA_IE_VENDOR_TYPE) != NULL ||
-		wpa_scan_get_ie(wa, WLAN_EID_RSN) != NULL;
-	wpa_b = wpa_scan_get_vendor_ie(wb, WPA_IE_VENDOR_TYPE) != NULL ||
-		wpa_scan_get_ie(wb, WLAN_EID_RSN) != NULL;
-
-	if (wpa_b && !wpa_a)
+	if (wb->wpa && !wa->wpa)
 		return 1;
-	if (!wpa_b && wpa_a)
+	if (!wb->wpa && wa->wpa)
 		return -1;
 
 	/* privacy support preferred */
-	if ((wa->caps & IEEE80211_CAP_PRIVACY) == 0 &&
-	    (wb->caps & IEEE80211_CAP_PRIVACY))
+	if (!wa->privacy && wb->privacy)
 		return 1;
-	if ((wa->caps & IEEE80211_CAP_PRIVACY) &&
-	    (wb->caps & IEEE80211_CAP_PRIVACY) == 0)
+	if (wa->privacy && !wb->privacy)
 		return -1;
 
-	if (wa->flags & wb->flags & WPA_SCAN_LEVEL_DBM) {
+	if (wa->level_dbm && wb->level_dbm) {
 		snr_a_full = wa->snr;
 		snr_a = MIN(wa->snr, GREAT_SNR);
 		snr_b_full = wb->snr;
@@ -2125,6 +2136,62 @@ static int wpa_scan_result_compar(const void *a, const void *b)
 }
 
 
+static void scan_res_sort_key(const struct wpa_scan_res *res,
+			      struct scan_sort_key *key)
+{
+	key->wpa = wpa_scan_get_vendor_ie(res, WPA_IE_VENDOR_TYPE) != NULL ||
+		wpa_scan_get_ie(res, WLAN_EID_RSN) != NULL;
+	key->privacy = !!(res->caps & IEEE80211_CAP_PRIVACY);
+	key->level_dbm = !!(res->flags & WPA_SCAN_LEVEL_DBM);
+	key->snr = res->snr;
+	key->level = res->level;
+	key->qual = res->qual;
+	key->est_throughput = res->est_throughput;
+	key->freq = res->freq;
+}
+
+
+static void bss_sort_key(const struct wpa_bss *bss, struct scan_sort_key *key)
+{
+	key->wpa = wpa_bss_get_vendor_ie(bss, WPA_IE_VENDOR_TYPE) != NULL ||
+		wpa_bss_get_ie(bss, WLAN_EID_RSN) != NULL;
+	key->privacy = !!(bss->caps & IEEE80211_CAP_PRIVACY);
+	key->level_dbm = !!(bss->flags & WPA_BSS_LEVEL_DBM);
+	key->snr = bss->snr;
+	key->level = bss->level;
+	key->qual = bss->qual;
+	key->est_throughput = bss->est_throughput;
+	key->freq = bss->freq;
+}
+
+
+/* Compare function for sorting scan results. Return >0 if @b is considered
+ * better. */
+static int wpa_scan_result_compar(const void *a, const void *b)
+{
+	struct wpa_scan_res **_wa = (void *) a;
+	struct wpa_scan_res **_wb = (void *) b;
+	struct scan_sort_key ka, kb;
+
+	scan_res_sort_key(*_wa, &ka);
+	scan_res_sort_key(*_wb, &kb);
+	return scan_sort_key_compar(&ka, &kb);
+}
+
+
+/* Same ordering as wpa_scan_result_compar(), but for BSS table entries */
+static int wpa_bss_compar(const void *a, const void *b)
+{
+	struct wpa_bss **_wa = (void *) a;
+	struct wpa_bss **_wb = (void *) b;
+	struct scan_sort_key ka, kb;
+
+	bss_sort_key(*_wa, &ka);
+	bss_sort_key(*_wb, &kb);
+	return scan_sort_key_compar(&ka, &kb);
+}
+
+
 #ifdef CONFIG_WPS
 /* Compare function for sorting scan results when searching a WPS AP for
  * provisioning. Return >0 if @b is considered better. */
@@ -2522,7 +2589,7 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 				struct scan_info *info, int new_scan)
 {
 	struct wpa_scan_results *scan_res;
-	size_t i;
+	size_t i, total = 0;
 	int (*compar)(const void *, const void *) = wpa_scan_result_compar;
 
 	scan_res = wpa_drv_get_scan_results2(wpa_s);
@@ -2542,9 +2609,17 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 	for (i = 0; i < scan_res->num; i++) {
 		struct wpa_scan_res *scan_res_item = scan_res->res[i];
 
+		if (scan_res_item->ie_len)
+			scan_res_item->ie_index = ie_index_build(
+				(const u8 *) (scan_res_item + 1),
+				scan_res_item->ie_len);
 		scan_snr(scan_res_item);
 		scan_est_throughput(wpa_s, scan_res_item);
+		total += sizeof(*scan_res_item) + scan_res_item->ie_len +
+			scan_res_item->beacon_ie_len;
 	}
+	wpa_dbg(wpa_s, MSG_DEBUG, "Fetched %zu scan results (%zu bytes)",
+		scan_res->num, total);
 
 #ifdef CONFIG_WPS
 	if (wpas_wps_searching(wpa_s)) {
@@ -2580,6 +2655,141 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 }
 
 
+struct scan_res_stream_ctx {
+	struct wpa_supplicant *wpa_s;
+	struct os_reltime fetch_time;
+	int update_bss;
+	unsigned int num;
+	unsigned int filtered;
+	size_t max_len;
+};
+
+
+static void wpa_supplicant_scan_res_stream_cb(void *ctx,
+					      struct wpa_scan_res *res)
+{
+	struct scan_res_stream_ctx *stream = ctx;
+	struct wpa_supplicant *wpa_s = stream->wpa_s;
+	size_t len;
+
+	if (!res) {
+		/* Driver restarted the fetch; start a new BSS table update */
+		if (stream->update_bss)
+			wpa_bss_update_start(wpa_s);
+		stream->num = 0;
+		stream->filtered = 0;
+		return;
+	}
+
+	if (!wpa_supplicant_filter_bssid_match(wpa_s, res->bssid)) {
+		stream->filtered++;
+		return;
+	}
+
+#ifndef CONFIG_NO_RANDOM_POOL
+	if (stream->num < 10) {
+		u8 buf[5];
+
+		buf[0] = res->bssid[5];
+		buf[1] = res->qual & 0xff;
+		buf[2] = res->noise & 0xff;
+		buf[3] = res->level & 0xff;
+		buf[4] = res->tsf & 0xff;
+		random_add_randomness(buf, sizeof(buf));
+	}
+#endif /* CONFIG_NO_RANDOM_POOL */
+
+	stream->num++;
+	len = sizeof(*res) + res->ie_len + res->beacon_ie_len;
+	if (len > stream->max_len)
+		stream->max_len = len;
+
+	scan_snr(res);
+	scan_est_throughput(wpa_s, res);
+	if (stream->update_bss)
+		wpa_bss_update_scan_res(wpa_s, res, &stream->fetch_time);
+}
+
+
+/**
+ * wpa_supplicant_stream_scan_results - Merge scan results into the BSS table
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @info: Information about what was scanned or %NULL if not available
+ * @new_scan: Whether a new scan was performed
+ * Returns: Empty scan results on success, %NULL on failure
+ *
+ * This is a variant of wpa_supplicant_get_scan_results() that merges each scan
+ * result into the BSS table as soon as the driver reports it instead of
+ * collecting the full list first. Only a single scan result is held in memory
+ * at a time. The returned structure carries the fetch time, but no entries, so
+ * this is only suitable for callers that use the BSS table afterwards. If the
+ * driver does not support streaming, this falls back to
+ * wpa_supplicant_get_scan_results() and the full list is returned.
+ */
+struct wpa_scan_results *
+wpa_supplicant_stream_scan_results(struct wpa_supplicant *wpa_s,
+				   struct scan_info *info, int new_scan)
+{
+	struct wpa_scan_results *scan_res;
+	struct scan_res_stream_ctx stream;
+
+	if (!wpa_s->driver->get_scan_results_cb)
+		return wpa_supplicant_get_scan_results(wpa_s, info, new_scan);
+
+	scan_res = os_zalloc(sizeof(*scan_res));
+	if (!scan_res)
+		return NULL;
+
+	os_memset(&stream, 0, sizeof(stream));
+	stream.wpa_s = wpa_s;
+	os_get_reltime(&stream.fetch_time);
+	scan_res->fetch_time = stream.fetch_time;
+
+	if (wpa_s->ignore_post_flush_scan_res) {
+		/* FLUSH command aborted an ongoing scan and these are the
+		 * results from the aborted scan. Do not process the results to
+		 * maintain flushed state. */
+		wpa_dbg(wpa_s, MSG_DEBUG,
+			"Do not update BSS table based on pending post-FLUSH scan results");
+		wpa_s->ignore_post_flush_scan_res = 0;
+	} else {
+		stream.update_bss = 1;
+		wpa_bss_update_start(wpa_s);
+	}
+
+	if (wpa_drv_get_scan_results_cb(wpa_s,
+					wpa_supplicant_scan_res_stream_cb,
+					&stream) < 0) {
+		wpa_dbg(wpa_s, MSG_DEBUG, "Failed to get scan results");
+		if (stream.update_bss) {
+			/* Finish the update round with the entries received so
+			 * far, but do not expire anything based on an
+			 * incomplete list. */
+			wpa_bss_update_sort(wpa_s, wpa_bss_compar);
+			wpa_bss_update_end(wpa_s, info, 0);
+		}
+		os_free(scan_res);
+		return NULL;
+	}
+
+	if (stream.filtered)
+		wpa_printf(MSG_DEBUG, "Filtered out %u scan results",
+			   stream.filtered);
+	wpa_dbg(wpa_s, MSG_DEBUG,
+		"Streamed %u scan results into the BSS table (largest entry %zu bytes)",
+		stream.num, stream.max_len);
+
+	if (!stream.update_bss)
+		return scan_res;
+
+	/* Keep the same preference order as the sorted scan result list */
+	wpa_bss_update_sort(wpa_s, wpa_bss_compar);
+	wpa_bss_update_end(wpa_s, info, new_scan);
+
+	return scan_res;
+}
+
+
 /**
  * wpa_supplicant_update_scan_results - Update scan results from the driver
  * @wpa_s: Pointer to wpa_supplicant data
@@ -2595,7 +2805,10 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 int wpa_supplicant_update_scan_results(struct wpa_supplicant *wpa_s)
 {
 	struct wpa_scan_results *scan_res;
-	scan_res = wpa_supplicant_get_scan_results(wpa_s, NULL, 0);
+	if (wpa_s->conf->scan_res_stream && !wpas_wps_searching(wpa_s))
+		scan_res = wpa_supplicant_stream_scan_results(wpa_s, NULL, 0);
+	else
+		scan_res = wpa_supplicant_get_scan_results(wpa_s, NULL, 0);
 	if (scan_res == NULL)
 		return -1;
 	wpa_scan_results_free(scan_res);
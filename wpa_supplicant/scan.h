@@ -47,6 +47,9 @@ int wpa_supplicant_trigger_scan(struct wpa_supplicant *wpa_s,
 struct wpa_scan_results *
 wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 				struct scan_info *info, int new_scan);
+struct wpa_scan_results *
+wpa_supplicant_stream_scan_results(struct wpa_supplicant *wpa_s,
+				   struct scan_info *info, int new_scan);
 int wpa_supplicant_update_scan_results(struct wpa_supplicant *wpa_s);
 const u8 * wpa_scan_get_ie(const struct wpa_scan_res *res, u8 ie);
 const u8 * wpa_scan_get_vendor_ie(const struct wpa_scan_res *res,
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+#
+# Convert a binary debug log (wpa_supplicant/hostapd -l <file>) to text
+#
+# This software may be distributed under the terms of the BSD license.
+# See README for more details.
+
+import sys, struct
+
+REC_FMT = 1
+REC_MSG = 2
+REC_TEXT = 3
+REC_HEXDUMP = 4
+REC_DROPPED = 5
+
+HEXDUMP_SHOW = 0x1
+HEXDUMP_NULL = 0x2
+HEXDUMP_ASCII = 0x4
+
+def parse_spec(fmt, i):
+    """Parse a conversion specification starting after '%'. Returns the
+    flags, width, precision, conversion character, and the index after the
+    specification. Width/precision are '*' when given as arguments."""
+    start = i
+    while i < len(fmt) and fmt[i] in "-+ #0'":
+        i += 1
+    flags = fmt[start:i].replace("'", "")
+    width = ''
+    if i < len(fmt) and fmt[i] == '*':
+        width = '*'
+        i += 1
+    else:
+        while i < len(fmt) and fmt[i].isdigit():
+            width += fmt[i]
+            i += 1
+    prec = None
+    if i < len(fmt) and fmt[i] == '.':
+        i += 1
+        if i < len(fmt) and fmt[i] == '*':
+            prec = '*'
+            i += 1
+        else:
+            prec = ''
+            while i < len(fmt) and fmt[i].isdigit():
+                prec += fmt[i]
+                i += 1
+            if not prec:
+                prec = '0'
+    while i < len(fmt) and fmt[i] in 'hlqjztL':
+        i += 1
+    conv = fmt[i] if i < len(fmt) else ''
+    return flags, width, prec, conv, i + 1
+
+class Args(object):
+    def __init__(self, data, endian):
+        self.data = data
+        self.pos = 0
+        self.endian = endian
+
+    def next(self):
+        tag = chr(self.data[self.pos])
+        self.pos += 1
+        if tag == 'i':
+            val, = struct.unpack_from(self.endian + 'q', self.data, self.pos)
+            self.pos += 8
+        elif tag in 'up':
+            val, = struct.unpack_from(self.endian + 'Q', self.data, self.pos)
+            self.pos += 8
+        elif tag == 'd':
+            val, = struct.unpack_from(self.endian + 'd', self.data, self.pos)
+            self.pos += 8
+        elif tag == 's':
+            slen, = struct.unpack_from(self.endian + 'H', self.data, self.pos)
+            self.pos += 2
+            val = self.data[self.pos:self.pos + slen].decode('latin-1')
+            self.pos += slen
+        else:
+            raise ValueError("Unknown argument tag %r" % tag)
+        return val
+
+def format_msg(fmt, args):
+    out = []
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        if c != '%':
+            out.append(c)
+            i += 1
+            continue
+        if fmt[i + 1:i + 2] == '%':
+            out.append('%')
+            i += 2
+            continue
+        flags, width, prec, conv, i = parse_spec(fmt, i + 1)
+        if width == '*':
+            width = args.next()
+            if width < 0:
+                flags += '-'
+                width = -width
+            width = str(width)
+        if prec == '*':
+            prec = args.next()
+            prec = str(prec) if prec >= 0 else None
+        val = args.next()
+        if conv == 'p':
+            val = '0x%x' % val if val else '(nil)'
+            conv = 's'
+            prec = None
+        elif conv == 'c':
+            val = chr(val & 0xff)
+            conv = 's'
+        elif conv in 'aA':
+            val = float.hex(val)
+            conv = 's'
+        elif conv == 'u':
+            conv = 'd'
+        spec = '%' + flags + width
+        if prec is not None:
+            spec += '.' + prec
+        out.append((spec + conv) % val)
+    return ''.join(out)
+
+def format_hexdump(title, flags, length, data):
+    ascii = flags & HEXDUMP_ASCII
+    name = 'hexdump_ascii' if ascii else 'hexdump'
+    hdr = '%s - %s(len=%d):' % (title, name, length)
+    if flags & HEXDUMP_NULL:
+        return hdr + ' [NULL]'
+    if not flags & HEXDUMP_SHOW:
+        return hdr + ' [REMOVED]'
+    more = ' ...' if len(data) < length else ''
+    if not ascii:
+        return hdr + ''.join(' %02x' % b for b in data) + more
+    lines = [hdr]
+    for pos in range(0, len(data), 16):
+        chunk = data[pos:pos + 16]
+        line = '    ' + ''.join(' %02x' % b for b in chunk)
+        line += '   ' * (16 - len(chunk)) + '   '
+        line += ''.join(chr(b) if 32 <= b < 127 else '_' for b in chunk)
+        line += ' ' * (16 - len(chunk))
+        lines.append(line)
+    if more:
+        lines.append('    ...')
+    return '\n'.join(lines)
+
+def decode(f, out, min_level=0, timestamps=True):
+    hdr = f.read(16)
+    if len(hdr) < 16 or hdr[0:8] != b'WPABLOG\n':
+        raise ValueError("Not a binary debug log file")
+    if struct.unpack('<I', hdr[12:16])[0] == 0x01020304:
+        endian = '<'
+    else:
+        endian = '>'
+    version, = struct.unpack(endian + 'I', hdr[8:12])
+    if version != 1:
+        raise ValueError("Unsupported binary log version %d" % version)
+
+    strings = {}
+    while True:
+        rec = f.read(24)
+        if len(rec) < 24:
+            break
+        rlen, rtype, level, thread, rid, usec, sec = \
+            struct.unpack(endian + 'IBBHIIQ', rec)
+        if rlen < 24:
+            raise ValueError("Invalid record length %d" % rlen)
+        data = f.read(rlen - 24)
+        if len(data) < rlen - 24:
+            break
+
+        if rtype == REC_FMT:
+            strings[rid] = data[:data.index(b'\0')].decode('latin-1')
+            continue
+        if level < min_level:
+            continue
+
+        if rtype == REC_MSG:
+            fmt = strings.get(rid)
+            if fmt is None:
+                txt = '[unknown format string %d]' % rid
+            else:
+                try:
+                    txt = format_msg(fmt, Args(data, endian))
+                except Exception as e:
+                    txt = '[could not decode "%s": %s]' % (fmt, e)
+        elif rtype == REC_TEXT:
+            txt = data[:data.index(b'\0')].decode('latin-1')
+        elif rtype == REC_HEXDUMP:
+            flags, length, dlen = struct.unpack_from(endian + 'III', data)
+            title = strings.get(rid, '[unknown title %d]' % rid)
+            txt = format_hexdump(title, flags, length, data[12:12 + dlen])
+        elif rtype == REC_DROPPED:
+            txt = 'binlog: %d message(s) dropped due to a full buffer' % rid
+        else:
+            continue
+
+        prefix = ''
+        if timestamps:
+            prefix = '%d.%06u: ' % (sec, usec)
+        if thread:
+            prefix += '[thread %d] ' % thread
+        out.write((prefix + txt + '\n').encode('latin-1'))
+
+def main():
+    import argparse
+    parser = argparse.ArgumentParser(
+        description='Convert a binary debug log to text')
+    parser.add_argument('file', help='binary debug log file')
+    parser.add_argument('-l', '--level', type=int, default=0,
+                        help='minimum debug level (0 = MSG_EXCESSIVE)')
+    parser.add_argument('-n', '--no-timestamps', action='store_true',
+                        help='do not include timestamps')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        decode(f, sys.stdout.buffer, args.level, not args.no_timestamps)
+
+if __name__ == "__main__":
+    main()
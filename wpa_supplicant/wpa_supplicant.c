@@ -7236,6 +7236,9 @@ struct wpa_global * wpa_supplicant_init(struct wpa_params *params)
 			return NULL;
 		}
 	}
+	if (params->wpa_debug_binlog_path &&
+	    wpa_debug_open_binlog(params->wpa_debug_binlog_path) < 0)
+		return NULL;
 
 	ret = eap_register_methods();
 	if (ret) {
@@ -7425,6 +7428,10 @@ void wpa_supplicant_deinit(struct wpa_global *global)
 	}
 	os_free(global->drv_priv);
 
+#ifdef CONFIG_SAE
+	sae_pt_cache_flush();
+#endif /* CONFIG_SAE */
+
 	random_deinit();
 
 	eloop_destroy();
@@ -7452,6 +7459,7 @@ void wpa_supplicant_deinit(struct wpa_global *global)
 	os_free(global->add_psk);
 
 	os_free(global);
+	wpa_debug_close_binlog();
 	wpa_debug_close_syslog();
 	wpa_debug_close_file();
 	wpa_debug_close_linux_tracing();
@@ -8548,6 +8556,33 @@ int wpa_drv_signal_poll(struct wpa_supplicant *wpa_s,
 }
 
 
+#ifdef CONFIG_TESTING_OPTIONS
+static void wpa_drv_scan_res_override(struct wpa_supplicant *wpa_s,
+				      struct wpa_scan_res *res)
+{
+	struct driver_signal_override *dso;
+
+	dl_list_for_each(dso, &wpa_s->drv_signal_override,
+			 struct driver_signal_override, list) {
+		if (os_memcmp(res->bssid, dso->bssid, ETH_ALEN) != 0)
+			continue;
+		wpa_printf(MSG_DEBUG,
+			   "Override driver scan signal level %d->%d for "
+			   MACSTR,
+			   res->level, dso->scan_level,
+			   MAC2STR(res->bssid));
+		res->flags |= WPA_SCAN_QUAL_INVALID;
+		if (dso->scan_level < 0)
+			res->flags |= WPA_SCAN_LEVEL_DBM;
+		else
+			res->flags &= ~WPA_SCAN_LEVEL_DBM;
+		res->level = dso->scan_level;
+		break;
+	}
+}
+#endif /* CONFIG_TESTING_OPTIONS */
+
+
 struct wpa_scan_results *
 wpa_drv_get_scan_results2(struct wpa_supplicant *wpa_s)
 {
@@ -8562,29 +8597,44 @@ wpa_drv_get_scan_results2(struct wpa_supplicant *wpa_s)
 	scan_res = wpa_s->driver->get_scan_results2(wpa_s->drv_priv);
 
 #ifdef CONFIG_TESTING_OPTIONS
-	for (idx = 0; scan_res && idx < scan_res->num; idx++) {
-		struct driver_signal_override *dso;
-		struct wpa_scan_res *res = scan_res->res[idx];
-
-		dl_list_for_each(dso, &wpa_s->drv_signal_override,
-				 struct driver_signal_override, list) {
-			if (os_memcmp(res->bssid, dso->bssid, ETH_ALEN) != 0)
-				continue;
-			wpa_printf(MSG_DEBUG,
-				   "Override driver scan signal level %d->%d for "
-				   MACSTR,
-				   res->level, dso->scan_level,
-				   MAC2STR(res->bssid));
-			res->flags |= WPA_SCAN_QUAL_INVALID;
-			if (dso->scan_level < 0)
-				res->flags |= WPA_SCAN_LEVEL_DBM;
-			else
-				res->flags &= ~WPA_SCAN_LEVEL_DBM;
-			res->level = dso->scan_level;
-			break;
-		}
-	}
+	for (idx = 0; scan_res && idx < scan_res->num; idx++)
+		wpa_drv_scan_res_override(wpa_s, scan_res->res[idx]);
 #endif /* CONFIG_TESTING_OPTIONS */
 
 	return scan_res;
 }
+
+
+struct wpa_drv_scan_res_cb_ctx {
+	struct wpa_supplicant *wpa_s;
+	void (*cb)(void *ctx, struct wpa_scan_res *res);
+	void *ctx;
+};
+
+static void wpa_drv_scan_res_cb(void *ctx, struct wpa_scan_res *res)
+{
+	struct wpa_drv_scan_res_cb_ctx *cb_ctx = ctx;
+
+#ifdef CONFIG_TESTING_OPTIONS
+	if (res)
+		wpa_drv_scan_res_override(cb_ctx->wpa_s, res);
+#endif /* CONFIG_TESTING_OPTIONS */
+	cb_ctx->cb(cb_ctx->ctx, res);
+}
+
+
+int wpa_drv_get_scan_results_cb(struct wpa_supplicant *wpa_s,
+				void (*cb)(void *ctx, struct wpa_scan_res *res),
+				void *ctx)
+{
+	struct wpa_drv_scan_res_cb_ctx cb_ctx;
+
+	if (!wpa_s->driver->get_scan_results_cb)
+		return -1;
+
+	cb_ctx.wpa_s = wpa_s;
+	cb_ctx.cb = cb;
+	cb_ctx.ctx = ctx;
+	return wpa_s->driver->get_scan_results_cb(wpa_s->drv_priv,
+						  wpa_drv_scan_res_cb, &cb_ctx);
+}
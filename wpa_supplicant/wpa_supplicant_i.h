@@ -207,6 +207,11 @@ struct wpa_params {
 	 */
 	int wpa_debug_tracing;
 
+	/**
+	 * wpa_debug_binlog_path - Path of binary debug log file or %NULL
+	 */
+	const char *wpa_debug_binlog_path;
+
 	/**
 	 * override_driver - Optional driver parameter override
 	 *
@@ -791,6 +796,11 @@ struct wpa_supplicant {
 	void (*scan_res_fail_handler)(struct wpa_supplicant *wpa_s);
 	struct dl_list bss; /* struct wpa_bss::list */
 	struct dl_list bss_id; /* struct wpa_bss::list_id */
+#define WPA_BSS_HASH_SIZE 256
+	/* struct wpa_bss::list_hash, hashed by BSSID */
+	struct dl_list bss_hash[WPA_BSS_HASH_SIZE];
+	/* struct wpa_bss::list_id_hash, hashed by id */
+	struct dl_list bss_id_hash[WPA_BSS_HASH_SIZE];
 	size_t num_bss;
 	unsigned int bss_update_idx;
 	unsigned int bss_next_id;
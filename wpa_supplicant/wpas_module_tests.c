@@ -10,8 +10,13 @@
 
 #include "utils/common.h"
 #include "utils/module_tests.h"
+#include "common/ieee802_11_defs.h"
+#include "drivers/driver.h"
 #include "wpa_supplicant_i.h"
+#include "config.h"
 #include "bssid_ignore.h"
+#include "bss.h"
+#include "scan.h"
 
 
 static int wpas_bssid_ignore_module_tests(void)
@@ -87,6 +92,389 @@ fail:
 }
 
 
+static void wpas_bss_test_bssid(unsigned int i, u8 *bssid)
+{
+	bssid[0] = 0x02;
+	bssid[1] = 0x00;
+	bssid[2] = 0x00;
+	bssid[3] = i >> 16;
+	bssid[4] = i >> 8;
+	bssid[5] = i;
+}
+
+
+static int wpas_bss_module_tests(void)
+{
+	struct wpa_supplicant *wpa_s;
+	struct wpa_global global;
+	struct wpa_config conf;
+	struct wpa_radio radio;
+	struct wpa_scan_res *res;
+	struct wpa_bss *bss;
+	struct os_reltime fetch_time, start, end;
+	const unsigned int num = 1000;
+	unsigned int i, round;
+	u8 bssid[ETH_ALEN], *ie;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "BSS table tests");
+
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&conf, 0, sizeof(conf));
+	conf.bss_max_count = num;
+	conf.bss_expiration_scan_count = 2;
+	os_memset(&radio, 0, sizeof(radio));
+	dl_list_init(&radio.ifaces);
+	dl_list_init(&radio.work);
+
+	wpa_s = os_zalloc(sizeof(*wpa_s));
+	res = os_zalloc(sizeof(*res) + 2 + 4 + 2 + 10);
+	if (!wpa_s || !res)
+		goto fail;
+	wpa_s->global = &global;
+	wpa_s->conf = &conf;
+	wpa_s->radio = &radio;
+	wpa_s->p2p_mgmt = 1; /* skip BSS notifications */
+	if (wpa_bss_init(wpa_s) < 0)
+		goto fail;
+
+	ie = (u8 *) (res + 1);
+	*ie++ = WLAN_EID_SSID;
+	*ie++ = 4;
+	os_memcpy(ie, "test", 4);
+	res->ie_len = 2 + 4;
+	res->freq = 2412;
+
+	/*
+	 * Fill the table and then merge a second scan with the same BSSes in
+	 * reverse order so that each lookup would need to go through most of
+	 * the list without an index.
+	 */
+	for (round = 0; round < 2; round++) {
+		os_get_reltime(&start);
+		os_get_reltime(&fetch_time);
+		wpa_bss_update_start(wpa_s);
+		for (i = 0; i < num; i++) {
+			wpas_bss_test_bssid(round ? num - 1 - i : i,
+					    res->bssid);
+			res->level = -50 - (int) round;
+			wpa_bss_update_scan_res(wpa_s, res, &fetch_time);
+		}
+		wpa_bss_update_end(wpa_s, NULL, 1);
+		os_get_reltime(&end);
+		os_reltime_sub(&end, &start, &end);
+		wpa_printf(MSG_INFO,
+			   "BSS table: merged %u scan results into %zu entries in %u.%06u s",
+			   num, wpa_s->num_bss, (unsigned int) end.sec,
+			   (unsigned int) end.usec);
+	}
+
+	if (wpa_s->num_bss != num ||
+	    wpa_s->last_scan_res_used != num)
+		goto fail;
+
+	for (i = 0; i < num; i++) {
+		wpas_bss_test_bssid(i, bssid);
+		bss = wpa_bss_get(wpa_s, bssid, (const u8 *) "test", 4);
+		if (!bss || bss->level != -51 ||
+		    wpa_bss_get_bssid(wpa_s, bssid) != bss ||
+		    wpa_bss_get_bssid_latest(wpa_s, bssid) != bss ||
+		    wpa_bss_get_id(wpa_s, bss->id) != bss ||
+		    wpa_bss_get(wpa_s, bssid, (const u8 *) "tes", 3))
+			goto fail;
+	}
+
+	/* Grow the IEs of an entry to force reallocation */
+	wpas_bss_test_bssid(10, res->bssid);
+	ie = (u8 *) (res + 1) + res->ie_len;
+	*ie++ = WLAN_EID_EXT_CAPAB;
+	*ie++ = 8;
+	os_memset(ie, 0, 8);
+	res->ie_len += 2 + 8;
+	wpa_bss_update_start(wpa_s);
+	wpa_bss_update_scan_res(wpa_s, res, &fetch_time);
+	res->ie_len -= 2 + 8;
+	bss = wpa_bss_get(wpa_s, res->bssid, (const u8 *) "test", 4);
+	if (!bss || bss->ie_len != 2 + 4 + 2 + 8 ||
+	    wpa_bss_get_bssid(wpa_s, res->bssid) != bss ||
+	    wpa_bss_get_id(wpa_s, bss->id) != bss)
+		goto fail;
+
+	/* Exceed bss_max_count to force removal of the oldest entries */
+	for (i = num; i < num + 100; i++) {
+		wpas_bss_test_bssid(i, res->bssid);
+		wpa_bss_update_scan_res(wpa_s, res, &fetch_time);
+	}
+	if (wpa_s->num_bss != num)
+		goto fail;
+	for (i = num - 101; i < num; i++) {
+		wpas_bss_test_bssid(i, bssid);
+		bss = wpa_bss_get_bssid(wpa_s, bssid);
+		if ((i == num - 101) != !!bss ||
+		    wpa_bss_get_id(wpa_s, i) != bss)
+			goto fail;
+	}
+
+	ret = 0;
+fail:
+	if (wpa_s) {
+		wpa_bss_deinit(wpa_s);
+		os_free(wpa_s->last_scan_res);
+		os_free(wpa_s);
+	}
+	os_free(res);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "BSS table module test failure");
+
+	return ret;
+}
+
+
+#define WPAS_SCAN_TEST_NUM 8
+
+struct wpas_scan_test_drv {
+	/* Scan results in driver order and one BSS that is not in the scan */
+	struct wpa_scan_res *res[WPAS_SCAN_TEST_NUM + 1];
+	unsigned int restart_after;
+	unsigned int fail_after;
+};
+
+
+static struct wpa_scan_results * wpas_scan_test_get(void *priv)
+{
+	struct wpas_scan_test_drv *drv = priv;
+	struct wpa_scan_results *res;
+	size_t i;
+
+	res = os_zalloc(sizeof(*res));
+	if (!res)
+		return NULL;
+	res->res = os_calloc(WPAS_SCAN_TEST_NUM, sizeof(struct wpa_scan_res *));
+	if (!res->res)
+		goto fail;
+	for (i = 0; i < WPAS_SCAN_TEST_NUM; i++) {
+		res->res[i] = os_memdup(drv->res[i], sizeof(struct wpa_scan_res) +
+					drv->res[i]->ie_len);
+		if (!res->res[i])
+			goto fail;
+		res->num++;
+	}
+	return res;
+fail:
+	wpa_scan_results_free(res);
+	return NULL;
+}
+
+
+static int wpas_scan_test_get_cb(void *priv,
+				 void (*cb)(void *ctx, struct wpa_scan_res *res),
+				 void *ctx)
+{
+	struct wpas_scan_test_drv *drv = priv;
+	struct wpa_scan_res *r;
+	unsigned int i;
+
+	for (i = 0; i < WPAS_SCAN_TEST_NUM; i++) {
+		if (drv->fail_after && i == drv->fail_after)
+			return -1;
+		if (drv->restart_after && i == drv->restart_after) {
+			/* Inconsistent dump; drop what was reported so far */
+			drv->restart_after = 0;
+			cb(ctx, NULL);
+			i = 0;
+		}
+		r = os_memdup(drv->res[i], sizeof(struct wpa_scan_res) +
+			      drv->res[i]->ie_len);
+		if (!r)
+			return -1;
+		cb(ctx, r);
+		os_free(r);
+	}
+
+	return WPAS_SCAN_TEST_NUM;
+}
+
+
+static const struct wpa_driver_ops wpas_scan_test_ops = {
+	.name = "scan_test",
+	.get_scan_results2 = wpas_scan_test_get,
+	.get_scan_results_cb = wpas_scan_test_get_cb,
+};
+
+
+static struct wpa_supplicant *
+wpas_scan_test_init(struct wpa_global *global, struct wpa_config *conf,
+		    struct wpa_radio *radio, struct wpas_scan_test_drv *drv)
+{
+	struct wpa_supplicant *wpa_s;
+	struct os_reltime fetch_time;
+
+	wpa_s = os_zalloc(sizeof(*wpa_s));
+	if (!wpa_s)
+		return NULL;
+	wpa_s->global = global;
+	wpa_s->conf = conf;
+	wpa_s->radio = radio;
+	wpa_s->driver = &wpas_scan_test_ops;
+	wpa_s->drv_priv = drv;
+	wpa_s->p2p_mgmt = 1; /* skip BSS notifications */
+#ifdef CONFIG_TESTING_OPTIONS
+	dl_list_init(&wpa_s->drv_signal_override);
+#endif /* CONFIG_TESTING_OPTIONS */
+	if (wpa_bss_init(wpa_s) < 0) {
+		os_free(wpa_s);
+		return NULL;
+	}
+
+	/* Start with two BSSes from the scan and one that is not in it */
+	os_get_reltime(&fetch_time);
+	wpa_bss_update_start(wpa_s);
+	wpa_bss_update_scan_res(wpa_s, drv->res[WPAS_SCAN_TEST_NUM],
+				&fetch_time);
+	wpa_bss_update_scan_res(wpa_s, drv->res[1], &fetch_time);
+	wpa_bss_update_scan_res(wpa_s, drv->res[2], &fetch_time);
+	wpa_bss_update_end(wpa_s, NULL, 0);
+
+	return wpa_s;
+}
+
+
+static void wpas_scan_test_deinit(struct wpa_supplicant *wpa_s)
+{
+	if (!wpa_s)
+		return;
+	wpa_bss_deinit(wpa_s);
+	os_free(wpa_s->last_scan_res);
+	os_free(wpa_s);
+}
+
+
+/* Last octets of the BSSIDs in BSS list order followed by last_scan_res */
+static size_t wpas_scan_test_order(struct wpa_supplicant *wpa_s, u8 *order,
+				   size_t len)
+{
+	struct wpa_bss *bss;
+	size_t i, pos = 0;
+
+	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+		if (pos < len)
+			order[pos++] = bss->bssid[5];
+	}
+	for (i = 0; i < wpa_s->last_scan_res_used; i++) {
+		if (pos < len)
+			order[pos++] = wpa_s->last_scan_res[i]->bssid[5];
+	}
+
+	return pos;
+}
+
+
+static int wpas_scan_stream_module_tests(void)
+{
+	struct wpa_supplicant *wpa_s = NULL;
+	struct wpa_global global;
+	struct wpa_config conf;
+	struct wpa_radio radio;
+	struct wpas_scan_test_drv drv;
+	struct wpa_scan_results *scan_res;
+	u8 sorted[2 * WPAS_SCAN_TEST_NUM + 1], order[sizeof(sorted)];
+	size_t sorted_len, order_len;
+	unsigned int i;
+	u8 *ie;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "Scan result streaming tests");
+
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&conf, 0, sizeof(conf));
+	conf.bss_max_count = 200;
+	conf.bss_expiration_scan_count = 1;
+	os_memset(&radio, 0, sizeof(radio));
+	dl_list_init(&radio.ifaces);
+	dl_list_init(&radio.work);
+	os_memset(&drv, 0, sizeof(drv));
+
+	for (i = 0; i <= WPAS_SCAN_TEST_NUM; i++) {
+		drv.res[i] = os_zalloc(sizeof(struct wpa_scan_res) + 2 + 4);
+		if (!drv.res[i])
+			goto fail;
+		wpas_bss_test_bssid(i, drv.res[i]->bssid);
+		drv.res[i]->freq = 2412;
+		/* Distinct levels that are not in driver order */
+		drv.res[i]->level = 10 + 10 * ((i * 3) % WPAS_SCAN_TEST_NUM);
+		ie = (u8 *) (drv.res[i] + 1);
+		*ie++ = WLAN_EID_SSID;
+		*ie++ = 4;
+		os_memcpy(ie, "test", 4);
+		drv.res[i]->ie_len = 2 + 4;
+	}
+	drv.res[WPAS_SCAN_TEST_NUM - 1]->caps |= IEEE80211_CAP_PRIVACY;
+
+	/* Reference: the sorted scan result list merged in one go */
+	wpa_s = wpas_scan_test_init(&global, &conf, &radio, &drv);
+	if (!wpa_s)
+		goto fail;
+	scan_res = wpa_supplicant_get_scan_results(wpa_s, NULL, 1);
+	if (!scan_res)
+		goto fail;
+	wpa_scan_results_free(scan_res);
+	sorted_len = wpas_scan_test_order(wpa_s, sorted, sizeof(sorted));
+	if (sorted_len != 2 * WPAS_SCAN_TEST_NUM ||
+	    sorted[0] != WPAS_SCAN_TEST_NUM - 1)
+		goto fail;
+	wpas_scan_test_deinit(wpa_s);
+	wpa_s = NULL;
+
+	/* Streaming in driver order, with a restarted dump, must leave the BSS
+	 * table in the same order */
+	wpa_s = wpas_scan_test_init(&global, &conf, &radio, &drv);
+	if (!wpa_s)
+		goto fail;
+	drv.restart_after = 3;
+	scan_res = wpa_supplicant_stream_scan_results(wpa_s, NULL, 1);
+	if (!scan_res || scan_res->num)
+		goto fail;
+	wpa_scan_results_free(scan_res);
+	order_len = wpas_scan_test_order(wpa_s, order, sizeof(order));
+	if (order_len != sorted_len ||
+	    os_memcmp(order, sorted, sorted_len) != 0)
+		goto fail;
+	wpas_scan_test_deinit(wpa_s);
+	wpa_s = NULL;
+
+	/* A failed dump completes the update with the partial results, but
+	 * does not expire entries that were not reported */
+	wpa_s = wpas_scan_test_init(&global, &conf, &radio, &drv);
+	if (!wpa_s)
+		goto fail;
+	drv.fail_after = 5;
+	if (wpa_supplicant_stream_scan_results(wpa_s, NULL, 1) ||
+	    wpa_s->num_bss != 6 || wpa_s->last_scan_res_used != 5 ||
+	    !wpa_bss_get_bssid(wpa_s, drv.res[WPAS_SCAN_TEST_NUM]->bssid))
+		goto fail;
+	for (i = 1; i < wpa_s->last_scan_res_used; i++) {
+		if (wpa_s->last_scan_res[i - 1]->level <=
+		    wpa_s->last_scan_res[i]->level)
+			goto fail;
+	}
+	if (dl_list_last(&wpa_s->bss, struct wpa_bss, list) !=
+	    wpa_s->last_scan_res[4])
+		goto fail;
+
+	ret = 0;
+fail:
+	wpas_scan_test_deinit(wpa_s);
+	for (i = 0; i <= WPAS_SCAN_TEST_NUM; i++)
+		os_free(drv.res[i]);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "Scan result streaming module test failure");
+
+	return ret;
+}
+
+
 int wpas_module_tests(void)
 {
 	int ret = 0;
@@ -96,6 +484,12 @@ int wpas_module_tests(void)
 	if (wpas_bssid_ignore_module_tests() < 0)
 		ret = -1;
 
+	if (wpas_bss_module_tests() < 0)
+		ret = -1;
+
+	if (wpas_scan_stream_module_tests() < 0)
+		ret = -1;
+
 #ifdef CONFIG_WPS
 	if (wps_module_tests() < 0)
 		ret = -1;